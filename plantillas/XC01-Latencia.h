@@ -0,0 +1,235 @@
+/*
+ * ===================================================================
+ * LATENCIA DEL loop() DEL XC01 (CONTADOR DE CICLOS)
+ *
+ * Mide cuánto tarda cada pieza del loop() (Blynk.run(),
+ * scheduler.run(), cada callback de un timer...) con el contador de
+ * ciclos del ESP32-S3 y lo acumula en un histograma fijo por pieza:
+ *
+ *   <10 µs  <100 µs  <1 ms  <10 ms  <100 ms  <1 s  <10 s  >=10 s
+ *
+ * Cada pieza tiene un presupuesto: si una llamada tarda más, se cuenta
+ * como bloqueo y se imprime en ese momento ("[LAT] Bloqueo: ...") si
+ * es el peor de esa pieza en la ventana (durante una caída de red no
+ * se llena el monitor). Un bloqueo largo es lo que hace que Blynk
+ * pierda su latido: así se ve QUIÉN fue y cuánto tardó.
+ *
+ * Uso:
+ *   static XC01LatSlot *latBlynk;
+ *   latBlynk = xc01LatSlot("Blynk.run", 500000UL);       // setup()
+ *   XC01_LAT_TIME(latBlynk, Blynk.run());                // loop()
+ *   scheduler.setInterval(1000, XC01_LAT_TIMED(tarea));  // un timer
+ *   xc01LatLoop(latLoop);       // Al inicio de loop(): tiempo entre vueltas
+ *
+ * El contador de 32 bits da la vuelta cada ~17.9 s a 240 MHz; lo que
+ * tarda más de XC01_LAT_LONG_MS se mide con los ticks de FreeRTOS
+ * (resolución de 1 ms). Medir una pieza cuesta unas decenas de ciclos.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define XC01_LAT_MAX_SLOTS 12
+#define XC01_LAT_BUCKETS 8             // Décadas de 10 µs a 10 s
+#define XC01_LAT_BUDGET_US 500000UL    // Presupuesto por defecto (500 ms)
+#define XC01_LAT_LONG_MS 10000UL       // Más que esto: con ticks de FreeRTOS
+
+typedef struct {
+    const char *name;
+    uint32_t budgetUs;          // Más que esto es un bloqueo
+    uint32_t count;
+    uint32_t stalls;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t buckets[XC01_LAT_BUCKETS];
+} XC01LatSlot;
+
+typedef struct {
+    uint32_t cycles;
+    TickType_t ticks;
+} XC01LatMark;
+
+static XC01LatSlot xc01LatSlots[XC01_LAT_MAX_SLOTS];
+static uint8_t xc01LatSlotCount = 0;
+static uint32_t xc01LatStalls = 0;     // Bloqueos de todas las piezas
+
+/**
+ * Regresa la pieza con ese nombre; si no existe, la crea. NULL si ya
+ * no hay lugar (medir con NULL no hace nada).
+ */
+static inline XC01LatSlot *xc01LatSlot(const char *name, uint32_t budgetUs)
+{
+    for (uint8_t i = 0; i < xc01LatSlotCount; i++) {
+        if (strcmp(xc01LatSlots[i].name, name) == 0) {
+            return &xc01LatSlots[i];
+        }
+    }
+    if (xc01LatSlotCount == XC01_LAT_MAX_SLOTS) {
+        return NULL;
+    }
+    XC01LatSlot *s = &xc01LatSlots[xc01LatSlotCount++];
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->budgetUs = budgetUs;
+    return s;
+}
+
+static inline XC01LatMark xc01LatStart()
+{
+    XC01LatMark m = { ESP.getCycleCount(), xTaskGetTickCount() };
+    return m;
+}
+
+// Microsegundos desde 'm'
+static inline uint32_t xc01LatElapsedUs(XC01LatMark m)
+{
+    uint32_t cycles = ESP.getCycleCount() - m.cycles;
+    uint32_t ms = (xTaskGetTickCount() - m.ticks) * portTICK_PERIOD_MS;
+
+    if (ms >= XC01_LAT_LONG_MS) {
+        return ms * 1000UL;
+    }
+    return cycles / getCpuFrequencyMhz();
+}
+
+// Agrega una medición a la pieza; regresa true si fue un bloqueo
+static inline bool xc01LatRecord(XC01LatSlot *s, uint32_t us)
+{
+    uint8_t b = 0;
+    bool worst;
+
+    if (!s) {
+        return false;
+    }
+    for (uint32_t limit = 10; b < XC01_LAT_BUCKETS - 1 && us >= limit; limit *= 10) {
+        b++;
+    }
+    s->buckets[b]++;
+    s->count++;
+    s->totalUs += us;
+    worst = us > s->maxUs;
+    if (worst) {
+        s->maxUs = us;
+    }
+    if (us <= s->budgetUs) {
+        return false;
+    }
+    s->stalls++;
+    xc01LatStalls++;
+    if (!worst) {
+        return true;
+    }
+    Serial.print("[LAT] Bloqueo: ");
+    Serial.print(s->name);
+    Serial.print(" tardó ");
+    Serial.print(us / 1000.0f, 1);
+    Serial.println(" ms");
+    return true;
+}
+
+static inline uint32_t xc01LatStop(XC01LatSlot *s, XC01LatMark m)
+{
+    uint32_t us = xc01LatElapsedUs(m);
+    xc01LatRecord(s, us);
+    return us;
+}
+
+// Mide una instrucción: XC01_LAT_TIME(latBlynk, Blynk.run());
+#define XC01_LAT_TIME(slot, code) \
+    do { \
+        XC01LatMark xc01Mark_ = xc01LatStart(); \
+        code; \
+        xc01LatStop(slot, xc01Mark_); \
+    } while (0)
+
+// Un callback de timer que se mide solo; su pieza lleva el nombre de la
+// función y se crea desde que se programa el timer
+#define XC01_LAT_TIMED(fn) \
+    (xc01LatSlot(#fn, XC01_LAT_BUDGET_US), []() { \
+        static XC01LatSlot *slot_ = xc01LatSlot(#fn, XC01_LAT_BUDGET_US); \
+        XC01_LAT_TIME(slot_, fn()); \
+    })
+
+/**
+ * Va al inicio de loop(): mide el tiempo desde la vuelta anterior. Es
+ * lo que espera Blynk entre dos Blynk.run(), con todo incluido.
+ */
+static inline void xc01LatLoop(XC01LatSlot *s)
+{
+    static XC01LatMark last;
+    static bool started = false;
+
+    if (started) {
+        xc01LatRecord(s, xc01LatElapsedUs(last));
+    }
+    last = xc01LatStart();
+    started = true;
+}
+
+
+//##################################################################
+// ### REPORTE ###
+//##################################################################
+
+// Todas las piezas en una tabla (µs); columnas: <10u <100u ... >=10s
+static inline void xc01LatPrint(Print &out)
+{
+    static const char *const HEADS[XC01_LAT_BUCKETS] = {
+        "<10u", "<100u", "<1m", "<10m", "<100m", "<1s", "<10s", ">=10s"
+    };
+    char line[48];
+
+    out.println("Latencia (µs)            llamadas      prom       máx  bloqueos");
+    for (uint8_t i = 0; i < xc01LatSlotCount; i++) {
+        const XC01LatSlot *s = &xc01LatSlots[i];
+        snprintf(line, sizeof(line), "%-22.22s %10lu", s->name, (unsigned long)s->count);
+        out.print(line);
+        snprintf(line, sizeof(line), " %9lu %9lu %9lu", s->count ? (unsigned long)(s->totalUs / s->count) : 0UL,
+                 (unsigned long)s->maxUs, (unsigned long)s->stalls);
+        out.println(line);
+        out.print("   ");
+        for (uint8_t b = 0; b < XC01_LAT_BUCKETS; b++) {
+            if (s->buckets[b]) {
+                out.print(" ");
+                out.print(HEADS[b]);
+                out.print(":");
+                out.print(s->buckets[b]);
+            }
+        }
+        out.println();
+    }
+}
+
+/**
+ * Resumen corto para un pin virtual: "nombre máx_ms/bloqueos" por
+ * pieza, ej. "loop 1093/2 Blynk.run 1093/1 updateTemperature 0/0".
+ */
+static inline void xc01LatSummary(char *buf, size_t size)
+{
+    size_t n = 0;
+
+    buf[0] = '\0';
+    for (uint8_t i = 0; i < xc01LatSlotCount && n < size; i++) {
+        const XC01LatSlot *s = &xc01LatSlots[i];
+        int w = snprintf(buf + n, size - n, "%s%s %lu/%lu", n ? " " : "", s->name,
+                         (unsigned long)(s->maxUs / 1000UL), (unsigned long)s->stalls);
+        if (w < 0) {
+            break;
+        }
+        n += (size_t)w;
+    }
+}
+
+// Empieza otra ventana de medición (las piezas se conservan)
+static inline void xc01LatReset()
+{
+    for (uint8_t i = 0; i < xc01LatSlotCount; i++) {
+        XC01LatSlot *s = &xc01LatSlots[i];
+        s->count = 0;
+        s->stalls = 0;
+        s->totalUs = 0;
+        s->maxUs = 0;
+        memset(s->buckets, 0, sizeof(s->buckets));
+    }
+}
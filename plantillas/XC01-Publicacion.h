@@ -0,0 +1,432 @@
+/*
+ * ===================================================================
+ * CAPA DE PUBLICACIÓN DEL XC01 (LOTES Y REPORTE POR CAMBIO)
+ *
+ * Cada mensaje hacia la nube cuesta tiempo (un AT+CASEND, ~140 ms) y
+ * datos por LTE. En lugar de Blynk.virtualWrite() el sketch llama a
+ * publishStage(): el valor queda "en espera" y publishFlush(), al
+ * final de cada vuelta de loop(), manda todo lo pendiente en UN
+ * mensaje. Si el mismo pin se escribe dos veces antes de enviar, sólo
+ * sale el último valor.
+ *
+ * Un pin puede tener además una política de envío (publishPolicy()):
+ * sólo se publica un cambio más grande que la banda muerta (absoluta
+ * o relativa), no más seguido que minMs, y de todos modos cada maxMs
+ * ("latido"). Un cambio que llega antes de minMs queda retenido y
+ * sale solo cuando se cumple el intervalo.
+ *
+ * Cómo se manda el lote lo decide el sketch (Blynk agrupado, una
+ * trama binaria de XC03-Telemetria.h...; con Blynk, publishSendBlynk()
+ * ya hace las dos cosas):
+ *
+ *   static bool publishSend(PendingWrite *writes, uint8_t count);
+ *   publishBegin(publishSend);                        // setup()
+ *   publishPolicy(V4, 0.5f, 0.0f, 10000UL, 300000UL); // setup()
+ *   publishStage(V4, humedad);                        // donde sea
+ *   publishFlush();                                   // loop()
+ *
+ * Si el envío falla (sin conexión) los valores se quedan y salen al
+ * reconectar. Si falla a medias (ej. los textos salieron por Blynk y
+ * la trama binaria no), el sender marca 'sent' en lo que sí salió y
+ * sólo se queda lo demás. Todo usa memoria fija.
+ *
+ * Un texto (publishStage(pin, "texto")) se copia a uno de
+ * PUBLISH_MAX_TEXTS búferes de PUBLISH_TEXT_MAX bytes; no pasa por la
+ * política de envío (un resumen se manda cada vez que se pide).
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef PUBLISH_MAX_PINS
+#define PUBLISH_MAX_PINS 8          // Pines distintos en espera
+#endif
+#ifndef PUBLISH_MAX_POLICIES
+#define PUBLISH_MAX_POLICIES 8      // Pines con política de envío
+#endif
+#ifndef PUBLISH_FLUSH_MS
+#define PUBLISH_FLUSH_MS 0UL        // Espera máx. de un lote (0 = cada vuelta)
+#endif
+#ifndef PUBLISH_MAX_TEXTS
+#define PUBLISH_MAX_TEXTS 2         // Textos en espera a la vez
+#endif
+#ifndef PUBLISH_TEXT_MAX
+#define PUBLISH_TEXT_MAX 160        // Bytes de un texto (con el '\0')
+#endif
+
+// Un valor en espera de la capa de publicación
+typedef struct {
+    uint8_t pin;
+    bool isFloat;
+    union {
+        int32_t i;
+        float f;
+    } value;
+    const char *text;           // No NULL: es un texto (va en lugar de 'value')
+    bool sent;                  // Ya salió (envío a medias): no se repite
+} PendingWrite;
+
+// Política de envío de un pin: sólo se publica un cambio real
+typedef struct {
+    uint8_t pin;
+    float deadbandAbs;          // Cambio mínimo absoluto (0 = cualquier cambio)
+    float deadbandRel;          // Cambio mínimo relativo (0.05 = 5 %)
+    unsigned long minIntervalMs; // Separación mínima entre envíos
+    unsigned long maxIntervalMs; // Se reenvía aunque no cambie (0 = nunca)
+    bool sent;                  // Ya se envió al menos una vez
+    bool held;                  // Hay un cambio esperando minIntervalMs
+    bool isFloat;
+    float lastSent;
+    float latest;               // Último valor recibido (enviado o no)
+    unsigned long lastSentAt;
+} PublishPolicy;
+
+// Manda 'count' valores en UN mensaje. Regresa true si salieron; si
+// no, se quedan en espera para el siguiente publishFlush() (menos los
+// que el sender marcó con 'sent').
+typedef bool (*PublishSender)(PendingWrite *writes, uint8_t count);
+
+static PublishSender publishSender = NULL;
+static PendingWrite publishPending[PUBLISH_MAX_PINS];
+static uint8_t publishPendingCount = 0;
+static unsigned long publishPendingSince = 0; // millis() del primer valor en espera
+
+// Contadores
+static uint32_t publishStaged = 0;     // Llamadas a publishStage()
+static uint32_t publishCoalesced = 0;  // Valores reemplazados antes de enviar
+static uint32_t publishBatches = 0;    // Mensajes realmente enviados
+static uint32_t publishSuppressed = 0; // Valores que no cambiaron lo suficiente
+
+static PublishPolicy publishPolicies[PUBLISH_MAX_POLICIES];
+static uint8_t publishPolicyCount = 0;
+
+// Búferes de los textos en espera. Uno está libre si ningún valor en
+// espera apunta a él.
+static char publishTexts[PUBLISH_MAX_TEXTS][PUBLISH_TEXT_MAX];
+static uint32_t publishTextsLost = 0;  // Textos sin búfer libre
+
+static inline void publishFlush();
+
+// Va en setup(), antes del primer publishStage()
+static inline void publishBegin(PublishSender sender)
+{
+    publishSender = sender;
+}
+
+/**
+ * Registra (o cambia) la política de envío de un pin. Va en setup().
+ * Un pin sin política se envía siempre.
+ */
+static inline PublishPolicy *publishPolicy(uint8_t pin, float deadbandAbs, float deadbandRel,
+                                           unsigned long minIntervalMs, unsigned long maxIntervalMs)
+{
+    PublishPolicy *policy = NULL;
+
+    for (uint8_t i = 0; i < publishPolicyCount; i++) {
+        if (publishPolicies[i].pin == pin) {
+            policy = &publishPolicies[i];
+        }
+    }
+    if (!policy) {
+        if (publishPolicyCount == PUBLISH_MAX_POLICIES) {
+            return NULL;
+        }
+        policy = &publishPolicies[publishPolicyCount++];
+    }
+    memset(policy, 0, sizeof(*policy));
+    policy->pin = pin;
+    policy->deadbandAbs = deadbandAbs;
+    policy->deadbandRel = deadbandRel;
+    policy->minIntervalMs = minIntervalMs;
+    policy->maxIntervalMs = maxIntervalMs;
+    return policy;
+}
+
+static inline PublishPolicy *publishPolicyFor(uint8_t pin)
+{
+    for (uint8_t i = 0; i < publishPolicyCount; i++) {
+        if (publishPolicies[i].pin == pin) {
+            return &publishPolicies[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Decide si 'value' se publica. Si sí, lo registra como enviado. Un
+ * cambio que llega antes de minIntervalMs queda retenido y sale cuando
+ * se cumple el intervalo (ver publishPolicyTick()). También sirve para
+ * una política que no pasa por publishStage() (ej. un valor que sale
+ * por el buffer de telemetría).
+ */
+static inline bool publishAccept(PublishPolicy *policy, float value, unsigned long now)
+{
+    policy->latest = value;
+
+    if (policy->sent) {
+        float diff = fabsf(value - policy->lastSent);
+        float band = policy->deadbandAbs;
+        if (policy->deadbandRel * fabsf(policy->lastSent) > band) {
+            band = policy->deadbandRel * fabsf(policy->lastSent);
+        }
+        bool changed = band > 0 ? diff >= band : diff > 0;
+        unsigned long elapsed = now - policy->lastSentAt;
+
+        bool heartbeat = policy->maxIntervalMs > 0 && elapsed >= policy->maxIntervalMs;
+        if (!heartbeat && (!changed || elapsed < policy->minIntervalMs)) {
+            policy->held = changed;
+            publishSuppressed++;
+            return false;
+        }
+    }
+
+    policy->sent = true;
+    policy->held = false;
+    policy->lastSent = value;
+    policy->lastSentAt = now;
+    return true;
+}
+
+static inline PendingWrite *publishSlot(uint8_t pin)
+{
+    publishStaged++;
+
+    // Si el pin ya está en espera, se reemplaza su valor
+    for (uint8_t i = 0; i < publishPendingCount; i++) {
+        if (publishPending[i].pin == pin) {
+            publishCoalesced++;
+            publishPending[i].sent = false;
+            return &publishPending[i];
+        }
+    }
+
+    // Lote lleno: se envía antes de agregar otro pin
+    if (publishPendingCount == PUBLISH_MAX_PINS) {
+        publishFlush();
+        if (publishPendingCount == PUBLISH_MAX_PINS) {
+            // Sin conexión: se pierde el valor más viejo
+            memmove(&publishPending[0], &publishPending[1],
+                    sizeof(PendingWrite) * (PUBLISH_MAX_PINS - 1));
+            publishPendingCount--;
+        }
+    }
+    if (publishPendingCount == 0) {
+        publishPendingSince = millis();
+    }
+    PendingWrite *slot = &publishPending[publishPendingCount++];
+    slot->pin = pin;
+    slot->sent = false;
+    return slot;
+}
+
+static inline void publishStageRaw(uint8_t pin, bool isFloat, float f, int32_t i)
+{
+    PendingWrite *slot = publishSlot(pin);
+    slot->isFloat = isFloat;
+    slot->text = NULL;
+    if (isFloat) {
+        slot->value.f = f;
+    } else {
+        slot->value.i = i;
+    }
+}
+
+// Suelta los cambios retenidos y los latidos que ya vencieron
+static inline void publishPolicyTick()
+{
+    unsigned long now = millis();
+
+    for (uint8_t i = 0; i < publishPolicyCount; i++) {
+        PublishPolicy *policy = &publishPolicies[i];
+        if (!policy->sent) {
+            continue;
+        }
+        unsigned long elapsed = now - policy->lastSentAt;
+        bool release = policy->held && elapsed >= policy->minIntervalMs;
+        bool heartbeat = policy->maxIntervalMs > 0 && elapsed >= policy->maxIntervalMs;
+
+        if (release || heartbeat) {
+            float value = policy->latest;
+            policy->held = false;
+            policy->lastSent = value;
+            policy->lastSentAt = now;
+            publishStageRaw(policy->pin, policy->isFloat, value, (int32_t)value);
+        }
+    }
+}
+
+// En lugar de Blynk.virtualWrite(pin, valor)
+static inline void publishStage(uint8_t pin, int32_t value)
+{
+    PublishPolicy *policy = publishPolicyFor(pin);
+
+    if (policy) {
+        policy->isFloat = false;
+        if (!publishAccept(policy, (float)value, millis())) {
+            return;
+        }
+    }
+    publishStageRaw(pin, false, 0, value);
+}
+
+static inline void publishStage(uint8_t pin, float value)
+{
+    PublishPolicy *policy = publishPolicyFor(pin);
+
+    if (policy) {
+        policy->isFloat = true;
+        if (!publishAccept(policy, value, millis())) {
+            return;
+        }
+    }
+    publishStageRaw(pin, true, value, 0);
+}
+
+// Un texto (ej. un resumen). Se copia; si no hay búfer libre, se pierde.
+static inline void publishStage(uint8_t pin, const char *text)
+{
+    char *buffer = NULL;
+
+    for (uint8_t k = 0; k < PUBLISH_MAX_TEXTS && !buffer; k++) {
+        bool used = false;
+        for (uint8_t i = 0; i < publishPendingCount; i++) {
+            if (publishPending[i].text == publishTexts[k] && publishPending[i].pin != pin) {
+                used = true;
+            }
+        }
+        if (!used) {
+            buffer = publishTexts[k];
+        }
+    }
+    if (!buffer) {
+        publishTextsLost++;
+        return;
+    }
+    snprintf(buffer, PUBLISH_TEXT_MAX, "%s", text);
+
+    PendingWrite *slot = publishSlot(pin);
+    slot->isFloat = false;
+    slot->text = buffer;
+}
+
+/**
+ * Manda los valores en espera en un solo mensaje (lo arma el
+ * PublishSender del sketch). Si no salen, se quedan (el último de cada
+ * pin) y salen al reconectar.
+ */
+static inline void publishFlush()
+{
+    publishPolicyTick();
+
+    if (publishPendingCount == 0 || !publishSender) {
+        return;
+    }
+    if (millis() - publishPendingSince < PUBLISH_FLUSH_MS && publishPendingCount < PUBLISH_MAX_PINS) {
+        return;
+    }
+    if (publishSender(publishPending, publishPendingCount)) {
+        publishBatches++;
+        publishPendingCount = 0;
+        return;
+    }
+
+    // Envío a medias: sólo se queda lo que no salió
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < publishPendingCount; i++) {
+        if (!publishPending[i].sent) {
+            publishPending[kept++] = publishPending[i];
+        }
+    }
+    publishPendingCount = kept;
+}
+
+// Contadores de la capa (sin fin de reporte: el sketch agrega lo suyo)
+static inline void publishPrintReport(Print &out)
+{
+    out.print("Publicación: ");
+    out.print(publishStaged);
+    out.print(" valores en ");
+    out.print(publishBatches);
+    out.print(" mensajes (");
+    out.print(publishCoalesced);
+    out.print(" reemplazados, ");
+    out.print(publishStaged > publishBatches ? publishStaged - publishBatches : 0);
+    out.println(" mensajes ahorrados)");
+    out.print("Sin cambio (no enviados): ");
+    out.println(publishSuppressed);
+    if (publishTextsLost > 0) {
+        out.print("Textos perdidos (sin búfer): ");
+        out.println(publishTextsLost);
+    }
+}
+
+#ifdef BlynkSimpleTinyGSM_h
+#include "XC03-Telemetria.h"
+
+/**
+ * PublishSender de los sketches con Blynk. Sin 'tel' el lote sale en
+ * un solo mensaje agrupado de Blynk. Con 'tel' (telemetría binaria)
+ * los números van en un reporte de XC03-Telemetria.h y los textos,
+ * que la trama no lleva, por Blynk cada uno por su lado; lo que ya
+ * salió se marca 'sent' para que una trama fallida no lo repita.
+ * Sin conexión regresa false y los valores se quedan.
+ */
+static inline bool publishSendBlynk(PendingWrite *writes, uint8_t count, XC03TelLink *tel)
+{
+    if (tel) {
+        bool textsSent = true;
+        uint8_t numbers = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (!writes[i].text) {
+                numbers++;
+            } else if (!writes[i].sent) {
+                if (Blynk.connected()) {
+                    Blynk.virtualWrite(writes[i].pin, writes[i].text);
+                    writes[i].sent = Blynk.connected();
+                }
+                textsSent = textsSent && writes[i].sent;
+            }
+        }
+        if (numbers == 0) {
+            return textsSent;
+        }
+        if (!xc03TelConnected(tel)) {
+            return false;
+        }
+        xc03TelReport(tel, 0);
+        for (uint8_t i = 0; i < count; i++) {
+            if (writes[i].text) {
+                continue;
+            } else if (writes[i].isFloat) {
+                xc03TelCenti(tel, writes[i].pin, writes[i].value.f);
+            } else {
+                xc03TelInt(tel, writes[i].pin, writes[i].value.i);
+            }
+        }
+        if (!xc03TelFrameEnd(tel) || !xc03TelSend(tel)) {
+            return false;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            writes[i].sent = writes[i].sent || !writes[i].text;
+        }
+        return textsSent;
+    }
+
+    if (!Blynk.connected()) {
+        return false;
+    }
+    Blynk.beginGroup();
+    for (uint8_t i = 0; i < count; i++) {
+        if (writes[i].text) {
+            Blynk.virtualWrite(writes[i].pin, writes[i].text);
+        } else if (writes[i].isFloat) {
+            Blynk.virtualWrite(writes[i].pin, writes[i].value.f);
+        } else {
+            Blynk.virtualWrite(writes[i].pin, writes[i].value.i);
+        }
+    }
+    Blynk.endGroup();
+    return Blynk.connected();
+}
+#endif
@@ -0,0 +1,338 @@
+/*
+ * ===================================================================
+ * MOTOR DE COMANDOS AT SIN ESPERA PARA EL XC03 (SIM7080G)
+ *
+ * TinyGSM manda un comando y se queda leyendo SerialAT hasta que llega
+ * la respuesta: mientras tanto loop() no atiende sensores ni Blynk.
+ * Aquí los comandos se forman en una cola y xc03AtUpdate(), llamada en
+ * cada vuelta de loop(), hace un poco de trabajo y regresa:
+ *   1. Lee lo que ya llegó al puerto, línea por línea (búfer fijo).
+ *   2. Si el comando en curso terminó ("OK", "ERROR" o su timeout),
+ *      avisa y manda el siguiente de la cola en la misma llamada.
+ *
+ * Después de un timeout el "OK" del comando viejo todavía puede llegar
+ * y se tomaría como respuesta del siguiente. Por eso el motor se
+ * resincroniza: descarta "OK"/"ERROR" durante XC03_AT_GUARD_MS, manda
+ * un "AT" solo y espera SU "OK" antes de mandar el siguiente comando.
+ * Si ese "AT" tampoco contesta en XC03_AT_GUARD_MS, el módem está
+ * callado (ej. apagado) y la cola sigue.
+ *
+ * Cada comando lleva:
+ *   - El texto sin "AT" ("+CEREG?"). Se copia: puede ser temporal.
+ *   - El prefijo de las líneas de respuesta que interesan ("+CEREG:");
+ *     "" = todas (ej. ATI). Cada una llega a su callback 'onLine'.
+ *   - Su propio timeout.
+ *   - Un XC03AtFuture para consultar después cómo terminó y/o un
+ *     callback 'onDone'. Los dos son opcionales.
+ *
+ * Las líneas que no son del comando en curso (o que llegan sin
+ * comando) son URC ("+APP PDP: 0,ACTIVE"): van al manejador
+ * registrado con xc03AtOnUrc() cuyo prefijo coincida.
+ *
+ * No maneja comandos con '>' (AT+CASEND) ni respuestas binarias: para
+ * eso se usa TinyGSM, y sólo con la cola vacía (xc03AtIdle()). El
+ * motor no debe leer el puerto mientras TinyGSM lo usa.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define XC03_LINE_MAX 128           // +CGNSINF mide ~100; NMEA máx. 82
+#define XC03_AT_QUEUE_SIZE 8        // Comandos en espera
+#define XC03_AT_TEXT_MAX 72         // Texto de un comando (sin "AT")
+#define XC03_AT_URC_MAX 6           // Manejadores de URC
+#define XC03_AT_TIMEOUT_MS 1000UL   // Timeout por defecto
+#define XC03_AT_GUARD_MS 200UL      // Tras un timeout: respuestas tardías descartadas
+
+
+//##################################################################
+// ### LECTURA DEL PUERTO SIN ESPERAR ###
+//##################################################################
+
+typedef struct {
+    char buf[XC03_LINE_MAX];    // La línea, sin "\r\n" y con '\0'
+    uint8_t len;
+    bool overflow;              // No cupo: se descarta completa
+    bool ready;                 // buf tiene una línea entregada
+} XC03LineReader;
+
+/**
+ * Pasa al búfer lo que ya llegó al puerto, sin esperar. Regresa true
+ * cuando hay una línea completa en r->buf; lo que sigue se queda en
+ * el puerto para la próxima llamada. Las líneas vacías no cuentan.
+ */
+static inline bool xc03ReadLine(Stream &s, XC03LineReader *r)
+{
+    if (r->ready) {
+        r->ready = false;
+        r->len = 0;
+    }
+    while (s.available() > 0) {
+        char ch = (char)s.read();
+        if (ch == '\r') {
+            continue;
+        }
+        if (ch == '\n') {
+            bool complete = r->len > 0 && !r->overflow;
+            r->overflow = false;
+            if (complete) {
+                r->buf[r->len] = '\0';
+                r->ready = true;
+                return true;
+            }
+            r->len = 0;
+            continue;
+        }
+        if (r->len < XC03_LINE_MAX - 1) {
+            r->buf[r->len++] = ch;
+        } else {
+            r->overflow = true;
+        }
+    }
+    return false;
+}
+
+static inline bool xc03StartsWith(const char *line, const char *prefix)
+{
+    return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+
+//##################################################################
+// ### COLA DE COMANDOS ###
+//##################################################################
+
+// Resincronización después de un timeout
+enum XC03AtResync {
+    XC03_AT_SYNCED,
+    XC03_AT_GUARD,              // Descartando respuestas tardías
+    XC03_AT_SYNC_SENT           // "AT" mandado, esperando su "OK"
+};
+
+enum XC03AtStatus {
+    XC03_AT_IDLE,               // El future no tiene comando
+    XC03_AT_PENDING,            // En la cola o esperando respuesta
+    XC03_AT_OK,
+    XC03_AT_ERROR,              // "ERROR" o "+CME ERROR: ..."
+    XC03_AT_TIMEOUT
+};
+
+typedef struct {
+    uint8_t status;             // XC03AtStatus
+} XC03AtFuture;
+
+// ¿Ya terminó (bien o mal)?
+static inline bool xc03AtDone(const XC03AtFuture *f)
+{
+    return f->status >= XC03_AT_OK;
+}
+
+typedef void (*XC03AtLineHandler)(const char *line, uint8_t len, void *ctx);
+typedef void (*XC03AtDoneHandler)(XC03AtStatus status, void *ctx);
+typedef void (*XC03UrcHandler)(const char *line, uint8_t len);
+
+typedef struct {
+    char text[XC03_AT_TEXT_MAX];
+    const char *prefix;         // NULL: ninguna línea interesa
+    unsigned long timeoutMs;
+    XC03AtLineHandler onLine;
+    XC03AtDoneHandler onDone;
+    void *ctx;
+    XC03AtFuture *future;
+} XC03AtCommand;
+
+typedef struct {
+    const char *prefix;
+    XC03UrcHandler handler;
+} XC03UrcRoute;
+
+static struct {
+    Stream *port;
+    XC03LineReader line;
+    XC03AtCommand queue[XC03_AT_QUEUE_SIZE];
+    uint8_t head;               // queue[head] es el más viejo
+    uint8_t count;
+    bool sent;                  // queue[head] ya se mandó
+    unsigned long sentAt;
+    uint8_t resync;             // XC03AtResync
+    unsigned long resyncAt;     // Inicio de la guarda o envío del "AT"
+    XC03UrcRoute urc[XC03_AT_URC_MAX];
+    uint8_t urcCount;
+    uint32_t commands;          // Estadísticas
+    uint32_t timeouts;
+    uint32_t resyncs;           // "AT" de resincronización mandados
+    uint32_t urcs;
+} xc03At;
+
+static inline void xc03AtBegin(Stream &port)
+{
+    memset(&xc03At, 0, sizeof(xc03At));
+    xc03At.port = &port;
+}
+
+// Las líneas que empiecen con 'prefix' y no sean respuesta van a 'handler'
+static inline bool xc03AtOnUrc(const char *prefix, XC03UrcHandler handler)
+{
+    if (xc03At.urcCount >= XC03_AT_URC_MAX) {
+        return false;
+    }
+    xc03At.urc[xc03At.urcCount].prefix = prefix;
+    xc03At.urc[xc03At.urcCount].handler = handler;
+    xc03At.urcCount++;
+    return true;
+}
+
+/**
+ * Forma un comando. Regresa false (y el future queda en IDLE) si la
+ * cola está llena o el texto no cabe. Se puede llamar desde los
+ * callbacks de otro comando.
+ */
+static inline bool xc03AtSend(const char *text, const char *prefix,
+                              XC03AtLineHandler onLine, XC03AtDoneHandler onDone, void *ctx,
+                              XC03AtFuture *future, unsigned long timeoutMs = XC03_AT_TIMEOUT_MS)
+{
+    if (future) {
+        future->status = XC03_AT_IDLE;
+    }
+    if (xc03At.count >= XC03_AT_QUEUE_SIZE || strlen(text) >= XC03_AT_TEXT_MAX) {
+        return false;
+    }
+    XC03AtCommand *c = &xc03At.queue[(xc03At.head + xc03At.count) % XC03_AT_QUEUE_SIZE];
+    strcpy(c->text, text);
+    c->prefix = prefix;
+    c->timeoutMs = timeoutMs;
+    c->onLine = onLine;
+    c->onDone = onDone;
+    c->ctx = ctx;
+    c->future = future;
+    if (future) {
+        future->status = XC03_AT_PENDING;
+    }
+    xc03At.count++;
+    return true;
+}
+
+// Sin líneas de respuesta: sólo importa "OK"
+static inline bool xc03AtCommand(const char *text, XC03AtFuture *future,
+                                 unsigned long timeoutMs = XC03_AT_TIMEOUT_MS)
+{
+    return xc03AtSend(text, NULL, NULL, NULL, NULL, future, timeoutMs);
+}
+
+// Con líneas de respuesta que empiezan con 'prefix'
+static inline bool xc03AtQuery(const char *text, const char *prefix,
+                               XC03AtLineHandler onLine, void *ctx, XC03AtFuture *future,
+                               unsigned long timeoutMs = XC03_AT_TIMEOUT_MS)
+{
+    return xc03AtSend(text, prefix, onLine, NULL, ctx, future, timeoutMs);
+}
+
+// Nada en la cola ni en curso: TinyGSM puede usar el puerto
+static inline bool xc03AtIdle()
+{
+    return xc03At.count == 0 && xc03At.resync == XC03_AT_SYNCED;
+}
+
+// Termina el comando en curso y lo saca de la cola
+static inline void xc03AtFinish(XC03AtStatus status)
+{
+    XC03AtCommand c = xc03At.queue[xc03At.head];
+
+    xc03At.head = (xc03At.head + 1) % XC03_AT_QUEUE_SIZE;
+    xc03At.count--;
+    xc03At.sent = false;
+    if (status == XC03_AT_TIMEOUT) {
+        xc03At.timeouts++;
+        xc03At.resync = XC03_AT_GUARD;
+        xc03At.resyncAt = millis();
+    }
+    if (c.future) {
+        c.future->status = status;
+    }
+    // Al final: el callback puede formar otro comando
+    if (c.onDone) {
+        c.onDone(status, c.ctx);
+    }
+}
+
+static inline bool xc03AtFinalResult(const char *line)
+{
+    return strcmp(line, "OK") == 0 || strcmp(line, "ERROR") == 0
+           || xc03StartsWith(line, "+CME ERROR");
+}
+
+static inline void xc03AtHandleLine(const char *line, uint8_t len)
+{
+    if (xc03At.resync != XC03_AT_SYNCED && xc03AtFinalResult(line)) {
+        // Durante la guarda es la respuesta tardía del comando viejo;
+        // después, sólo el "OK" del "AT" cierra la resincronización
+        if (xc03At.resync == XC03_AT_SYNC_SENT && strcmp(line, "OK") == 0) {
+            xc03At.resync = XC03_AT_SYNCED;
+        }
+        return;
+    }
+    if (xc03At.sent) {
+        const XC03AtCommand *c = &xc03At.queue[xc03At.head];
+
+        if (strcmp(line, "OK") == 0) {
+            xc03AtFinish(XC03_AT_OK);
+            return;
+        }
+        if (strcmp(line, "ERROR") == 0 || xc03StartsWith(line, "+CME ERROR")) {
+            xc03AtFinish(XC03_AT_ERROR);
+            return;
+        }
+        if (c->prefix && xc03StartsWith(line, c->prefix)) {
+            if (c->onLine) {
+                c->onLine(line, len, c->ctx);
+            }
+            return;
+        }
+        if (line[0] == 'A' && line[1] == 'T') {
+            return;             // Eco del comando (antes de ATE0)
+        }
+    }
+    for (uint8_t i = 0; i < xc03At.urcCount; i++) {
+        if (xc03StartsWith(line, xc03At.urc[i].prefix)) {
+            xc03At.urcs++;
+            xc03At.urc[i].handler(line, len);
+            return;
+        }
+    }
+}
+
+/**
+ * Va en loop(). Lee lo que ya llegó, cierra el comando en curso si
+ * terminó y manda el siguiente. Nunca espera.
+ */
+static inline void xc03AtUpdate(unsigned long now)
+{
+    if (!xc03At.port) {
+        return;
+    }
+    while (xc03ReadLine(*xc03At.port, &xc03At.line)) {
+        xc03AtHandleLine(xc03At.line.buf, xc03At.line.len);
+    }
+    if (xc03At.sent && now - xc03At.sentAt >= xc03At.queue[xc03At.head].timeoutMs) {
+        xc03AtFinish(XC03_AT_TIMEOUT);
+    }
+    if (xc03At.resync == XC03_AT_GUARD && now - xc03At.resyncAt >= XC03_AT_GUARD_MS) {
+        xc03At.port->print("AT\r\n");
+        xc03At.resync = XC03_AT_SYNC_SENT;
+        xc03At.resyncAt = now;
+        xc03At.resyncs++;
+    } else if (xc03At.resync == XC03_AT_SYNC_SENT && now - xc03At.resyncAt >= XC03_AT_GUARD_MS) {
+        // Sin "OK": el módem no contesta nada (ej. apagado), así que
+        // tampoco hay respuestas tardías en camino
+        xc03At.resync = XC03_AT_SYNCED;
+    }
+    if (!xc03At.sent && xc03At.count > 0 && xc03At.resync == XC03_AT_SYNCED) {
+        xc03At.port->print("AT");
+        xc03At.port->print(xc03At.queue[xc03At.head].text);
+        xc03At.port->print("\r\n");
+        xc03At.sent = true;
+        xc03At.sentAt = now;
+        xc03At.commands++;
+    }
+}
@@ -0,0 +1,491 @@
+/*
+ * ===================================================================
+ * ARRANQUE DEL XC03 (SIM7080G) SIN ESPERA
+ *
+ * El encendido del módem es una máquina de estados que avanza UN paso
+ * en cada llamada a xc03BootUpdate() desde loop():
+ *
+ *   PROBE    "AT" un par de veces: si contesta, ya estaba encendido
+ *            (sólo se reinició el ESP32) y no hay que tocar el PWRKEY.
+ *   PWRKEY   Pulso de XC03_BOOT_PULSE_MS en el Power Key.
+ *   WAIT_AT  "AT" cada XC03_BOOT_AT_POLL_MS hasta que conteste.
+ *   pasos    Los del sketch, en orden (init, red, PDP, Blynk, GNSS...).
+ *   READY    xc03BootUpdate() regresa true.
+ *   RETRY    Tras un error: pausa y de nuevo desde PROBE (el pulso
+ *            sólo si el módem no contesta: uno de más lo apagaría).
+ *
+ * El pulso lo termina un esp_timer de una vez, no loop(): con >= 1.2 s
+ * el SIM7080G se APAGA, así que un loop() detenido 100 ms de más
+ * (un AT+CASEND, una reconexión de Blynk) no debe alargarlo.
+ *
+ * Cada paso del sketch es una función que regresa de inmediato:
+ *
+ *   static const XC03BootStep bootSteps[] = {
+ *       { NULL, xc03BootStepInit },        // modem.init()
+ *       { "red", xc03BootStepNetwork },    // CEREG + AT+CNACT=0,1
+ *       { "PDP", xc03BootStepAttach },
+ *       { "Blynk", xc03BootStepBlynk },    // Blynk.config() + connect()
+ *   };
+ *   xc03BootBegin(&boot, &modem, SerialMon, PIN_MODEM_PK, bootSteps, 4, NULL);
+ *
+ * Un paso con nombre aparece en xc03BootPrintTimes() con la hora en
+ * que terminó; xc03BootMarkData() la imprime junto con la del primer
+ * dato enviado. El "AT" de prueba va por TinyGSM; un sketch que usa la
+ * cola de XC03-AT.h pasa sus propios ganchos (XC03BootHooks).
+ *
+ * Se incluye después de <TinyGsmClient.h> (como XC03-Telemetria.h).
+ * El paso de Blynk sólo existe si antes se incluyó <BlynkSimpleTinyGSM.h>.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <TinyGsmClient.h>
+#include "esp_timer.h"
+
+#define XC03_BOOT_MAX_STEPS 6
+#define XC03_BOOT_PULSE_MS 1100UL         // >= 1 s enciende; < 1.2 s no lo apaga
+#define XC03_BOOT_AT_POLL_MS 250UL        // Cadencia de "AT" mientras arranca
+#define XC03_BOOT_AT_REPLY_MS 100UL       // Espera máx. de la respuesta a "AT"
+#define XC03_BOOT_AT_READY_MS 15000UL     // Sin respuesta: otro pulso
+#define XC03_BOOT_WARM_TRIES 3            // "AT" antes de dar el módem por apagado
+#define XC03_BOOT_RETRY_MS 5000UL         // Pausa después de un error
+#define XC03_BOOT_NET_POLL_MS 1000UL      // Cadencia de AT+CEREG?
+#define XC03_BOOT_NET_TIMEOUT_MS 120000UL
+#define XC03_BOOT_ATTACH_POLL_MS 500UL    // Cadencia de AT+CNACT?
+#define XC03_BOOT_ATTACH_TIMEOUT_MS 60000UL
+
+typedef enum {
+    XC03_BOOT_PROBE,            // ¿Ya estaba encendido? (arranque en caliente)
+    XC03_BOOT_PWRKEY,           // Pulso en el Power Key
+    XC03_BOOT_WAIT_AT,          // "AT" hasta que conteste
+    XC03_BOOT_STEPS,            // Pasos del sketch
+    XC03_BOOT_READY,
+    XC03_BOOT_RETRY             // Pausa y de nuevo desde la prueba
+} XC03BootState;
+
+typedef enum {
+    XC03_STEP_WAIT,             // Sigue en este paso (se llama otra vez)
+    XC03_STEP_DONE,             // Al siguiente paso
+    XC03_STEP_SKIP,             // No hacía falta (arranque en caliente)
+    XC03_STEP_FAIL              // A RETRY (ver xc03BootFail())
+} XC03StepResult;
+
+typedef enum {
+    XC03_PROBE_WAIT,            // Sin respuesta todavía
+    XC03_PROBE_OK,
+    XC03_PROBE_NONE             // No contestó (o contestó error)
+} XC03ProbeResult;
+
+typedef struct XC03Boot XC03Boot;
+
+typedef struct {
+    const char *name;           // En el resumen de tiempos (NULL = no aparece)
+    XC03StepResult (*run)(XC03Boot *boot, unsigned long inStep);
+} XC03BootStep;
+
+// Ganchos opcionales (NULL = el comportamiento de TinyGSM)
+typedef struct {
+    // "AT" de prueba: mandarlo y preguntar si ya contestó
+    void (*probeSend)(XC03Boot *boot);
+    XC03ProbeResult (*probePoll)(XC03Boot *boot, unsigned long waited);
+    // Arranque en caliente con el PDP activo: cerrar los sockets que
+    // quedaron abiertos antes del reinicio
+    void (*onReuse)(XC03Boot *boot);
+} XC03BootHooks;
+
+struct XC03Boot {
+    TinyGsm *modem;
+    Print *log;
+    uint8_t pwrKeyPin;
+    const char *apn;            // Para xc03BootStepNetwork() (NULL = sin red)
+    const char *user;
+    const char *pass;
+    const XC03BootStep *steps;
+    uint8_t stepCount;
+    const XC03BootHooks *hooks;
+    uint8_t sockets;            // Los que cierra xc03BootCloseSockets() (0, 1, ...)
+    const char *blynkAuth;      // Para xc03BootStepBlynk()
+    const char *blynkDomain;
+
+    XC03BootState state;
+    uint8_t step;               // Paso en curso (en XC03_BOOT_STEPS)
+    unsigned long stateAt;      // Cuándo se entró a la etapa (o paso) actual
+    unsigned long lastPoll;
+    bool warm;                  // El módem ya estaba encendido (primer arranque)
+    bool alive;                 // Contestó en PROBE, sin pulso (esta vuelta)
+    bool reuse;                 // ... y con el PDP activo: red y PDP se saltan
+    uint8_t atProbes;           // "AT" enviados en PROBE
+    bool atPending;             // Se envió "AT" y falta la respuesta
+
+    esp_timer_handle_t pulseTimer;
+    bool pulsing;
+    volatile bool pulseDone;    // Lo pone el esp_timer al bajar el PWRKEY
+
+    unsigned long atMs;                     // Primer "AT" contestado (0 = aún no)
+    unsigned long stepMs[XC03_BOOT_MAX_STEPS];  // Fin de cada paso (0 = saltado)
+    unsigned long dataMs;                   // Primer dato enviado (0 = aún no)
+};
+
+static inline void xc03BootEnter(XC03Boot *b, XC03BootState next)
+{
+    b->state = next;
+    b->stateAt = millis();
+    b->lastPoll = 0;
+    b->atPending = false;
+    if (next == XC03_BOOT_PROBE) {
+        b->atProbes = 0;
+    }
+}
+
+// Corre en la tarea de esp_timer: baja el PWRKEY a tiempo aunque loop()
+// esté ocupado
+static inline void xc03BootPulseEnd(void *arg)
+{
+    XC03Boot *b = (XC03Boot *)arg;
+
+    digitalWrite(b->pwrKeyPin, LOW);
+    b->pulseDone = true;
+}
+
+/**
+ * Prepara el arranque. 'steps' debe vivir mientras se use 'b' (un
+ * arreglo const global). El PWRKEY ya debe estar en OUTPUT y LOW.
+ */
+static inline void xc03BootBegin(XC03Boot *b, TinyGsm *modem, Print &log, uint8_t pwrKeyPin,
+                                 const XC03BootStep *steps, uint8_t stepCount,
+                                 const XC03BootHooks *hooks)
+{
+    esp_timer_create_args_t timer = {};
+
+    memset(b, 0, sizeof(*b));
+    b->modem = modem;
+    b->log = &log;
+    b->pwrKeyPin = pwrKeyPin;
+    b->steps = steps;
+    b->stepCount = stepCount < XC03_BOOT_MAX_STEPS ? stepCount : XC03_BOOT_MAX_STEPS;
+    b->hooks = hooks;
+
+    timer.callback = xc03BootPulseEnd;
+    timer.arg = b;
+    timer.name = "pwrkey";
+    if (esp_timer_create(&timer, &b->pulseTimer) != ESP_OK) {
+        b->pulseTimer = NULL;
+    }
+    xc03BootEnter(b, XC03_BOOT_PROBE);
+}
+
+// Datos del PDP para xc03BootStepNetwork()
+static inline void xc03BootSetApn(XC03Boot *b, const char *apn, const char *user, const char *pass)
+{
+    b->apn = apn;
+    b->user = user;
+    b->pass = pass;
+}
+
+// Sockets abiertos por el sketch (Blynk el 0, la telemetría el 1...)
+// que xc03BootCloseSockets() cierra en un arranque en caliente
+static inline void xc03BootSetSockets(XC03Boot *b, uint8_t count)
+{
+    b->sockets = count;
+}
+
+// Para usar desde un paso: imprime el motivo y regresa XC03_STEP_FAIL
+static inline XC03StepResult xc03BootFail(XC03Boot *b, const char *msg)
+{
+    b->log->println(msg);
+    return XC03_STEP_FAIL;
+}
+
+// Para usar desde un paso: true si ya pasaron 'everyMs' desde la
+// última consulta (y la marca)
+static inline bool xc03BootPoll(XC03Boot *b, unsigned long everyMs)
+{
+    unsigned long now = millis();
+
+    if (b->lastPoll != 0 && now - b->lastPoll < everyMs) {
+        return false;
+    }
+    b->lastPoll = now;
+    return true;
+}
+
+static inline bool xc03BootReady(const XC03Boot *b)
+{
+    return b->state == XC03_BOOT_READY;
+}
+
+
+//##################################################################
+// ### PRUEBA CON "AT" ###
+//##################################################################
+
+static inline void xc03BootProbeSend(XC03Boot *b)
+{
+    if (b->hooks && b->hooks->probeSend) {
+        b->hooks->probeSend(b);
+        return;
+    }
+    b->modem->sendAT("");
+}
+
+static inline XC03ProbeResult xc03BootProbePoll(XC03Boot *b, unsigned long waited)
+{
+    if (b->hooks && b->hooks->probePoll) {
+        return b->hooks->probePoll(b, waited);
+    }
+    if (b->modem->stream.available()) {
+        // Ya llegó algo: leerlo toma ~1 ms
+        return b->modem->waitResponse(XC03_BOOT_AT_REPLY_MS) == 1 ? XC03_PROBE_OK : XC03_PROBE_NONE;
+    }
+    return waited >= XC03_BOOT_AT_REPLY_MS ? XC03_PROBE_NONE : XC03_PROBE_WAIT;
+}
+
+
+//##################################################################
+// ### PASOS COMUNES (TinyGSM) ###
+//##################################################################
+
+/**
+ * modem.init() e información del módem. Si el módem ya estaba
+ * encendido, registrado y con el PDP activo (sólo se reinició el
+ * ESP32), se usa tal cual: los pasos de red y PDP se saltan.
+ */
+static inline XC03StepResult xc03BootStepInit(XC03Boot *b, unsigned long inStep)
+{
+    (void)inStep;
+    // El módem ya contesta: estos comandos regresan en milisegundos
+    if (!b->modem->init()) {
+        return xc03BootFail(b, "Error al iniciar el módem");
+    }
+    b->log->print("Modem: ");
+    b->log->println(b->modem->getModemInfo());
+
+    // Si sólo está registrado, xc03BootStepNetwork() lo ve en su primera consulta
+    b->reuse = b->alive && b->apn && b->modem->isNetworkConnected() && b->modem->isGprsConnected();
+    if (b->reuse) {
+        b->log->println("Módem ya conectado: se reutiliza el PDP");
+        if (b->hooks && b->hooks->onReuse) {
+            b->hooks->onReuse(b);
+        }
+    }
+    return XC03_STEP_DONE;
+}
+
+// Espera el registro (CEREG) y pide la activación del PDP
+static inline XC03StepResult xc03BootStepNetwork(XC03Boot *b, unsigned long inStep)
+{
+    if (b->reuse) {
+        return XC03_STEP_SKIP;
+    }
+    if (inStep >= XC03_BOOT_NET_TIMEOUT_MS) {
+        return xc03BootFail(b, "Sin registro en la red");
+    }
+    if (!xc03BootPoll(b, XC03_BOOT_NET_POLL_MS) || !b->modem->isNetworkConnected()) {
+        return XC03_STEP_WAIT;
+    }
+    // Igual que gprsConnect(), pero sin esperar la activación
+    b->modem->sendAT(GF("+CNCFG=0,1,\""), b->apn, GF("\",\""), b->user, GF("\",\""), b->pass, GF("\""));
+    b->modem->waitResponse();
+    b->modem->sendAT(GF("+CNACT=0,1"));
+    b->modem->waitResponse();
+    return XC03_STEP_DONE;
+}
+
+// Espera a que el PDP quede activo
+static inline XC03StepResult xc03BootStepAttach(XC03Boot *b, unsigned long inStep)
+{
+    if (b->reuse) {
+        return XC03_STEP_SKIP;
+    }
+    if (inStep >= XC03_BOOT_ATTACH_TIMEOUT_MS) {
+        return xc03BootFail(b, "El PDP no se activó");
+    }
+    if (!xc03BootPoll(b, XC03_BOOT_ATTACH_POLL_MS) || !b->modem->isGprsConnected()) {
+        return XC03_STEP_WAIT;
+    }
+    return XC03_STEP_DONE;
+}
+
+/**
+ * Gancho onReuse: en un arranque en caliente los sockets pudieron
+ * quedar abiertos antes del reinicio. Cierra los primeros
+ * b->sockets (xc03BootSetSockets()).
+ */
+static inline void xc03BootCloseSockets(XC03Boot *b)
+{
+    for (uint8_t mux = 0; mux < b->sockets; mux++) {
+        b->modem->sendAT(GF("+CACLOSE="), mux);
+        b->modem->waitResponse(XC03_BOOT_AT_REPLY_MS);
+    }
+}
+
+#ifdef BlynkSimpleTinyGSM_h
+// Datos de Blynk.Cloud para xc03BootStepBlynk()
+static inline void xc03BootSetBlynk(XC03Boot *b, const char *auth, const char *domain)
+{
+    b->blynkAuth = auth;
+    b->blynkDomain = domain;
+}
+
+// Configura Blynk y pide la conexión. Si falla, Blynk.run() reintenta
+// cada 5 s: el arranque no espera el login.
+static inline XC03StepResult xc03BootStepBlynk(XC03Boot *b, unsigned long inStep)
+{
+    (void)inStep;
+    b->log->println("Conectando a Blynk...");
+    Blynk.config(*b->modem, b->blynkAuth, b->blynkDomain);
+    Blynk.connect();
+    return XC03_STEP_DONE;
+}
+#endif
+
+
+//##################################################################
+// ### MÁQUINA DE ESTADOS ###
+//##################################################################
+
+/**
+ * Avanza el arranque UN paso. Ninguna etapa espera un tiempo fijo:
+ * cada una pregunta y regresa. Lo más largo que se detiene loop() es
+ * una respuesta AT (o lo que tarde un paso del sketch).
+ * @return true cuando terminaron todos los pasos.
+ */
+static inline bool xc03BootUpdate(XC03Boot *b)
+{
+    unsigned long now = millis();
+    unsigned long inState = now - b->stateAt;
+
+    switch (b->state) {
+
+    case XC03_BOOT_PWRKEY:
+        if (!b->pulsing) {
+            b->log->println("Encendiendo módem XC03...");
+            b->pulsing = true;
+            b->pulseDone = false;
+            digitalWrite(b->pwrKeyPin, HIGH);
+            if (!b->pulseTimer || esp_timer_start_once(b->pulseTimer, XC03_BOOT_PULSE_MS * 1000ULL) != ESP_OK) {
+                // Sin timer: mejor detener loop() 1.1 s que arriesgar un pulso de apagado
+                delay(XC03_BOOT_PULSE_MS);
+                xc03BootPulseEnd(b);
+            }
+            break;
+        }
+        if (b->pulseDone) {
+            b->pulsing = false;
+            xc03BootEnter(b, XC03_BOOT_WAIT_AT);
+        }
+        break;
+
+    case XC03_BOOT_PROBE:
+    case XC03_BOOT_WAIT_AT:
+        if (b->atPending) {
+            XC03ProbeResult r = xc03BootProbePoll(b, now - b->lastPoll);
+            if (r == XC03_PROBE_WAIT) {
+                break;
+            }
+            b->atPending = false;
+            if (r == XC03_PROBE_OK) {
+                b->alive = b->state == XC03_BOOT_PROBE;
+                if (b->atMs == 0) {
+                    b->warm = b->alive;
+                    b->atMs = millis();
+                }
+                b->step = 0;
+                xc03BootEnter(b, b->stepCount ? XC03_BOOT_STEPS : XC03_BOOT_READY);
+            }
+            break;
+        }
+        if (b->state == XC03_BOOT_PROBE && b->atProbes >= XC03_BOOT_WARM_TRIES) {
+            // No contestó: está apagado, hay que encenderlo
+            xc03BootEnter(b, XC03_BOOT_PWRKEY);
+            break;
+        }
+        if (b->state == XC03_BOOT_WAIT_AT && inState >= XC03_BOOT_AT_READY_MS) {
+            b->log->println("El módem no contesta, otro pulso...");
+            xc03BootEnter(b, XC03_BOOT_PWRKEY);
+            break;
+        }
+        if (b->lastPoll == 0 || now - b->lastPoll >= XC03_BOOT_AT_POLL_MS) {
+            xc03BootProbeSend(b);
+            b->atPending = true;
+            b->lastPoll = now;
+            b->atProbes++;
+        }
+        break;
+
+    case XC03_BOOT_STEPS: {
+        XC03StepResult r = b->steps[b->step].run(b, inState);
+        if (r == XC03_STEP_WAIT) {
+            break;
+        }
+        if (r == XC03_STEP_FAIL) {
+            xc03BootEnter(b, XC03_BOOT_RETRY);
+            break;
+        }
+        b->stepMs[b->step] = r == XC03_STEP_DONE ? millis() : 0;
+        b->step++;
+        xc03BootEnter(b, b->step < b->stepCount ? XC03_BOOT_STEPS : XC03_BOOT_READY);
+        break;
+    }
+
+    case XC03_BOOT_READY:
+        return true;
+
+    case XC03_BOOT_RETRY:
+        // Un error de red o de init no quiere decir que esté apagado:
+        // si todavía contesta "AT", otro pulso lo APAGARÍA
+        if (inState >= XC03_BOOT_RETRY_MS) {
+            xc03BootEnter(b, XC03_BOOT_PROBE);
+        }
+        break;
+    }
+    return b->state == XC03_BOOT_READY;
+}
+
+static inline void xc03BootPrintStage(Print *out, const char *name, unsigned long ms)
+{
+    out->print(name);
+    if (ms == 0) {
+        // Etapa saltada en un arranque en caliente
+        out->print("(ya estaba)");
+        return;
+    }
+    out->print(ms / 1000.0f);
+    out->print(" s");
+}
+
+/**
+ * Imprime "Arranque: AT 5.02 s, red 13.10 s, ..." (sin fin de línea:
+ * el sketch puede agregar sus propias etapas).
+ */
+static inline void xc03BootPrintTimes(XC03Boot *b)
+{
+    b->log->print(b->warm ? "Arranque en caliente: " : "Arranque: ");
+    xc03BootPrintStage(b->log, "AT ", b->atMs);
+    for (uint8_t i = 0; i < b->stepCount; i++) {
+        if (b->steps[i].name) {
+            b->log->print(", ");
+            b->log->print(b->steps[i].name);
+            b->log->print(" ");
+            xc03BootPrintStage(b->log, "", b->stepMs[i]);
+        }
+    }
+}
+
+/**
+ * Se llama cada vez que sale un dato; la primera vez imprime
+ * "Arranque: ..., primer dato 21.40 s" (lo que de verdad espera quien
+ * mira la app, no sólo la conexión).
+ */
+static inline void xc03BootMarkData(XC03Boot *b)
+{
+    if (b->dataMs != 0) {
+        return;
+    }
+    b->dataMs = millis();
+
+    xc03BootPrintTimes(b);
+    xc03BootPrintStage(b->log, ", primer dato ", b->dataMs);
+    b->log->println();
+}
@@ -0,0 +1,478 @@
+/*
+ * ===================================================================
+ * LECTURA DE POSICIONES DEL XC03 (SIM7080G) SIN String
+ *
+ * modem.getGPS() de TinyGSM arma un String por cada campo de la
+ * respuesta (y otro más mientras espera el "OK"): con una consulta
+ * por segundo, en un localizador que corre semanas, eso es memoria
+ * dinámica que se pide y se suelta sin parar y que termina
+ * fragmentando el heap.
+ *
+ * Aquí la respuesta se copia del puerto (SerialAT) a un búfer fijo
+ * de una línea y se analiza en una sola pasada, campo por campo, sin
+ * pedir memoria. Los números se convierten a enteros con punto fijo
+ * (sin float ni atof), así que XC03Fix mide 28 bytes.
+ *
+ * Entradas que entiende:
+ *   +CGNSINF: ...     Respuesta del XC03 a AT+CGNSINF
+ *   $--RMC, $--GGA    Frases NMEA de cualquier talker (GP, GN, GL...),
+ *                     con su checksum. Las dos se juntan en el mismo
+ *                     XC03Fix: RMC trae fecha, velocidad y rumbo; GGA
+ *                     altitud, satélites usados y HDOP.
+ *
+ * Consulta sin esperar (para usar en loop()):
+ *   xc03GnssAsk()   Manda AT+CGNSINF y regresa de inmediato.
+ *   xc03GnssPoll()  Lee lo que ya llegó. XC03_GNSS_PENDING mientras
+ *                   falte el "OK"; XC03_GNSS_FIX si hubo posición.
+ * Estas dos leen SerialAT por su cuenta. Si el puerto lo lleva el
+ * motor de XC03-AT.h, se usa xc03GnssOnLine() como callback de
+ * xc03AtQuery("+CGNSINF", "+CGNSINF:", ...).
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "XC03-AT.h"                // XC03LineReader / xc03ReadLine
+
+#define XC03_GNSS_REPLY_MS 1000UL   // Espera máx. del "OK" de AT+CGNSINF
+
+typedef struct {
+    int32_t latitude;           // Grados × 1 000 000 (+ norte)
+    int32_t longitude;          // Grados × 1 000 000 (+ este)
+    int32_t altitude;           // Metros × 10
+    uint16_t speed;             // km/h × 10
+    uint16_t course;            // Grados × 10
+    uint16_t hdop;              // × 100
+    uint8_t vsat;               // Satélites en vista
+    uint8_t usat;               // Satélites usados
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+    uint8_t valid;              // 1: la posición es buena
+} XC03Fix;
+
+
+//##################################################################
+// ### NÚMEROS Y CAMPOS ###
+//##################################################################
+
+// "[-]123.4567" -> entero × 10^decimals (trunca lo que sobra).
+// Falla si el campo está vacío o trae algo que no es número.
+static inline bool xc03ParseFixed(const char *s, const char *end, uint8_t decimals, int32_t *out)
+{
+    bool negative = false;
+    bool digits = false;
+    int32_t v = 0;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+    while (s < end && *s >= '0' && *s <= '9') {
+        v = v * 10 + (*s - '0');
+        digits = true;
+        s++;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        while (s < end && *s >= '0' && *s <= '9') {
+            if (decimals) {
+                v = v * 10 + (*s - '0');
+                decimals--;
+            }
+            digits = true;
+            s++;
+        }
+    }
+    if (!digits || s != end) {
+        return false;
+    }
+    while (decimals) {
+        v *= 10;
+        decimals--;
+    }
+    *out = negative ? -v : v;
+    return true;
+}
+
+// n dígitos seguidos como entero (quien llama revisa la longitud)
+static inline uint16_t xc03Digits(const char *s, uint8_t n)
+{
+    uint16_t v = 0;
+    while (n--) {
+        v = v * 10 + (*s++ - '0');
+    }
+    return v;
+}
+
+// NMEA "ddmm.mmmmm" (o "dddmm.mmmmm") -> grados × 1 000 000
+static inline bool xc03ParseNmeaAngle(const char *s, const char *end, char hemisphere, int32_t *out)
+{
+    int32_t v;  // Minutos × 100 000, con los grados en las centenas
+
+    if (!xc03ParseFixed(s, end, 5, &v) || v < 0) {
+        return false;
+    }
+    int32_t degrees = v / 10000000;
+    int32_t minutes = v % 10000000;
+    v = degrees * 1000000 + minutes / 6;    // min × 1e5 × 10 / 60
+    *out = (hemisphere == 'S' || hemisphere == 'W') ? -v : v;
+    return true;
+}
+
+// Recorre una línea campo por campo. En NMEA también lleva el XOR
+// de lo recorrido para revisar el checksum al llegar al '*'.
+typedef struct {
+    const char *p;
+    const char *end;
+    uint8_t sum;
+} XC03Cursor;
+
+// Deja en [*start, *stop) el siguiente campo; false al terminar la línea
+static inline bool xc03NextField(XC03Cursor *c, const char **start, const char **stop)
+{
+    if (c->p > c->end || (c->p < c->end && *c->p == '*')) {
+        return false;
+    }
+    *start = c->p;
+    while (c->p < c->end && *c->p != ',' && *c->p != '*') {
+        c->sum ^= (uint8_t)*c->p;
+        c->p++;
+    }
+    *stop = c->p;
+    if (c->p < c->end && *c->p == ',') {
+        c->sum ^= ',';
+        c->p++;
+    } else if (c->p == c->end) {
+        c->p++;                 // Marca el fin para la próxima llamada
+    }
+    return true;
+}
+
+static inline int8_t xc03Hex(char h)
+{
+    if (h >= '0' && h <= '9') return h - '0';
+    if (h >= 'A' && h <= 'F') return h - 'A' + 10;
+    if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+    return -1;
+}
+
+// Al terminar los campos: ¿el "*hh" coincide con el XOR?
+static inline bool xc03ChecksumOk(const XC03Cursor *c)
+{
+    if (c->p + 3 > c->end || *c->p != '*') {
+        return false;
+    }
+    int8_t hi = xc03Hex(c->p[1]);
+    int8_t lo = xc03Hex(c->p[2]);
+    return hi >= 0 && lo >= 0 && (uint8_t)(hi << 4 | lo) == c->sum;
+}
+
+
+//##################################################################
+// ### +CGNSINF ###
+//##################################################################
+
+/**
+ * +CGNSINF: <run>,<fix>,<UTC>,<lat>,<lon>,<alt>,<km/h>,<rumbo>,<modo>,,
+ *           <HDOP>,<PDOP>,<VDOP>,,<en vista>,<usados>,...
+ * Regresa true sólo con run = 1, fix = 1 y latitud/longitud; si no,
+ * 'fix' no se toca. Sin fix (lo normal mientras busca) sale en el
+ * segundo campo.
+ */
+static inline bool xc03ParseCGNSINF(const char *line, size_t len, XC03Fix *fix)
+{
+    static const char PREFIX[] = "+CGNSINF:";
+    const size_t prefixLen = sizeof(PREFIX) - 1;
+
+    if (len < prefixLen || memcmp(line, PREFIX, prefixLen) != 0) {
+        return false;
+    }
+
+    XC03Cursor c = { line + prefixLen, line + len, 0 };
+    while (c.p < c.end && *c.p == ' ') {
+        c.p++;
+    }
+
+    XC03Fix f;
+    memset(&f, 0, sizeof(f));
+    const char *s, *e;
+    int32_t v;
+    uint8_t position = 0;       // Bit 0 latitud, bit 1 longitud
+
+    for (uint8_t field = 0; field <= 15 && xc03NextField(&c, &s, &e); field++) {
+        switch (field) {
+        case 0:                 // GNSS encendido
+        case 1:                 // Fix
+            if (e - s != 1 || *s != '1') {
+                return false;
+            }
+            break;
+        case 2:                 // yyyyMMddhhmmss.sss
+            if (e - s >= 14) {
+                f.year = xc03Digits(s, 4);
+                f.month = (uint8_t)xc03Digits(s + 4, 2);
+                f.day = (uint8_t)xc03Digits(s + 6, 2);
+                f.hour = (uint8_t)xc03Digits(s + 8, 2);
+                f.minute = (uint8_t)xc03Digits(s + 10, 2);
+                f.second = (uint8_t)xc03Digits(s + 12, 2);
+            }
+            break;
+        case 3:
+            if (xc03ParseFixed(s, e, 6, &f.latitude)) position |= 1;
+            break;
+        case 4:
+            if (xc03ParseFixed(s, e, 6, &f.longitude)) position |= 2;
+            break;
+        case 5:
+            xc03ParseFixed(s, e, 1, &f.altitude);
+            break;
+        case 6:
+            if (xc03ParseFixed(s, e, 1, &v)) f.speed = (uint16_t)v;
+            break;
+        case 7:
+            if (xc03ParseFixed(s, e, 1, &v)) f.course = (uint16_t)v;
+            break;
+        case 10:
+            if (xc03ParseFixed(s, e, 2, &v)) f.hdop = (uint16_t)v;
+            break;
+        case 14:
+            if (xc03ParseFixed(s, e, 0, &v)) f.vsat = (uint8_t)v;
+            break;
+        case 15:
+            if (xc03ParseFixed(s, e, 0, &v)) f.usat = (uint8_t)v;
+            break;
+        }
+    }
+
+    if (position != 3) {
+        return false;
+    }
+    f.valid = 1;
+    *fix = f;
+    return true;
+}
+
+
+//##################################################################
+// ### NMEA: RMC Y GGA ###
+//##################################################################
+
+// "$GNRMC" y "$GPRMC" son la misma frase: sólo importa el tipo
+static inline bool xc03NmeaIs(const char *line, size_t len, const char *type)
+{
+    return len > 7 && line[0] == '$' && line[6] == ',' && memcmp(line + 3, type, 3) == 0;
+}
+
+// Campos de RMC y GGA que se convierten al final, ya con el checksum
+// revisado: así una frase mala no deja 'fix' a medias.
+typedef struct {
+    const char *time, *lat, *latEnd, *lon, *lonEnd;
+    char latHemisphere, lonHemisphere;
+} XC03NmeaPosition;
+
+static inline bool xc03NmeaApplyPosition(const XC03NmeaPosition *n, XC03Fix *f)
+{
+    if (!n->lat || !n->lon
+        || !xc03ParseNmeaAngle(n->lat, n->latEnd, n->latHemisphere, &f->latitude)
+        || !xc03ParseNmeaAngle(n->lon, n->lonEnd, n->lonHemisphere, &f->longitude)) {
+        return false;
+    }
+    if (n->time) {
+        f->hour = (uint8_t)xc03Digits(n->time, 2);
+        f->minute = (uint8_t)xc03Digits(n->time + 2, 2);
+        f->second = (uint8_t)xc03Digits(n->time + 4, 2);
+    }
+    return true;
+}
+
+// Campos 1 a 5 de GGA (y 1, 3 a 6 de RMC): hora y posición
+static inline void xc03NmeaPositionField(XC03NmeaPosition *n, uint8_t slot, const char *s, const char *e)
+{
+    switch (slot) {
+    case 0: n->time = e - s >= 6 ? s : NULL; break;
+    case 1: n->lat = s; n->latEnd = e; break;
+    case 2: n->latHemisphere = s < e ? *s : 0; break;
+    case 3: n->lon = s; n->lonEnd = e; break;
+    case 4: n->lonHemisphere = s < e ? *s : 0; break;
+    }
+}
+
+/**
+ * $--RMC,hhmmss.ss,A,ddmm.mm,N,dddmm.mm,W,nudos,rumbo,ddmmyy,...*hh
+ * Actualiza en 'fix' posición, hora, fecha, velocidad y rumbo.
+ * Con estado 'V' (sin posición) o checksum malo regresa false y no
+ * toca 'fix'.
+ */
+static inline bool xc03ParseRMC(const char *line, size_t len, XC03Fix *fix)
+{
+    if (!xc03NmeaIs(line, len, "RMC")) {
+        return false;
+    }
+
+    XC03Cursor c = { line + 1, line + len, 0 };
+    XC03NmeaPosition n;
+    memset(&n, 0, sizeof(n));
+    const char *s, *e, *date = NULL;
+    int32_t knots = 0, course = 0;
+    bool active = false;
+
+    for (uint8_t field = 0; xc03NextField(&c, &s, &e); field++) {
+        switch (field) {
+        case 1: xc03NmeaPositionField(&n, 0, s, e); break;
+        case 2: active = e - s == 1 && *s == 'A'; break;
+        case 3: case 4: case 5: case 6:
+            xc03NmeaPositionField(&n, field - 2, s, e);
+            break;
+        case 7: xc03ParseFixed(s, e, 2, &knots); break;
+        case 8: xc03ParseFixed(s, e, 1, &course); break;
+        case 9: date = e - s == 6 ? s : NULL; break;
+        }
+    }
+
+    XC03Fix f = *fix;
+    if (!active || !xc03ChecksumOk(&c) || !xc03NmeaApplyPosition(&n, &f)) {
+        return false;
+    }
+    f.speed = (uint16_t)(knots * 1852 / 10000);     // nudos × 100 -> km/h × 10
+    f.course = (uint16_t)course;
+    if (date) {
+        f.day = (uint8_t)xc03Digits(date, 2);
+        f.month = (uint8_t)xc03Digits(date + 2, 2);
+        uint16_t yy = xc03Digits(date + 4, 2);
+        f.year = yy < 80 ? 2000 + yy : 1900 + yy;  // NMEA sólo trae dos dígitos
+    }
+    f.valid = 1;
+    *fix = f;
+    return true;
+}
+
+/**
+ * $--GGA,hhmmss.ss,ddmm.mm,N,dddmm.mm,W,calidad,usados,HDOP,alt,M,...*hh
+ * Actualiza en 'fix' posición, hora, altitud, satélites usados y HDOP.
+ * Con calidad 0 (sin posición) o checksum malo regresa false.
+ */
+static inline bool xc03ParseGGA(const char *line, size_t len, XC03Fix *fix)
+{
+    if (!xc03NmeaIs(line, len, "GGA")) {
+        return false;
+    }
+
+    XC03Cursor c = { line + 1, line + len, 0 };
+    XC03NmeaPosition n;
+    memset(&n, 0, sizeof(n));
+    const char *s, *e;
+    int32_t quality = 0, used = 0, hdop = 0, altitude = 0;
+
+    for (uint8_t field = 0; xc03NextField(&c, &s, &e); field++) {
+        switch (field) {
+        case 1: case 2: case 3: case 4: case 5:
+            xc03NmeaPositionField(&n, field - 1, s, e);
+            break;
+        case 6: xc03ParseFixed(s, e, 0, &quality); break;
+        case 7: xc03ParseFixed(s, e, 0, &used); break;
+        case 8: xc03ParseFixed(s, e, 2, &hdop); break;
+        case 9: xc03ParseFixed(s, e, 1, &altitude); break;
+        }
+    }
+
+    XC03Fix f = *fix;
+    if (quality == 0 || !xc03ChecksumOk(&c) || !xc03NmeaApplyPosition(&n, &f)) {
+        return false;
+    }
+    f.usat = (uint8_t)used;
+    f.hdop = (uint16_t)hdop;
+    f.altitude = altitude;
+    f.valid = 1;
+    *fix = f;
+    return true;
+}
+
+// Cualquiera de las dos (otras frases regresan false)
+static inline bool xc03ParseNMEA(const char *line, size_t len, XC03Fix *fix)
+{
+    return xc03ParseRMC(line, len, fix) || xc03ParseGGA(line, len, fix);
+}
+
+
+//##################################################################
+// ### CONSULTA AT+CGNSINF SIN ESPERAR ###
+//##################################################################
+
+enum XC03GnssReply {
+    XC03_GNSS_PENDING,          // Falta el "OK"
+    XC03_GNSS_FIX,              // Hubo posición (ya está en 'fix')
+    XC03_GNSS_NO_FIX,           // Contestó, pero sin posición
+    XC03_GNSS_TIMEOUT           // No contestó a tiempo
+};
+
+typedef struct {
+    XC03LineReader line;
+    XC03Fix fix;                // La respuesta puede tardar varias llamadas
+    unsigned long askedAt;
+    bool waiting;
+    bool gotFix;
+} XC03GnssQuery;
+
+// Manda AT+CGNSINF. Lo que quedara de una consulta anterior se tira.
+static inline void xc03GnssAsk(XC03GnssQuery *q, Stream &s, unsigned long now)
+{
+    while (s.available() > 0) {
+        s.read();
+    }
+    q->line.len = 0;
+    q->line.overflow = false;
+    q->line.ready = false;
+    s.print("AT+CGNSINF\r\n");
+    q->askedAt = now;
+    q->waiting = true;
+    q->gotFix = false;
+}
+
+// Lee lo que ya llegó de la respuesta y regresa de inmediato.
+// 'fix' sólo se llena cuando regresa XC03_GNSS_FIX.
+static inline XC03GnssReply xc03GnssPoll(XC03GnssQuery *q, Stream &s, unsigned long now, XC03Fix *fix)
+{
+    XC03GnssReply reply = XC03_GNSS_PENDING;
+
+    if (!q->waiting) {
+        return XC03_GNSS_NO_FIX;
+    }
+    while (reply == XC03_GNSS_PENDING && xc03ReadLine(s, &q->line)) {
+        const char *l = q->line.buf;
+        if (xc03ParseCGNSINF(l, q->line.len, &q->fix)) {
+            q->gotFix = true;
+        } else if (strcmp(l, "OK") == 0 || strcmp(l, "ERROR") == 0) {
+            reply = q->gotFix ? XC03_GNSS_FIX : XC03_GNSS_NO_FIX;
+        }
+    }
+    if (reply == XC03_GNSS_PENDING && now - q->askedAt >= XC03_GNSS_REPLY_MS) {
+        reply = q->gotFix ? XC03_GNSS_FIX : XC03_GNSS_TIMEOUT;
+    }
+    if (reply == XC03_GNSS_PENDING) {
+        return reply;
+    }
+    q->waiting = false;
+    if (reply == XC03_GNSS_FIX) {
+        *fix = q->fix;
+    }
+    return reply;
+}
+
+
+//##################################################################
+// ### CON EL MOTOR DE XC03-AT.h ###
+//##################################################################
+
+typedef struct {
+    XC03Fix fix;
+    bool valid;                 // Hubo posición en la última respuesta
+} XC03GnssResult;
+
+// Callback 'onLine' para xc03AtQuery(); 'ctx' es un XC03GnssResult
+static inline void xc03GnssOnLine(const char *line, uint8_t len, void *ctx)
+{
+    XC03GnssResult *r = (XC03GnssResult *)ctx;
+    if (xc03ParseCGNSINF(line, len, &r->fix)) {
+        r->valid = true;
+    }
+}
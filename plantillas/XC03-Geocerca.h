@@ -0,0 +1,637 @@
+/*
+ * ===================================================================
+ * GEOCERCAS EN EL EQUIPO PARA EL LOCALIZADOR
+ *
+ * En lugar de subir cada posición para que la nube decida si el
+ * vehículo entró o salió de una zona, el XC01 lo decide aquí y sólo
+ * sube los eventos de ENTRADA y SALIDA (~3 bytes cada uno).
+ *
+ * Cercas: círculos (centro y radio en metros) y polígonos (3 o más
+ * vértices, cóncavos también), hasta GEO_MAX_FENCES en un arreglo
+ * fijo. Coordenadas en grados × 1e6, como en XC03Fix.
+ *
+ * Revisión de una posición en dos pasos:
+ * 1. Índice de rejilla: la caja que cubre todas las cercas se parte
+ *    en GEO_GRID × GEO_GRID celdas y cada celda guarda las cercas
+ *    cuya caja (bbox) la toca. La posición cae en UNA celda: sólo esas
+ *    cercas son candidatas, y de ésas sólo las que tienen la posición
+ *    dentro de su caja pasan al paso 2.
+ * 2. Prueba exacta: distancia al centro (círculo) o cruce de rayo con
+ *    enteros de 64 bits (polígono).
+ * Con cientos de cercas la revisión cuesta lo mismo que con unas
+ * cuantas: lo que importa es cuántas caen en la celda. Si las cajas
+ * no caben en GEO_MAX_CELL_ITEMS, se revisan todas las cajas (más
+ * lento, mismo resultado).
+ *
+ * Histéresis: se entra al cruzar el borde, pero se sale hasta estar
+ * 'hysteresisM' metros afuera. Así el ruido del GPS en el borde no
+ * manda entradas y salidas sin parar.
+ *
+ * Las cercas llegan como texto (geoLoad()), por ejemplo en un pin de
+ * Blynk o un archivo por HTTP:
+ *   BLYNK_WRITE(V20) { geoLoad(&cercas, param.asStr(), strlen(param.asStr())); }
+ * Cálculos planos (metros = grados × 111 km): sirven para cercas de
+ * hasta decenas de km que no cruzan el meridiano 180.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include "XC03-GNSS.h"              // xc03ParseFixed
+#include "XC03-Varint.h"
+
+#ifndef GEO_MAX_FENCES
+#define GEO_MAX_FENCES 256
+#endif
+#ifndef GEO_MAX_VERTICES
+#define GEO_MAX_VERTICES 2048       // Vértices de todos los polígonos
+#endif
+#ifndef GEO_MAX_CELL_ITEMS
+#define GEO_MAX_CELL_ITEMS 4096     // Cercas por celda, sumando todas las celdas
+#endif
+#define GEO_GRID 32                 // Celdas por lado del índice
+#define GEO_MAX_INSIDE 16           // Cercas en las que se puede estar a la vez
+#define GEO_HYSTERESIS_M 10         // Metros afuera para contar una salida
+#define GEO_MAX_RADIUS_M 100000UL
+#define GEO_M_PER_E6 0.1113195f     // Metros por 1e-6 grados de latitud
+
+enum GeoShape {
+    GEO_CIRCLE = 0,
+    GEO_POLYGON = 1
+};
+
+enum GeoEventType {
+    GEO_ENTER = 0,
+    GEO_EXIT = 1
+};
+
+typedef struct {
+    int32_t minLat, minLon, maxLat, maxLon;    // Grados × 1e6
+} GeoBox;
+
+typedef struct {
+    int32_t lat, lon;
+} GeoPoint;
+
+typedef struct {
+    GeoBox box;
+    uint16_t id;                // El que le dio la nube
+    uint8_t shape;              // GeoShape
+    bool inside;
+    float lonScale;             // Metros por 1e-6 grados de longitud ahí
+    GeoPoint center;            // Círculo
+    float radiusM;
+    uint16_t first, count;      // Polígono: sus vértices en GeoSet.vertices
+} GeoFence;
+
+typedef struct {
+    uint32_t t;                 // Segundos Unix de la posición
+    uint16_t fenceId;
+    uint8_t type;               // GeoEventType
+} GeoEvent;
+
+typedef struct {
+    GeoFence fences[GEO_MAX_FENCES];
+    uint16_t count;
+    GeoPoint vertices[GEO_MAX_VERTICES];
+    uint16_t vertexCount;
+    // Índice de rejilla (geoIndexBuild())
+    bool indexed;               // false: se revisan todas las cajas
+    GeoBox box;                 // Caja de todas las cercas
+    int32_t cellLat, cellLon;   // Tamaño de una celda (grados × 1e6)
+    uint16_t cellStart[GEO_GRID * GEO_GRID + 1];
+    uint16_t cellItems[GEO_MAX_CELL_ITEMS];
+    // Cercas en las que está ahora
+    uint16_t insideList[GEO_MAX_INSIDE];
+    uint8_t insideCount;
+    uint16_t hysteresisM;
+    // Estadísticas
+    uint32_t fixes;             // Posiciones revisadas
+    uint32_t exactTests;        // Pruebas exactas (pasaron la caja)
+    uint32_t events;
+    uint32_t loadErrors;        // Registros de geoLoad() que no se usaron
+    uint32_t overflows;         // Entradas perdidas (GEO_MAX_INSIDE)
+} GeoSet;
+
+static inline void geoClear(GeoSet *s)
+{
+    s->count = 0;
+    s->vertexCount = 0;
+    s->insideCount = 0;
+    s->indexed = false;
+}
+
+static inline void geoBegin(GeoSet *s, uint16_t hysteresisM)
+{
+    memset(s, 0, sizeof(*s));
+    s->hysteresisM = hysteresisM;
+}
+
+
+//##################################################################
+// ### PRUEBAS EXACTAS ###
+//##################################################################
+
+static inline bool geoBoxHas(const GeoBox *b, int32_t lat, int32_t lon)
+{
+    return lat >= b->minLat && lat <= b->maxLat && lon >= b->minLon && lon <= b->maxLon;
+}
+
+// Cruce de rayo hacia el este: cada borde que cruza cambia adentro/afuera
+static inline bool geoPolygonHas(const GeoPoint *v, uint16_t n, int32_t lat, int32_t lon)
+{
+    bool in = false;
+
+    for (uint16_t i = 0, j = n - 1; i < n; j = i++) {
+        const GeoPoint *a = &v[j];
+        const GeoPoint *b = &v[i];
+        if ((a->lat > lat) != (b->lat > lat)) {
+            int64_t lhs = (int64_t)(lon - a->lon) * (b->lat - a->lat);
+            int64_t rhs = (int64_t)(lat - a->lat) * (b->lon - a->lon);
+            if (b->lat > a->lat ? lhs < rhs : lhs > rhs) {
+                in = !in;
+            }
+        }
+    }
+    return in;
+}
+
+// ¿La posición está dentro de la cerca? (sin revisar la caja)
+static inline bool geoFenceHas(const GeoSet *s, const GeoFence *f, int32_t lat, int32_t lon)
+{
+    if (f->shape == GEO_CIRCLE) {
+        float dy = (lat - f->center.lat) * GEO_M_PER_E6;
+        float dx = (lon - f->center.lon) * f->lonScale;
+        return dx * dx + dy * dy <= f->radiusM * f->radiusM;
+    }
+    return geoPolygonHas(s->vertices + f->first, f->count, lat, lon);
+}
+
+// Metros desde la posición hasta el borde de la cerca
+static inline float geoFenceDistanceM(const GeoSet *s, const GeoFence *f, int32_t lat, int32_t lon)
+{
+    if (f->shape == GEO_CIRCLE) {
+        float dy = (lat - f->center.lat) * GEO_M_PER_E6;
+        float dx = (lon - f->center.lon) * f->lonScale;
+        return fabsf(sqrtf(dx * dx + dy * dy) - f->radiusM);
+    }
+    // Distancia a cada lado, con la posición en el origen
+    const GeoPoint *v = s->vertices + f->first;
+    float best = INFINITY;
+    for (uint16_t i = 0, j = f->count - 1; i < f->count; j = i++) {
+        float ax = (v[j].lon - lon) * f->lonScale, ay = (v[j].lat - lat) * GEO_M_PER_E6;
+        float bx = (v[i].lon - lon) * f->lonScale, by = (v[i].lat - lat) * GEO_M_PER_E6;
+        float dx = bx - ax, dy = by - ay;
+        float len2 = dx * dx + dy * dy;
+        float u = len2 > 0 ? -(ax * dx + ay * dy) / len2 : 0;
+        u = u < 0 ? 0 : (u > 1 ? 1 : u);
+        float cx = ax + u * dx, cy = ay + u * dy;
+        float d2 = cx * cx + cy * cy;
+        if (d2 < best) {
+            best = d2;
+        }
+    }
+    return sqrtf(best);
+}
+
+
+//##################################################################
+// ### ÍNDICE DE REJILLA ###
+//##################################################################
+
+// Fila o columna de la celda (se recorta a la rejilla)
+static inline uint8_t geoCellOf(int32_t v, int32_t min, int32_t size)
+{
+    int32_t c = (v - min) / size;
+    return c < 0 ? 0 : (c >= GEO_GRID ? GEO_GRID - 1 : (uint8_t)c);
+}
+
+/**
+ * Rehace el índice después de cambiar las cercas (geoLoad() ya lo
+ * llama). Cada celda lista las cercas cuya caja la toca, en
+ * cellItems[cellStart[c] .. cellStart[c + 1]).
+ */
+static inline void geoIndexBuild(GeoSet *s)
+{
+    uint32_t total = 0;
+
+    s->indexed = false;
+    if (s->count == 0) {
+        return;
+    }
+    s->box = s->fences[0].box;
+    for (uint16_t i = 1; i < s->count; i++) {
+        const GeoBox *b = &s->fences[i].box;
+        s->box.minLat = min(s->box.minLat, b->minLat);
+        s->box.minLon = min(s->box.minLon, b->minLon);
+        s->box.maxLat = max(s->box.maxLat, b->maxLat);
+        s->box.maxLon = max(s->box.maxLon, b->maxLon);
+    }
+    s->cellLat = (s->box.maxLat - s->box.minLat) / GEO_GRID + 1;
+    s->cellLon = (s->box.maxLon - s->box.minLon) / GEO_GRID + 1;
+
+    // Cuántas cercas por celda...
+    memset(s->cellStart, 0, sizeof(s->cellStart));
+    for (uint16_t i = 0; i < s->count; i++) {
+        const GeoBox *b = &s->fences[i].box;
+        uint8_t r0 = geoCellOf(b->minLat, s->box.minLat, s->cellLat);
+        uint8_t r1 = geoCellOf(b->maxLat, s->box.minLat, s->cellLat);
+        uint8_t c0 = geoCellOf(b->minLon, s->box.minLon, s->cellLon);
+        uint8_t c1 = geoCellOf(b->maxLon, s->box.minLon, s->cellLon);
+        for (uint8_t r = r0; r <= r1; r++) {
+            for (uint8_t c = c0; c <= c1; c++) {
+                s->cellStart[r * GEO_GRID + c]++;
+            }
+        }
+        total += (uint32_t)(r1 - r0 + 1) * (c1 - c0 + 1);
+    }
+    if (total > GEO_MAX_CELL_ITEMS) {
+        return;
+    }
+    // ... dónde termina cada celda, y se llenan de atrás para adelante:
+    // al final cellStart[c] queda en el inicio de la celda c
+    for (uint16_t c = 1; c < GEO_GRID * GEO_GRID; c++) {
+        s->cellStart[c] += s->cellStart[c - 1];
+    }
+    s->cellStart[GEO_GRID * GEO_GRID] = (uint16_t)total;
+    for (uint16_t i = s->count; i-- > 0;) {
+        const GeoBox *b = &s->fences[i].box;
+        uint8_t r0 = geoCellOf(b->minLat, s->box.minLat, s->cellLat);
+        uint8_t r1 = geoCellOf(b->maxLat, s->box.minLat, s->cellLat);
+        uint8_t c0 = geoCellOf(b->minLon, s->box.minLon, s->cellLon);
+        uint8_t c1 = geoCellOf(b->maxLon, s->box.minLon, s->cellLon);
+        for (uint8_t r = r0; r <= r1; r++) {
+            for (uint8_t c = c0; c <= c1; c++) {
+                s->cellItems[--s->cellStart[r * GEO_GRID + c]] = i;
+            }
+        }
+    }
+    s->indexed = true;
+}
+
+
+//##################################################################
+// ### REVISIÓN DE UNA POSICIÓN ###
+//##################################################################
+
+/**
+ * Revisa una posición contra todas las cercas y deja en 'events' las
+ * entradas y salidas (a lo más maxEvents; lo que no cupo sale en la
+ * siguiente posición). Regresa cuántos eventos hubo.
+ * Sólo las cercas de la celda de la posición y aquéllas en las que ya
+ * estaba pasan por la prueba exacta.
+ */
+static inline uint8_t geoUpdate(GeoSet *s, int32_t lat, int32_t lon, uint32_t t,
+                                GeoEvent *events, uint8_t maxEvents)
+{
+    uint8_t n = 0;
+
+    s->fixes++;
+
+    // Salidas: sólo las cercas en las que estaba
+    for (uint8_t k = 0; k < s->insideCount && n < maxEvents;) {
+        GeoFence *f = &s->fences[s->insideList[k]];
+        s->exactTests++;
+        if (geoFenceHas(s, f, lat, lon) || geoFenceDistanceM(s, f, lat, lon) <= s->hysteresisM) {
+            k++;
+            continue;
+        }
+        f->inside = false;
+        s->insideList[k] = s->insideList[--s->insideCount];
+        events[n].t = t;
+        events[n].fenceId = f->id;
+        events[n++].type = GEO_EXIT;
+    }
+
+    // Entradas: las candidatas de la celda (o todas sin índice)
+    uint16_t from = 0, to = s->count;
+    if (s->indexed) {
+        if (!geoBoxHas(&s->box, lat, lon)) {
+            s->events += n;
+            return n;
+        }
+        uint16_t c = geoCellOf(lat, s->box.minLat, s->cellLat) * GEO_GRID
+                     + geoCellOf(lon, s->box.minLon, s->cellLon);
+        from = s->cellStart[c];
+        to = s->cellStart[c + 1];
+    }
+    for (uint16_t i = from; i < to && n < maxEvents; i++) {
+        uint16_t idx = s->indexed ? s->cellItems[i] : i;
+        GeoFence *f = &s->fences[idx];
+        if (f->inside || !geoBoxHas(&f->box, lat, lon)) {
+            continue;
+        }
+        s->exactTests++;
+        if (!geoFenceHas(s, f, lat, lon)) {
+            continue;
+        }
+        if (s->insideCount == GEO_MAX_INSIDE) {
+            s->overflows++;
+            continue;
+        }
+        f->inside = true;
+        s->insideList[s->insideCount++] = idx;
+        events[n].t = t;
+        events[n].fenceId = f->id;
+        events[n++].type = GEO_ENTER;
+    }
+    s->events += n;
+    return n;
+}
+
+
+//##################################################################
+// ### CARGA DESDE LA NUBE (TEXTO) ###
+//##################################################################
+
+#define GEO_FIELD_MAX 16            // Un campo ("-103.342000" y sobra)
+
+/*
+ * Lee las cercas carácter por carácter: sólo guarda el campo en curso
+ * y cada vértice va directo a GeoSet.vertices, así que un polígono de
+ * cualquier largo puede llegar en pedazos de cualquier tamaño (ej. lo
+ * que va regresando client.read()):
+ *
+ *   geoLoaderBegin(&loader, &cercas);
+ *   geoLoaderFeed(&loader, pedazo, n);     // Las veces que haga falta
+ *   geoLoaderEnd(&loader);                 // Rehace el índice
+ *
+ * Entre Begin y End no se llama a geoUpdate() (el índice no está al día).
+ *
+ * Una "X" no olvida dónde está el vehículo: si una cerca en la que
+ * estaba vuelve a llegar con el mismo id, sigue "adentro" (sin otra
+ * ENTRADA) y la SALIDA sale cuando deje la cerca nueva. Una que ya no
+ * llega se borra sin SALIDA.
+ */
+typedef struct {
+    GeoSet *set;
+    char field[GEO_FIELD_MAX];  // Campo en curso
+    uint8_t fieldLen;
+    uint16_t fieldIndex;        // Campos completos del registro (0 = aún no llega el tipo)
+    char type;                  // 'C', 'P' o 'X'
+    bool bad;                   // El registro ya no se usa: se salta hasta el separador
+    int32_t lat;                // Latitud del par en curso
+    GeoFence fence;             // Cerca en curso (se agrega al terminar el registro)
+    uint16_t carried[GEO_MAX_INSIDE];   // Ids en los que estaba antes de la "X"
+    uint8_t carriedCount;
+    uint16_t used;              // Registros usados
+} GeoLoader;
+
+static inline void geoLoaderBegin(GeoLoader *l, GeoSet *s)
+{
+    memset(l, 0, sizeof(*l));
+    l->set = s;
+}
+
+static inline float geoLonScale(int32_t lat)
+{
+    return GEO_M_PER_E6 * cosf(lat * 1e-6f * (float)M_PI / 180.0f);
+}
+
+// Un campo completo del registro en curso; false si el registro ya no sirve
+static inline bool geoLoaderField(GeoLoader *l)
+{
+    GeoSet *s = l->set;
+    GeoFence *f = &l->fence;
+    const char *p = l->field, *e = l->field + l->fieldLen;
+    uint16_t k = l->fieldIndex++;
+    int32_t v;
+
+    if (k == 0) {
+        l->type = l->fieldLen == 1 ? *p : 0;
+        return l->type == 'X' || l->type == 'C' || l->type == 'P';
+    }
+    if (l->type == 'X') {
+        return true;            // Lo que siga a la X no importa
+    }
+    if (k == 1) {
+        if (s->count == GEO_MAX_FENCES || !xc03ParseFixed(p, e, 0, &v) || v < 0 || v > 0xFFFF) {
+            return false;
+        }
+        memset(f, 0, sizeof(*f));
+        f->id = (uint16_t)v;
+        f->shape = l->type == 'C' ? GEO_CIRCLE : GEO_POLYGON;
+        f->first = s->vertexCount;
+        return true;
+    }
+    if (l->type == 'C' && k >= 4) {
+        if (k > 4 || !xc03ParseFixed(p, e, 0, &v) || v <= 0 || v > (int32_t)GEO_MAX_RADIUS_M) {
+            return false;
+        }
+        f->radiusM = (float)v;
+        return true;
+    }
+
+    // Coordenadas: latitud en los campos pares, longitud en los impares
+    if (!xc03ParseFixed(p, e, 6, &v)) {
+        return false;
+    }
+    if (k % 2 == 0) {
+        l->lat = v;
+        return abs(v) <= 90000000L;
+    }
+    if (abs(v) > 180000000L) {
+        return false;
+    }
+    GeoPoint point = { l->lat, v };
+    if (l->type == 'C') {
+        f->center = point;
+        return true;
+    }
+
+    // Los vértices se escriben al final del arreglo; si el registro
+    // falla no se cuentan
+    if (f->first + f->count == GEO_MAX_VERTICES) {
+        return false;
+    }
+    s->vertices[f->first + f->count] = point;
+    if (f->count == 0) {
+        f->box = { point.lat, point.lon, point.lat, point.lon };
+    }
+    f->box.minLat = min(f->box.minLat, point.lat);
+    f->box.minLon = min(f->box.minLon, point.lon);
+    f->box.maxLat = max(f->box.maxLat, point.lat);
+    f->box.maxLon = max(f->box.maxLon, point.lon);
+    f->count++;
+    return true;
+}
+
+// Agrega la cerca; si estaba adentro antes de la "X", lo sigue estando
+static inline void geoLoaderAdd(GeoLoader *l, const GeoFence *f)
+{
+    GeoSet *s = l->set;
+    GeoFence *added = &s->fences[s->count];
+
+    *added = *f;
+    for (uint8_t k = 0; k < l->carriedCount; k++) {
+        if (l->carried[k] == f->id && s->insideCount < GEO_MAX_INSIDE) {
+            added->inside = true;
+            s->insideList[s->insideCount++] = s->count;
+            l->carried[k] = l->carried[--l->carriedCount];
+            break;
+        }
+    }
+    s->count++;
+}
+
+// Fin de un registro: agrega la cerca (o cuenta el error)
+static inline void geoLoaderRecord(GeoLoader *l)
+{
+    GeoSet *s = l->set;
+    GeoFence *f = &l->fence;
+
+    if (l->fieldIndex == 0 && l->fieldLen == 0 && !l->bad) {
+        return;                 // Registro vacío ("\n\n", ";;")
+    }
+    bool ok = !l->bad && geoLoaderField(l);
+
+    if (ok && l->type == 'X') {
+        for (uint8_t k = 0; k < s->insideCount && l->carriedCount < GEO_MAX_INSIDE; k++) {
+            l->carried[l->carriedCount++] = s->fences[s->insideList[k]].id;
+        }
+        geoClear(s);
+    } else if (ok && l->type == 'C') {
+        ok = l->fieldIndex == 5;
+        if (ok) {
+            f->lonScale = geoLonScale(f->center.lat);
+            float dLonF = f->radiusM / f->lonScale;     // Crece cerca de los polos
+            int32_t dLat = (int32_t)(f->radiusM / GEO_M_PER_E6) + 1;
+            int32_t dLon = dLonF < 180e6f ? (int32_t)dLonF + 1 : 180000000L;
+            f->box = { f->center.lat - dLat, f->center.lon - dLon, f->center.lat + dLat, f->center.lon + dLon };
+            geoLoaderAdd(l, f);
+        }
+    } else if (ok) {
+        ok = l->fieldIndex % 2 == 0 && f->count >= 3;
+        if (ok) {
+            f->lonScale = geoLonScale((f->box.minLat + f->box.maxLat) / 2);
+            s->vertexCount += f->count;
+            geoLoaderAdd(l, f);
+        }
+    }
+    if (ok) {
+        l->used++;
+    } else {
+        s->loadErrors++;
+    }
+    l->fieldLen = 0;
+    l->fieldIndex = 0;
+    l->bad = false;
+}
+
+static inline void geoLoaderFeed(GeoLoader *l, const char *text, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        char ch = text[i];
+
+        if (ch == ';' || ch == '\n') {
+            geoLoaderRecord(l);
+        } else if (ch == ',') {
+            l->bad = l->bad || !geoLoaderField(l);
+            l->fieldLen = 0;
+        } else if (ch == '\r' || ch == ' ') {
+            continue;
+        } else if (l->fieldLen == GEO_FIELD_MAX) {
+            l->bad = true;      // Campo demasiado largo: no es un número
+        } else {
+            l->field[l->fieldLen++] = ch;
+        }
+    }
+}
+
+// Termina el último registro (si no llegó su separador) y rehace el índice
+static inline uint16_t geoLoaderEnd(GeoLoader *l)
+{
+    geoLoaderRecord(l);
+    geoIndexBuild(l->set);
+    return l->used;
+}
+
+/**
+ * Agrega las cercas de 'text' y rehace el índice. Un registro por
+ * línea o separados por ';':
+ *   C,id,lat,lon,radio_m                 círculo
+ *   P,id,lat,lon,lat,lon,lat,lon[,...]   polígono (3 vértices o más)
+ *   X                                    borra todas (ver GeoLoader: las que
+ *                                        vuelven con el mismo id conservan
+ *                                        si el vehículo estaba adentro)
+ * lat/lon en grados con hasta 6 decimales. Para texto que llega en
+ * pedazos, GeoLoader. Lo que no se entiende o no cabe se salta y se
+ * cuenta en loadErrors.
+ * @return registros usados.
+ */
+static inline uint16_t geoLoad(GeoSet *s, const char *text, size_t len)
+{
+    GeoLoader l;
+
+    geoLoaderBegin(&l, s);
+    geoLoaderFeed(&l, text, len);
+    return geoLoaderEnd(&l);
+}
+
+
+//##################################################################
+// ### BLOQUE DE EVENTOS (LO QUE SE SUBE) ###
+//##################################################################
+
+/*
+ * Formato:
+ *   byte 0    GEO_EVENTS_FORMAT
+ *   evento    varint t (el primero completo, luego la diferencia con
+ *             el anterior) + varint id << 1 | tipo
+ * Tres o cuatro bytes por evento en lugar de una posición por segundo.
+ */
+#define GEO_EVENTS_FORMAT 1
+#ifndef GEO_EVENTS_BLOCK_SIZE
+#define GEO_EVENTS_BLOCK_SIZE 128
+#endif
+#define GEO_EVENT_MAX (2 * XC03_VARINT_MAX)
+
+typedef struct {
+    uint8_t data[GEO_EVENTS_BLOCK_SIZE];
+    uint16_t len;
+    uint16_t count;
+    uint32_t lastT;
+} GeoEventBlock;
+
+static inline void geoEventsBegin(GeoEventBlock *b)
+{
+    b->data[0] = GEO_EVENTS_FORMAT;
+    b->len = 1;
+    b->count = 0;
+    b->lastT = 0;
+}
+
+// Agrega un evento; false si ya no cabe (el bloque queda igual)
+static inline bool geoEventsAppend(GeoEventBlock *b, const GeoEvent *ev)
+{
+    uint8_t tmp[GEO_EVENT_MAX];
+    uint8_t n = xc03PutVarint(tmp, ev->t - b->lastT);
+
+    n += xc03PutVarint(tmp + n, (uint32_t)ev->fenceId << 1 | ev->type);
+    if (b->len + n > GEO_EVENTS_BLOCK_SIZE) {
+        return false;
+    }
+    memcpy(b->data + b->len, tmp, n);
+    b->len += n;
+    b->count++;
+    b->lastT = ev->t;
+    return true;
+}
+
+// Siguiente evento desde data[*pos] (*pos empieza en 1); false al final
+static inline bool geoEventsNext(const uint8_t *data, uint16_t len, uint16_t *pos,
+                                 uint32_t *lastT, GeoEvent *ev)
+{
+    uint32_t dt, key;
+
+    if (len < 1 || data[0] != GEO_EVENTS_FORMAT || *pos >= len
+        || !xc03GetVarint(data, len, pos, &dt) || !xc03GetVarint(data, len, pos, &key)) {
+        return false;
+    }
+    *lastT += dt;
+    ev->t = *lastT;
+    ev->fenceId = (uint16_t)(key >> 1);
+    ev->type = key & 1;
+    return true;
+}
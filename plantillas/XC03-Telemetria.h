@@ -0,0 +1,325 @@
+/*
+ * ===================================================================
+ * TELEMETRÍA BINARIA POR TCP PARA EL XC03
+ *
+ * Alternativa a Blynk.virtualWrite() para SUBIR datos. Blynk manda
+ * cada valor como texto ("vw", "2", "23.45") con 5 bytes de
+ * encabezado, y un grupo con hora agrega otros dos mensajes: un
+ * resumen de 5 valores cuesta ~100 bytes. Aquí el mismo resumen son
+ * ~18 bytes, y varios resúmenes viajan juntos en UN envío TCP
+ * (un AT+CASEND) por una conexión que se queda abierta.
+ *
+ * Tramas (una o varias por envío):
+ *   byte      largo del resto de la trama (1-255)
+ *   byte      tipo
+ *   ...       cuerpo
+ *
+ *   XC03_TEL_HELLO   versión (1 byte) + id del dispositivo (texto).
+ *                    Va primero en cada conexión.
+ *   XC03_TEL_REPORT  varint: edad en segundos (hace cuánto se midió;
+ *                    el receptor le resta eso a su hora de llegada,
+ *                    así el XC01 no necesita reloj). Luego valores
+ *                    hasta el final de la trama:
+ *                      varint clave = pin << 2 | tipo
+ *                      XC03_TEL_INT    entero (zigzag varint)
+ *                      XC03_TEL_CENTI  valor × 100 (zigzag varint)
+ *                      XC03_TEL_FLOAT  float de 4 bytes (little endian)
+ * Los pines son los mismos números de pin virtual que en Blynk. Varint
+ * y zigzag como en XC03-Varint.h.
+ *
+ * Las tramas se arman en un búfer fijo; xc03TelSend() lo manda todo
+ * en una escritura. Si falla, el búfer se vacía: quien armó las tramas
+ * conserva sus datos (buffer de muestras, valores en espera) y las
+ * vuelve a armar cuando xc03TelMaintain() reabra la conexión.
+ *
+ * Se incluye después de <TinyGsmClient.h> (el sketch define antes el
+ * modelo del módem). Blynk usa el socket 0: el cliente de este enlace
+ * debe usar otro (TinyGsmClient client(modem, 1)).
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <TinyGsmClient.h>
+#include "XC03-Varint.h"
+
+#define XC03_TEL_PORT 9000          // Puerto por defecto del receptor
+#define XC03_TEL_VERSION 1
+#ifndef XC03_TEL_BUF_SIZE
+#define XC03_TEL_BUF_SIZE 512       // Bytes por envío
+#endif
+#define XC03_TEL_ID_MAX 32          // Largo máx. del id en el HELLO
+#define XC03_TEL_RETRY_MS 10000UL   // Pausa entre intentos de conexión
+
+enum XC03TelFrameType {
+    XC03_TEL_HELLO = 1,
+    XC03_TEL_REPORT = 2
+};
+
+enum XC03TelValueType {
+    XC03_TEL_INT = 0,
+    XC03_TEL_CENTI = 1,
+    XC03_TEL_FLOAT = 2
+};
+
+typedef struct {
+    TinyGsmClient *client;
+    const char *host;
+    uint16_t port;
+    const char *deviceId;
+    uint8_t buf[XC03_TEL_BUF_SIZE];
+    uint16_t len;
+    uint16_t frameStart;        // Dónde empieza la trama en construcción
+    bool overflow;              // Algo de esa trama no cupo
+    bool attempted;             // Ya se intentó conectar alguna vez
+    unsigned long lastAttemptAt;
+    // Estadísticas
+    uint32_t connects;
+    uint32_t frames;
+    uint32_t writes;            // Envíos TCP
+    uint32_t bytes;
+    uint32_t failures;          // Conexiones o envíos fallidos
+} XC03TelLink;
+
+static inline void xc03TelBegin(XC03TelLink *l, TinyGsmClient &client, const char *host,
+                                uint16_t port, const char *deviceId)
+{
+    memset(l, 0, sizeof(*l));
+    l->client = &client;
+    l->host = host;
+    l->port = port;
+    l->deviceId = deviceId;
+}
+
+
+//##################################################################
+// ### ARMADO DE TRAMAS ###
+//##################################################################
+
+static inline void xc03TelPut(XC03TelLink *l, const void *data, uint8_t n)
+{
+    if (l->overflow || l->len + n > XC03_TEL_BUF_SIZE) {
+        l->overflow = true;
+        return;
+    }
+    memcpy(l->buf + l->len, data, n);
+    l->len += n;
+}
+
+static inline void xc03TelPutVarint(XC03TelLink *l, uint32_t v)
+{
+    uint8_t tmp[XC03_VARINT_MAX];
+    xc03TelPut(l, tmp, xc03PutVarint(tmp, v));
+}
+
+static inline void xc03TelFrameBegin(XC03TelLink *l, uint8_t type)
+{
+    uint8_t header[2] = { 0, type };    // El largo se llena al cerrar
+
+    l->frameStart = l->len;
+    l->overflow = false;
+    xc03TelPut(l, header, sizeof(header));
+}
+
+/**
+ * Cierra la trama. Si algo no cupo en el búfer (o pasa de 255 bytes)
+ * la trama se quita completa y regresa false: hay que mandar lo que
+ * ya hay con xc03TelSend() y volver a armarla.
+ */
+static inline bool xc03TelFrameEnd(XC03TelLink *l)
+{
+    uint16_t n = l->len - l->frameStart - 1;
+
+    if (l->overflow || n > 255) {
+        l->len = l->frameStart;
+        l->overflow = false;
+        return false;
+    }
+    l->buf[l->frameStart] = (uint8_t)n;
+    l->frames++;
+    return true;
+}
+
+// Empieza un reporte de valores medidos hace 'ageS' segundos
+static inline void xc03TelReport(XC03TelLink *l, uint32_t ageS)
+{
+    xc03TelFrameBegin(l, XC03_TEL_REPORT);
+    xc03TelPutVarint(l, ageS);
+}
+
+static inline void xc03TelInt(XC03TelLink *l, uint8_t pin, int32_t value)
+{
+    xc03TelPutVarint(l, (uint32_t)pin << 2 | XC03_TEL_INT);
+    xc03TelPutVarint(l, xc03Zigzag(value));
+}
+
+// Con dos decimales (temperatura, humedad...)
+static inline void xc03TelCenti(XC03TelLink *l, uint8_t pin, float value)
+{
+    xc03TelPutVarint(l, (uint32_t)pin << 2 | XC03_TEL_CENTI);
+    xc03TelPutVarint(l, xc03Zigzag((int32_t)lroundf(value * 100.0f)));
+}
+
+static inline void xc03TelFloat(XC03TelLink *l, uint8_t pin, float value)
+{
+    xc03TelPutVarint(l, (uint32_t)pin << 2 | XC03_TEL_FLOAT);
+    xc03TelPut(l, &value, sizeof(value));   // El ESP32 es little endian
+}
+
+
+//##################################################################
+// ### CONEXIÓN Y ENVÍO ###
+//##################################################################
+
+static inline bool xc03TelConnected(XC03TelLink *l)
+{
+    return l->client->connected();
+}
+
+/**
+ * Va en loop() cuando ya hay red. Si la conexión se cayó, la reabre
+ * (a lo más una vez cada XC03_TEL_RETRY_MS) y manda el HELLO. Abrir
+ * espera la respuesta de AT+CAOPEN, como Blynk.connect().
+ * @return true si hay conexión.
+ */
+static inline bool xc03TelMaintain(XC03TelLink *l, unsigned long now)
+{
+    if (l->client->connected()) {
+        return true;
+    }
+    if (l->attempted && now - l->lastAttemptAt < XC03_TEL_RETRY_MS) {
+        return false;
+    }
+    l->attempted = true;
+    l->lastAttemptAt = now;
+    if (!l->client->connect(l->host, l->port)) {
+        l->failures++;
+        return false;
+    }
+    l->connects++;
+
+    uint8_t hello[3 + XC03_TEL_ID_MAX];
+    uint8_t n = (uint8_t)strnlen(l->deviceId, XC03_TEL_ID_MAX);
+    hello[0] = 2 + n;
+    hello[1] = XC03_TEL_HELLO;
+    hello[2] = XC03_TEL_VERSION;
+    memcpy(hello + 3, l->deviceId, n);
+    if (l->client->write(hello, 3 + n) != 3u + n) {
+        l->client->stop();
+        l->failures++;
+        return false;
+    }
+    l->writes++;
+    l->bytes += 3 + n;
+    return true;
+}
+
+/**
+ * Manda todas las tramas del búfer en una escritura. Con o sin éxito
+ * el búfer queda vacío.
+ */
+static inline bool xc03TelSend(XC03TelLink *l)
+{
+    if (l->len == 0) {
+        return true;
+    }
+    uint16_t n = l->len;
+
+    l->len = 0;
+    if (!l->client->connected()) {
+        return false;
+    }
+    if (l->client->write(l->buf, n) != n) {
+        l->client->stop();
+        l->failures++;
+        return false;
+    }
+    l->writes++;
+    l->bytes += n;
+    return true;
+}
+
+// "Telemetría: 12 tramas, 3 envíos TCP, ..." (para el reporte del sketch)
+static inline void xc03TelPrintReport(Print &out, const XC03TelLink *l)
+{
+    out.print("Telemetría: ");
+    out.print(l->frames);
+    out.print(" tramas, ");
+    out.print(l->writes);
+    out.print(" envíos TCP, ");
+    out.print(l->bytes);
+    out.print(" bytes, ");
+    out.print(l->connects);
+    out.print(" conexiones, ");
+    out.print(l->failures);
+    out.println(" fallas");
+}
+
+
+//##################################################################
+// ### LECTURA (RECEPTOR) ###
+//##################################################################
+
+typedef struct {
+    uint8_t type;               // XC03TelFrameType
+    const uint8_t *body;
+    uint16_t len;
+    uint16_t pos;
+} XC03TelFrame;
+
+typedef struct {
+    uint8_t pin;
+    uint8_t type;               // XC03TelValueType
+    int32_t i;                  // INT y CENTI (× 100)
+    float f;                    // Todos, ya en unidades
+} XC03TelValue;
+
+/**
+ * Siguiente trama completa desde data[*pos]. Regresa false si todavía
+ * no llegan todos sus bytes (*pos no se mueve).
+ */
+static inline bool xc03TelNextFrame(const uint8_t *data, uint16_t len, uint16_t *pos, XC03TelFrame *f)
+{
+    if (*pos >= len || *pos + 1 + data[*pos] > len) {
+        return false;
+    }
+    uint8_t n = data[*pos];
+    f->type = n > 0 ? data[*pos + 1] : 0;
+    f->body = data + *pos + 2;
+    f->len = n > 0 ? n - 1 : 0;
+    f->pos = 0;
+    *pos += 1 + n;
+    return true;
+}
+
+static inline bool xc03TelReportAge(XC03TelFrame *f, uint32_t *ageS)
+{
+    return f->type == XC03_TEL_REPORT && xc03GetVarint(f->body, f->len, &f->pos, ageS);
+}
+
+// Siguiente valor de un reporte (después de xc03TelReportAge)
+static inline bool xc03TelNextValue(XC03TelFrame *f, XC03TelValue *v)
+{
+    uint32_t key, raw;
+
+    if (f->pos >= f->len || !xc03GetVarint(f->body, f->len, &f->pos, &key)) {
+        return false;
+    }
+    v->pin = (uint8_t)(key >> 2);
+    v->type = key & 3;
+    if (v->type == XC03_TEL_FLOAT) {
+        if (f->pos + 4 > f->len) {
+            return false;
+        }
+        memcpy(&v->f, f->body + f->pos, 4);
+        f->pos += 4;
+        v->i = (int32_t)v->f;
+        return true;
+    }
+    if (v->type > XC03_TEL_FLOAT || !xc03GetVarint(f->body, f->len, &f->pos, &raw)) {
+        return false;
+    }
+    v->i = xc03Unzigzag(raw);
+    v->f = v->type == XC03_TEL_CENTI ? v->i / 100.0f : (float)v->i;
+    return true;
+}
@@ -0,0 +1,251 @@
+/*
+ * ===================================================================
+ * TRAYECTOS COMPACTOS PARA EL LOCALIZADOR
+ *
+ * Una posición como texto ("2025-10-18T12:00:00Z,20.676900,
+ * -103.347500,12.3") cuesta ~50 bytes, y como floats ~20. Aquí el
+ * trayecto se guarda en un bloque binario en dos pasos:
+ *
+ * 1. Filtro de banda muerta (TrackFilter): sólo se guarda un punto si
+ *    el rumbo o la velocidad cambiaron más que su umbral desde el
+ *    último guardado, o si pasó maxGapS sin guardar (latido). Lo que
+ *    quede a menos de minDistanceM del último no se guarda: parado,
+ *    el ruido del GPS no llena el bloque. En una recta a velocidad
+ *    constante basta el latido; la línea entre dos puntos guardados
+ *    pasa cerca de los que se tiraron. En una curva larga y suave se
+ *    separa más (la flecha del arco: ~60 m en carretera con 15°);
+ *    bajar headingDeg la acerca a cambio de más puntos.
+ *
+ * 2. Cada punto se guarda como diferencia contra el anterior, en
+ *    varint con zigzag: de 4 a 7 bytes por punto en un recorrido
+ *    normal.
+ *
+ * Formato del bloque:
+ *   byte 0    TRACK_FORMAT
+ *   punto 0   t, lat, lon, vel completos
+ *   punto n   t, lat, lon y vel menos los del punto n - 1
+ * t: segundos Unix (UTC); lat/lon: grados × 100 000 (~1.1 m, menos
+ * que el error del GPS); vel: km/h × 10. Varint y zigzag como en
+ * XC03-Varint.h (el t del punto 0 va sin zigzag). El número de puntos
+ * no va en el bloque: se lee hasta el final.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include "XC03-GNSS.h"              // XC03Fix
+#include "XC03-Varint.h"
+
+#define TRACK_FORMAT 1
+#ifndef TRACK_BLOCK_SIZE
+#define TRACK_BLOCK_SIZE 512        // Bytes por bloque
+#endif
+#define TRACK_POINT_MAX (4 * XC03_VARINT_MAX)  // Lo más que puede medir un punto
+
+typedef struct {
+    uint32_t t;                 // Segundos Unix (UTC)
+    int32_t latitude;           // Grados × 100 000
+    int32_t longitude;          // Grados × 100 000
+    uint16_t speed;             // km/h × 10
+} TrackPoint;
+
+
+//##################################################################
+// ### CONVERSIONES ###
+//##################################################################
+
+// Fecha UTC -> segundos Unix (días desde 1970 por el método de eras)
+static inline uint32_t trackEpoch(uint16_t year, uint8_t month, uint8_t day,
+                                  uint8_t hour, uint8_t minute, uint8_t second)
+{
+    int32_t y = (int32_t)year - (month <= 2);
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+
+    return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+// Grados × 1e6 -> grados × 1e5, redondeando
+static inline int32_t trackE5(int32_t e6)
+{
+    return e6 >= 0 ? (e6 + 5) / 10 : (e6 - 5) / 10;
+}
+
+static inline void trackPointFromFix(const XC03Fix *fix, TrackPoint *p)
+{
+    p->t = trackEpoch(fix->year, fix->month, fix->day, fix->hour, fix->minute, fix->second);
+    p->latitude = trackE5(fix->latitude);
+    p->longitude = trackE5(fix->longitude);
+    p->speed = fix->speed;
+}
+
+// Distancia en metros entre dos puntos (grados × 1e6). Aproximación
+// plana: sobra para los pocos cientos de metros entre dos puntos.
+static inline float trackDistanceM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    const float M_PER_E6 = 0.1113195f;     // Metros por 1e-6 grados
+    float dy = (lat2 - lat1) * M_PER_E6;
+    float dx = (lon2 - lon1) * M_PER_E6 * cosf(lat1 * 1e-6f * (float)M_PI / 180.0f);
+    return sqrtf(dx * dx + dy * dy);
+}
+
+
+//##################################################################
+// ### FILTRO DE BANDA MUERTA ###
+//##################################################################
+
+typedef struct {
+    // Umbrales
+    uint16_t minDistanceM;      // Más cerca del último guardado: no se guarda
+    uint16_t headingDeg;        // Cambio de rumbo que obliga a guardar
+    uint16_t speedKmh;          // Cambio de velocidad que obliga a guardar
+    uint16_t maxGapS;           // Latido: al menos un punto cada maxGapS
+    // Último punto guardado
+    bool started;
+    uint32_t t;
+    int32_t latitude, longitude;    // Grados × 1e6
+    uint16_t speed, course;         // × 10
+} TrackFilter;
+
+static inline void trackFilterReset(TrackFilter *f)
+{
+    f->started = false;
+}
+
+// Umbrales del filtro; el primer punto que llegue se guarda
+static inline void trackFilterBegin(TrackFilter *f, uint16_t minDistanceM, uint16_t headingDeg,
+                                    uint16_t speedKmh, uint16_t maxGapS)
+{
+    memset(f, 0, sizeof(*f));
+    f->minDistanceM = minDistanceM;
+    f->headingDeg = headingDeg;
+    f->speedKmh = speedKmh;
+    f->maxGapS = maxGapS;
+    trackFilterReset(f);
+}
+
+/**
+ * ¿Se guarda esta posición? 't' es su hora en segundos Unix. Si
+ * regresa true, el filtro la toma como el último punto guardado.
+ */
+static inline bool trackFilterKeep(TrackFilter *f, const XC03Fix *fix, uint32_t t)
+{
+    bool keep = !f->started || t - f->t >= f->maxGapS;
+
+    if (!keep && trackDistanceM(f->latitude, f->longitude, fix->latitude, fix->longitude) >= f->minDistanceM) {
+        int16_t turn = (int16_t)((fix->course - f->course + 5400) % 3600) - 1800;   // -180..180 °
+        int16_t accel = (int16_t)fix->speed - (int16_t)f->speed;
+        keep = abs(turn) >= f->headingDeg * 10 || abs(accel) >= f->speedKmh * 10;
+    }
+    if (keep) {
+        f->started = true;
+        f->t = t;
+        f->latitude = fix->latitude;
+        f->longitude = fix->longitude;
+        f->speed = fix->speed;
+        f->course = fix->course;
+    }
+    return keep;
+}
+
+
+//##################################################################
+// ### CODIFICADOR ###
+//##################################################################
+
+typedef struct {
+    uint8_t data[TRACK_BLOCK_SIZE];
+    uint16_t len;
+    uint16_t count;             // Puntos en el bloque
+    TrackPoint last;            // Base de la siguiente diferencia
+} TrackBlock;
+
+static inline void trackBegin(TrackBlock *b)
+{
+    b->data[0] = TRACK_FORMAT;
+    b->len = 1;
+    b->count = 0;
+}
+
+// Agrega un punto; false si ya no cabe (el bloque queda igual)
+static inline bool trackAppend(TrackBlock *b, const TrackPoint *p)
+{
+    uint8_t tmp[TRACK_POINT_MAX];
+    uint8_t n = 0;
+
+    if (b->count == 0) {
+        n += xc03PutVarint(tmp + n, p->t);
+        n += xc03PutVarint(tmp + n, xc03Zigzag(p->latitude));
+        n += xc03PutVarint(tmp + n, xc03Zigzag(p->longitude));
+        n += xc03PutVarint(tmp + n, p->speed);
+    } else {
+        n += xc03PutVarint(tmp + n, xc03Zigzag((int32_t)(p->t - b->last.t)));
+        n += xc03PutVarint(tmp + n, xc03Zigzag(p->latitude - b->last.latitude));
+        n += xc03PutVarint(tmp + n, xc03Zigzag(p->longitude - b->last.longitude));
+        n += xc03PutVarint(tmp + n, xc03Zigzag((int32_t)p->speed - (int32_t)b->last.speed));
+    }
+    if (b->len + n > TRACK_BLOCK_SIZE) {
+        return false;
+    }
+    memcpy(b->data + b->len, tmp, n);
+    b->len += n;
+    b->count++;
+    b->last = *p;
+    return true;
+}
+
+
+//##################################################################
+// ### DECODIFICADOR ###
+//##################################################################
+
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+    uint16_t pos;
+    uint16_t index;             // Puntos leídos
+    TrackPoint last;
+} TrackReader;
+
+// false si el bloque no es de este formato
+static inline bool trackReaderBegin(TrackReader *r, const uint8_t *data, uint16_t len)
+{
+    r->data = data;
+    r->len = len;
+    r->pos = 1;
+    r->index = 0;
+    memset(&r->last, 0, sizeof(r->last));
+    return len >= 1 && data[0] == TRACK_FORMAT;
+}
+
+// Siguiente punto; false al final del bloque (o si está cortado)
+static inline bool trackNext(TrackReader *r, TrackPoint *p)
+{
+    uint32_t t, lat, lon, speed;
+
+    if (r->pos >= r->len
+        || !xc03GetVarint(r->data, r->len, &r->pos, &t)
+        || !xc03GetVarint(r->data, r->len, &r->pos, &lat)
+        || !xc03GetVarint(r->data, r->len, &r->pos, &lon)
+        || !xc03GetVarint(r->data, r->len, &r->pos, &speed)) {
+        return false;
+    }
+    if (r->index == 0) {
+        p->t = t;
+        p->latitude = xc03Unzigzag(lat);
+        p->longitude = xc03Unzigzag(lon);
+        p->speed = (uint16_t)speed;
+    } else {
+        p->t = r->last.t + xc03Unzigzag(t);
+        p->latitude = r->last.latitude + xc03Unzigzag(lat);
+        p->longitude = r->last.longitude + xc03Unzigzag(lon);
+        p->speed = (uint16_t)(r->last.speed + xc03Unzigzag(speed));
+    }
+    r->last = *p;
+    r->index++;
+    return true;
+}
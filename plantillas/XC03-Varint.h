@@ -0,0 +1,56 @@
+/*
+ * ===================================================================
+ * VARINT Y ZIGZAG PARA TRAMAS BINARIAS DEL XC03
+ *
+ * Un entero sin signo se guarda en 7 bits por byte, el bit alto indica
+ * que sigue otro byte (como protobuf): 0-127 cuesta 1 byte, hasta
+ * 16383 cuesta 2. Los enteros con signo pasan antes por zigzag
+ * (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...) para que los negativos chicos
+ * también sean cortos.
+ *
+ * Lo usan XC03-Trayecto.h (trayectos del GPS) y XC03-Telemetria.h
+ * (telemetría por TCP).
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define XC03_VARINT_MAX 5           // Bytes de un uint32_t en varint
+
+static inline uint32_t xc03Zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t xc03Unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Escribe 'v' en 'out' (caben XC03_VARINT_MAX); regresa los bytes usados
+static inline uint8_t xc03PutVarint(uint8_t *out, uint32_t v)
+{
+    uint8_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Lee un varint desde data[*pos]; false si se acaba antes de terminar
+static inline bool xc03GetVarint(const uint8_t *data, uint16_t len, uint16_t *pos, uint32_t *v)
+{
+    uint32_t result = 0;
+    for (uint8_t shift = 0; shift < 7 * XC03_VARINT_MAX && *pos < len; shift += 7) {
+        uint8_t b = data[(*pos)++];
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,240 @@
+/*
+ * ===================================================================
+ * GESTOR DEL BUS I2C DE LOS MÓDULOS XN (VELOCIDAD ADAPTATIVA)
+ *
+ * Wire arranca a 100 kHz. Con varios módulos XN en los mismos pines
+ * del mikroBUS, subir el reloj es lo más barato para ocupar menos el
+ * bus y leer antes.
+ *
+ * xnBusBegin() prueba cada módulo a 1 MHz, 400 kHz y 100 kHz (en ese
+ * orden) y se queda con la velocidad más alta a la que respondió
+ * XN_BUS_PROBES veces seguidas sin error. Cada módulo guarda SU
+ * velocidad; antes de cada transacción xnBusSelect() cambia el reloj
+ * solo si el módulo anterior usaba otra.
+ *
+ * En operación, xnBusResult() cuenta los errores (NACK o timeout) por
+ * ventanas de XN_BUS_WINDOW transacciones; si en una ventana hay
+ * XN_BUS_MAX_ERRORS o más, el módulo baja a la siguiente velocidad.
+ * Tras XN_BUS_RECOVER_WINDOWS ventanas seguidas sin un solo error sube
+ * una de nuevo (nunca arriba de la que pasó en xnBusBegin()): un
+ * cable movido o un arranque ruidoso no lo dejan lento para siempre.
+ * Si al subir vuelve a fallar, la siguiente subida espera el doble
+ * de ventanas (hasta XN_BUS_RECOVER_WINDOWS << XN_BUS_MAX_BACKOFF).
+ *
+ * Un módulo que no pasó por xnBusBegin() se usa a 100 kHz, la
+ * velocidad estándar que todo módulo I2C aguanta.
+ *
+ * Todo es 'inline' y el estado vive en xnBusState(): varios XN*.cpp
+ * pueden incluir este archivo y enlazarse juntos.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define XN_BUS_MAX_DEVICES 8
+#define XN_BUS_PROBES 8         // Transacciones de prueba por velocidad
+#define XN_BUS_WINDOW 32        // Transacciones por ventana de errores
+#define XN_BUS_MAX_ERRORS 2     // Errores por ventana para bajar de velocidad
+#define XN_BUS_RECOVER_WINDOWS 64 // Ventanas limpias seguidas para subir una
+#define XN_BUS_MAX_BACKOFF 5    // Subidas fallidas que duplican la espera
+
+#define XN_BUS_RATE_COUNT 3
+
+// Velocidades a probar, de la más rápida a la más lenta
+inline uint32_t xnBusRate(uint8_t index)
+{
+    static const uint32_t rates[XN_BUS_RATE_COUNT] = { 1000000UL, 400000UL, 100000UL };
+    return rates[index];
+}
+
+typedef struct {
+    uint8_t address;
+    uint8_t rate;               // Índice en xnBusRate()
+    uint8_t bestRate;           // La que pasó en xnBusBegin() (tope al subir)
+    uint8_t windowCount;        // Transacciones en la ventana actual
+    uint8_t windowErrors;       // Errores en la ventana actual
+    uint16_t cleanWindows;      // Ventanas seguidas sin errores
+    uint8_t backoff;            // Subidas que fallaron seguidas
+    bool trial;                 // Acaba de subir: si falla, cuenta en 'backoff'
+    uint32_t transactions;
+    uint32_t errors;
+    uint8_t fallbacks;          // Veces que bajó de velocidad
+    uint8_t recoveries;         // Veces que volvió a subir
+} XNBusDevice;
+
+typedef struct {
+    XNBusDevice devices[XN_BUS_MAX_DEVICES];
+    uint8_t count;
+    uint32_t clock;             // Reloj puesto en Wire (0 = no sabemos)
+} XNBusState;
+
+// Estado del bus: uno solo aunque varios .cpp incluyan este archivo
+inline XNBusState &xnBusState()
+{
+    static XNBusState state;
+    return state;
+}
+
+inline XNBusDevice *xnBusDevice(uint8_t address)
+{
+    XNBusState &bus = xnBusState();
+
+    for (uint8_t i = 0; i < bus.count; i++) {
+        if (bus.devices[i].address == address) {
+            return &bus.devices[i];
+        }
+    }
+    return NULL;
+}
+
+inline void xnBusSetClock(uint32_t hz)
+{
+    XNBusState &bus = xnBusState();
+
+    if (hz != bus.clock) {
+        Wire.setClock(hz);
+        bus.clock = hz;
+    }
+}
+
+// Una transacción de prueba: la dirección responde y entrega 1 byte
+inline bool xnBusProbeOnce(uint8_t address)
+{
+    Wire.beginTransmission(address);
+    if (Wire.endTransmission() != 0) {
+        return false;
+    }
+    return Wire.requestFrom(address, (uint8_t)1) == 1 && Wire.read() >= 0;
+}
+
+// Índice de la velocidad más alta que aguanta el módulo; -1 si no responde
+inline int8_t xnBusProbe(uint8_t address)
+{
+    for (uint8_t r = 0; r < XN_BUS_RATE_COUNT; r++) {
+        xnBusSetClock(xnBusRate(r));
+
+        uint8_t ok = 0;
+        while (ok < XN_BUS_PROBES && xnBusProbeOnce(address)) {
+            ok++;
+        }
+        if (ok == XN_BUS_PROBES) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Va en setup(), después de Wire.begin(). Prueba los módulos de la lista
+ * y regresa cuántos respondieron.
+ */
+inline uint8_t xnBusBegin(const uint8_t *addresses, uint8_t count)
+{
+    XNBusState &bus = xnBusState();
+
+    bus.count = 0;
+    for (uint8_t i = 0; i < count && bus.count < XN_BUS_MAX_DEVICES; i++) {
+        int8_t rate = xnBusProbe(addresses[i]);
+
+        Serial.print("XN");
+        Serial.print(addresses[i]);
+        if (rate < 0) {
+            Serial.println(": no responde");
+            continue;
+        }
+        Serial.print(": ");
+        Serial.print(xnBusRate(rate) / 1000UL);
+        Serial.println(" kHz");
+
+        XNBusDevice *dev = &bus.devices[bus.count++];
+        memset(dev, 0, sizeof(*dev));
+        dev->address = addresses[i];
+        dev->rate = (uint8_t)rate;
+        dev->bestRate = (uint8_t)rate;
+    }
+    return bus.count;
+}
+
+// Antes de cada transacción: pone el reloj del módulo (100 kHz si no
+// se probó: no hereda el de otro módulo)
+inline void xnBusSelect(uint8_t address)
+{
+    XNBusDevice *dev = xnBusDevice(address);
+
+    xnBusSetClock(xnBusRate(dev ? dev->rate : XN_BUS_RATE_COUNT - 1));
+}
+
+// Después de cada transacción: cuenta errores y baja de velocidad si
+// hace falta (o sube una tras muchas ventanas limpias)
+inline void xnBusResult(uint8_t address, bool ok)
+{
+    XNBusDevice *dev = xnBusDevice(address);
+
+    if (!dev) {
+        return;
+    }
+    dev->transactions++;
+    dev->windowCount++;
+    if (!ok) {
+        dev->errors++;
+        dev->windowErrors++;
+    }
+
+    if (dev->windowErrors >= XN_BUS_MAX_ERRORS) {
+        if (dev->rate + 1 < XN_BUS_RATE_COUNT) {
+            dev->rate++;
+            dev->fallbacks++;
+            Serial.print("XN");
+            Serial.print(address);
+            Serial.print(": errores en el bus, baja a ");
+            Serial.print(xnBusRate(dev->rate) / 1000UL);
+            Serial.println(" kHz");
+        }
+        if (dev->trial && dev->backoff < XN_BUS_MAX_BACKOFF) {
+            dev->backoff++;
+        }
+        dev->trial = false;
+        dev->windowCount = 0;
+        dev->windowErrors = 0;
+        dev->cleanWindows = 0;
+    } else if (dev->windowCount >= XN_BUS_WINDOW) {
+        dev->cleanWindows = dev->windowErrors == 0 ? dev->cleanWindows + 1 : 0;
+        dev->windowCount = 0;
+        dev->windowErrors = 0;
+
+        if (dev->cleanWindows < ((uint16_t)XN_BUS_RECOVER_WINDOWS << dev->backoff)) {
+            return;
+        }
+        dev->cleanWindows = 0;
+        if (dev->trial) {
+            // Aguantó la subida anterior
+            dev->trial = false;
+            dev->backoff = 0;
+        }
+        if (dev->rate > dev->bestRate) {
+            dev->rate--;
+            dev->trial = true;
+            dev->recoveries++;
+            Serial.print("XN");
+            Serial.print(address);
+            Serial.print(": bus sin errores, sube a ");
+            Serial.print(xnBusRate(dev->rate) / 1000UL);
+            Serial.println(" kHz");
+        }
+    }
+}
+
+inline void xnBusReport()
+{
+    XNBusState &bus = xnBusState();
+
+    for (uint8_t i = 0; i < bus.count; i++) {
+        XNBusDevice *dev = &bus.devices[i];
+        Serial.printf("XN%u: %lu kHz, %lu trans, %lu errores, %u bajadas, %u subidas\n",
+                      dev->address, (unsigned long)(xnBusRate(dev->rate) / 1000UL),
+                      (unsigned long)dev->transactions, (unsigned long)dev->errors,
+                      dev->fallbacks, dev->recoveries);
+    }
+}
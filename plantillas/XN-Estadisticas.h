@@ -0,0 +1,196 @@
+/*
+ * ===================================================================
+ * ESTADÍSTICAS EN VENTANA PARA LECTURAS DE MÓDULOS XN
+ *
+ * Para muestrear un sensor varias veces por segundo y subir a la nube
+ * sólo un resumen por ventana: cuántas muestras, mínimo, máximo,
+ * promedio y desviación estándar. La memoria es fija: no se guardan
+ * las muestras, sólo acumuladores de unos 20 bytes.
+ *
+ * XNStats usa el método de Welford: el promedio y la suma de
+ * cuadrados se actualizan con cada muestra sin restar números grandes
+ * (con float, sumar x y x² por separado pierde precisión enseguida).
+ * Dos acumuladores se pueden juntar con xnStatsMerge().
+ *
+ * Ventanas:
+ *   XNTumbling  Ventanas fijas que no se traslapan (0-60 s, 60-120 s...).
+ *               Al cerrar una, xnTumblingAdd() entrega su resumen.
+ *   XNSliding   Los últimos windowMs, en XN_SLIDING_BUCKETS cubetas.
+ *               Al avanzar se descarta la cubeta más vieja completa,
+ *               así que la ventana real mide entre windowMs menos una
+ *               cubeta y windowMs.
+ *
+ * Las funciones reciben 'now' (millis()) para poder usarse desde una
+ * tarea de FreeRTOS con la hora de la lectura.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+#define XN_SLIDING_BUCKETS 10
+
+typedef struct {
+    uint32_t count;
+    float mean;
+    float m2;                   // Suma de (x - promedio)²
+    float min;
+    float max;
+} XNStats;
+
+static inline void xnStatsReset(XNStats *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+static inline void xnStatsAdd(XNStats *s, float x)
+{
+    s->count++;
+    if (s->count == 1) {
+        s->mean = x;
+        s->m2 = 0;
+        s->min = x;
+        s->max = x;
+        return;
+    }
+    float delta = x - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * (x - s->mean);
+    if (x < s->min) {
+        s->min = x;
+    }
+    if (x > s->max) {
+        s->max = x;
+    }
+}
+
+// Junta 'b' dentro de 'a' (como si todas las muestras fueran de 'a')
+static inline void xnStatsMerge(XNStats *a, const XNStats *b)
+{
+    if (b->count == 0) {
+        return;
+    }
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    uint32_t n = a->count + b->count;
+    float delta = b->mean - a->mean;
+
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((float)a->count * b->count / n);
+    a->count = n;
+    if (b->min < a->min) {
+        a->min = b->min;
+    }
+    if (b->max > a->max) {
+        a->max = b->max;
+    }
+}
+
+// Varianza de la muestra (n - 1); 0 con menos de dos muestras
+static inline float xnStatsVariance(const XNStats *s)
+{
+    return s->count > 1 ? s->m2 / (s->count - 1) : 0.0f;
+}
+
+static inline float xnStatsStddev(const XNStats *s)
+{
+    return sqrtf(xnStatsVariance(s));
+}
+
+
+//##################################################################
+// ### VENTANAS FIJAS (TUMBLING) ###
+//##################################################################
+
+typedef struct {
+    XNStats stats;
+    unsigned long windowMs;
+    unsigned long startedAt;
+} XNTumbling;
+
+static inline void xnTumblingBegin(XNTumbling *w, unsigned long windowMs, unsigned long now)
+{
+    xnStatsReset(&w->stats);
+    w->windowMs = windowMs;
+    w->startedAt = now;
+}
+
+/**
+ * Agrega una muestra. Si con ella la ventana ya terminó, copia el
+ * resumen de la ventana cerrada en 'closed', empieza la siguiente con
+ * esta muestra y regresa true.
+ */
+static inline bool xnTumblingAdd(XNTumbling *w, float x, unsigned long now, XNStats *closed)
+{
+    bool done = now - w->startedAt >= w->windowMs;
+
+    if (done) {
+        *closed = w->stats;
+        xnStatsReset(&w->stats);
+        // Sin atraso acumulado; tras un hueco largo se empieza de nuevo
+        w->startedAt += w->windowMs;
+        if (now - w->startedAt >= w->windowMs) {
+            w->startedAt = now;
+        }
+    }
+    xnStatsAdd(&w->stats, x);
+    return done;
+}
+
+
+//##################################################################
+// ### VENTANA DESLIZANTE (SLIDING) ###
+//##################################################################
+
+typedef struct {
+    XNStats buckets[XN_SLIDING_BUCKETS];
+    unsigned long bucketMs;
+    unsigned long bucketStart;  // Inicio de la cubeta actual
+    uint8_t current;
+} XNSliding;
+
+static inline void xnSlidingBegin(XNSliding *s, unsigned long windowMs, unsigned long now)
+{
+    memset(s, 0, sizeof(*s));
+    s->bucketMs = windowMs / XN_SLIDING_BUCKETS;
+    if (s->bucketMs == 0) {
+        s->bucketMs = 1;
+    }
+    s->bucketStart = now;
+}
+
+// Avanza hasta la cubeta de 'now' vaciando las que salen de la ventana
+static inline void xnSlidingAdvance(XNSliding *s, unsigned long now)
+{
+    uint8_t steps = 0;
+
+    while (now - s->bucketStart >= s->bucketMs && steps < XN_SLIDING_BUCKETS) {
+        s->current = (s->current + 1) % XN_SLIDING_BUCKETS;
+        xnStatsReset(&s->buckets[s->current]);
+        s->bucketStart += s->bucketMs;
+        steps++;
+    }
+    // Hueco más largo que la ventana: todo quedó vacío
+    if (now - s->bucketStart >= s->bucketMs) {
+        s->bucketStart = now;
+    }
+}
+
+static inline void xnSlidingAdd(XNSliding *s, float x, unsigned long now)
+{
+    xnSlidingAdvance(s, now);
+    xnStatsAdd(&s->buckets[s->current], x);
+}
+
+// Resumen de la ventana que termina en 'now'
+static inline void xnSlidingGet(XNSliding *s, unsigned long now, XNStats *out)
+{
+    xnSlidingAdvance(s, now);
+    xnStatsReset(out);
+    for (uint8_t i = 0; i < XN_SLIDING_BUCKETS; i++) {
+        xnStatsMerge(out, &s->buckets[i]);
+    }
+}
@@ -0,0 +1,308 @@
+/*
+ * ===================================================================
+ * MAPA DE REGISTROS DE LOS MÓDULOS XN (EN TIEMPO DE COMPILACIÓN)
+ *
+ * Cada registro se describe UNA vez con XNRegister (dirección I2C,
+ * número de registro, tipo crudo, orden de bytes y escala). Con eso el
+ * compilador genera las lecturas y escrituras: no hay tablas ni
+ * "switch" en tiempo de ejecución, todo queda como constantes.
+ *
+ * XNBurst junta registros contiguos del mismo módulo para leerlos (o
+ * escribirlos) en UNA sola transacción, aprovechando el
+ * auto-incremento de los módulos XN. Si los registros no son del mismo
+ * módulo o no son contiguos, el programa no compila.
+ *
+ * Agregar un módulo nuevo:
+ *   typedef XNRegister<7, 0x01, uint16_t, XN_BIG_ENDIAN, 10> XN07Presion;
+ *   float p = xnReadScaled<XN07Presion>();
+ *
+ * Todas las transacciones pasan por el gestor del bus (XN-Bus.h), que
+ * pone el reloj de cada módulo y cuenta sus errores.
+ *
+ * XNSnapshot guarda una copia de los registros de un módulo con su
+ * edad: las consultas se responden desde RAM hasta que la copia es
+ * más vieja que maxAgeMs. La copia es de a lo más XN_SNAPSHOT_MAX
+ * bytes; una más larga no se lee (refreshXNSnapshot() regresa false).
+ *
+ * Compatible con C++11 (núcleo ESP32 de Arduino 2.x).
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "XN-Bus.h"
+
+enum XNEndian {
+    XN_BIG_ENDIAN,          // Byte más significativo primero (XN04)
+    XN_LITTLE_ENDIAN
+};
+
+// Un registro de un módulo XN
+//   Address: dirección I2C del módulo
+//   Reg:     número de registro
+//   Raw:     tipo crudo; define el ancho (sizeof) y el signo
+//   Endian:  orden de los bytes en el bus
+//   Divisor: valor = crudo / Divisor (1 = sin escala)
+template <uint8_t Address, uint8_t Reg, typename Raw,
+          XNEndian Endian = XN_BIG_ENDIAN, uint16_t Divisor = 1>
+struct XNRegister {
+    typedef Raw raw_type;
+    static constexpr uint8_t address = Address;
+    static constexpr uint8_t reg = Reg;
+    static constexpr uint8_t width = sizeof(Raw);
+    static constexpr XNEndian endian = Endian;
+    static constexpr uint16_t divisor = Divisor;
+};
+
+// Bytes del bus -> valor crudo (el ciclo se desenrolla: el ancho es constante)
+template <typename R>
+inline typename R::raw_type xnDecode(const uint8_t *bytes)
+{
+    uint32_t value = 0;
+
+    for (uint8_t i = 0; i < R::width; i++) {
+        uint8_t b = (R::endian == XN_BIG_ENDIAN) ? bytes[i] : bytes[R::width - 1 - i];
+        value = (value << 8) | b;
+    }
+    return (typename R::raw_type)value;
+}
+
+// Valor crudo -> bytes del bus
+template <typename R>
+inline void xnEncode(uint8_t *bytes, typename R::raw_type raw)
+{
+    uint32_t value = (uint32_t)raw;
+
+    for (uint8_t i = 0; i < R::width; i++) {
+        uint8_t b = (uint8_t)(value >> (8 * (R::width - 1 - i)));
+        bytes[(R::endian == XN_BIG_ENDIAN) ? i : R::width - 1 - i] = b;
+    }
+}
+
+// Valor crudo -> unidades (ej. centésimas de grado -> grados)
+template <typename R>
+inline float xnScale(typename R::raw_type raw)
+{
+    return R::divisor == 1 ? (float)raw : (float)raw / (float)R::divisor;
+}
+
+
+//##################################################################
+// ### RÁFAGAS (REGISTROS CONTIGUOS EN UNA TRANSACCIÓN) ###
+//##################################################################
+
+// Bytes de una lista de registros
+template <typename... Regs> struct XNLength;
+template <> struct XNLength<> {
+    static constexpr uint8_t value = 0;
+};
+template <typename R, typename... Rest> struct XNLength<R, Rest...> {
+    static constexpr uint8_t value = R::width + XNLength<Rest...>::value;
+};
+
+// Todos del mismo módulo y con números de registro consecutivos
+template <typename... Regs> struct XNContiguous;
+template <typename R> struct XNContiguous<R> {
+    static constexpr bool value = true;
+};
+template <typename R, typename Next, typename... Rest> struct XNContiguous<R, Next, Rest...> {
+    static constexpr bool value = R::address == Next::address
+                                  && R::reg + 1 == Next::reg
+                                  && XNContiguous<Next, Rest...>::value;
+};
+
+// Posición (en bytes) del registro Q dentro de la ráfaga.
+// Si Q no es parte de la ráfaga, no compila.
+template <typename Q, typename... Regs> struct XNOffset;
+template <typename Q, typename... Rest> struct XNOffset<Q, Q, Rest...> {
+    static constexpr uint8_t value = 0;
+};
+template <typename Q, typename R, typename... Rest> struct XNOffset<Q, R, Rest...> {
+    static constexpr uint8_t value = R::width + XNOffset<Q, Rest...>::value;
+};
+
+template <typename R, typename... Rest> struct XNFirst {
+    typedef R type;
+};
+
+template <typename... Regs>
+struct XNBurst {
+    static_assert(XNContiguous<Regs...>::value,
+                  "XNBurst: los registros deben ser del mismo modulo y contiguos");
+
+    static constexpr uint8_t address = XNFirst<Regs...>::type::address;
+    static constexpr uint8_t first = XNFirst<Regs...>::type::reg;
+    static constexpr uint8_t length = XNLength<Regs...>::value;
+
+    // Valor crudo del registro Q dentro de los bytes de la ráfaga
+    template <typename Q>
+    static typename Q::raw_type get(const uint8_t *bytes)
+    {
+        return xnDecode<Q>(bytes + XNOffset<Q, Regs...>::value);
+    }
+
+    template <typename Q>
+    static float getScaled(const uint8_t *bytes)
+    {
+        return xnScale<Q>(get<Q>(bytes));
+    }
+
+    template <typename Q>
+    static void set(uint8_t *bytes, typename Q::raw_type raw)
+    {
+        xnEncode<Q>(bytes + XNOffset<Q, Regs...>::value, raw);
+    }
+};
+
+
+//##################################################################
+// ### ACCESO AL BUS ###
+//##################################################################
+
+// Lee 'length' bytes desde el registro 'reg' (una transacción)
+inline bool xnReadBytes(uint8_t address, uint8_t reg, uint8_t *bytes, uint8_t length)
+{
+    xnBusSelect(address);
+
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    bool ok = Wire.endTransmission() == 0
+              && Wire.requestFrom(address, length) == length;
+
+    xnBusResult(address, ok);
+    if (!ok) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        bytes[i] = Wire.read();
+    }
+    return true;
+}
+
+// Escribe 'length' bytes desde el registro 'reg' (una transacción)
+inline bool xnWriteBytes(uint8_t address, uint8_t reg, const uint8_t *bytes, uint8_t length)
+{
+    xnBusSelect(address);
+
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(bytes, length);
+    bool ok = Wire.endTransmission() == 0;
+
+    xnBusResult(address, ok);
+    return ok;
+}
+
+template <typename R>
+inline bool xnRead(typename R::raw_type *raw)
+{
+    uint8_t bytes[R::width];
+
+    if (!xnReadBytes(R::address, R::reg, bytes, R::width)) {
+        return false;
+    }
+    *raw = xnDecode<R>(bytes);
+    return true;
+}
+
+// Lectura ya escalada; NAN si el módulo no respondió
+template <typename R>
+inline float xnReadScaled()
+{
+    typename R::raw_type raw;
+
+    if (!xnRead<R>(&raw)) {
+        return NAN;
+    }
+    return xnScale<R>(raw);
+}
+
+template <typename R>
+inline bool xnWrite(typename R::raw_type raw)
+{
+    uint8_t bytes[R::width];
+
+    xnEncode<R>(bytes, raw);
+    return xnWriteBytes(R::address, R::reg, bytes, R::width);
+}
+
+// Toda la ráfaga en una transacción; 'bytes' debe tener B::length
+template <typename B>
+inline bool xnReadBurst(uint8_t *bytes)
+{
+    return xnReadBytes(B::address, B::first, bytes, B::length);
+}
+
+template <typename B>
+inline bool xnWriteBurst(const uint8_t *bytes)
+{
+    return xnWriteBytes(B::address, B::first, bytes, B::length);
+}
+
+
+//##################################################################
+// ### COPIA DE REGISTROS CON EDAD MÁXIMA ###
+//##################################################################
+
+#ifndef XN_SNAPSHOT_MAX
+#define XN_SNAPSHOT_MAX 6       // Bytes de una copia (el bloque del XN04)
+#endif
+
+// Una transacción llena la copia de un módulo y las consultas
+// siguientes se responden desde RAM hasta que tiene más de maxAgeMs
+typedef struct {
+    uint8_t address;            // Dirección I2C del módulo
+    uint8_t firstReg;           // Primer registro de la copia
+    uint8_t length;             // Bytes de la copia (auto-incremento)
+    uint8_t data[XN_SNAPSHOT_MAX]; // Registros tal como llegan por el bus
+    unsigned long readAt;       // millis() de la última lectura
+    bool valid;
+} XNSnapshot;
+
+typedef struct {
+    uint32_t hits;              // Consultas servidas desde RAM
+    uint32_t reads;             // Transacciones I2C hechas
+} XNCacheStats;
+
+inline XNCacheStats &xnCacheStats()
+{
+    static XNCacheStats stats;
+    return stats;
+}
+
+// Lee la copia completa en una sola transacción. 'length' lo pone quien
+// declara la copia: si no cabe en 'data' no se toca el bus
+inline bool refreshXNSnapshot(XNSnapshot *snap)
+{
+    if (snap->length > sizeof(snap->data)) {
+        snap->valid = false;
+        return false;
+    }
+    xnCacheStats().reads++;
+
+    if (!xnReadBytes(snap->address, snap->firstReg, snap->data, snap->length)) {
+        snap->valid = false;
+        return false;
+    }
+    snap->readAt = millis();
+    snap->valid = true;
+    return true;
+}
+
+// Regresa la copia; sólo usa el bus si es más vieja que maxAgeMs
+// (maxAgeMs = 0 obliga a leer)
+inline bool getXNSnapshot(XNSnapshot *snap, unsigned long maxAgeMs)
+{
+    if (snap->valid && millis() - snap->readAt < maxAgeMs) {
+        xnCacheStats().hits++;
+        return true;
+    }
+    return refreshXNSnapshot(snap);
+}
+
+// Marca la copia como vieja (por ejemplo, después de escribir el módulo)
+inline void invalidateXNSnapshot(XNSnapshot *snap)
+{
+    snap->valid = false;
+}
@@ -1,33 +1,138 @@
 // Modulo XN01
+#include "XN-Registros.h"
+// Aviso de cambio del XN01 por su linea INT
+// El XN01 baja INT (colector abierto) cuando cambia alguna entrada y la
+// suelta cuando se lee el registro 0x01. Asi el bus solo se usa cuando
+// hubo un cambio.
+// OJO: MIKROBUS_INT es el Power Key del XC03 en las plantillas con modem.
+#define XN01_INT_PIN MIKROBUS_INT
+#define XN01_QUEUE_SIZE 8           // Potencia de 2
+#define XN01_SETTLE_MS 5UL          // Antirrebote: espera antes de leer
+
+// Se llama con las 8 entradas y los bits que cambiaron
+typedef void (*XN01ChangeCallback)( uint8_t inputs, uint8_t changed );
+
+// Cola sin candados: la ISR solo escribe xn01Head y loop() solo xn01Tail
+static uint32_t xn01Queue[XN01_QUEUE_SIZE];    // millis() de cada flanco
+static volatile uint8_t xn01Head = 0;
+static volatile uint8_t xn01Tail = 0;
+
+static uint8_t xn01Inputs = 0;                  // Ultimo valor leido
+static XN01ChangeCallback xn01OnChange = NULL;
+
+// Registro 0x01 del XN01: las 8 entradas (ver XN-Registros.h)
+typedef XNRegister<1, 0x01, uint8_t> XN01Inputs;
+
+// Copia del registro de entradas
+#define XN01_MAX_AGE_MS 20UL
+static XNSnapshot xn01Snap = { XN01Inputs::address, XN01Inputs::reg, XN01Inputs::width };
+static bool xn01IntArmed = false;
+
+// Las 8 entradas como mascara (bit 0 = entrada 1).
+// Con la INT armada la copia solo se vence cuando hay un flanco pendiente;
+// sin INT se vence despues de XN01_MAX_AGE_MS.
+bool readXN01All( uint8_t *inputs ) {
+    unsigned long maxAge = XN01_MAX_AGE_MS;
+
+    if ( xn01IntArmed && xn01Head == xn01Tail )
+        maxAge = 0xFFFFFFFFUL;
+
+    if ( !getXNSnapshot( &xn01Snap, maxAge ) )
+        return false;
+
+    *inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    return true;
+}
+
 //                             Input es el led a encender
 uint8_t readXN01Input( uint8_t input ) {
     uint8_t inputs = 0;
 
-    // Inicia la comunicación con el XN(01)
-    Wire.beginTransmission(1);
-    // Selecciona el registro de las entradas
-    Wire.write( 0x01 );
-    // Finaliza la comunicación con el nodo
-    Wire.endTransmission();
-
-    // Lee 1 byte con la información de las entradas
-    Wire.requestFrom( 1, 1);
-        
-    inputs = Wire.read();
-
     if ( input > 8 || input < 1 )
         return 255;
-    
+
+    // Leer las 8 entradas una por una cuesta una sola transaccion
+    if ( !readXN01All( &inputs ) )
+        return 255;
+
     return ( inputs >> (input - 1) ) & 0x01;
 }
 
+void IRAM_ATTR onXN01Int( ) {
+    uint8_t head = xn01Head;
+    uint8_t next = ( head + 1 ) & ( XN01_QUEUE_SIZE - 1 );
+
+    // Cola llena: ya hay una lectura pendiente, no se pierde nada
+    if ( next == __atomic_load_n( &xn01Tail, __ATOMIC_ACQUIRE ) )
+        return;
+
+    xn01Queue[head] = millis();
+    __atomic_store_n( &xn01Head, next, __ATOMIC_RELEASE );
+}
+
+void beginXN01Interrupt( XN01ChangeCallback onChange ) {
+    xn01OnChange = onChange;
+    pinMode( XN01_INT_PIN, INPUT_PULLUP );
+
+    // Lectura inicial: deja INT en alto antes de armar la interrupcion
+    if ( refreshXNSnapshot( &xn01Snap ) )
+        xn01Inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    attachInterrupt( digitalPinToInterrupt( XN01_INT_PIN ), onXN01Int, FALLING );
+    xn01IntArmed = true;
+}
+
+// Va en loop(). Sin flancos pendientes no toca el bus.
+void processXN01Events( ) {
+    uint8_t head = __atomic_load_n( &xn01Head, __ATOMIC_ACQUIRE );
+
+    if ( xn01Tail == head )
+        return;
+
+    // Espera a que las entradas se asienten desde el primer flanco
+    if ( millis() - xn01Queue[xn01Tail] < XN01_SETTLE_MS )
+        return;
+
+    // Todos los flancos pendientes se atienden con UNA lectura
+    __atomic_store_n( &xn01Tail, head, __ATOMIC_RELEASE );
+
+    // Lee el registro de entradas (y con eso suelta INT)
+    if ( !refreshXNSnapshot( &xn01Snap ) )
+        return;
+
+    uint8_t inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    uint8_t changed = inputs ^ xn01Inputs;
+    xn01Inputs = inputs;
+
+    if ( changed && xn01OnChange )
+        xn01OnChange( inputs, changed );
+}
+
+void printXN01Change( uint8_t inputs, uint8_t changed ) {
+    for ( uint8_t i = 0; i < 8; i++ ) {
+        if ( changed & ( 1 << i ) ) {
+            Serial.print( "Entrada " );
+            Serial.print( i + 1 );
+            Serial.print( ": " );
+            Serial.println( ( inputs >> i ) & 0x01 );
+        }
+    }
+}
+
 void setup(){
     // Le decimos al LED que va a estar en modo salida
     pinMode(BOARD_LED, OUTPUT);
 
-}
+    Serial.begin(115200);
+    Wire.setPins( MIKROBUS_SDA, MIKROBUS_SCL );
+    Wire.begin();
 
-void loop(){
+    // Velocidad del bus para el XN01 (prueba 1 MHz, 400 kHz y 100 kHz)
+    const uint8_t xnAddresses[] = { 1 };
+    xnBusBegin( xnAddresses, sizeof( xnAddresses ) );
 
+    beginXN01Interrupt( printXN01Change );
 }
 
+void loop(){
+    processXN01Events();
+}
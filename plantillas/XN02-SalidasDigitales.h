@@ -0,0 +1,173 @@
+/*
+ * ===================================================================
+ * SALIDAS DEL XN02 (COPIA SOMBRA)
+ *
+ * El registro 0x01 del XN02 tiene las 8 salidas (bit 0 = salida 1).
+ * Las funciones por bit sólo cambian una copia (sombra) y el bus se usa
+ * únicamente cuando la copia es distinta de lo último que se escribió
+ * en el módulo:
+ *
+ *   beginXN02();                 // setup(): parte del estado real
+ *   writeXN02Output(3, HIGH);    // Escribe sólo si cambió
+ *
+ * Dentro de una transacción (beginXN02Transaction() /
+ * commitXN02Transaction()) los cambios se juntan y se escriben con UNA
+ * transacción al final.
+ *
+ * Todo es 'inline' y el estado vive en xn02State(): el módulo
+ * (XN02-SalidasDigitales.cpp), la plantilla y los sketches que mueven
+ * salidas por su cuenta usan la misma copia.
+ * ===================================================================
+ */
+#pragma once
+
+#include "XN-Registros.h"
+
+// Registro 0x01 del XN02: las 8 salidas (ver XN-Registros.h)
+typedef XNRegister<2, 0x01, uint8_t> XN02Outputs;
+
+typedef struct {
+    uint8_t shadow;             // Estado deseado de las 8 salidas
+    uint8_t written;            // Último valor escrito en el XN02
+    bool synced;                // false: 'written' no es confiable
+    uint8_t txDepth;            // Transacciones abiertas (anidables)
+    uint32_t writes;            // Escrituras hechas en el bus
+    uint32_t skipped;           // Escrituras evitadas (sin cambio)
+} XN02State;
+
+inline XN02State &xn02State()
+{
+    static XN02State state;
+    return state;
+}
+
+// Lee el registro de salidas del XN02 y sincroniza la copia
+inline bool readXN02Binary(uint8_t *outputs)
+{
+    XN02State &s = xn02State();
+
+    if (!xnRead<XN02Outputs>(outputs)) {
+        return false;
+    }
+    if (s.txDepth == 0) {
+        s.shadow = *outputs;
+    }
+    s.written = *outputs;
+    s.synced = true;
+    return true;
+}
+
+// Escribe la copia en el XN02 sólo si cambió
+inline bool flushXN02()
+{
+    XN02State &s = xn02State();
+
+    if (s.synced && s.shadow == s.written) {
+        s.skipped++;
+        return true;
+    }
+
+    s.writes++;
+
+    if (!xnWrite<XN02Outputs>(s.shadow)) {
+        // No sabemos qué quedó en el módulo: la siguiente escritura va al bus
+        s.synced = false;
+        return false;
+    }
+
+    s.written = s.shadow;
+    s.synced = true;
+    return true;
+}
+
+// Va en setup(): parte del estado real de las salidas
+inline bool beginXN02()
+{
+    uint8_t outputs;
+    return readXN02Binary(&outputs);
+}
+
+inline void beginXN02Transaction()
+{
+    xn02State().txDepth++;
+}
+
+// Cierra la transacción; la más externa escribe (si hubo cambio)
+inline bool commitXN02Transaction()
+{
+    XN02State &s = xn02State();
+
+    if (s.txDepth == 0 || --s.txDepth > 0) {
+        return true;
+    }
+    return flushXN02();
+}
+
+// Las 8 salidas de una vez (bit 0 = salida 1)
+inline bool writeXN02Binary(uint8_t data)
+{
+    XN02State &s = xn02State();
+
+    s.shadow = data;
+    if (s.txDepth > 0) {
+        return true;
+    }
+    return flushXN02();
+}
+
+// 'output' es la salida (1 - 8)
+inline bool writeXN02Output(uint8_t output, bool stat)
+{
+    if (output > 8 || output < 1) {
+        return false;
+    }
+
+    uint8_t mask = 1 << (output - 1);
+    uint8_t shadow = xn02State().shadow;
+
+    return writeXN02Binary(stat ? (shadow | mask) : (shadow & ~mask));
+}
+
+inline bool setXN02Output(uint8_t output)
+{
+    return writeXN02Output(output, HIGH);
+}
+
+inline bool clearXN02Output(uint8_t output)
+{
+    return writeXN02Output(output, LOW);
+}
+
+inline bool toggleXN02Output(uint8_t output)
+{
+    if (output > 8 || output < 1) {
+        return false;
+    }
+    return writeXN02Binary(xn02State().shadow ^ (1 << (output - 1)));
+}
+
+// Estado deseado de una salida (desde la copia, sin usar el bus)
+inline uint8_t getXN02Output(uint8_t output)
+{
+    if (output > 8 || output < 1) {
+        return 255;
+    }
+    return (xn02State().shadow >> (output - 1)) & 0x01;
+}
+
+inline void writeXN02(bool o1 = LOW, bool o2 = LOW, bool o3 = LOW, bool o4 = LOW,
+                      bool o5 = LOW, bool o6 = LOW, bool o7 = LOW, bool o8 = LOW)
+{
+    uint8_t data = 0;
+
+    data |= o1;
+    data |= o2 << 1;
+    data |= o3 << 2;
+    data |= o4 << 3;
+    data |= o5 << 4;
+    data |= o6 << 5;
+    data |= o7 << 6;
+    data |= o8 << 7;
+
+    writeXN02Binary(data);
+}
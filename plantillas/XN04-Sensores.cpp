@@ -1,55 +1,68 @@
 // Modulo XN04
+#include "XN04-Sensores.h"
+
+// Copia de los registros 0x01 - 0x03 (6 bytes, auto-incremento desde 0x01)
+// Los getters aceptan una copia de hasta XN04_MAX_AGE_MS: el sensor cambia
+// despacio y asi temperatura, humedad y luz salen de la misma lectura.
+#define XN04_MAX_AGE_MS 1000UL
+static XNSnapshot xn04Snap = { XN04Block::address, XN04Block::first, XN04Block::length };
+
+static void decodeXN04( XN04Data *data ){
+    xn04Decode( xn04Snap.data, data );
+}
+
+// Lee temperatura, humedad y luz en una sola transaccion.
+// El XN04 incrementa el registro automaticamente, asi que pidiendo
+// 6 bytes desde el 0x01 recibimos los registros 0x01, 0x02 y 0x03.
+// Siempre usa el bus (y de paso refresca la copia).
+// Regresa false si el modulo no entrego los 6 bytes.
+bool readXN04All( XN04Data *data ){
+
+    if ( !refreshXNSnapshot( &xn04Snap ) )
+        return false;
+
+    decodeXN04( data );
+    return true;
+}
+
+// Igual que readXN04All, pero acepta una copia de hasta maxAgeMs
+bool readXN04Cached( XN04Data *data, unsigned long maxAgeMs ){
+
+    if ( !getXNSnapshot( &xn04Snap, maxAgeMs ) )
+        return false;
+
+    decodeXN04( data );
+    return true;
+}
+
 float readXN04Temperature( ){
 
-    float temperature;
-    uint16_t temperature_int;
-    // Comunicarse con XN04
-    Wire.beginTransmission( 4 );
-    // Registro de temperature
-    Wire.write( 0x01 );
-    Wire.endTransmission();
-
-    // Pide 2 bytes al modulo 4 (XNO4)
-    Wire.requestFrom( 4, 2 );
-    
-    temperature_int = ( (Wire.read() << 8) | Wire.read() );
-    temperature = temperature_int/100.0f;
-
-    return temperature;
+    XN04Data data;
+
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return NAN;
+
+    return xnScale<XN04Temperature>( data.temperature_int );
 }
 
 float readXN04Humidity( ){
 
-    float humidity;
-    uint16_t humidity_int;
-    // Comunicarse con XN04
-    Wire.beginTransmission( 4 );
-    // Registro de humidity
-    Wire.write( 0x02 );
-    Wire.endTransmission();
+    XN04Data data;
 
-    Wire.requestFrom( 4, 2 );
-    
-    humidity_int = ( (Wire.read() << 8) | Wire.read() );
-    humidity = humidity_int/100.0f;
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return NAN;
 
-    return humidity;
+    return xnScale<XN04Humidity>( data.humidity_int );
 
 }
 
 uint16_t readXN04Luminosity( ){
 
-    uint16_t lux;
-    // Comunicarse con XN04
-    Wire.beginTransmission( 4 );
-    // Registro de lux
-    Wire.write( 0x03 );
-    Wire.endTransmission();
+    XN04Data data;
 
-    Wire.requestFrom( 4, 2 );
-    
-    lux = ( (Wire.read() << 8) | Wire.read() );
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return 0;
 
-    return lux;
+    return data.lux;
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,82 @@
+/*
+ * ===================================================================
+ * REGISTROS DEL XN04 (TEMPERATURA, HUMEDAD Y LUZ)
+ *
+ * Los tres registros del XN04 se describen aquí una sola vez (ver
+ * XN-Registros.h) para que el módulo (XN04-Sensores.cpp) y los sketches
+ * que leen el XN04 por su cuenta usen la misma dirección, registros y
+ * escala:
+ *
+ *   uint8_t bytes[XN04Block::length];
+ *   if (xnReadBurst<XN04Block>(bytes)) {
+ *       float t = XN04Block::getScaled<XN04Temperature>(bytes);
+ *   }
+ *
+ * El XN04 auto-incrementa el registro: la ráfaga de 6 bytes desde el
+ * 0x01 trae temperatura, humedad y luz en UNA transacción.
+ *
+ * También vive aquí la ventana de resumen (XN04Window): quien lee el
+ * sensor le pasa cada lectura con xn04WindowAdd() y recibe un resumen
+ * (XN04Summary) cada vez que se cierra la ventana.
+ * ===================================================================
+ */
+#pragma once
+
+#include "XN-Registros.h"
+#include "XN-Estadisticas.h"
+
+// Imagen de los registros 0x01 - 0x03 del XN04 tal como llegan por el bus
+// (valores crudos, 2 bytes cada uno)
+typedef struct __attribute__((packed)) {
+    uint16_t temperature_int;   // Registro 0x01 (centésimas de grado)
+    uint16_t humidity_int;      // Registro 0x02 (centésimas de %)
+    uint16_t lux;               // Registro 0x03 (lux)
+} XN04Data;
+
+typedef XNRegister<4, 0x01, uint16_t, XN_BIG_ENDIAN, 100> XN04Temperature;
+typedef XNRegister<4, 0x02, uint16_t, XN_BIG_ENDIAN, 100> XN04Humidity;
+typedef XNRegister<4, 0x03, uint16_t> XN04Lux;
+typedef XNBurst<XN04Temperature, XN04Humidity, XN04Lux> XN04Block;
+
+// Bytes de la ráfaga -> valores crudos
+inline void xn04Decode(const uint8_t *bytes, XN04Data *data)
+{
+    data->temperature_int = XN04Block::get<XN04Temperature>(bytes);
+    data->humidity_int = XN04Block::get<XN04Humidity>(bytes);
+    data->lux = XN04Block::get<XN04Lux>(bytes);
+}
+
+// Resumen por ventana (ver XN-Estadisticas.h)
+// Para muestrear a 1-10 Hz y subir solo un resumen por ventana. Cada
+// muestra es UNA lectura de 6 bytes; no se guardan las muestras.
+typedef struct {
+    XNStats temperature;        // Grados
+    XNStats humidity;           // %
+    XNStats lux;
+} XN04Summary;
+
+typedef struct {
+    XNTumbling temperature;
+    XNTumbling humidity;
+    XNTumbling lux;
+} XN04Window;
+
+inline void xn04WindowBegin(XN04Window *w, unsigned long windowMs, unsigned long now)
+{
+    xnTumblingBegin(&w->temperature, windowMs, now);
+    xnTumblingBegin(&w->humidity, windowMs, now);
+    xnTumblingBegin(&w->lux, windowMs, now);
+}
+
+// Agrega una lectura. Regresa true cuando se cerró una ventana y deja su
+// resumen en 'closed'. Las tres ventanas empiezan juntas, así que
+// también cierran juntas.
+inline bool xn04WindowAdd(XN04Window *w, const XN04Data *data, unsigned long now,
+                          XN04Summary *closed)
+{
+    bool done = xnTumblingAdd(&w->temperature, xnScale<XN04Temperature>(data->temperature_int),
+                              now, &closed->temperature);
+    xnTumblingAdd(&w->humidity, xnScale<XN04Humidity>(data->humidity_int), now, &closed->humidity);
+    xnTumblingAdd(&w->lux, data->lux, now, &closed->lux);
+    return done;
+}
@@ -1,31 +1,89 @@
-void writeXN11(uint8_t relay, uint8_t stat)
-{
-    uint8_t reg = 0x00;
-    uint8_t data = 0x00;
-
-    if ( stat ){
-        data = 0x01;
-    } else {
-        data = 0x00;
-    }
+// Modulo XN11
+// Descriptores y copia sombra de los relevadores: XN11-Relevadores.h
+#include "XN11-Relevadores.h"
+
+// Secuenciador de relevadores
+// Un programa es una lista de pasos ordenada por tiempo. Cada
+// XN11_TICK_MS se aplican todos los pasos que ya vencieron y se hace UNA
+// escritura, asi que los pasos del mismo tick van en la misma transaccion.
+// No usa delay(): loop() queda libre para Blynk, sensores, etc.
+#define XN11_TICK_MS 50UL
+
+typedef struct {
+    uint32_t atMs;      // Tiempo desde el inicio del programa
+    uint8_t relay;      // 1 o 2
+    uint8_t stat;       // HIGH / LOW
+} XN11Step;
+
+static const XN11Step *xn11Program = NULL;
+static uint8_t xn11ProgramLength = 0;
+static uint32_t xn11PeriodMs = 0;       // 0: el programa corre una vez
+static uint8_t xn11NextStep = 0;
+static unsigned long xn11StartedAt = 0;
+static unsigned long xn11LastTick = 0;
+
+// Arranca un programa; periodMs > 0 lo repite cada periodMs
+void startXN11Program( const XN11Step *steps, uint8_t length, uint32_t periodMs ) {
+    xn11Program = steps;
+    xn11ProgramLength = length;
+    xn11PeriodMs = periodMs;
+    xn11NextStep = 0;
+    xn11StartedAt = millis();
+    // El primer tick es inmediato
+    xn11LastTick = xn11StartedAt - XN11_TICK_MS;
+}
 
-    switch( relay ){
-        case 1:
-        case 2:
-        reg = relay;
-        break;
-        default:
+void stopXN11Program( ) {
+    xn11Program = NULL;
+}
+
+bool isXN11ProgramRunning( ) {
+    return xn11Program != NULL;
+}
+
+// Va en loop()
+void updateXN11Sequencer( ) {
+    if ( xn11Program == NULL )
         return;
+
+    unsigned long now = millis();
+    if ( now - xn11LastTick < XN11_TICK_MS )
+        return;
+    xn11LastTick = now;
+
+    bool changed = false;
+
+    // Aplica en la copia todos los pasos vencidos
+    while ( xn11NextStep < xn11ProgramLength
+            && now - xn11StartedAt >= xn11Program[xn11NextStep].atMs ) {
+        changed |= setXN11Relay( xn11Program[xn11NextStep].relay,
+                                 xn11Program[xn11NextStep].stat );
+        xn11NextStep++;
     }
 
-    // Comunicacion con XN11
-    Wire.beginTransmission(11);
-    // Valor de salidas
-    Wire.write( reg );
-    Wire.write(data);
-    Wire.endTransmission();
+    if ( changed )
+        flushXN11();
+
+    // Fin del programa: se repite o se detiene
+    if ( xn11NextStep >= xn11ProgramLength ) {
+        if ( xn11PeriodMs == 0 ) {
+            xn11Program = NULL;
+        } else if ( now - xn11StartedAt >= xn11PeriodMs ) {
+            xn11StartedAt += xn11PeriodMs;
+            xn11NextStep = 0;
+        }
+    }
 }
 
+// Relevador 1 a los 0 s, relevador 2 a los 5 s y los dos se apagan
+// a los 10 s (una sola transaccion); se repite cada 15 s
+static const XN11Step demoProgram[] = {
+    {     0UL, 1, HIGH },
+    {  5000UL, 2, HIGH },
+    { 10000UL, 1, LOW },
+    { 10000UL, 2, LOW },
+};
+
 void setup() {
 
     // Configuración de comunicaciones seriales
@@ -33,21 +91,20 @@ void setup() {
     Wire.setPins( MIKROBUS_SDA, MIKROBUS_SCL );
     Wire.begin();
 
-    writeXN11( 1, LOW );
-    writeXN11( 2, LOW );
-}
+    // Velocidad del bus para el XN11 (prueba 1 MHz, 400 kHz y 100 kHz)
+    const uint8_t xnAddresses[] = { 11 };
+    xnBusBegin( xnAddresses, sizeof( xnAddresses ) );
 
-void loop() {
+    // Los dos relevadores en una transaccion
+    setXN11Relay( 1, LOW );
+    setXN11Relay( 2, LOW );
+    flushXN11();
 
-    writeXN11( 1, HIGH );
-    delay( 5000UL );
-    writeXN11( 2, HIGH );
-    delay( 5000UL );
+    startXN11Program( demoProgram, sizeof( demoProgram ) / sizeof( demoProgram[0] ), 15000UL );
+}
 
-    
+void loop() {
 
-    writeXN11( 1, LOW );
-    writeXN11( 2, LOW );
-    delay( 5000UL );
+    updateXN11Sequencer();
 
 }
@@ -0,0 +1,95 @@
+/*
+ * ===================================================================
+ * RELEVADORES DEL XN11 (COPIA SOMBRA)
+ *
+ * Registros 0x01 y 0x02 del XN11 (relevador 1 y 2). setXN11Relay() sólo
+ * cambia una copia; flushXN11() escribe en el módulo sólo lo que cambió
+ * y, si cambian los dos, los escribe juntos (auto-incremento desde
+ * 0x01) en UNA transacción:
+ *
+ *   setXN11Relay(1, HIGH);
+ *   setXN11Relay(2, LOW);
+ *   flushXN11();
+ *
+ * Todo es 'inline' y el estado vive en xn11State(): el módulo
+ * (XN11-Relevadores.cpp) y los sketches que mueven relevadores por su
+ * cuenta usan la misma copia.
+ * ===================================================================
+ */
+#pragma once
+
+#include "XN-Registros.h"
+
+// Registros 0x01 y 0x02 del XN11 (ver XN-Registros.h)
+typedef XNRegister<11, 0x01, uint8_t> XN11Relay1;
+typedef XNRegister<11, 0x02, uint8_t> XN11Relay2;
+typedef XNBurst<XN11Relay1, XN11Relay2> XN11Relays;
+
+typedef struct {
+    uint8_t shadow[2];          // Estado deseado
+    uint8_t written[2];         // Último valor escrito
+    bool synced;                // false: forzar escritura
+    uint32_t writes;            // Transacciones hechas
+    uint32_t skipped;           // Escrituras evitadas (sin cambio)
+} XN11State;
+
+inline XN11State &xn11State()
+{
+    static XN11State state;
+    return state;
+}
+
+// Escribe en el XN11 sólo los relevadores que cambiaron
+inline bool flushXN11()
+{
+    XN11State &s = xn11State();
+    bool dirty1 = !s.synced || s.shadow[0] != s.written[0];
+    bool dirty2 = !s.synced || s.shadow[1] != s.written[1];
+
+    if (!dirty1 && !dirty2) {
+        s.skipped++;
+        return true;
+    }
+
+    bool ok;
+    if (dirty1 && dirty2) {
+        // Los dos relevadores: registro 0x01 y el XN11 avanza al 0x02
+        uint8_t bytes[XN11Relays::length];
+        XN11Relays::set<XN11Relay1>(bytes, s.shadow[0]);
+        XN11Relays::set<XN11Relay2>(bytes, s.shadow[1]);
+        ok = xnWriteBurst<XN11Relays>(bytes);
+    } else if (dirty1) {
+        ok = xnWrite<XN11Relay1>(s.shadow[0]);
+    } else {
+        ok = xnWrite<XN11Relay2>(s.shadow[1]);
+    }
+    s.writes++;
+
+    if (!ok) {
+        s.synced = false;
+        return false;
+    }
+
+    s.written[0] = s.shadow[0];
+    s.written[1] = s.shadow[1];
+    s.synced = true;
+    return true;
+}
+
+// Sólo cambia la copia (se escribe con flushXN11)
+inline bool setXN11Relay(uint8_t relay, uint8_t stat)
+{
+    if (relay != 1 && relay != 2) {
+        return false;
+    }
+    xn11State().shadow[relay - 1] = stat ? 0x01 : 0x00;
+    return true;
+}
+
+inline void writeXN11(uint8_t relay, uint8_t stat)
+{
+    if (!setXN11Relay(relay, stat)) {
+        return;
+    }
+    flushXN11();
+}
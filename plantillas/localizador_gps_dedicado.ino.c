@@ -1,13 +1,36 @@
 /*
  * ===================================================================
  * PROYECTO:      Localizador GPS Dedicado (Solo GNSS)
- * VERSIÓN:       1.0
+ * VERSIÓN:       1.5 (Geocercas en el Equipo)
  *
  * DESCRIPCIÓN:
  * Este script demuestra el uso correcto del modo GNSS del XC03.
- * Inicia el módem y entra en un bucle de espera activa (con timeout)
- * para adquirir un "fix" de GPS. Una vez obtenido, imprime las
- * coordenadas en el monitor serie.
+ * Inicia el módem y adquiere el "fix" de GPS con una máquina de
+ * estados NO bloqueante: loop() la avanza un paso a la vez, el módem
+ * se consulta con una cadencia fija y el resultado (fix, timeout o
+ * progreso) llega por callbacks. Mientras tanto el resto del programa
+ * (el parpadeo del LED, lecturas de sensores, etc.) sigue corriendo.
+ *
+ * El módem también arranca sin pausas fijas: un pulso de 1.1 s en el
+ * Power Key y después "AT" cada 250 ms hasta que conteste. Si ya
+ * contesta antes del pulso (sólo se reinició el ESP32), no se pulsa.
+ *
+ * Las posiciones se leen sin modem.getGPS(): la respuesta a
+ * AT+CGNSINF se analiza en un búfer fijo (XC03-GNSS.h) y queda en un
+ * XC03Fix con enteros de punto fijo. Así una consulta por segundo
+ * durante semanas no pide memoria dinámica ni fragmenta el heap.
+ *
+ * Cada posición pasa además por un filtro de banda muerta y, si
+ * cambió el rumbo o la velocidad, se agrega al trayecto: un bloque
+ * binario de TRACK_BLOCK_SIZE bytes con diferencias en varint
+ * (XC03-Trayecto.h), de ~6 bytes por punto. Es lo que se subiría a
+ * la nube en lugar de las posiciones en texto.
+ *
+ * Geocercas: cada posición se revisa contra las cercas (círculos y
+ * polígonos) de GEOFENCES con XC03-Geocerca.h. Un índice de rejilla
+ * deja sólo las cercas cercanas para la prueba exacta, así que
+ * cientos de cercas cuestan microsegundos por posición. Sólo las
+ * ENTRADAS y SALIDAS se guardan para subir (~3 bytes por evento).
  *
  * NOTA: Este script NO utiliza la red celular (GPRS/LTE).
  * ===================================================================
@@ -22,9 +45,14 @@
  * GLOSARIO DE FUNCIONES CLAVE (PARA GPS y TIMERS)
  * ===================================================================
  * * --- LIBRERÍA TinyGsmClient (MÓDEM XC03) ---
- * * modem.restart()
+ * * modem.init()
  * Para QUÉ: Configura el módem con comandos AT iniciales.
- * Esencial después de un reinicio por hardware.
+ * Esencial después de encenderlo por hardware.
+ *
+ * * xc03BootUpdate(&boot)
+ * Para QUÉ: Avanza el encendido del módem UN paso y regresa de
+ * inmediato (XC03-Arranque.h). Regresa true cuando el GNSS ya está
+ * habilitado. El pulso del PWRKEY lo termina un esp_timer.
  *
  * * modem.gprsDisconnect()
  * Para QUÉ: Se desconecta forzosamente de la red celular.
@@ -35,11 +63,42 @@
  * Para QUÉ: Habilita la antena y el receptor GNSS del XC03.
  * (REGLA DE ORO: Falla si la red GPRS/LTE está activa).
  *
- * * modem.getGPS( &lat, &lon, ...)
- * Para QUÉ: Pide al módem que "llene" nuestras variables
- * globales (lat, lon, etc.) con los datos actuales del GPS.
- * Devuelve 'true' solo si ya tiene un "fix" (posición válida).
- * Devuelve 'false' si aún está buscando señal.
+ * * --- LECTURA DE POSICIONES (XC03-GNSS.h) ---
+ * * xc03GnssAsk(&query, SerialAT, millis())
+ * Para QUÉ: Manda AT+CGNSINF y regresa sin esperar la respuesta.
+ *
+ * * xc03GnssPoll(&query, SerialAT, millis(), &fix)
+ * Para QUÉ: Lee lo que ya llegó de la respuesta. Regresa
+ * XC03_GNSS_FIX cuando 'fix' ya tiene una posición válida y
+ * XC03_GNSS_PENDING mientras la respuesta no termina de llegar.
+ * No usa String: la línea se copia a un búfer fijo.
+ *
+ * * --- TRAYECTO COMPACTO (XC03-Trayecto.h) ---
+ * * trackFilterBegin(&filter, metros, grados, km/h, segundos)
+ * Para QUÉ: Pone los umbrales del filtro (distancia mínima, cambio
+ * de rumbo, cambio de velocidad y latido) y lo deja vacío.
+ *
+ * * trackFilterKeep(&filter, &fix, t)
+ * Para QUÉ: ¿Vale la pena guardar esta posición? Sí cuando cambió
+ * el rumbo o la velocidad, o cada 'maxGapS' segundos aunque no.
+ *
+ * * trackAppend(&block, &point)
+ * Para QUÉ: Agrega el punto al bloque binario. Regresa false si
+ * ya no cabe (hay que subirlo y empezar otro con trackBegin()).
+ *
+ * * --- GEOCERCAS (XC03-Geocerca.h) ---
+ * * geoLoad(&geofences, texto, largo)
+ * Para QUÉ: Carga las cercas desde texto ("C,id,lat,lon,radio" o
+ * "P,id,lat,lon,lat,lon,..."), como llegarían de la nube, y arma
+ * el índice de rejilla.
+ *
+ * * geoUpdate(&geofences, lat, lon, t, eventos, max)
+ * Para QUÉ: Revisa una posición contra todas las cercas y regresa
+ * cuántas entradas/salidas hubo. Sale de una cerca hasta estar
+ * 'hysteresisM' metros afuera (el ruido del GPS no la hace parpadear).
+ *
+ * * geoEventsAppend(&block, &evento)
+ * Para QUÉ: Agrega el evento al bloque binario que se subiría.
  *
  * * --- FUNCIONES DE TEMPORIZACIÓN (ARDUINO C++) ---
  * * millis()
@@ -47,12 +106,26 @@
  * desde que el XC01 se encendió. Es la base de nuestro
  * temporizador no bloqueante.
  *
- * * while ( ( millis() - timer ) < timeout ) { ... }
- * Para QUÉ: Esta es la lógica clave del "timeout".
+ * * if ( ( millis() - timer ) >= intervalo ) { ... }
+ * Para QUÉ: Esta es la lógica clave del temporizador no bloqueante.
  * 'timer' = El momento en que empezamos a contar.
  * 'millis() - timer' = El tiempo que ha transcurrido.
- * El bucle 'while' se repetirá (intentando obtener GPS)
- * hasta que el tiempo transcurrido supere el 'timeout'.
+ * En lugar de quedarnos en un 'while' esperando, revisamos la
+ * condición en cada vuelta de loop() y, si todavía no es hora,
+ * regresamos de inmediato para que el resto del programa corra.
+ *
+ * * --- MOTOR DE ADQUISICIÓN GNSS (SECCIÓN 7) ---
+ * * gnssBegin(onFix, onTimeout, onProgress)
+ * Para QUÉ: Registra las funciones que se llamarán cuando haya
+ * "fix", cuando se agote el tiempo o para reportar el avance.
+ *
+ * * gnssStartAcquisition()
+ * Para QUÉ: Inicia una búsqueda (90s la primera vez, 30s después).
+ *
+ * * updateGNSS()
+ * Para QUÉ: Avanza la máquina de estados UN paso. Se llama en cada
+ * vuelta de loop(); sólo habla con el módem cada
+ * 'gnssPollIntervalMs' milisegundos.
  *
  * * --- FUNCIONES DE ARRANQUE (ARDUINO C++) ---
  * * Serial.begin(baudios)
@@ -70,8 +143,8 @@
  *
  * * digitalWrite(pin, ESTADO)
  * Para QUÉ: Escribe un valor digital (HIGH o LOW) en un
- * pin de salida. Lo usamos para la secuencia de reinicio
- * del módem (el pulso de 3 segundos).
+ * pin de salida. Lo usamos para la secuencia
+ * de encendido del módem (el pulso de 1.1 segundos).
  *
  * * delay(milisegundos)
  * Para QUÉ: Pausa la ejecución del programa.
@@ -89,6 +162,10 @@
 
 #include <Arduino.h>
 #include <TinyGsmClient.h>
+#include "XC03-Arranque.h"
+#include "XC03-GNSS.h"
+#include "XC03-Trayecto.h"
+#include "XC03-Geocerca.h"
 
 
 //##################################################################
@@ -132,7 +209,68 @@ const char pass[] = "";
 // ### SECCIÓN 4: OBJETOS GLOBALES Y DECLARACIONES ###
 //##################################################################
 static TinyGsm modem(SerialAT); // Objeto módem
-bool updateGNSS();              // Prototipo de la función
+
+// --- Motor de adquisición GNSS (ver SECCIÓN 7) ---
+enum GnssState {
+    GNSS_IDLE,      // Sin búsqueda en curso
+    GNSS_SEARCHING, // Consultando al módem con la cadencia configurada
+    GNSS_FIXED,     // La última búsqueda terminó con "fix"
+    GNSS_TIMEOUT    // La última búsqueda agotó su tiempo
+};
+
+// Datos de una posición válida (enteros de punto fijo, ver XC03-GNSS.h)
+typedef XC03Fix GnssFix;
+
+typedef void (*GnssFixCallback)(const GnssFix &fix);
+typedef void (*GnssTimeoutCallback)(unsigned long elapsed_ms);
+typedef void (*GnssProgressCallback)(unsigned long elapsed_ms, unsigned long timeout_ms, uint16_t polls);
+
+// Cada cuánto se le pregunta al módem por la posición (AT+CGNSINF)
+unsigned long gnssPollIntervalMs = 1000UL;
+// Cada cuánto se reporta el avance de la búsqueda
+unsigned long gnssProgressIntervalMs = 10000UL;
+
+void gnssBegin(GnssFixCallback onFix, GnssTimeoutCallback onTimeout, GnssProgressCallback onProgress);
+bool gnssStartAcquisition();
+GnssState gnssGetState();
+bool updateGNSS();              // Avanza la máquina de estados un paso
+
+// --- Arranque del módem (XC03-Arranque.h, ver SECCIÓN 5) ---
+XC03Boot boot;
+
+XC03StepResult bootStepGnss(XC03Boot *b, unsigned long inStep);
+
+const XC03BootStep bootSteps[] = {
+    { NULL, xc03BootStepInit },     // modem.init()
+    { NULL, bootStepGnss },         // GPRS apagado y GNSS habilitado
+};
+
+// --- Trayecto compacto (XC03-Trayecto.h) ---
+TrackFilter trackFilter;        // Umbrales en setup() (trackFilterBegin())
+TrackBlock track;
+uint16_t trackSeen = 0;         // Posiciones que pasaron por el filtro
+
+void recordTrack(const GnssFix &fix);
+
+// --- Geocercas (XC03-Geocerca.h) ---
+// El texto que mandaría la nube (un pin de Blynk, un archivo por
+// HTTP...). Aquí viene fijo porque este script no usa la red.
+const char GEOFENCES[] =
+    "C,1,20.676300,-103.342000,200\n"              // Base (círculo de 200 m)
+    "P,2,20.683500,-103.338000,20.683500,-103.334000,20.687000,-103.334000,"
+    "20.687000,-103.330000,20.690000,-103.330000,20.690000,-103.338000\n"  // Zona en L
+    "C,3,20.702963,-103.318790,100\n"              // Cliente
+    "C,10,20.659700,-103.349400,300\n"             // Centro
+    "P,11,20.640000,-103.400000,20.640000,-103.390000,20.650000,-103.395000\n";
+GeoSet geofences;
+GeoEventBlock geoLog;           // Eventos que se subirían
+
+void checkGeofences(const GnssFix &fix);
+
+// Callbacks de este script (SECCIÓN 6)
+void onGnssFix(const GnssFix &fix);
+void onGnssTimeout(unsigned long elapsed_ms);
+void onGnssProgress(unsigned long elapsed_ms, unsigned long timeout_ms, uint16_t polls);
 
 
 //##################################################################
@@ -148,144 +286,361 @@ void setup() {
     pinMode(BOARD_LED, OUTPUT);
     digitalWrite(BOARD_LED, LOW);
     pinMode(PIN_MODEM_PK, OUTPUT);
-
-    // --- 3. Reinicio por Hardware del Módem XC03 ---
-    SerialMon.println("Reiniciando módem XC03 (pulso de 3s)...");
-    digitalWrite(PIN_MODEM_PK, HIGH);
-    delay(3000);
     digitalWrite(PIN_MODEM_PK, LOW);
-    
-    // Espera a que el módem esté listo
-    delay(3000); 
-
-    // --- 4. Configuración Inicial del Módem ---
-    SerialMon.println("Iniciando modem LTE (restart)...");
-    modem.restart();
-    String modemInfo = modem.getModemInfo();
-    SerialMon.print("Modem: ");
-    SerialMon.println(modemInfo);
-
-    // --- 5. HABILITACIÓN DEL MODO GNSS (GPS) ---
+
+    // --- Trayecto ---
+    // Se guarda un punto si a más de 10 m del último el rumbo cambió 15°
+    // o la velocidad 5 km/h; y al menos uno cada 60 s
+    trackFilterBegin(&trackFilter, 10, 15, 5, 60);
+    trackBegin(&track);
+
+    // --- Geocercas ---
+    geoBegin(&geofences, GEO_HYSTERESIS_M);
+    geoLoad(&geofences, GEOFENCES, sizeof(GEOFENCES) - 1);
+    geoEventsBegin(&geoLog);
+    SerialMon.print("Geocercas: ");
+    SerialMon.print(geofences.count);
+    SerialMon.print(" cargadas, ");
+    SerialMon.print(geofences.loadErrors);
+    SerialMon.println(geofences.indexed ? " con error, con índice" : " con error, sin índice");
+
+    // --- 3. Módem XC03 ---
+    // Ya no se espera aquí: loop() enciende el módem, habilita el GNSS
+    // y arranca la búsqueda con xc03BootUpdate().
+    xc03BootBegin(&boot, &modem, SerialMon, PIN_MODEM_PK, bootSteps,
+                  sizeof(bootSteps) / sizeof(bootSteps[0]), NULL);
+}
+
+/**
+ * @brief Último paso del arranque: apaga el GPRS, habilita el GNSS y
+ * arranca la primera búsqueda.
+ */
+XC03StepResult bootStepGnss(XC03Boot *b, unsigned long inStep) {
+    (void)inStep;
+
+    // --- HABILITACIÓN DEL MODO GNSS (GPS) ---
     // (REGLA DE ORO: Aseguramos que GPRS esté apagado)
     SerialMon.println("Desconectando GPRS (por si acaso)...");
     modem.gprsDisconnect();
-    
+
     SerialMon.println("Habilitando GNSS...");
     if (!modem.enableGPS()) {
-        SerialMon.println("¡Error fatal! No se pudo iniciar el GNSS.");
-        // Bucle infinito: el programa no puede continuar.
-        while (1) {
-            delay(1000);
-        }
+        // Ya no es un error fatal: se reintenta desde la prueba con "AT"
+        return xc03BootFail(b, "¡Error! No se pudo iniciar el GNSS.");
     }
-    SerialMon.println("GNSS Habilitado. Buscando satélites...");
+    SerialMon.print("GNSS Habilitado a los ");
+    SerialMon.print(millis() / 1000.0f);
+    SerialMon.println(" s. Buscando satélites...");
+
+    // Arranque del Motor GNSS (no bloqueante)
+    gnssBegin(onGnssFix, onGnssTimeout, onGnssProgress);
+    gnssStartAcquisition();
+    return XC03_STEP_DONE;
 }
 
 
 //##################################################################
 // ### SECCIÓN 6: BUCLE PRINCIPAL (LOOP) ###
 //##################################################################
+
+// Tiempo entre una búsqueda y la siguiente
+const unsigned long GNSS_RETRY_MS = 1000UL;
+// Parpadeo del LED: lento mientras busca, destello corto con "fix"
+const unsigned long LED_SEARCH_MS = 500UL;
+const unsigned long LED_FIX_MS = 100UL;
+
+unsigned long nextAcquisitionAt = 0; // Cuándo iniciar la siguiente búsqueda
+unsigned long ledTimer = 0;
+unsigned long ledFixUntil = 0;       // Mientras millis() < esto, LED encendido
+bool ledState = false;
+
 void loop() {
-    // Intenta obtener la posición
-    if (updateGNSS()) {
-        // Si lo logra, parpadea el LED
-        SerialMon.println("¡Posición obtenida!");
-        digitalWrite(BOARD_LED, HIGH);
-        delay(100);
-        digitalWrite(BOARD_LED, LOW);
+    // --- Tarea 1: GNSS (un paso, regresa de inmediato) ---
+    // Mientras el módem arranca, xc03BootUpdate() regresa false
+    if (xc03BootUpdate(&boot)) {
+        updateGNSS();
+
+        GnssState state = gnssGetState();
+        if ((state == GNSS_FIXED || state == GNSS_TIMEOUT) &&
+            (long)(millis() - nextAcquisitionAt) >= 0) {
+            gnssStartAcquisition();
+        }
+    }
+
+    // --- Tarea 2: LED (sigue parpadeando durante el 'Cold Boot') ---
+    unsigned long now = millis();
+    if ((long)(ledFixUntil - now) > 0) {
+        ledState = true;
+    } else if (gnssGetState() == GNSS_SEARCHING) {
+        if (now - ledTimer >= LED_SEARCH_MS) {
+            ledTimer = now;
+            ledState = !ledState;
+        }
     } else {
-        SerialMon.println("Aún buscando 'fix'...");
+        ledState = false;
+    }
+    digitalWrite(BOARD_LED, ledState ? HIGH : LOW);
+
+    // --- Tarea 3: aquí van las demás tareas (sensores, etc.) ---
+}
+
+/**
+ * @brief Se llama una vez por cada "fix" obtenido.
+ */
+void onGnssFix(const GnssFix &fix) {
+    SerialMon.println("--- ¡GPS FIX OBTENIDO! ---");
+    Serial.print("Latitud: ");
+    Serial.println(fix.latitude / 1e6, 6); // Imprime con 6 decimales
+
+    Serial.print("Longitud: ");
+    Serial.println(fix.longitude / 1e6, 6); // Imprime con 6 decimales
+
+    Serial.print("Velocidad ( km/h ): ");
+    Serial.println(fix.speed / 10.0, 1);
+
+    Serial.print("Altitud (mts): ");
+    Serial.println(fix.altitude / 10.0, 1);
+
+    Serial.print("Satelites (en vista): ");
+    Serial.println(fix.vsat);
+
+    Serial.print("Satelites (utilizados): ");
+    Serial.println(fix.usat);
+
+    Serial.print("Precision (HDOP): ");
+    Serial.println(fix.hdop / 100.0, 2);
+
+    Serial.print("Fecha/Hora: ");
+    Serial.print(fix.day); Serial.print("/"); Serial.print(fix.month); Serial.print("/"); Serial.print(fix.year);
+    Serial.print(" ");
+    Serial.print(fix.hour); Serial.print(":"); Serial.print(fix.minute); Serial.print(":"); Serial.println(fix.second);
+    SerialMon.println("---------------------------");
+
+    SerialMon.println("¡Posición obtenida!");
+    recordTrack(fix);
+    checkGeofences(fix);
+    ledFixUntil = millis() + LED_FIX_MS;
+    nextAcquisitionAt = millis() + GNSS_RETRY_MS;
+}
+
+/**
+ * @brief El trayecto ya no cabe en el bloque: aquí se subiría
+ * track.data (track.len bytes). Se reporta y se empieza otro.
+ */
+void closeTrack() {
+    SerialMon.print("Trayecto completo: ");
+    SerialMon.print(track.count);
+    SerialMon.print(" puntos de ");
+    SerialMon.print(trackSeen);
+    SerialMon.print(" posiciones en ");
+    SerialMon.print(track.len);
+    SerialMon.print(" bytes (");
+    SerialMon.print((float)track.len / trackSeen, 1);
+    SerialMon.println(" bytes por posición)");
+    trackBegin(&track);
+    trackSeen = 0;
+}
+
+/**
+ * @brief Agrega la posición al trayecto si el filtro la acepta.
+ */
+void recordTrack(const GnssFix &fix) {
+    TrackPoint p;
+    trackPointFromFix(&fix, &p);
+
+    trackSeen++;
+    if (!trackFilterKeep(&trackFilter, &fix, p.t)) {
+        return;             // Sin cambios: la línea entre puntos la cubre
+    }
+    if (!trackAppend(&track, &p)) {
+        closeTrack();
+        trackSeen = 1;
+        trackAppend(&track, &p);
+    }
+    SerialMon.print("Trayecto: ");
+    SerialMon.print(track.count);
+    SerialMon.print(" puntos, ");
+    SerialMon.print(track.len);
+    SerialMon.println(" bytes");
+}
+
+/**
+ * @brief El bloque de eventos ya no cabe: aquí se subiría geoLog.data
+ * (geoLog.len bytes). Se reporta y se empieza otro. Este sketch no
+ * tiene GPRS; plantilla_conexion_gnss.c sube los eventos en sus
+ * ventanas, los guarda hasta que el servidor confirma y recibe las
+ * cercas en la respuesta.
+ */
+void closeGeoLog() {
+    SerialMon.print("Eventos de geocercas: ");
+    SerialMon.print(geoLog.count);
+    SerialMon.print(" en ");
+    SerialMon.print(geoLog.len);
+    SerialMon.print(" bytes (");
+    SerialMon.print(geofences.fixes);
+    SerialMon.println(" posiciones revisadas)");
+    geoEventsBegin(&geoLog);
+}
+
+/**
+ * @brief Revisa la posición contra las geocercas; sólo las entradas
+ * y salidas se guardan para subir.
+ */
+void checkGeofences(const GnssFix &fix) {
+    GeoEvent events[4];
+    uint32_t t = trackEpoch(fix.year, fix.month, fix.day, fix.hour, fix.minute, fix.second);
+    uint8_t n = geoUpdate(&geofences, fix.latitude, fix.longitude, t, events, 4);
+
+    for (uint8_t i = 0; i < n; i++) {
+        SerialMon.print("Geocerca ");
+        SerialMon.print(events[i].fenceId);
+        SerialMon.println(events[i].type == GEO_ENTER ? ": ENTRADA" : ": SALIDA");
+        if (!geoEventsAppend(&geoLog, &events[i])) {
+            closeGeoLog();
+            geoEventsAppend(&geoLog, &events[i]);
+        }
     }
+}
+
+/**
+ * @brief Se llama cuando una búsqueda agota su tiempo sin "fix".
+ */
+void onGnssTimeout(unsigned long elapsed_ms) {
+    SerialMon.print("Sin 'fix' después de ");
+    SerialMon.print(elapsed_ms / 1000);
+    SerialMon.println(" s. Se reintentará.");
+    nextAcquisitionAt = millis() + GNSS_RETRY_MS;
+}
 
-    // Espera 1 segundo antes de volver a intentarlo
-    delay(1000UL);
+/**
+ * @brief Reporte periódico mientras se busca.
+ */
+void onGnssProgress(unsigned long elapsed_ms, unsigned long timeout_ms, uint16_t polls) {
+    SerialMon.print("Aún buscando 'fix'... ");
+    SerialMon.print(elapsed_ms / 1000);
+    SerialMon.print("/");
+    SerialMon.print(timeout_ms / 1000);
+    SerialMon.print(" s (");
+    SerialMon.print(polls);
+    SerialMon.println(" consultas)");
 }
 
 
 //##################################################################
-// ### SECCIÓN 7: FUNCIÓN DE ADQUISICIÓN DE GPS (EL CEREBRO) ###
+// ### SECCIÓN 7: MOTOR DE ADQUISICIÓN DE GPS (EL CEREBRO) ###
 //##################################################################
 
+// Estado interno del motor
+static GnssState gnssState = GNSS_IDLE;
+static bool gnssColdboot = true;     // El primer arranque requiere más tiempo
+static unsigned long gnssTimer = 0;  // Inicio de la búsqueda actual
+static unsigned long gnssTimeout = 0;
+static unsigned long gnssLastPoll = 0;
+static unsigned long gnssLastProgress = 0;
+static uint16_t gnssPolls = 0;
+static XC03GnssQuery gnssQuery;      // AT+CGNSINF en curso (sin String)
+
+static GnssFixCallback gnssOnFix = nullptr;
+static GnssTimeoutCallback gnssOnTimeout = nullptr;
+static GnssProgressCallback gnssOnProgress = nullptr;
+
 /**
- * @brief Intenta obtener un "fix" de GPS dentro de un timeout.
- * @return true si se obtuvo la posición, false si se agotó el tiempo.
+ * @brief Registra los callbacks del motor (cualquiera puede ser nullptr).
  */
-bool updateGNSS() {
-    // Bandera para el primer arranque (requiere más tiempo)
-    static bool coldboot = true;
-    
+void gnssBegin(GnssFixCallback onFix, GnssTimeoutCallback onTimeout, GnssProgressCallback onProgress) {
+    gnssOnFix = onFix;
+    gnssOnTimeout = onTimeout;
+    gnssOnProgress = onProgress;
+    gnssState = GNSS_IDLE;
+}
+
+/**
+ * @brief Inicia una búsqueda de "fix". No espera: sólo arma el estado.
+ * @return false si ya había una búsqueda en curso.
+ */
+bool gnssStartAcquisition() {
     // Tiempos de espera (en milisegundos)
     const unsigned long timeout_coldboot = 90000; // 90 segundos
     const unsigned long timeout_run = 30000;      // 30 segundos
 
-    // Variables locales para almacenar los datos del GPS
-    float latitude, longitude, speed, alt, accuracy;
-    int vsat, usat, year, month, day, hour, minute, second;
-
-    unsigned long timer = 0;
-    unsigned long timeout = 0;
-    bool success = false;
+    if (gnssState == GNSS_SEARCHING) {
+        return false;
+    }
 
     // Asigna el timeout correcto (largo si es coldboot, corto si no)
-    if (coldboot) {
-        timeout = timeout_coldboot;
+    if (gnssColdboot) {
+        gnssTimeout = timeout_coldboot;
         SerialMon.println("Iniciando 'Cold Boot' (timeout: 90s)...");
     } else {
-        timeout = timeout_run;
+        gnssTimeout = timeout_run;
     }
 
-    // Comienza el temporizador
-    timer = millis();
-
-    // --- BUCLE DE ESPERA ACTIVA ---
-    // Se queda aquí hasta que se acabe el tiempo O encuentre la posición
-    while ((millis() - timer) < timeout) {
-
-        // Pide los datos al módem. 'success' será true si el fix es válido.
-        success = modem.getGPS(&latitude, &longitude, &speed, &alt, &vsat, &usat, &accuracy,
-                               &year, &month, &day, &hour, &minute, &second);
+    // Comienza el temporizador; la primera consulta sale en el siguiente paso
+    gnssTimer = millis();
+    gnssLastPoll = gnssTimer - gnssPollIntervalMs;
+    gnssLastProgress = gnssTimer;
+    gnssPolls = 0;
+    gnssState = GNSS_SEARCHING;
+    return true;
+}
 
-        // Si se obtiene la posición, finaliza el bucle inmediatamente
-        if (success) {
-            break;
-        }
-    }
+GnssState gnssGetState() {
+    return gnssState;
+}
 
-    // Si el bucle terminó sin éxito (timeout), retorna 'false'
-    if (!success) {
+/**
+ * @brief Avanza la búsqueda un paso. Nunca espera: a lo más manda UNA
+ * consulta al módem, y sólo si ya pasó 'gnssPollIntervalMs'. La
+ * respuesta se lee en los pasos siguientes, conforme llega.
+ * @return true si en este paso se obtuvo un "fix".
+ */
+bool updateGNSS() {
+    if (gnssState != GNSS_SEARCHING) {
         return false;
     }
 
-    // --- Impresión de Datos (Si hubo éxito) ---
-    SerialMon.println("--- ¡GPS FIX OBTENIDO! ---");
-    Serial.print("Latitud: ");
-    Serial.println((double)latitude, 6); // Imprime con 6 decimales
-
-    Serial.print("Longitud: ");
-    Serial.println((double)longitude, 6); // Imprime con 6 decimales
+    unsigned long now = millis();
+    unsigned long elapsed = now - gnssTimer;
 
-    Serial.print("Velocidad ( km/h ): ");
-    Serial.println(speed);
-
-    Serial.print("Altitud (mts): ");
-    Serial.println(alt);
+    // --- ¿Se acabó el tiempo? ---
+    if (elapsed >= gnssTimeout) {
+        gnssState = GNSS_TIMEOUT;
+        if (gnssOnTimeout) {
+            gnssOnTimeout(elapsed);
+        }
+        return false;
+    }
 
-    Serial.print("Satelites (en vista): ");
-    Serial.println(vsat);
+    // --- Reporte de avance ---
+    if (gnssOnProgress && now - gnssLastProgress >= gnssProgressIntervalMs) {
+        gnssLastProgress = now;
+        gnssOnProgress(elapsed, gnssTimeout, gnssPolls);
+    }
 
-    Serial.print("Satelites (utilizados): ");
-    Serial.println(usat);
+    // --- ¿Hay una consulta en curso? Se lee lo que ya llegó ---
+    if (gnssQuery.waiting) {
+        GnssFix fix;
+        if (xc03GnssPoll(&gnssQuery, SerialAT, now, &fix) != XC03_GNSS_FIX) {
+            return false;
+        }
 
-    Serial.print("Precision (mts): ");
-    Serial.println(accuracy);
+        // Marca que el coldboot ya pasó
+        gnssColdboot = false;
+        gnssState = GNSS_FIXED;
+        if (gnssOnFix) {
+            gnssOnFix(fix);
+        }
+        return true;
+    }
 
-    Serial.print("Fecha/Hora: ");
-    Serial.print(day); Serial.print("/"); Serial.print(month); Serial.print("/"); Serial.print(year);
-    Serial.print(" ");
-    Serial.print(hour); Serial.print(":"); Serial.print(minute); Serial.print(":"); Serial.println(second);
-    SerialMon.println("---------------------------");
+    // --- ¿Ya toca preguntarle al módem? ---
+    if (now - gnssLastPoll < gnssPollIntervalMs) {
+        return false;
+    }
+    gnssLastPoll = now;
+    gnssPolls++;
 
-    // Marca que el coldboot ya pasó
-    coldboot = false;
-    return true;
-}
\ No newline at end of file
+    // Manda AT+CGNSINF; la respuesta se lee en los siguientes pasos
+    xc03GnssAsk(&gnssQuery, SerialAT, now);
+    return false;
+}
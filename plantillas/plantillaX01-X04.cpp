@@ -1,6 +1,9 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <SPI.h>
+#include "XN-Registros.h"
+#include "XN02-SalidasDigitales.h"
+#include "XN04-Sensores.h"
 
 
 #define MIKROBUS_AN 4
@@ -18,107 +21,212 @@
 
 #define BOARD_LED 16
 
+// Modulos XN conectados al bus I2C
+static const uint8_t xnAddresses[] = { 1, 2, 4, 11 };
+
 // Modulo XN01
+// Aviso de cambio del XN01 por su linea INT
+// El XN01 baja INT (colector abierto) cuando cambia alguna entrada y la
+// suelta cuando se lee el registro 0x01. Asi el bus solo se usa cuando
+// hubo un cambio.
+// OJO: MIKROBUS_INT es el Power Key del XC03 en las plantillas con modem.
+#define XN01_INT_PIN MIKROBUS_INT
+#define XN01_QUEUE_SIZE 8           // Potencia de 2
+#define XN01_SETTLE_MS 5UL          // Antirrebote: espera antes de leer
+
+// Se llama con las 8 entradas y los bits que cambiaron
+typedef void (*XN01ChangeCallback)( uint8_t inputs, uint8_t changed );
+
+// Cola sin candados: la ISR solo escribe xn01Head y loop() solo xn01Tail
+static uint32_t xn01Queue[XN01_QUEUE_SIZE];    // millis() de cada flanco
+static volatile uint8_t xn01Head = 0;
+static volatile uint8_t xn01Tail = 0;
+
+static uint8_t xn01Inputs = 0;                  // Ultimo valor leido
+static XN01ChangeCallback xn01OnChange = NULL;
+
+// Registro 0x01 del XN01: las 8 entradas (ver XN-Registros.h)
+typedef XNRegister<1, 0x01, uint8_t> XN01Inputs;
+
+// Copia del registro de entradas
+#define XN01_MAX_AGE_MS 20UL
+static XNSnapshot xn01Snap = { XN01Inputs::address, XN01Inputs::reg, XN01Inputs::width };
+static bool xn01IntArmed = false;
+
+// Las 8 entradas como mascara (bit 0 = entrada 1).
+// Con la INT armada la copia solo se vence cuando hay un flanco pendiente;
+// sin INT se vence despues de XN01_MAX_AGE_MS.
+bool readXN01All( uint8_t *inputs ) {
+    unsigned long maxAge = XN01_MAX_AGE_MS;
+
+    if ( xn01IntArmed && xn01Head == xn01Tail )
+        maxAge = 0xFFFFFFFFUL;
+
+    if ( !getXNSnapshot( &xn01Snap, maxAge ) )
+        return false;
+
+    *inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    return true;
+}
+
+//                             Input es el led a encender
 uint8_t readXN01Input( uint8_t input ) {
     uint8_t inputs = 0;
 
-    // Inicia la comunicación con el XN(01)
-    Wire.beginTransmission(1);
-    // Selecciona el registro de las entradas
-    Wire.write( 0x01 );
-    // Finaliza la comunicación con el nodo
-    Wire.endTransmission();
-
-    // Lee 1 byte con la información de las entradas
-    Wire.requestFrom( 1, 1);
-        
-    inputs = Wire.read();
-
     if ( input > 8 || input < 1 )
         return 255;
-    
+
+    // Leer las 8 entradas una por una cuesta una sola transaccion
+    if ( !readXN01All( &inputs ) )
+        return 255;
+
     return ( inputs >> (input - 1) ) & 0x01;
 }
 
-// Modulo XN02
-void readXN02Binary (uint8_t stat) {
-    // Empieza la transmisión
-    Wire.beingTransmission(2);
+void IRAM_ATTR onXN01Int( ) {
+    uint8_t head = xn01Head;
+    uint8_t next = ( head + 1 ) & ( XN01_QUEUE_SIZE - 1 );
+
+    // Cola llena: ya hay una lectura pendiente, no se pierde nada
+    if ( next == __atomic_load_n( &xn01Tail, __ATOMIC_ACQUIRE ) )
+        return;
 
-    // Termina transmision
-    Wire.endTransmission();
+    xn01Queue[head] = millis();
+    __atomic_store_n( &xn01Head, next, __ATOMIC_RELEASE );
 }
 
-void writeXN02( bool o1 = LOW, bool o2 = LOW, bool o3 = LOW, bool o4 = LOW, bool o5 = LOW, bool o6 = LOW, bool o7 = LOW, bool o8 = LOW ){
-    uint8_t data = 0;
+void beginXN01Interrupt( XN01ChangeCallback onChange ) {
+    xn01OnChange = onChange;
+    pinMode( XN01_INT_PIN, INPUT_PULLUP );
 
-    data |= o1;
-    data |= o2 << 1;
-    data |= o3 << 2;
-    data |= o4 << 3;
-    data |= o5 << 4;
-    data |= o6 << 5;
-    data |= o7 << 6;
-    data |= o8 << 7;
+    // Lectura inicial: deja INT en alto antes de armar la interrupcion
+    if ( refreshXNSnapshot( &xn01Snap ) )
+        xn01Inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    attachInterrupt( digitalPinToInterrupt( XN01_INT_PIN ), onXN01Int, FALLING );
+    xn01IntArmed = true;
+}
+
+// Va en loop(). Sin flancos pendientes no toca el bus.
+void processXN01Events( ) {
+    uint8_t head = __atomic_load_n( &xn01Head, __ATOMIC_ACQUIRE );
+
+    if ( xn01Tail == head )
+        return;
+
+    // Espera a que las entradas se asienten desde el primer flanco
+    if ( millis() - xn01Queue[xn01Tail] < XN01_SETTLE_MS )
+        return;
+
+    // Todos los flancos pendientes se atienden con UNA lectura
+    __atomic_store_n( &xn01Tail, head, __ATOMIC_RELEASE );
 
-    writeXN02Binary( data );
+    // Lee el registro de entradas (y con eso suelta INT)
+    if ( !refreshXNSnapshot( &xn01Snap ) )
+        return;
+
+    uint8_t inputs = xnDecode<XN01Inputs>( xn01Snap.data );
+    uint8_t changed = inputs ^ xn01Inputs;
+    xn01Inputs = inputs;
+
+    if ( changed && xn01OnChange )
+        xn01OnChange( inputs, changed );
 }
 
+void printXN01Change( uint8_t inputs, uint8_t changed ) {
+    for ( uint8_t i = 0; i < 8; i++ ) {
+        if ( changed & ( 1 << i ) ) {
+            Serial.print( "Entrada " );
+            Serial.print( i + 1 );
+            Serial.print( ": " );
+            Serial.println( ( inputs >> i ) & 0x01 );
+        }
+    }
+}
+
+// Modulo XN02
+// Driver con copia sombra de las 8 salidas: XN02-SalidasDigitales.h
+
 // Modulo XN04
+
+// Copia de los registros 0x01 - 0x03 (6 bytes, auto-incremento desde 0x01)
+// Los getters aceptan una copia de hasta XN04_MAX_AGE_MS: el sensor cambia
+// despacio y asi temperatura, humedad y luz salen de la misma lectura.
+#define XN04_MAX_AGE_MS 1000UL
+static XNSnapshot xn04Snap = { XN04Block::address, XN04Block::first, XN04Block::length };
+
+static void decodeXN04( XN04Data *data ){
+    xn04Decode( xn04Snap.data, data );
+}
+
+// Lee temperatura, humedad y luz en una sola transaccion.
+// El XN04 incrementa el registro automaticamente, asi que pidiendo
+// 6 bytes desde el 0x01 recibimos los registros 0x01, 0x02 y 0x03.
+// Siempre usa el bus (y de paso refresca la copia).
+// Regresa false si el modulo no entrego los 6 bytes.
+bool readXN04All( XN04Data *data ){
+
+    if ( !refreshXNSnapshot( &xn04Snap ) )
+        return false;
+
+    decodeXN04( data );
+    return true;
+}
+
+// Igual que readXN04All, pero acepta una copia de hasta maxAgeMs
+bool readXN04Cached( XN04Data *data, unsigned long maxAgeMs ){
+
+    if ( !getXNSnapshot( &xn04Snap, maxAgeMs ) )
+        return false;
+
+    decodeXN04( data );
+    return true;
+}
+
 float readXN04Temperature( ){
 
-    float temperature;
-    uint16_t temperature_int;
-    // XN04
-    Wire.beginTransmission( 4 );
-    // Registro de temperature
-    Wire.write( 0x01 );
-    Wire.endTransmission();
+    XN04Data data;
 
-    Wire.requestFrom( 4, 2 );
-    
-    temperature_int = ( (Wire.read() << 8) | Wire.read() );
-    temperature = temperature_int/100.0f;
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return NAN;
 
-    return temperature;
+    return xnScale<XN04Temperature>( data.temperature_int );
 }
 
 float readXN04Humidity( ){
 
-    float humidity;
-    uint16_t humidity_int;
-    // XN04
-    Wire.beginTransmission( 4 );
-    // Registro de humidity
-    Wire.write( 0x02 );
-    Wire.endTransmission();
+    XN04Data data;
 
-    Wire.requestFrom( 4, 2 );
-    
-    humidity_int = ( (Wire.read() << 8) | Wire.read() );
-    humidity = humidity_int/100.0f;
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return NAN;
 
-    return humidity;
+    return xnScale<XN04Humidity>( data.humidity_int );
 
 }
 
 uint16_t readXN04Luminosity( ){
 
-    uint16_t lux;
-    // XN04
-    Wire.beginTransmission( 4 );
-    // Registro de lux
-    Wire.write( 0x03 );
-    Wire.endTransmission();
+    XN04Data data;
 
-    Wire.requestFrom( 4, 2 );
-    
-    lux = ( (Wire.read() << 8) | Wire.read() );
+    if ( !readXN04Cached( &data, XN04_MAX_AGE_MS ) )
+        return 0;
 
-    return lux;
+    return data.lux;
 
 }
 
+// Copia en el XN02 las entradas del XN01 que cambiaron.
+// Todos los bits se juntan en una transaccion: una sola escritura I2C.
+void mirrorXN01Change( uint8_t inputs, uint8_t changed ) {
+    printXN01Change( inputs, changed );
+
+    beginXN02Transaction();
+    for ( uint8_t i = 0; i < 8; i++ ) {
+        if ( changed & ( 1 << i ) )
+            writeXN02Output( i + 1, ( inputs >> i ) & 0x01 );
+    }
+    commitXN02Transaction();
+}
+
 void setup(){
 
 // Escanear I2C 
@@ -132,14 +240,13 @@ void setup(){
     pinMode( MIKROBUS_RST, OUTPUT );
     pinMode( MIKROBUS_CS, OUTPUT );
     pinMode( MIKROBUS_PWM, OUTPUT );
-    pinMode( MIKROBUS_INT, OUTPUT );
+    // MIKROBUS_INT es la entrada INT del XN01 (ver beginXN01Interrupt)
     pinMode( BOARD_LED, OUTPUT );
 
     digitalWrite( MIKROBUS_AN, HIGH );
     digitalWrite( MIKROBUS_RST, HIGH );
     digitalWrite( MIKROBUS_CS, HIGH );
     digitalWrite( MIKROBUS_PWM, HIGH );
-    digitalWrite( MIKROBUS_INT, HIGH );
     digitalWrite( BOARD_LED, HIGH );
 
     // UART config
@@ -149,6 +256,8 @@ void setup(){
     // I2C config
     Wire.setPins( MIKROBUS_SDA, MIKROBUS_SCL ); // mikroBUS
     Wire.begin();
+    // Velocidad del bus por modulo (prueba 1 MHz, 400 kHz y 100 kHz)
+    xnBusBegin( xnAddresses, sizeof( xnAddresses ) );
 
     // SPI config
     SPI.begin( MIKROBUS_SCK, MIKROBUS_MISO, MIKROBUS_MOSI ); // mikroBUS
@@ -157,6 +266,12 @@ void setup(){
     //----- Código ----
     //------------------
 
+    // Salidas del XN02: parte del estado real del modulo
+    beginXN02();
+
+    // Entradas del XN01 por interrupcion (solo lee el bus cuando cambian)
+    beginXN01Interrupt( mirrorXN01Change );
+
     // Para el output de X01 (importante ponerlo antes de usar los leds)
     // pinMode(BOARD_LED, OUTPUT);
     // Encender el led
@@ -165,6 +280,8 @@ void setup(){
 }
 
 void loop(){
+    processXN01Events();
+
     // Escaneo de I2C
     // byte error, address;
     // int nDevices = 0;
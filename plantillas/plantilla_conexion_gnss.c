@@ -1,15 +1,45 @@
 /*
  * ===================================================================
  * PROYECTO:      DEMO: ALTERNAR GNSS Y GPRS
- * VERSIÓN:       1.0 (Demo de Secuencia)
+ * VERSIÓN:       2.6 (Geocercas desde la Nube)
  *
  * DESCRIPCIÓN:
- * Este script es una demostración técnica (no una app funcional)
- * que muestra la secuencia de comandos para obedecer la Regla de Oro
- * del XC03: alternar entre el modo GNSS (GPS) y el modo GPRS (SIM).
+ * Este script obedece la Regla de Oro del XC03 alternando entre el
+ * modo GNSS (GPS) y el modo GPRS (SIM) con un "árbitro" que es el
+ * único dueño del radio:
+ *   1. Ventana GNSS: junta N posiciones (una cada FIX_INTERVAL_MS).
+ *   2. Ventana GPRS: se conecta UNA vez y sube todo el lote.
+ *   3. Repite.
+ * Cada cambio de modo cuesta segundos (TTFF del GPS, attach de la
+ * red), así que subir N posiciones por cada conexión reduce los
+ * cambios de modo por posición reportada. El tamaño del lote y los
+ * timeouts de cada ventana se calculan con los tiempos MEDIDOS de
+ * TTFF y de attach (promedio móvil exponencial).
  *
- * NOTA: El loop() fallará en obtener un fix o conexión real
- * debido a la falta de tiempos de espera (delays/timers).
+ * El árbitro es NO bloqueante: loop() lo avanza un paso a la vez.
+ * El encendido del módem también (SECCIÓN 5): un pulso de 1.1 s en el
+ * Power Key y "AT" cada 250 ms hasta que conteste, sin pausas fijas.
+ * Si ya contesta antes del pulso (sólo se reinició el ESP32), no se pulsa.
+ *
+ * Las posiciones se leen sin modem.getGPS(): la respuesta a
+ * AT+CGNSINF se analiza en un búfer fijo (XC03-GNSS.h), sin String, y
+ * el lote guarda enteros de punto fijo (grados × 1 000 000).
+ *
+ * Ningún estado espera al módem: los comandos AT van a la cola del
+ * motor de XC03-AT.h, que loop() avanza con xc03AtUpdate(), y cada
+ * estado revisa su respuesta en las vueltas siguientes. Sólo el envío
+ * TCP del lote sigue en TinyGSM (es corto y usa el '>' de AT+CASEND).
+ *
+ * El lote se sube como bloque binario (XC03-Trayecto.h): cada posición
+ * va como diferencia contra la anterior en varint, ~6 bytes en lugar
+ * de ~50 de una línea CSV. Con UPLOAD_BINARY = false se sube en CSV.
+ *
+ * Geocercas (XC03-Geocerca.h): cada posición se revisa contra las
+ * cercas y sólo las ENTRADAS y SALIDAS se guardan (~3 bytes cada una).
+ * Suben con el lote y se quedan guardadas hasta que el servidor
+ * contesta "OK"; en esa misma respuesta llegan las cercas nuevas
+ * (texto de geoLoad(), leído según llega con GeoLoader), así que se
+ * cambian sin recompilar.
  * ===================================================================
  * HARDWARE UTILIZADO:
  * - Controlador:   Microside XC01 R5-I (ESP32-S3)
@@ -25,30 +55,77 @@
  * * NO SE PUEDE USAR GNSS (GPS) Y GPRS/LTE (RED CELULAR) AL MISMO TIEMPO.
  * * Debes apagar uno antes de encender el otro.
  *
- * * --- FUNCIONES GNSS (GPS) ---
- * * modem.enableGPS()
- * Para QUÉ: Enciende el receptor GNSS. (GPRS debe estar apagado).
+ * * --- MOTOR AT SIN ESPERA (XC03-AT.h) ---
+ * * xc03AtUpdate(millis())
+ * Para QUÉ: Va en loop(). Lee lo que ya llegó del módem, cierra el
+ * comando en curso si terminó y manda el siguiente de la cola.
+ * Tras un timeout primero manda un "AT" solo y espera su "OK", para
+ * que una respuesta tardía no se tome como la del siguiente comando.
+ *
+ * * xc03AtCommand("+CGNSPWR=1", &future)
+ * Para QUÉ: Forma un comando en la cola y regresa de inmediato.
+ * 'future.status' pasa de XC03_AT_PENDING a XC03_AT_OK,
+ * XC03_AT_ERROR o XC03_AT_TIMEOUT cuando el módem contesta.
+ *
+ * * xc03AtQuery("+CEREG?", "+CEREG:", onLine, ctx, &future)
+ * Para QUÉ: Igual, pero cada línea de respuesta que empieza con
+ * "+CEREG:" se pasa a 'onLine'.
  *
- * * modem.getGPS( &lat, &lon, ...)
- * Para QUÉ: Intenta leer la posición del módem. Devuelve 'true'
- * si tiene un "fix" válido.
+ * * xc03AtOnUrc("+APP PDP:", handler)
+ * Para QUÉ: Registra quién atiende un aviso que el módem manda
+ * solo (URC), como "+APP PDP: 0,ACTIVE" al activarse GPRS.
  *
- * * modem.disableGPS()
- * Para QUÉ: Apaga el receptor GNSS. Necesario antes de
- * poder conectarse a la red celular.
+ * * --- COMANDOS GNSS (GPS) ---
+ * * AT+CGNSPWR=1 / AT+CGNSPWR=0
+ * Para QUÉ: Enciende / apaga el receptor GNSS. (GPRS debe estar
+ * apagado para encenderlo).
  *
- * * --- FUNCIONES GPRS/LTE (SIM) ---
- * * modem.gprsConnect( apn, user, pass )
- * Para QUÉ: Enciende la red celular y se conecta al APN.
- * (GNSS debe estar apagado).
+ * * AT+CGNSINF (con xc03GnssOnLine de XC03-GNSS.h)
+ * Para QUÉ: Lee la posición sin String. El XC03GnssResult queda
+ * con 'valid' = true si hubo "fix".
  *
- * * modem.isGprsConnected()
- * Para QUÉ: Devuelve 'true' si el módem está conectado a la
- * red celular.
+ * * --- COMANDOS GPRS/LTE (SIM) ---
+ * * AT+CEREG?
+ * Para QUÉ: ¿Ya está registrado en la red celular? (requisito
+ * para activar GPRS).
  *
- * * modem.gprsDisconnect()
+ * * AT+CNCFG=0,1,"apn","user","pass" y AT+CNACT=0,1
+ * Para QUÉ: Configura el APN y pide la activación de GPRS. La
+ * activación llega después por el URC "+APP PDP: 0,ACTIVE" (y
+ * se confirma con AT+CNACT?).
+ *
+ * * AT+CNACT=0,0
  * Para QUÉ: Apaga la conexión de red celular. Necesario
  * antes de poder encender el GNSS.
+ *
+ * * --- ARRANQUE DEL MÓDEM (SECCIÓN 5) ---
+ * * xc03BootUpdate(&boot)
+ * Para QUÉ: Avanza el encendido del módem UN paso y regresa de
+ * inmediato (XC03-Arranque.h). Regresa true cuando el árbitro ya
+ * puede usar el radio. Aquí el "AT" de prueba y la inicialización
+ * van por la cola de comandos (ganchos de XC03-Arranque.h).
+ *
+ * * --- ÁRBITRO DE MODOS (SECCIÓN 7) ---
+ * * arbiterStep()
+ * Para QUÉ: Avanza el árbitro UN paso. Se llama en cada vuelta de
+ * loop() y regresa de inmediato si no hay nada que hacer.
+ *
+ * * trackBegin(&block) / trackAppend(&block, &point)
+ * Para QUÉ: Arman el bloque binario del lote (XC03-Trayecto.h).
+ * El servidor lo lee con trackReaderBegin() y trackNext().
+ *
+ * * geoUpdate(&geofences, lat, lon, t, eventos, max)
+ * Para QUÉ: Revisa una posición contra las geocercas y regresa las
+ * ENTRADAS y SALIDAS (XC03-Geocerca.h).
+ *
+ * * geoLoaderFeed(&loader, pedazo, largo)
+ * Para QUÉ: Agrega las cercas que mandó el servidor ("X" las borra
+ * todas) según van llegando los bytes de la respuesta a cada lote;
+ * geoLoaderEnd() rehace el índice al final.
+ *
+ * * ewmaUpdate( promedio, muestra )
+ * Para QUÉ: Promedio móvil exponencial (peso 1/4 a la muestra
+ * nueva). Suaviza las mediciones de TTFF y attach.
  * ===================================================================
  */
 
@@ -60,6 +137,11 @@
 
 #include <Arduino.h>
 #include <TinyGsmClient.h>
+#include "XC03-AT.h"
+#include "XC03-Arranque.h"
+#include "XC03-GNSS.h"
+#include "XC03-Trayecto.h"
+#include "XC03-Geocerca.h"
 
 
 //##################################################################
@@ -82,32 +164,62 @@ const char user[] = "";    // Usuario del APN (normalmente vacío)
 const char pass[] = "";    // Password del APN (normalmente vacío)
 const char pin[] = "";     // PIN de 4 dígitos de tu SIM (dejar "" si no tiene)
 
-// Crea el objeto 'modem'
+// Servidor que recibe el lote de posiciones
+const char server[] = "tracker.example.com";
+const uint16_t port = 80;
+// true: bloque binario de XC03-Trayecto.h; false: una línea CSV por posición
+const bool UPLOAD_BINARY = true;
+
+// Crea el objeto 'modem' y el cliente TCP que usa la ventana GPRS
 static TinyGsm modem(SerialAT);
+static TinyGsmClient client(modem);
 
 
 //##################################################################
 // ### SECCIÓN 4: VARIABLES GLOBALES PARA DATOS GNSS ###
 //##################################################################
-// Variables "contenedoras" que modem.getGPS() llenará
-float latitude;
-float longitude;
-float speed;
-float alt;
-int vsat;
-int usat;
-float accuracy;
-int year;
-int month;
-int day;
-int hour;
-int minute;
-int second;
+// Última posición leída y lo que llenó el último AT+CGNSINF
+XC03Fix lastFix;
+XC03GnssResult gnssReply;
+
+// Lo que van contestando el módem y sus URC (SECCIÓN 7)
+bool netRegistered = false;     // Último +CEREG
+bool pdpActive = false;         // +CNACT? o el URC "+APP PDP"
+int16_t signalQuality = 99;     // Último +CSQ (99 = desconocida)
+
+void onPdpUrc(const char *line, uint8_t len);
+
+// --- Lote de posiciones pendientes de subir ---
+#define MAX_FIXES 20
+
+struct StoredFix {
+    int32_t latitude;       // Grados × 1 000 000
+    int32_t longitude;
+    uint16_t speed;         // km/h × 10
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+};
+
+StoredFix fixes[MAX_FIXES];
+uint8_t fixCount = 0;
+
+// Un lote lleno siempre cabe en un bloque binario (SECCIÓN 7)
+static_assert(1 + MAX_FIXES * TRACK_POINT_MAX <= TRACK_BLOCK_SIZE, "MAX_FIXES no cabe en TrackBlock");
+
+// --- Geocercas (XC03-Geocerca.h) ---
+// Empiezan vacías: las manda el servidor en la respuesta a cada lote.
+// Los eventos se quedan en geoLog hasta que el servidor contesta "OK".
+GeoSet geofences;
+GeoEventBlock geoLog;
+uint32_t geoEventsLost = 0;     // No cupieron en geoLog (llegaron sin confirmar los anteriores)
+uint32_t geoEventsUploaded = 0;
 
 
 //##################################################################
 // ### SECCIÓN 5: FUNCIÓN DE ARRANQUE (SETUP) ###
 //##################################################################
+void bootBegin(); // Prototipo (abajo)
+
 void setup() {
     // --- 1. Inicializar Comunicaciones ---
     // (AÑADIDO FALTANTE) Inicia el monitor serial (USB)
@@ -119,80 +231,675 @@ void setup() {
 
     // --- 2. Inicializar Pines de E/S (I/O) ---
     pinMode(PIN_MODEM_PK, OUTPUT);
-
-    // --- 3. Reinicio por Hardware del Módem XC03 ---
-    SerialMon.println("Reiniciando módem XC03 (pulso de 3s)...");
-    digitalWrite(PIN_MODEM_PK, HIGH);
-    delay(3000); // 3000ms = 3 segundos
     digitalWrite(PIN_MODEM_PK, LOW);
-    
-    // Espera a que el módem esté listo
-    delay(3000);
 
-    // --- 4. Configuración Inicial del Módem ---
-    SerialMon.println("Iniciando modem (restart)...");
-    modem.restart();
+    // --- 3. Módem XC03 ---
+    // Ya no se espera aquí: loop() enciende el módem con
+    // xc03BootUpdate() y después le pasa el radio al árbitro.
+    // Todos los comandos AT pasan por la cola del motor.
+    xc03AtBegin(SerialAT);
+    xc03AtOnUrc("+APP PDP:", onPdpUrc);
+    bootBegin();
+
+    // --- 4. Geocercas: llegan con la primera respuesta del servidor ---
+    geoBegin(&geofences, GEO_HYSTERESIS_M);
+    geoEventsBegin(&geoLog);
+}
+
+// --- Arranque del módem (XC03-Arranque.h) ---
+// Tiempos del pulso y de los "AT": XC03_BOOT_* en el header
+XC03Boot boot;
+XC03AtFuture bootReply;         // El "AT" de prueba en curso
+XC03AtFuture bootEcho;          // ATE0: si falla, el módem no está bien
 
-    // Si la SIM tiene PIN, intenta desbloquearla
-    if (strlen(pin) > 0) {
+void onSimUnlock(XC03AtStatus status, void *ctx) {
+    if (status != XC03_AT_OK) {
+        SerialMon.println("¡FALLO AL DESBLOQUEAR SIM! Verifica el PIN.");
+    }
+}
+
+// +CPIN: READY / +CPIN: SIM PIN
+void onSimStatus(const char *line, uint8_t len, void *ctx) {
+    if (strstr(line, "SIM PIN") && strlen(pin) > 0) {
+        // Si la SIM tiene PIN, intenta desbloquearla (se forma al final)
+        char cmd[XC03_AT_TEXT_MAX];
+        snprintf(cmd, sizeof(cmd), "+CPIN=\"%s\"", pin);
         SerialMon.println("Desbloqueando SIM...");
-        // (BUG CORREGIDO: Usamos la variable 'pin', no 'GSM_PIN')
-        if (!modem.simUnlock(pin)) {
-            SerialMon.println("¡FALLO AL DESBLOQUEAR SIM! Verifica el PIN.");
-        }
+        xc03AtSend(cmd, NULL, NULL, onSimUnlock, NULL, NULL);
     }
-    SerialMon.println("Setup completado. Iniciando loop de demostración...");
+}
+
+// Respuesta de ATI: modelo y versión del firmware
+void onModemInfo(const char *line, uint8_t len, void *ctx) {
+    SerialMon.print("Módem: ");
+    SerialMon.println(line);
+}
+
+// El "AT" de prueba va por la cola con su propio timeout
+void bootProbeSend(XC03Boot *b) {
+    xc03AtCommand("", &bootReply, XC03_BOOT_AT_REPLY_MS);
+}
+
+XC03ProbeResult bootProbePoll(XC03Boot *b, unsigned long waited) {
+    if (bootReply.status == XC03_AT_PENDING) {
+        return XC03_PROBE_WAIT;
+    }
+    return bootReply.status == XC03_AT_OK ? XC03_PROBE_OK : XC03_PROBE_NONE;
+}
+
+// Lo mismo que modem.init(), pero en la cola: los comandos salen uno
+// tras otro sin que loop() espere ninguno
+XC03StepResult bootStepInit(XC03Boot *b, unsigned long inStep) {
+    xc03AtCommand("E0", &bootEcho);
+    xc03AtCommand("+CMEE=0", NULL);
+    xc03AtQuery("+CPIN?", "+CPIN:", onSimStatus, NULL, NULL);
+    xc03AtQuery("I", "", onModemInfo, NULL, NULL);
+    // Por si el módem quedó con GPRS activo (Regla de Oro); mismo
+    // timeout que gprsDisconnect()
+    xc03AtCommand("+CNACT=0,0", NULL, 60000UL);
+    return XC03_STEP_DONE;
+}
+
+// Espera a que la cola se vacíe; incluye el +CPIN="..." que forme onSimStatus()
+XC03StepResult bootStepInitWait(XC03Boot *b, unsigned long inStep) {
+    if (!xc03AtIdle()) {
+        return XC03_STEP_WAIT;
+    }
+    if (bootEcho.status != XC03_AT_OK) {
+        return xc03BootFail(b, "Error al iniciar el módem");
+    }
+    SerialMon.print("Módem listo a los ");
+    SerialMon.print(millis() / 1000.0f);
+    SerialMon.println(" s. Iniciando el árbitro GNSS/GPRS...");
+    return XC03_STEP_DONE;
+}
+
+const XC03BootStep bootSteps[] = {
+    { NULL, bootStepInit },
+    { NULL, bootStepInitWait },
+};
+const XC03BootHooks bootHooks = { bootProbeSend, bootProbePoll, NULL };
+
+/**
+ * @brief Prepara el encendido del módem; loop() lo avanza con
+ * xc03BootUpdate(&boot). No hay pausas fijas: se pregunta "AT" hasta
+ * que el módem conteste.
+ */
+void bootBegin() {
+    xc03BootBegin(&boot, &modem, SerialMon, PIN_MODEM_PK, bootSteps,
+                  sizeof(bootSteps) / sizeof(bootSteps[0]), &bootHooks);
 }
 
 
 //##################################################################
-// ### SECCIÓN 6: BUCLE PRINCIPAL (LOOP DE DEMOSTRACIÓN) ###
+// ### SECCIÓN 6: BUCLE PRINCIPAL (LOOP) ###
 //##################################################################
+void arbiterStep(); // Prototipo (SECCIÓN 7)
+
 void loop() {
-    SerialMon.println("--- Inicio del Ciclo de Demo ---");
-
-    // --- 1. DEMO MODO GNSS (GPS) ---
-    SerialMon.println("Habilitando GNSS...");
-    modem.enableGPS();
-
-    // Intenta leer el GPS. (Fallará porque no tiene tiempo de 'fix')
-    if (modem.getGPS(&latitude, &longitude, &speed, &alt, &vsat,
-                     &usat, &accuracy, &year, &month, &day, &hour, &minute, &second))
-    {
-        // (Es casi imposible que el código llegue aquí)
-        SerialMon.println("¡Posición GPS obtenida!"); 
-        SerialMon.print("Latitud: ");
-        SerialMon.println((double)latitude, 5);
-        SerialMon.print("Longitud: ");
-        SerialMon.println((double)longitude, 5);
-    } else {
-        SerialMon.println("GNSS habilitado, pero sin 'fix' (falta tiempo).");
+    // El motor AT lee lo que llegó del módem y manda el siguiente comando
+    xc03AtUpdate(millis());
+
+    // El árbitro decide qué modo usa el radio; nunca se queda esperando.
+    // Mientras el módem arranca, xc03BootUpdate() regresa false.
+    if (xc03BootUpdate(&boot)) {
+        arbiterStep();
     }
 
-    // Apaga el GNSS (para cumplir la Regla de Oro)
-    SerialMon.println("Deshabilitando GNSS...");
-    modem.disableGPS();
+    // Aquí pueden ir otras tareas (sensores, LED, etc.)
+}
 
-    // --- 2. DEMO MODO GPRS (SIM) ---
-    SerialMon.println("Habilitando GPRS (SIM)...");
-    
-    // Intenta conectar a GPRS. (Fallará porque no tiene tiempo de conectar)
-    modem.gprsConnect(apn, user, pass);
-    
-    // (Pausa corta solo para dar tiempo a que el comando anterior se envíe)
-    delay(100); 
 
-    if (modem.isGprsConnected()) {
-        // (Es casi imposible que el código llegue aquí)
-        SerialMon.println("¡GPRS Conectado!");
+//##################################################################
+// ### SECCIÓN 7: ÁRBITRO DE MODOS GNSS / GPRS ###
+//##################################################################
+
+// --- Parámetros (en milisegundos) ---
+const unsigned long FIX_INTERVAL_MS = 5000UL;    // Separación entre posiciones guardadas
+const unsigned long GNSS_POLL_MS = 1000UL;       // Cadencia de AT+CGNSINF
+const unsigned long NET_POLL_MS = 1000UL;        // Cadencia de AT+CEREG?
+const unsigned long ATTACH_POLL_MS = 500UL;      // Cadencia de AT+CNACT?
+const unsigned long REGISTER_TIMEOUT_MS = 60000UL;
+const unsigned long RETRY_MS = 5000UL;           // Pausa después de un error
+const unsigned long GNSS_WINDOW_MIN_MS = 20000UL;
+const unsigned long GNSS_WINDOW_MAX_MS = 180000UL;
+const unsigned long ATTACH_WINDOW_MIN_MS = 10000UL;
+const unsigned long ATTACH_WINDOW_MAX_MS = 60000UL;
+const uint8_t BATCH_MIN = 3;
+const unsigned long REPLY_TIMEOUT_MS = 10000UL;
+
+// Se busca que los cambios de modo (TTFF + attach) sean a lo más
+// 1/OVERHEAD_FACTOR del tiempo que se pasa juntando posiciones
+const unsigned long OVERHEAD_FACTOR = 3;
+
+enum ArbiterState {
+    ARB_GNSS_ON,       // Encender el GNSS
+    ARB_GNSS_SEARCH,   // Juntar posiciones
+    ARB_GNSS_OFF,      // Apagar el GNSS
+    ARB_GPRS_REGISTER, // Esperar el registro en la red
+    ARB_GPRS_ATTACH,   // Esperar la activación de GPRS
+    ARB_GPRS_UPLOAD,   // Subir el lote
+    ARB_GPRS_REPLY,    // Leer el "OK" y las cercas del servidor
+    ARB_GPRS_OFF,      // Apagar GPRS
+    ARB_WAIT           // Pausa antes de reintentar
+};
+
+ArbiterState arbState = ARB_GNSS_ON;
+ArbiterState arbAfterWait = ARB_GNSS_ON;
+unsigned long arbStateAt = 0;   // Cuándo se entró al estado actual
+unsigned long arbLastPoll = 0;
+unsigned long lastStoredAt = 0;
+unsigned long gnssWindowMs = 0;
+unsigned long attachWindowMs = 0;
+uint8_t batchTarget = BATCH_MIN;
+uint8_t windowFixes = 0;        // Posiciones guardadas en esta ventana
+XC03AtFuture arbReply;          // Comando del estado actual (IDLE: no se ha mandado)
+
+// Tiempos medidos (promedio móvil). Arrancan con valores conservadores.
+unsigned long ttffAvgMs = 45000UL;
+unsigned long attachAvgMs = 5000UL;
+
+// Estadísticas
+unsigned long modeSwitches = 0;
+unsigned long fixesUploaded = 0;
+
+unsigned long ewmaUpdate(unsigned long avg, unsigned long sample) {
+    // avg + (sample - avg) / 4, sin perder el signo
+    if (sample >= avg) {
+        return avg + (sample - avg) / 4;
+    }
+    return avg - (avg - sample) / 4;
+}
+
+unsigned long clampMs(unsigned long v, unsigned long lo, unsigned long hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void arbiterEnter(ArbiterState next) {
+    arbState = next;
+    arbStateAt = millis();
+    arbLastPoll = arbStateAt - 3600000UL; // La primera consulta sale de inmediato
+    arbReply.status = XC03_AT_IDLE;
+}
+
+void arbiterRetry(ArbiterState next) {
+    arbAfterWait = next;
+    arbiterEnter(ARB_WAIT);
+}
+
+/**
+ * @brief Calcula el tamaño del lote y los timeouts de las ventanas
+ * con los tiempos medidos de TTFF y attach.
+ */
+void arbiterPlanWindows() {
+    unsigned long overhead = ttffAvgMs + attachAvgMs;
+    unsigned long n = (OVERHEAD_FACTOR * overhead + FIX_INTERVAL_MS - 1) / FIX_INTERVAL_MS;
+    if (n < BATCH_MIN) {
+        n = BATCH_MIN;
+    }
+    if (n > MAX_FIXES) {
+        n = MAX_FIXES;
+    }
+    batchTarget = (uint8_t)n;
+
+    // El GNSS tiene el doble del TTFF promedio para el primer fix,
+    // más el tiempo para juntar el lote
+    gnssWindowMs = clampMs(2 * ttffAvgMs + batchTarget * FIX_INTERVAL_MS,
+                           GNSS_WINDOW_MIN_MS, GNSS_WINDOW_MAX_MS);
+    attachWindowMs = clampMs(3 * attachAvgMs, ATTACH_WINDOW_MIN_MS, ATTACH_WINDOW_MAX_MS);
+}
+
+/**
+ * @brief Guarda la última posición leída. Si el lote está lleno se
+ * descarta la más vieja.
+ */
+void storeFix() {
+    if (fixCount == MAX_FIXES) {
+        memmove(&fixes[0], &fixes[1], sizeof(StoredFix) * (MAX_FIXES - 1));
+        fixCount--;
+    }
+    StoredFix &f = fixes[fixCount++];
+    f.latitude = lastFix.latitude;
+    f.longitude = lastFix.longitude;
+    f.speed = lastFix.speed;
+    f.year = lastFix.year;
+    f.month = lastFix.month;
+    f.day = lastFix.day;
+    f.hour = lastFix.hour;
+    f.minute = lastFix.minute;
+    f.second = lastFix.second;
+}
+
+/**
+ * @brief Revisa la última posición contra las geocercas (todas las
+ * consultas, no sólo las que se guardan). Si geoLog está lleno, el
+ * evento se cuenta como perdido: los anteriores siguen sin confirmar.
+ */
+void checkGeofences() {
+    GeoEvent events[4];
+    uint32_t t = trackEpoch(lastFix.year, lastFix.month, lastFix.day,
+                            lastFix.hour, lastFix.minute, lastFix.second);
+    uint8_t n = geoUpdate(&geofences, lastFix.latitude, lastFix.longitude, t, events, 4);
+
+    for (uint8_t i = 0; i < n; i++) {
+        SerialMon.print("[GEO] Geocerca ");
+        SerialMon.print(events[i].fenceId);
+        SerialMon.println(events[i].type == GEO_ENTER ? ": ENTRADA" : ": SALIDA");
+        if (!geoEventsAppend(&geoLog, &events[i])) {
+            geoEventsLost++;
+        }
+    }
+}
+
+/**
+ * @brief Llega una posición en la ventana GNSS: la primera mide el
+ * TTFF; las demás se guardan cada FIX_INTERVAL_MS.
+ */
+void arbiterOnFix(unsigned long now, unsigned long inState) {
+    if (windowFixes == 0) {
+        // Primer fix de la ventana: esta es la muestra de TTFF
+        ttffAvgMs = ewmaUpdate(ttffAvgMs, inState);
+        SerialMon.print("[GNSS] Fix en ");
+        SerialMon.print(inState / 1000.0, 1);
+        SerialMon.println(" s");
+    } else if (now - lastStoredAt < FIX_INTERVAL_MS) {
+        return;
+    }
+    storeFix();
+    lastStoredAt = now;
+    windowFixes++;
+    if (windowFixes >= batchTarget) {
+        arbiterEnter(ARB_GNSS_OFF);
+    }
+}
+
+/**
+ * @brief Arma el lote como bloque binario (XC03-Trayecto.h).
+ * @return Bytes del bloque en 'block.data'.
+ */
+size_t encodeBatch(TrackBlock &block) {
+    trackBegin(&block);
+    for (uint8_t i = 0; i < fixCount; i++) {
+        const StoredFix &f = fixes[i];
+        TrackPoint p;
+        p.t = trackEpoch(f.year, f.month, f.day, f.hour, f.minute, f.second);
+        p.latitude = trackE5(f.latitude);
+        p.longitude = trackE5(f.longitude);
+        p.speed = f.speed;
+        trackAppend(&block, &p);    // Siempre cabe (static_assert de SECCIÓN 4)
+    }
+    return block.len;
+}
+
+/**
+ * @brief Sube el lote completo (posiciones y eventos de geocercas) en
+ * UNA conexión TCP y UN envío. Binario: 2 bytes con el largo del
+ * trayecto (big endian), el bloque del trayecto y geoLog.data.
+ * @return true si el servidor recibió todos los bytes. La conexión se
+ * queda abierta para leer la respuesta (ARB_GPRS_REPLY).
+ */
+bool uploadBatch() {
+    // CSV, cada línea: 2025-10-18T12:00:00Z,20.676900,-103.347500,12.3
+    // y cada evento:   GEO,1760788800,3,ENTRADA
+    static char payload[MAX_FIXES * 56 + GEO_EVENTS_BLOCK_SIZE / 2 * 32];
+    static uint8_t packet[2 + TRACK_BLOCK_SIZE + GEO_EVENTS_BLOCK_SIZE];
+    static TrackBlock block;
+    const uint8_t *data = (const uint8_t *)payload;
+    size_t len = 0;
+
+    if (UPLOAD_BINARY) {
+        size_t trackLen = encodeBatch(block);
+        packet[0] = (uint8_t)(trackLen >> 8);
+        packet[1] = (uint8_t)trackLen;
+        memcpy(packet + 2, block.data, trackLen);
+        memcpy(packet + 2 + trackLen, geoLog.data, geoLog.len);
+        len = 2 + trackLen + geoLog.len;
+        data = packet;
     } else {
-        SerialMon.println("GPRS conectando, pero sin red (falta tiempo).");
+        for (uint8_t i = 0; i < fixCount; i++) {
+            const StoredFix &f = fixes[i];
+            len += snprintf(payload + len, sizeof(payload) - len,
+                            "%04u-%02u-%02uT%02u:%02u:%02uZ,%.6f,%.6f,%.1f\n",
+                            f.year, f.month, f.day, f.hour, f.minute, f.second,
+                            f.latitude / 1e6, f.longitude / 1e6, f.speed / 10.0);
+        }
+        uint16_t pos = 1;
+        uint32_t lastT = 0;
+        GeoEvent ev;
+        while (geoEventsNext(geoLog.data, geoLog.len, &pos, &lastT, &ev)) {
+            len += snprintf(payload + len, sizeof(payload) - len, "GEO,%lu,%u,%s\n",
+                            (unsigned long)ev.t, ev.fenceId,
+                            ev.type == GEO_ENTER ? "ENTRADA" : "SALIDA");
+        }
+    }
+
+    if (!client.connect(server, port)) {
+        SerialMon.println("No se pudo abrir la conexión con el servidor.");
+        return false;
+    }
+    bool ok = client.write(data, len) == len;
+    if (!ok) {
+        client.stop();
+        return false;
+    }
+    SerialMon.print("[GPRS] ");
+    SerialMon.print(len);
+    SerialMon.println(" bytes enviados.");
+    return true;
+}
+
+// --- Respuesta del servidor: "OK,<n>\n" y n bytes de cercas ---
+// Las cercas pasan a GeoLoader byte por byte según llegan: un polígono
+// puede ser de cualquier largo (hasta GEO_MAX_VERTICES).
+#define REPLY_HEAD_MAX 32
+
+struct {
+    char head[REPLY_HEAD_MAX];  // La línea "OK,<n>"
+    uint8_t headLen;
+    bool acked;                 // Ya llegó "OK,<n>"
+    long left;                  // Bytes de cercas que faltan
+    bool loading;               // geoLoaderBegin() ya se llamó
+    GeoLoader fences;
+    uint16_t fencesLoaded;
+} reply;
+
+void replyBegin() {
+    reply.headLen = 0;
+    reply.acked = false;
+    reply.left = 0;
+    reply.loading = false;
+    reply.fencesLoaded = 0;
+}
+
+// Cierra la carga de cercas. Si la respuesta se cortó, el último
+// registro (a medias) no se usa.
+void replyEnd(bool complete) {
+    if (!reply.loading) {
+        return;
+    }
+    if (!complete) {
+        reply.fences.bad = true;
+    }
+    reply.fencesLoaded = geoLoaderEnd(&reply.fences);
+    reply.loading = false;
+}
+
+/**
+ * @brief Lee lo que haya llegado de la respuesta, sin esperar.
+ * @return true cuando la respuesta terminó (reply.acked dice si el
+ * servidor confirmó el lote).
+ */
+bool replyRead() {
+    while (client.available() > 0) {
+        char c = (char)client.read();
+        if (!reply.acked) {
+            if (c != '\n') {
+                if (reply.headLen < REPLY_HEAD_MAX - 1) {
+                    reply.head[reply.headLen++] = c;
+                }
+                continue;
+            }
+            reply.head[reply.headLen] = '\0';
+            if (!xc03StartsWith(reply.head, "OK,")) {
+                SerialMon.print("[GPRS] Respuesta inesperada: ");
+                SerialMon.println(reply.head);
+                return true;
+            }
+            reply.acked = true;
+            reply.left = atol(reply.head + 3);
+            if (reply.left <= 0) {
+                return true;
+            }
+            geoLoaderBegin(&reply.fences, &geofences);
+            reply.loading = true;
+            continue;
+        }
+        geoLoaderFeed(&reply.fences, &c, 1);
+        if (--reply.left == 0) {
+            replyEnd(true);
+            return true;
+        }
+    }
+    return false;
+}
+
+// +CEREG: <n>,<stat>  (1 = registrado, 5 = registrado en roaming)
+void onCeregLine(const char *line, uint8_t len, void *ctx) {
+    const char *comma = strchr(line, ',');
+    netRegistered = comma && (comma[1] == '1' || comma[1] == '5');
+}
+
+// +CSQ: <rssi>,<ber>
+void onCsqLine(const char *line, uint8_t len, void *ctx) {
+    signalQuality = (int16_t)atoi(line + 6);
+}
+
+// +CNACT: <contexto>,<estado>,"<ip>" (una línea por contexto)
+void onCnactLine(const char *line, uint8_t len, void *ctx) {
+    if (xc03StartsWith(line, "+CNACT: 0,")) {
+        pdpActive = line[10] == '1';
+    }
+}
+
+// URC: +APP PDP: 0,ACTIVE / +APP PDP: 0,DEACTIVE
+void onPdpUrc(const char *line, uint8_t len) {
+    if (xc03StartsWith(line, "+APP PDP: 0,")) {
+        pdpActive = strcmp(line + 12, "ACTIVE") == 0;
     }
+}
 
-    // Apaga el GPRS (para cumplir la Regla de Oro)
-    SerialMon.println("Deshabilitando GPRS...");
-    modem.gprsDisconnect();
+/**
+ * @brief Avanza el árbitro un paso. Ningún estado espera al módem:
+ * forma su comando en la cola del motor AT y revisa la respuesta
+ * (arbReply) en las vueltas siguientes.
+ */
+void arbiterStep() {
+    unsigned long now = millis();
+    unsigned long inState = now - arbStateAt;
+
+    switch (arbState) {
+
+    case ARB_GNSS_ON:
+        if (arbReply.status == XC03_AT_IDLE) {
+            arbiterPlanWindows();
+            SerialMon.print("[GNSS] Encendiendo. Lote: ");
+            SerialMon.print(batchTarget);
+            SerialMon.print(" posiciones, ventana: ");
+            SerialMon.print(gnssWindowMs / 1000);
+            SerialMon.println(" s");
+            xc03AtCommand("+CGNSPWR=1", &arbReply);
+            break;
+        }
+        if (!xc03AtDone(&arbReply)) {
+            break;
+        }
+        if (arbReply.status != XC03_AT_OK) {
+            SerialMon.println("[GNSS] No se pudo encender.");
+            arbiterRetry(ARB_GNSS_ON);
+            break;
+        }
+        modeSwitches++;
+        windowFixes = 0;
+        arbiterEnter(ARB_GNSS_SEARCH);
+        break;
 
-    SerialMon.println("--- Fin del Ciclo de Demo ---");
-    delay(5000); // Espera 5 segundos antes de repetir
-}
\ No newline at end of file
+    case ARB_GNSS_SEARCH:
+        // Con una consulta en curso sólo se espera (la ventana no se
+        // cierra a media respuesta)
+        if (arbReply.status == XC03_AT_PENDING) {
+            break;
+        }
+        if (arbReply.status != XC03_AT_IDLE) {
+            arbReply.status = XC03_AT_IDLE;
+            if (gnssReply.valid) {
+                lastFix = gnssReply.fix;
+                checkGeofences();
+                arbiterOnFix(now, inState);
+                if (arbState != ARB_GNSS_SEARCH) {
+                    break;
+                }
+            }
+        }
+        if (inState >= gnssWindowMs) {
+            SerialMon.println("[GNSS] Se acabó la ventana.");
+            arbiterEnter(ARB_GNSS_OFF);
+            break;
+        }
+        if (now - arbLastPoll < GNSS_POLL_MS) {
+            break;
+        }
+        arbLastPoll = now;
+        gnssReply.valid = false;
+        xc03AtQuery("+CGNSINF", "+CGNSINF:", xc03GnssOnLine, &gnssReply, &arbReply);
+        break;
+
+    case ARB_GNSS_OFF:
+        // Regla de Oro: el GNSS se apaga ANTES de tocar la red. La cola
+        // manda los comandos en orden: no hace falta esperar el "OK".
+        xc03AtCommand("+CGNSPWR=0", NULL);
+        if (fixCount == 0 && geoLog.count == 0) {
+            arbiterRetry(ARB_GNSS_ON);
+        } else {
+            arbiterEnter(ARB_GPRS_REGISTER);
+        }
+        break;
+
+    case ARB_GPRS_REGISTER:
+        if (arbReply.status == XC03_AT_PENDING) {
+            break;
+        }
+        if (arbReply.status != XC03_AT_IDLE && netRegistered) {
+            SerialMon.print("[GPRS] Registrado, señal (CSQ): ");
+            SerialMon.println(signalQuality);
+            // Igual que gprsConnect(), pero sin esperar la activación
+            char cfg[XC03_AT_TEXT_MAX];
+            snprintf(cfg, sizeof(cfg), "+CNCFG=0,1,\"%s\",\"%s\",\"%s\"", apn, user, pass);
+            xc03AtCommand(cfg, NULL);
+            xc03AtCommand("+CNACT=0,1", NULL);
+            pdpActive = false;
+            arbiterEnter(ARB_GPRS_ATTACH);
+            break;
+        }
+        if (inState >= REGISTER_TIMEOUT_MS) {
+            SerialMon.println("[GPRS] Sin red. El lote se queda para la próxima.");
+            arbiterEnter(ARB_GPRS_OFF);
+            break;
+        }
+        if (now - arbLastPoll < NET_POLL_MS) {
+            break;
+        }
+        arbLastPoll = now;
+        // Dos consultas independientes, una tras otra en la cola
+        netRegistered = false;
+        xc03AtQuery("+CSQ", "+CSQ:", onCsqLine, NULL, NULL);
+        xc03AtQuery("+CEREG?", "+CEREG:", onCeregLine, NULL, &arbReply);
+        break;
+
+    case ARB_GPRS_ATTACH:
+        if (arbReply.status == XC03_AT_PENDING) {
+            break;
+        }
+        // Normalmente lo avisa el URC "+APP PDP: 0,ACTIVE" (onPdpUrc)
+        if (pdpActive) {
+            attachAvgMs = ewmaUpdate(attachAvgMs, inState);
+            modeSwitches++;
+            SerialMon.print("[GPRS] Conectado en ");
+            SerialMon.print(inState / 1000.0, 1);
+            SerialMon.println(" s");
+            arbiterEnter(ARB_GPRS_UPLOAD);
+            break;
+        }
+        if (inState >= attachWindowMs) {
+            SerialMon.println("[GPRS] No se activó a tiempo.");
+            attachAvgMs = ewmaUpdate(attachAvgMs, inState);
+            arbiterEnter(ARB_GPRS_OFF);
+            break;
+        }
+        if (now - arbLastPoll < ATTACH_POLL_MS) {
+            break;
+        }
+        arbLastPoll = now;
+        // Por si el URC se perdió
+        xc03AtQuery("+CNACT?", "+CNACT:", onCnactLine, NULL, &arbReply);
+        break;
+
+    case ARB_GPRS_UPLOAD:
+        // El envío va por TinyGSM: primero se vacía la cola para que el
+        // motor no le gane las respuestas del puerto
+        if (!xc03AtIdle()) {
+            break;
+        }
+        if (!uploadBatch()) {
+            arbiterEnter(ARB_GPRS_OFF);
+            break;
+        }
+        replyBegin();
+        arbiterEnter(ARB_GPRS_REPLY);
+        break;
+
+    case ARB_GPRS_REPLY:
+        // Las posiciones y los eventos sólo se borran cuando el servidor
+        // contesta "OK"; sin respuesta se quedan y suben con el
+        // siguiente lote
+        if (!xc03AtIdle()) {
+            break;
+        }
+        if (!replyRead()) {
+            if (inState < REPLY_TIMEOUT_MS && client.connected()) {
+                break;
+            }
+            SerialMon.println("[GPRS] Sin respuesta. El lote se queda para la próxima.");
+            replyEnd(false);
+        }
+        if (reply.acked) {
+            SerialMon.print("[GPRS] Lote confirmado: ");
+            SerialMon.print(fixCount);
+            SerialMon.print(" posiciones, ");
+            SerialMon.print(geoLog.count);
+            SerialMon.println(" eventos de geocercas.");
+            fixesUploaded += fixCount;
+            fixCount = 0;
+            geoEventsUploaded += geoLog.count;
+            geoEventsBegin(&geoLog);
+        }
+        if (reply.fencesLoaded > 0) {
+            SerialMon.print("[GEO] Cercas actualizadas, activas: ");
+            SerialMon.print(geofences.count);
+            SerialMon.print(", registros con error: ");
+            SerialMon.println(geofences.loadErrors);
+        }
+        client.stop();
+        arbiterEnter(ARB_GPRS_OFF);
+        break;
+
+    case ARB_GPRS_OFF:
+        // Regla de Oro: GPRS se apaga ANTES de volver al GNSS. La cola
+        // manda +CNACT=0,0 antes que el +CGNSPWR=1 de ARB_GNSS_ON.
+        xc03AtCommand("+CNACT=0,0", NULL, 60000UL);
+        pdpActive = false;
+        SerialMon.print("[ARB] Cambios de modo: ");
+        SerialMon.print(modeSwitches);
+        SerialMon.print(", posiciones subidas: ");
+        SerialMon.print(fixesUploaded);
+        SerialMon.print(", eventos: ");
+        SerialMon.print(geoEventsUploaded);
+        if (geoEventsLost > 0) {
+            SerialMon.print(" (perdidos: ");
+            SerialMon.print(geoEventsLost);
+            SerialMon.print(")");
+        }
+        SerialMon.print(", TTFF prom: ");
+        SerialMon.print(ttffAvgMs / 1000.0, 1);
+        SerialMon.print(" s, attach prom: ");
+        SerialMon.print(attachAvgMs / 1000.0, 1);
+        SerialMon.println(" s");
+        arbiterEnter(ARB_GNSS_ON);
+        break;
+
+    case ARB_WAIT:
+        if (inState >= RETRY_MS) {
+            arbiterEnter(arbAfterWait);
+        }
+        break;
+    }
+}
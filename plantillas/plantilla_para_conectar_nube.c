@@ -3,12 +3,30 @@
  * PROYECTO:      PLANTILLA PARA CONECTAR A LA NUBE (LTE)
  * AUTOR:         [TU NOMBRE O NOMBRE DE EQUIPO]
  * FECHA:         Octubre 2025
- * VERSIÓN:       1.0 (Plantilla Base)
+ * VERSIÓN:       1.6 (Latencia del Loop Medida)
  *
  * DESCRIPCIÓN:
  * Esta es la plantilla fundamental para el Hackathon 2025.
  * Conecta el controlador XC01 a Blynk.Cloud usando el
  * módulo celular XC03 (SIM7080G) para control y monitoreo básico.
+ * Los valores hacia la nube pasan por una capa de publicación: todo
+ * lo que se escribe en una vuelta del scheduler sale junto en UN
+ * solo mensaje (cada mensaje cuesta tiempo y datos por LTE).
+ * El botón se atiende por interrupción: cada flanco se guarda en una
+ * cola y loop() lo procesa con antirrebote en milisegundos.
+ * El módem arranca con una máquina de estados (XC03-Arranque.h): en lugar
+ * de esperar tiempos fijos pregunta "AT", el registro y el PDP hasta
+ * que están listos. El botón y el LED funcionan desde el primer
+ * segundo. Si el módem contesta antes del pulso (sólo se reinició el
+ * ESP32), se reutilizan el registro y el PDP que ya tenía. Al salir
+ * el primer dato se imprime cuánto tardó cada etapa del arranque.
+ * Con TELEMETRY_UPLINK_BINARY en 1 los valores SUBEN en tramas binarias
+ * por una conexión TCP propia (XC03-Telemetria.h) en lugar de como
+ * mensajes de Blynk; Blynk se queda para el control desde la app (V0).
+ * Cada pieza del loop() (arranque del módem, Blynk.run(),
+ * scheduler.run(), publishFlush()) se mide con el contador de ciclos
+ * (XC01-Latencia.h): un bloqueo se reporta en el momento y cada 10
+ * minutos sale la tabla completa por Serial y un resumen en V2.
  *
  * ===================================================================
  * HARDWARE UTILIZADO:
@@ -20,6 +38,7 @@
  * -------------------------------------------------------------------
  * V0 (Entrada): Control Remoto de BOARD_LED (0=OFF, 1=ON)
  * V1 (Salida):  Estado del BOARD_BUTTON (0=Presionado, 1=Liberado)
+ * V2 (Salida):  Latencia del loop: "pieza máx_ms/bloqueos ..." (texto)
  * ===================================================================
  */
 
@@ -68,15 +87,71 @@
  * * scheduler.setInterval(milisegundos, funcion)
  * Para QUÉ: Le dice al 'scheduler' que ejecute 'funcion'
  * cada 'milisegundos'.
+ * * attachInterrupt(digitalPinToInterrupt(pin), isr, CHANGE)
+ * Para QUÉ: Ejecuta la función 'isr' en el instante en que el pin
+ * cambia de nivel, sin esperar al loop(). La ISR debe ser muy
+ * corta (aquí solo guarda el flanco en una cola) y llevar IRAM_ATTR.
+ * * processInputs()
+ * Para QUÉ: Saca los flancos de la cola, les aplica antirrebote y
+ * llama a updateButton() sólo con cambios reales.
+ * * --- CAPA DE PUBLICACIÓN (XC01-Publicacion.h) ---
+ * * publishStage(Vpin, valor)
+ * Para QUÉ: Úsala en lugar de Blynk.virtualWrite(). No envía nada:
+ * deja el valor "en espera". Si el mismo pin se escribe dos veces
+ * antes de enviar, sólo sale el último valor.
+ * El valor también puede ser un texto (se copia; ej. el resumen de
+ * latencia). Con la telemetría binaria los textos salen por Blynk.
+ * * publishFlush()
+ * Para QUÉ: Envía todos los valores en espera en UN mensaje
+ * (publishSendBlynk(): Blynk.beginGroup() ... Blynk.endGroup()).
+ * loop() la llama al terminar cada vuelta del scheduler.
+ * * publishPolicy(Vpin, banda, bandaRel, minMs, maxMs)
+ * Para QUÉ: Hace que publishStage() sólo envíe cambios reales del
+ * pin: más grandes que la banda muerta (absoluta o relativa), no
+ * más seguido que minMs, y de todos modos cada maxMs ("latido").
  *
  * * --- LIBRERÍA TinyGsmClient (MÓDEM XC03) ---
  * * TinyGsm modem(SerialAT)
  * Para QUÉ: Crea el objeto "controlador" para nuestro módem XC03.
  * Le dice que debe usar 'SerialAT' (Serial2) para enviar comandos.
  *
- * * modem.restart()
+ * * modem.init()
  * Para QUÉ: Envía los comandos AT de inicialización al SIM7080G
  * para configurarlo en un estado conocido y listo para conectar.
+ *
+ * * Blynk.config(modem, auth, domain) / Blynk.connect()
+ * Para QUÉ: Igual que Blynk.begin() pero SIN encender la red:
+ * se usan cuando el PDP ya está activo.
+ *
+ * * --- TELEMETRÍA BINARIA (XC03-Telemetria.h) ---
+ * * xc03TelMaintain(&tel, millis())
+ * Para QUÉ: Mantiene abierta la conexión TCP con el receptor de
+ * telemetría (socket 1 del módem; Blynk usa el 0). Si se cae, la
+ * reabre cada XC03_TEL_RETRY_MS.
+ * * xc03TelReport() / xc03TelInt() / xc03TelCenti() / xc03TelSend()
+ * Para QUÉ: Arman un reporte binario (un byte de pin y el valor en
+ * varint) y lo mandan en una sola escritura TCP. publishFlush() los
+ * usa en lugar de Blynk.virtualWrite() si TELEMETRY_UPLINK_BINARY es 1.
+ *
+ * * --- ARRANQUE DEL MÓDEM (SECCIÓN 10) ---
+ * * xc03BootUpdate(&boot)
+ * Para QUÉ: Avanza el arranque del módem UN paso y regresa de
+ * inmediato (XC03-Arranque.h). Regresa true cuando Blynk ya está
+ * configurado. El pulso del PWRKEY lo termina un esp_timer.
+ * * xc03BootMarkData(&boot)
+ * Para QUÉ: Se llama con cada dato que sale; la primera vez imprime
+ * cuánto tardó cada etapa del arranque y el primer dato.
+ *
+ * * --- LATENCIA DEL LOOP (XC01-Latencia.h) ---
+ * * XC01_LAT_TIME(pieza, instrucción)
+ * Para QUÉ: Mide cuánto tarda la instrucción con el contador de
+ * ciclos y lo suma al histograma de la pieza.
+ * * XC01_LAT_TIMED(funcion)
+ * Para QUÉ: Va en scheduler.setInterval() en lugar de la función:
+ * cada llamada del timer se mide en su propia pieza.
+ * * latencyReport()
+ * Para QUÉ: Imprime los histogramas, manda el resumen a V2 y
+ * empieza otra ventana de medición.
  * ===================================================================
  */
 
@@ -102,6 +177,10 @@
 #include <Wire.h>                 // Librería I2C (preparada para el XN04)
 #include <TinyGsmClient.h>        // Librería de control del módem
 #include <BlynkSimpleTinyGSM.h>   // Puente entre Blynk y TinyGSM
+#include "XC03-Telemetria.h"      // Telemetría binaria por TCP (opcional)
+#include "XC01-Latencia.h"        // Histogramas de latencia del loop()
+#include "XC01-Publicacion.h"     // Envío por lotes y por cambio
+#include "XC03-Arranque.h"        // Arranque del módem sin espera
 
 
 //##################################################################
@@ -148,34 +227,143 @@ const char pass[] = "";
 const char domain[] = "ny3.blynk.cloud";
 const char auth[] = BLYNK_AUTH_TOKEN;
 
+// --- Telemetría binaria (XC03-Telemetria.h) ---
+// 1: los valores suben como tramas binarias al receptor de abajo y
+// Blynk sólo se usa para el control. 0: todo por Blynk.
+#ifndef TELEMETRY_UPLINK_BINARY
+#define TELEMETRY_UPLINK_BINARY 0
+#endif
+const char telemetryHost[] = "telemetria.example.com";
+const uint16_t telemetryPort = XC03_TEL_PORT;
+const char telemetryId[] = "xc01-plantilla";
+
 
 //##################################################################
 // ### SECCIÓN 5: OBJETOS GLOBALES Y VARIABLES ###
 //##################################################################
 static BlynkTimer scheduler;
 static TinyGsm modem(SerialAT);
+static TinyGsmClient telClient(modem, 1);  // Socket 1: el 0 es de Blynk
+static XC03TelLink tel;
+
+// --- Capa de publicación por lotes (XC01-Publicacion.h, SECCIÓN 9) ---
+const unsigned long PUBLISH_REPORT_MS = 600000UL; // Reporte de contadores
+const unsigned long BUTTON_MIN_INTERVAL_MS = 200UL; // V1: a lo más 5 envíos por segundo
+
+bool publishSend(PendingWrite *writes, uint8_t count);
+void publishReport();
+
+// --- Entradas por interrupción (SECCIÓN 6) ---
+#define INPUT_QUEUE_SIZE 16            // Potencia de 2
+const unsigned long DEBOUNCE_MS = 20UL; // Tiempo estable para aceptar un nivel
+
+// Un flanco capturado por la ISR
+typedef struct {
+    uint32_t t_ms;                      // millis() del flanco
+    uint8_t level;                      // Nivel del pin después del flanco
+} InputEvent;
+
+void updateButton(int current_status);
+void processInputs();
+
+// --- Latencia del loop (XC01-Latencia.h) ---
+// Un AT+CASEND tarda ~140 ms: 500 ms deja pasar uno o dos por vuelta
+const uint32_t LOOP_BUDGET_US = 500000UL;          // Más que esto es un bloqueo
+const unsigned long LATENCY_REPORT_MS = 600000UL;  // Tabla por Serial y V2
+
+static XC01LatSlot *latLoop;        // Tiempo entre vueltas de loop()
+static XC01LatSlot *latBoot;
+static XC01LatSlot *latBlynk;
+static XC01LatSlot *latScheduler;   // Incluye los timers (cada uno tiene la suya)
+static XC01LatSlot *latPublish;
+
+void latencyReport();
+
+// --- Arranque del módem (XC03-Arranque.h) ---
+// Tiempos del pulso, de los "AT" y de la red: XC03_BOOT_* en el header
+static XC03Boot boot;
+
+void bootBegin();
 
 
 //##################################################################
-// ### SECCIÓN 6: TAREAS PROGRAMADAS (TIMER) ###
+// ### SECCIÓN 6: ENTRADAS POR INTERRUPCIÓN (BOTÓN) ###
 //##################################################################
 
+// Cola sin candados de un productor (la ISR) y un consumidor (loop()):
+// la ISR sólo escribe 'inputHead' y loop() sólo escribe 'inputTail'.
+static InputEvent inputQueue[INPUT_QUEUE_SIZE];
+static volatile uint8_t inputHead = 0;
+static volatile uint8_t inputTail = 0;
+static volatile uint32_t inputOverflows = 0; // Flancos perdidos (cola llena)
+
+static int buttonState = HIGH;               // Último nivel aceptado
+
 /**
- * @brief Revisa el estado del botón BOOT y lo envía a Blynk (V1).
- * * Optimizado para enviar datos solo cuando hay un cambio.
+ * @brief ISR del botón BOOT: guarda el flanco y regresa.
  */
-void updateButton( )
+void IRAM_ATTR onButtonEdge()
 {
-    static int prev_status = HIGH;
+    uint8_t head = inputHead;
+    uint8_t next = (head + 1) & (INPUT_QUEUE_SIZE - 1);
 
-    int current_status = digitalRead( BOARD_BUTTON );
-
-    if ( current_status == prev_status ){
+    if (next == __atomic_load_n(&inputTail, __ATOMIC_ACQUIRE)) {
+        inputOverflows++;
         return;
     }
+    inputQueue[head].t_ms = millis();
+    inputQueue[head].level = digitalRead(BOARD_BUTTON);
+    __atomic_store_n(&inputHead, next, __ATOMIC_RELEASE);
+}
 
-    prev_status = current_status;
-    Blynk.virtualWrite(V1, current_status);
+/**
+ * @brief Antirrebote: un nivel se acepta si se mantuvo DEBOUNCE_MS
+ * (hasta el siguiente flanco o hasta ahora). Como cada flanco trae su
+ * hora, funciona aunque loop() llegue tarde a procesar la cola.
+ */
+void processInputs()
+{
+    uint8_t head = __atomic_load_n(&inputHead, __ATOMIC_ACQUIRE);
+
+    while (inputTail != head) {
+        uint8_t tail = inputTail;
+        uint8_t next = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+        InputEvent event = inputQueue[tail];
+        bool stable;
+
+        if (next != head) {
+            stable = inputQueue[next].t_ms - event.t_ms >= DEBOUNCE_MS;
+        } else if (millis() - event.t_ms >= DEBOUNCE_MS) {
+            stable = true;
+        } else {
+            break; // Aún puede rebotar: se revisa en la siguiente vuelta
+        }
+        __atomic_store_n(&inputTail, next, __ATOMIC_RELEASE);
+
+        if (stable && event.level != buttonState) {
+            buttonState = event.level;
+            updateButton(buttonState);
+        }
+    }
+
+    // Si la cola se llenó se perdieron flancos: se relee el pin
+    if (inputOverflows > 0 && inputTail == head) {
+        inputOverflows = 0;
+        int level = digitalRead(BOARD_BUTTON);
+        if (level != buttonState) {
+            buttonState = level;
+            updateButton(buttonState);
+        }
+    }
+}
+
+/**
+ * @brief Envía el estado del botón BOOT a Blynk (V1).
+ * * Sólo se llama cuando el nivel realmente cambió.
+ */
+void updateButton(int current_status)
+{
+    publishStage(V1, (int32_t)current_status);
 }
 
 
@@ -202,33 +390,34 @@ void setup()
     pinMode(BOARD_LED, OUTPUT);
     digitalWrite(BOARD_LED, LOW);
     pinMode(PIN_MODEM_PK, OUTPUT);
-
-    // --- 3. Reinicio por Hardware del Módem XC03 ---
-    SerialMon.println("Reiniciando módem XC03 (pulso de 3s)...");
-    
-    // Esta secuencia es crítica:
-    // El módem SIM7080G requiere un pulso de 3000ms (3 segundos)
-    // en el pin Power Key (PK) para forzar un reinicio limpio.
-    digitalWrite(PIN_MODEM_PK, HIGH);
-    delay(3000); // Pausa BLOQUEANTE de 3 segundos (aceptable en setup())
     digitalWrite(PIN_MODEM_PK, LOW);
 
-    // --- 4. Conexión a la Red Celular y Blynk ---
-    SerialMon.println("Iniciando modem LTE...");
-    modem.restart();
-    
-    String modemInfo = modem.getModemInfo();
-    SerialMon.print("Modem: ");
-    SerialMon.println(modemInfo);
-
-    SerialMon.println("Conectando a GPRS y Blynk...");
-    Blynk.begin(auth, modem, apn, user, pass, domain);
-    SerialMon.println("Conexión iniciada.");
-
-    // --- 5. Programar Tareas ---
-    // '1000UL' = 1000 milisegundos (1 segundo). 'UL' es por 'Unsigned Long'.
-    // Ejecuta updateButton cada 1 segundo.
-    scheduler.setInterval(1000UL, updateButton);
+    // --- 3. Módem XC03 y Blynk ---
+    // Ya no se espera aquí: loop() enciende el módem y conecta con
+    // xc03BootUpdate(), y mientras tanto el botón y el LED funcionan.
+    bootBegin();
+    xc03TelBegin(&tel, telClient, telemetryHost, telemetryPort, telemetryId);
+
+    // --- 5. Interrupciones y Tareas ---
+    // El botón ya no se revisa cada segundo: cada flanco dispara onButtonEdge()
+    buttonState = digitalRead(BOARD_BUTTON);
+    attachInterrupt(digitalPinToInterrupt(BOARD_BUTTON), onButtonEdge, CHANGE);
+
+    // Piezas del loop() que se miden (en este orden salen en la tabla)
+    latLoop = xc01LatSlot("loop (vuelta)", LOOP_BUDGET_US);
+    latBoot = xc01LatSlot("xc03BootUpdate", LOOP_BUDGET_US);
+    latBlynk = xc01LatSlot("Blynk.run", LOOP_BUDGET_US);
+    latScheduler = xc01LatSlot("scheduler.run", LOOP_BUDGET_US);
+    latPublish = xc01LatSlot("publishFlush", LOOP_BUDGET_US);
+
+    // Reporte de los contadores de la capa de publicación (cada 10 minutos)
+    scheduler.setInterval(PUBLISH_REPORT_MS, XC01_LAT_TIMED(publishReport));
+    scheduler.setInterval(LATENCY_REPORT_MS, latencyReport);
+
+    publishBegin(publishSend);
+    // V1: cualquier cambio cuenta; si el botón se presiona muy rápido,
+    // el último estado sale al cumplirse BUTTON_MIN_INTERVAL_MS
+    publishPolicy(V1, 0.0f, 0.0f, BUTTON_MIN_INTERVAL_MS, 0UL);
 }
 
 
@@ -237,13 +426,99 @@ void setup()
 //##################################################################
 void loop()
 {
-    Blynk.run();
-    scheduler.run();
+    bool online;
+
+    xc01LatLoop(latLoop);
+
+    XC01_LAT_TIME(latBoot, online = xc03BootUpdate(&boot));
+    if (online) {
+        XC01_LAT_TIME(latBlynk, Blynk.run());
+        if (TELEMETRY_UPLINK_BINARY) {
+            xc03TelMaintain(&tel, millis());
+        }
+    }
+    processInputs();
+    XC01_LAT_TIME(latScheduler, scheduler.run());
+
+    // Todo lo que las tareas escribieron en esta vuelta sale junto
+    XC01_LAT_TIME(latPublish, publishFlush());
+}
+
+/**
+ * @brief Imprime los histogramas de latencia, manda el resumen a V2
+ * y empieza otra ventana: cada reporte cubre LATENCY_REPORT_MS.
+ */
+void latencyReport()
+{
+    char summary[160];
+
+    xc01LatPrint(SerialMon);
+    xc01LatSummary(summary, sizeof(summary));
+    publishStage(V2, summary);
+    xc01LatReset();
+}
+
+
+//##################################################################
+// ### SECCIÓN 9: CAPA DE PUBLICACIÓN (POR LOTES) ###
+//##################################################################
+
+/**
+ * @brief Manda un lote de la capa de publicación en un solo mensaje
+ * agrupado de Blynk (o en un reporte binario con
+ * TELEMETRY_UPLINK_BINARY), con publishSendBlynk(). Sin conexión
+ * regresa false y los valores se quedan para el siguiente
+ * publishFlush().
+ */
+bool publishSend(PendingWrite *writes, uint8_t count)
+{
+    if (!publishSendBlynk(writes, count, TELEMETRY_UPLINK_BINARY ? &tel : NULL)) {
+        return false;
+    }
+    xc03BootMarkData(&boot);
+    return true;
+}
+
+void publishReport()
+{
+    publishPrintReport(Serial);
+    if (TELEMETRY_UPLINK_BINARY) {
+        xc03TelPrintReport(Serial, &tel);
+    }
+}
+
+
+//##################################################################
+// ### SECCIÓN 10: ARRANQUE DEL MÓDEM (NO BLOQUEANTE) ###
+//##################################################################
+
+static const XC03BootStep bootSteps[] = {
+    { NULL, xc03BootStepInit },         // Eco apagado, SIM lista
+    { "red", xc03BootStepNetwork },     // Registro en la red (CEREG)
+    { "PDP", xc03BootStepAttach },      // Activación del PDP (CNACT)
+    { "Blynk", xc03BootStepBlynk },     // Conexión con Blynk.Cloud
+};
+
+// Arranque en caliente: cierra los sockets que quedaron abiertos
+static const XC03BootHooks bootHooks = { NULL, NULL, xc03BootCloseSockets };
+
+/**
+ * @brief Prepara el arranque del módem; loop() lo avanza con
+ * xc03BootUpdate(&boot). Lo más largo que se detiene loop() es una
+ * respuesta AT (o el AT+CAOPEN de Blynk).
+ */
+void bootBegin()
+{
+    xc03BootBegin(&boot, &modem, SerialMon, PIN_MODEM_PK, bootSteps,
+                  sizeof(bootSteps) / sizeof(bootSteps[0]), &bootHooks);
+    xc03BootSetApn(&boot, apn, user, pass);
+    xc03BootSetBlynk(&boot, auth, domain);
+    xc03BootSetSockets(&boot, TELEMETRY_UPLINK_BINARY ? 2 : 1);
 }
 
 
 //##################################################################
-// ### SECCIÓN 9: FUNCIONES DE EVENTOS BLYNK (CALLBACKS) ###
+// ### SECCIÓN 11: FUNCIONES DE EVENTOS BLYNK (CALLBACKS) ###
 //##################################################################
 
 BLYNK_CONNECTED()
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <SPI.h>
+#include "XN-Bus.h"
 
 
 #define MIKROBUS_AN 4
@@ -18,6 +19,9 @@
 
 #define BOARD_LED 16
 
+// Modulos XN conectados al bus I2C
+static const uint8_t xnAddresses[] = { 1, 2, 4, 11 };
+
 
 void setup(){
 
@@ -49,6 +53,8 @@ void setup(){
     // I2C config
     Wire.setPins( MIKROBUS_SDA, MIKROBUS_SCL ); // mikroBUS
     Wire.begin();
+    // Velocidad del bus por modulo (prueba 1 MHz, 400 kHz y 100 kHz)
+    xnBusBegin( xnAddresses, sizeof( xnAddresses ) );
 
     // SPI config
     SPI.begin( MIKROBUS_SCK, MIKROBUS_MISO, MIKROBUS_MOSI ); // mikroBUS
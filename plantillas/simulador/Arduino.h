@@ -0,0 +1,267 @@
+/*
+ * ===================================================================
+ * SUSTITUTO DE Arduino.h PARA EL SIMULADOR (HOST / LINUX)
+ *
+ * Solo incluye lo que usan las plantillas: tiempo, GPIO, String,
+ * Print/Stream, los puertos Serial (monitor) y Serial2 (módem XC03) y
+ * un subconjunto de FreeRTOS (tareas fijadas a un núcleo).
+ * ===================================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+
+// Modos de attachInterrupt()
+#define RISING    0x01
+#define FALLING   0x02
+#define CHANGE    0x03
+
+// En el ESP32 pone la función en IRAM; aquí no hace nada
+#define IRAM_ATTR
+#define digitalPinToInterrupt(p) (p)
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define SERIAL_8N1 0x800001c
+
+#define F(s) (s)
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+//##################################################################
+// ### TIEMPO Y GPIO ###
+//##################################################################
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// La ISR se llama en el instante simulado del flanco (--pin, XN01 INT)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// PSRAM del ESP32-S3 (esp32-hal-psram.h). En la computadora es memoria
+// normal; sim::config.psram = false simula una placa sin PSRAM.
+bool psramFound();
+void *ps_malloc(size_t size);
+
+// Contador de ciclos del CPU (Esp.h) y su frecuencia (esp32-hal-cpu.h).
+// Aquí el contador avanza con el tiempo simulado, a 240 MHz.
+class EspClass {
+public:
+    uint32_t getCycleCount();
+};
+extern EspClass ESP;
+uint32_t getCpuFrequencyMhz();
+
+
+//##################################################################
+// ### FreeRTOS (SUBCONJUNTO) ###
+//##################################################################
+// En el ESP32 Arduino.h ya incluye FreeRTOS. Aquí cada tarea es una
+// corrutina que corre cuando vence su vTaskDelay() y cuyo tiempo se
+// cuenta aparte (como si estuviera en el otro núcleo).
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  1
+#define pdFAIL  0
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define ARDUINO_RUNNING_CORE 1
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t tarea, const char *nombre,
+                                   uint32_t pila, void *parametro,
+                                   UBaseType_t prioridad, TaskHandle_t *handle,
+                                   BaseType_t nucleo);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *anterior, TickType_t incremento);
+TickType_t xTaskGetTickCount();
+BaseType_t xPortGetCoreID();
+
+
+//##################################################################
+// ### String ###
+//##################################################################
+class String {
+public:
+    String(const char *s = "") : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v, unsigned char base = 10);
+    String(unsigned int v, unsigned char base = 10);
+    String(long v, unsigned char base = 10);
+    String(unsigned long v, unsigned char base = 10);
+    String(float v, unsigned int decimals = 2);
+    String(double v, unsigned int decimals = 2);
+
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.length(); }
+    bool reserve(unsigned int n) { s_.reserve(n); return true; }
+
+    char charAt(unsigned int i) const { return i < s_.length() ? s_[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    String &operator+=(const char *o) { s_ += o; return *this; }
+    String &operator+=(char c) { s_ += c; return *this; }
+    bool concat(char c) { s_ += c; return true; }
+    bool concat(const String &o) { s_ += o.s_; return true; }
+
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator==(const char *o) const { return s_ == o; }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+    bool equals(const String &o) const { return s_ == o.s_; }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String &o, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    bool startsWith(const String &o) const { return s_.compare(0, o.s_.length(), o.s_) == 0; }
+    bool endsWith(const String &o) const;
+
+    void trim();
+    void replace(const String &de, const String &a);
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+    double toDouble() const { return strtod(s_.c_str(), nullptr); }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+
+private:
+    std::string s_;
+};
+
+
+//##################################################################
+// ### Print / Stream ###
+//##################################################################
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t n);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t write(const char *buf, size_t n) { return write((const uint8_t *)buf, n); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(long long v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned long long v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(double v, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(const T &v, int f) { size_t n = print(v, f); return n + println(); }
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout_ = ms; }
+    unsigned long getTimeout() const { return timeout_; }
+
+    size_t readBytes(uint8_t *buf, size_t n);
+    size_t readBytes(char *buf, size_t n) { return readBytes((uint8_t *)buf, n); }
+    size_t readBytesUntil(char fin, char *buf, size_t n);
+    String readStringUntil(char fin);
+    String readString();
+    bool find(const char *objetivo);
+    long parseInt();
+    float parseFloat();
+
+protected:
+    // Lectura con espera (en tiempo simulado) hasta timeout_.
+    int timedRead();
+    unsigned long timeout_ = 1000;
+};
+
+
+//##################################################################
+// ### PUERTOS SERIE ###
+//##################################################################
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int uart) : uart_(uart) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1);
+    void end() {}
+    operator bool() const { return true; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override;
+    using Print::write;
+
+private:
+    int uart_;
+};
+
+extern HardwareSerial Serial;    // Monitor USB (stdout)
+extern HardwareSerial Serial2;   // mikroBUS RX/TX -> módem XC03
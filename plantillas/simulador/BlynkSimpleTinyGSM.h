@@ -0,0 +1,227 @@
+/*
+ * ===================================================================
+ * SUSTITUTO DE BlynkSimpleTinyGSM.h PARA EL SIMULADOR
+ *
+ * Blynk viaja por un TinyGsmClient (socket 0 del módem): cada
+ * mensaje (login, virtualWrite, ping, ...) es un encabezado de 5 bytes
+ * + cuerpo, enviado con su propio AT+CASEND, igual que en la placa.
+ *
+ * Los mensajes entre beginGroup() y endGroup() se juntan y salen en
+ * UN solo AT+CASEND al cerrar el grupo.
+ *
+ * La "nube" guarda el último valor de cada pin virtual. Las escrituras
+ * desde la app se programan con --app t_ms:Vn=valor y se entregan a
+ * BLYNK_WRITE(Vn) dentro de Blynk.run().
+ * ===================================================================
+ */
+#pragma once
+// La misma guarda que la librería: los headers XC la usan para saber
+// si hay Blynk (xc03BootStepBlynk(), publishSendBlynk())
+#define BlynkSimpleTinyGSM_h
+
+#include "Arduino.h"
+#include "TinyGsmClient.h"
+
+#define V0 0
+#define V1 1
+#define V2 2
+#define V3 3
+#define V4 4
+#define V5 5
+#define V6 6
+#define V7 7
+#define V8 8
+#define V9 9
+#define V10 10
+#define V11 11
+#define V12 12
+#define V13 13
+#define V14 14
+#define V15 15
+#define V16 16
+#define V17 17
+#define V18 18
+#define V19 19
+#define V20 20
+#define V21 21
+#define V22 22
+#define V23 23
+#define V24 24
+#define V25 25
+#define V26 26
+#define V27 27
+#define V28 28
+#define V29 29
+#define V30 30
+#define V31 31
+
+#define BLYNK_MAX_VPIN 32
+
+#ifndef BLYNK_PRINT
+#define BLYNK_LOG(msg)
+#else
+#define BLYNK_LOG(msg) do { BLYNK_PRINT.print("[Blynk] "); BLYNK_PRINT.println(msg); } while (0)
+#endif
+
+//##################################################################
+// ### PARÁMETROS Y CALLBACKS ###
+//##################################################################
+class BlynkParam {
+public:
+    explicit BlynkParam(const String &v) : v_(v) {}
+    int asInt() const { return (int)v_.toInt(); }
+    long asLong() const { return v_.toInt(); }
+    float asFloat() const { return v_.toFloat(); }
+    double asDouble() const { return v_.toDouble(); }
+    const char *asStr() const { return v_.c_str(); }
+    const char *asString() const { return v_.c_str(); }
+private:
+    String v_;
+};
+
+struct BlynkReq {
+    uint8_t pin;
+};
+
+typedef void (*WidgetWriteHandler)(BlynkReq &request, const BlynkParam &param);
+
+#define BLYNK_WRITE_2(pin) \
+    void BlynkWidgetWrite ## pin (BlynkReq &request, const BlynkParam &param)
+#define BLYNK_WRITE(pin) BLYNK_WRITE_2(pin)
+
+#define BLYNK_CONNECTED() void BlynkOnConnected()
+#define BLYNK_DISCONNECTED() void BlynkOnDisconnected()
+
+#define BLYNK_DECLARE_WRITE(n) BLYNK_WRITE_2(n);
+BLYNK_DECLARE_WRITE(0)  BLYNK_DECLARE_WRITE(1)  BLYNK_DECLARE_WRITE(2)  BLYNK_DECLARE_WRITE(3)
+BLYNK_DECLARE_WRITE(4)  BLYNK_DECLARE_WRITE(5)  BLYNK_DECLARE_WRITE(6)  BLYNK_DECLARE_WRITE(7)
+BLYNK_DECLARE_WRITE(8)  BLYNK_DECLARE_WRITE(9)  BLYNK_DECLARE_WRITE(10) BLYNK_DECLARE_WRITE(11)
+BLYNK_DECLARE_WRITE(12) BLYNK_DECLARE_WRITE(13) BLYNK_DECLARE_WRITE(14) BLYNK_DECLARE_WRITE(15)
+BLYNK_DECLARE_WRITE(16) BLYNK_DECLARE_WRITE(17) BLYNK_DECLARE_WRITE(18) BLYNK_DECLARE_WRITE(19)
+BLYNK_DECLARE_WRITE(20) BLYNK_DECLARE_WRITE(21) BLYNK_DECLARE_WRITE(22) BLYNK_DECLARE_WRITE(23)
+BLYNK_DECLARE_WRITE(24) BLYNK_DECLARE_WRITE(25) BLYNK_DECLARE_WRITE(26) BLYNK_DECLARE_WRITE(27)
+BLYNK_DECLARE_WRITE(28) BLYNK_DECLARE_WRITE(29) BLYNK_DECLARE_WRITE(30) BLYNK_DECLARE_WRITE(31)
+#undef BLYNK_DECLARE_WRITE
+
+void BlynkOnConnected();
+void BlynkOnDisconnected();
+
+
+//##################################################################
+// ### Blynk ###
+//##################################################################
+class BlynkSim {
+public:
+    void begin(const char *auth, TinyGsm &modem, const char *apn,
+               const char *user, const char *pass,
+               const char *domain = "blynk.cloud", uint16_t port = 80);
+    void config(TinyGsm &modem, const char *auth,
+                const char *domain = "blynk.cloud", uint16_t port = 80);
+    bool connect(uint32_t timeout_ms = 18000UL);
+    void disconnect();
+    bool connected() const { return conectado_; }
+    void run();
+
+    template <typename... Args>
+    void virtualWrite(int pin, Args... valores)
+    {
+        String cuerpo = String("vw") + '\0' + String(pin);
+        agregar(cuerpo, valores...);
+        enviarComando(20, cuerpo, pin);
+    }
+
+    // Agrupa los virtualWrite siguientes (opcionalmente bajo una misma
+    // marca de tiempo en ms UTC, para subir datos históricos).
+    void beginGroup();
+    void beginGroup(uint64_t timestamp_ms);
+    void endGroup();
+
+    template <typename... Args>
+    void syncVirtual(Args... pines)
+    {
+        int lista[] = {pines...};
+        for (int pin : lista) {
+            sincronizar(pin);
+        }
+    }
+
+private:
+    void agregar(String &) {}
+    template <typename T, typename... Args>
+    void agregar(String &cuerpo, T v, Args... resto)
+    {
+        cuerpo += '\0';
+        cuerpo += formatear(v);
+        agregar(cuerpo, resto...);
+    }
+
+    template <typename T>
+    static String formatear(T v) { return String(v); }
+    static String formatear(const char *v) { return String(v); }
+    static String formatear(const String &v) { return v; }
+    // Blynk formatea los flotantes con 3 decimales
+    static String formatear(float v) { return String(v, 3); }
+    static String formatear(double v) { return String(v, 3); }
+
+    void enviarComando(uint8_t cmd, const String &cuerpo, int pin = -1);
+    void sincronizar(int pin);
+    void perderConexion();
+
+    TinyGsm *modem_ = nullptr;
+    TinyGsmClient cliente_;
+    const char *auth_ = "";
+    const char *domain_ = "";
+    uint16_t port_ = 80;
+    bool conectado_ = false;
+    bool agrupando_ = false;
+    std::string grupo_;         // Tramas pendientes del grupo abierto
+    uint16_t msgId_ = 0;
+    unsigned long ultimoEnvio_ = 0;
+    unsigned long ultimoIntento_ = 0;
+};
+
+extern BlynkSim Blynk;
+
+
+//##################################################################
+// ### BlynkTimer (SimpleTimer) ###
+//##################################################################
+class BlynkTimer {
+public:
+    typedef void (*timer_callback)();
+    typedef void (*timer_callback_p)(void *);
+
+    static const int MAX_TIMERS = 16;
+
+    int setInterval(unsigned long d, timer_callback f) { return alta(d, (void *)f, nullptr, false, -1); }
+    int setInterval(unsigned long d, timer_callback_p f, void *p) { return alta(d, (void *)f, p, true, -1); }
+    int setTimeout(unsigned long d, timer_callback f) { return alta(d, (void *)f, nullptr, false, 1); }
+    int setTimeout(unsigned long d, timer_callback_p f, void *p) { return alta(d, (void *)f, p, true, 1); }
+    int setTimer(unsigned long d, timer_callback f, unsigned n) { return alta(d, (void *)f, nullptr, false, (int)n); }
+
+    void run();
+    void deleteTimer(int id);
+    void restartTimer(int id);
+    bool changeInterval(int id, unsigned long d);
+    bool isEnabled(int id);
+    void enable(int id);
+    void disable(int id);
+    int getNumTimers() const { return usados_; }
+
+private:
+    struct Temporizador {
+        void *f = nullptr;
+        void *param = nullptr;
+        bool conParam = false;
+        unsigned long prev = 0;
+        unsigned long delay = 0;
+        int repeticiones = -1;     // -1 = siempre
+        bool activo = false;
+        bool habilitado = false;
+    };
+
+    int alta(unsigned long d, void *f, void *p, bool conParam, int n);
+
+    Temporizador t_[MAX_TIMERS];
+    int usados_ = 0;
+};
@@ -0,0 +1,22 @@
+/*
+ * ===================================================================
+ * SUSTITUTO DE SPI.h PARA EL SIMULADOR (HOST / LINUX)
+ *
+ * Ninguna plantilla usa SPI todavía; solo existe para que
+ * SPI.begin() compile.
+ * ===================================================================
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1)
+    {
+        (void)sck; (void)miso; (void)mosi; (void)ss;
+    }
+    void end() {}
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,156 @@
+/*
+ * ===================================================================
+ * SUSTITUTO DE TinyGsmClient.h (SIM7080) PARA EL SIMULADOR
+ *
+ * Igual que la librería real, habla con el módem por comandos AT a
+ * través del Stream que recibe (Serial2). El módem simulado responde
+ * con los tiempos configurados en sim::Config, así que cada llamada
+ * bloqueante (restart, gprsConnect, getGPS, ...) gasta el tiempo que
+ * gastaría en la placa.
+ *
+ * getGPS() analiza la respuesta con String, como TinyGSM.
+ * ===================================================================
+ */
+#pragma once
+
+#include "Arduino.h"
+
+#include <string>
+
+#define GSM_NL "\r\n"
+#define GF(x) x
+#define GFP(x) x
+typedef const char *GsmConstStr;
+
+static const char GSM_OK[] = "OK" GSM_NL;
+static const char GSM_ERROR[] = "ERROR" GSM_NL;
+
+enum SimStatus {
+    SIM_ERROR = 0,
+    SIM_READY = 1,
+    SIM_LOCKED = 2,
+    SIM_ANTITHEFT_LOCKED = 3,
+};
+
+class TinyGsmClient;
+
+class TinyGsmSim7080 {
+public:
+    explicit TinyGsmSim7080(Stream &s) : stream(s) {}
+
+    // --- Arranque ---
+    bool begin(const char *pin = nullptr) { return init(pin); }
+    bool init(const char *pin = nullptr);
+    bool restart(const char *pin = nullptr);
+    bool poweroff();
+    bool testAT(uint32_t timeout_ms = 10000L);
+    String getModemInfo();
+    bool simUnlock(const char *pin);
+    SimStatus getSimStatus(uint32_t timeout_ms = 10000L);
+    void maintain();
+
+    // --- Red celular ---
+    bool isNetworkConnected();
+    bool waitForNetwork(uint32_t timeout_ms = 60000L);
+    int16_t getSignalQuality();
+    bool gprsConnect(const char *apn, const char *user = nullptr, const char *pwd = nullptr);
+    bool gprsDisconnect();
+    bool isGprsConnected();
+    String getLocalIP();
+    bool getNetworkTime(int *year, int *month, int *day,
+                        int *hour, int *minute, int *second, float *timezone);
+
+    // --- GNSS ---
+    bool enableGPS();
+    bool disableGPS();
+    String getGPSraw();
+    bool getGPS(float *lat, float *lon, float *speed = 0, float *alt = 0,
+                int *vsat = 0, int *usat = 0, float *accuracy = 0,
+                int *year = 0, int *month = 0, int *day = 0,
+                int *hour = 0, int *minute = 0, int *second = 0);
+
+    // --- Acceso directo a comandos AT (público en TinyGSM) ---
+    template <typename... Args>
+    void sendAT(Args... cmd)
+    {
+        streamWrite("AT", cmd..., GSM_NL);
+        stream.flush();
+    }
+
+    int8_t waitResponse(uint32_t timeout_ms, String &data,
+                        GsmConstStr r1 = GFP(GSM_OK), GsmConstStr r2 = GFP(GSM_ERROR),
+                        GsmConstStr r3 = nullptr, GsmConstStr r4 = nullptr,
+                        GsmConstStr r5 = nullptr);
+    int8_t waitResponse(uint32_t timeout_ms,
+                        GsmConstStr r1 = GFP(GSM_OK), GsmConstStr r2 = GFP(GSM_ERROR),
+                        GsmConstStr r3 = nullptr, GsmConstStr r4 = nullptr,
+                        GsmConstStr r5 = nullptr)
+    {
+        String data;
+        return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+    }
+    int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK), GsmConstStr r2 = GFP(GSM_ERROR),
+                        GsmConstStr r3 = nullptr, GsmConstStr r4 = nullptr,
+                        GsmConstStr r5 = nullptr)
+    {
+        return waitResponse(1000L, r1, r2, r3, r4, r5);
+    }
+
+    bool streamSkipUntil(char c, uint32_t timeout_ms = 1000L);
+
+    Stream &stream;
+
+protected:
+    friend class TinyGsmClient;
+
+    void streamWrite() {}
+    template <typename T, typename... Args>
+    void streamWrite(T primero, Args... resto)
+    {
+        stream.print(primero);
+        streamWrite(resto...);
+    }
+
+    // Procesa una línea no solicitada (URC) recibida mientras se
+    // espera otra respuesta.
+    bool handleURC(const String &linea);
+
+    // Estado que el módem informa por URC
+    bool pdpActivo_ = false;
+    bool sockConectado_[4] = {false, false, false, false};
+    bool sockDatos_[4] = {false, false, false, false};  // URC +CADATAIND
+};
+
+typedef TinyGsmSim7080 TinyGsm;
+
+
+class TinyGsmClient : public Stream {
+public:
+    TinyGsmClient() : at_(nullptr), mux_(0) {}
+    explicit TinyGsmClient(TinyGsm &modem, uint8_t mux = 0) : at_(&modem), mux_(mux) {}
+
+    bool init(TinyGsm *modem, uint8_t mux = 0) { at_ = modem; mux_ = mux; return true; }
+
+    int connect(const char *host, uint16_t puerto, int timeout_s = 75);
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t n) override;
+    using Print::write;
+
+    // Como TinyGSM: si no hay nada en el búfer, pregunta al módem con
+    // AT+CARECV al llegar "+CADATAIND" o cada 500 ms.
+    int available() override;
+    int read() override;
+    int peek() override;
+
+private:
+    void recibir();
+
+    TinyGsm *at_;
+    uint8_t mux_;
+    std::string rx_;
+    unsigned long ultimaConsulta_ = 0;
+};
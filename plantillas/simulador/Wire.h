@@ -0,0 +1,53 @@
+/*
+ * ===================================================================
+ * SUSTITUTO DE Wire.h PARA EL SIMULADOR (HOST / LINUX)
+ *
+ * Mismo comportamiento que la Wire del ESP32: los bytes se acumulan
+ * en beginTransmission()/write() y la transacción ocurre en
+ * endTransmission(); requestFrom() es una transacción de lectura.
+ * Cada transacción gasta tiempo simulado según el reloj del bus.
+ * ===================================================================
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire : public Stream {
+public:
+    bool setPins(int sda, int scl) { (void)sda; (void)scl; return true; }
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frecuencia = 0);
+    bool end() { return true; }
+
+    bool setClock(uint32_t frecuencia);
+    uint32_t getClock();
+    void setTimeOut(uint16_t ms) { timeOutMs_ = ms; }
+    uint16_t getTimeOut() const { return timeOutMs_; }
+
+    void beginTransmission(uint16_t direccion);
+    void beginTransmission(int direccion) { beginTransmission((uint16_t)direccion); }
+    uint8_t endTransmission(bool sendStop = true);
+
+    size_t requestFrom(uint16_t direccion, size_t n, bool sendStop = true);
+    uint8_t requestFrom(int direccion, int n) { return (uint8_t)requestFrom((uint16_t)direccion, (size_t)n, true); }
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t n) override;
+    using Print::write;
+    size_t write(int b) { return write((uint8_t)b); }
+
+    int available() override { return (int)(rxLen_ - rxPos_); }
+    int read() override { return rxPos_ < rxLen_ ? rxBuf_[rxPos_++] : -1; }
+    int peek() override { return rxPos_ < rxLen_ ? rxBuf_[rxPos_] : -1; }
+
+private:
+    uint16_t txDireccion_ = 0;
+    uint8_t txBuf_[128];
+    size_t txLen_ = 0;
+    uint8_t rxBuf_[128];
+    size_t rxLen_ = 0;
+    size_t rxPos_ = 0;
+    uint16_t timeOutMs_ = 50;
+};
+
+extern TwoWire Wire;
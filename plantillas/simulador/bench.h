@@ -0,0 +1,113 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: HERRAMIENTAS PARA MICROBENCHMARKS
+ *
+ * Lo que comparten los bench_*.cpp que miden tiempo por operación:
+ *
+ *   - Conteo de asignaciones: reemplaza operator new, así cada caso
+ *     dice cuántas veces pidió memoria dinámica por operación.
+ *   - benchMedir(): calienta, mide BENCH_RONDAS rondas de al menos
+ *     BENCH_RONDA_MS y reporta la mediana en ns/op y la dispersión
+ *     entre rondas. Con la mediana una ronda interrumpida por el
+ *     sistema no mueve el resultado; si la dispersión pasa de ~5 %,
+ *     la máquina estaba ocupada.
+ *   - benchSumidero: que el compilador no quite el trabajo medido.
+ *
+ * Se incluye en UN solo archivo por programa (define operator new).
+ * Los tiempos son de la computadora, no del ESP32: sirven para
+ * comparar antes y después de un cambio, no como valor absoluto.
+ * ===================================================================
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_RONDAS 7
+#define BENCH_RONDA_MS 20           // Rondas más cortas miden ruido
+
+//##################################################################
+// ### CONTEO DE ASIGNACIONES ###
+//##################################################################
+static uint64_t asignaciones = 0;
+
+void *operator new(size_t n)
+{
+    asignaciones++;
+    void *p = malloc(n ? n : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+
+//##################################################################
+// ### MEDICIÓN ###
+//##################################################################
+static volatile int32_t benchSumidero = 0;
+static const char *benchFiltro = nullptr;  // Sólo los casos que lo contienen
+
+static inline void benchEncabezado()
+{
+    printf("%-40s %12s %8s %14s\n", "caso", "tiempo", "±", "memoria");
+}
+
+// Separa los grupos de casos
+static inline void benchGrupo(const char *titulo)
+{
+    if (!benchFiltro) {
+        printf("--- %s\n", titulo);
+    }
+}
+
+// Nanosegundos que tardan 'iteraciones' llamadas
+template <typename F>
+static double benchRonda(uint32_t iteraciones, F &operacion)
+{
+    auto inicio = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iteraciones; i++) {
+        operacion();
+    }
+    auto fin = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(fin - inicio).count();
+}
+
+/**
+ * Mide 'operacion' con al menos 'iteraciones' llamadas por ronda (se
+ * duplican hasta que la ronda dure BENCH_RONDA_MS; eso también sirve
+ * de calentamiento). Imprime la mediana de las rondas en ns/op, la
+ * dispersión (máx - mín entre rondas, en % de la mediana) y las
+ * asignaciones por operación. Regresa la mediana.
+ */
+template <typename F>
+static double benchMedir(const char *nombre, uint32_t iteraciones, F &&operacion)
+{
+    if (benchFiltro && !strstr(nombre, benchFiltro)) {
+        return 0;
+    }
+    iteraciones = iteraciones ? iteraciones : 1;
+    while (benchRonda(iteraciones, operacion) < BENCH_RONDA_MS * 1e6 && iteraciones < 0x40000000UL) {
+        iteraciones *= 2;
+    }
+
+    double rondas[BENCH_RONDAS];
+    uint64_t antes = asignaciones;
+    for (int r = 0; r < BENCH_RONDAS; r++) {
+        rondas[r] = benchRonda(iteraciones, operacion) / iteraciones;
+    }
+    double asig = (double)(asignaciones - antes) / ((double)iteraciones * BENCH_RONDAS);
+
+    std::sort(rondas, rondas + BENCH_RONDAS);
+    double mediana = rondas[BENCH_RONDAS / 2];
+    double dispersion = mediana > 0 ? 100.0 * (rondas[BENCH_RONDAS - 1] - rondas[0]) / mediana : 0;
+    printf("%-40s %9.1f ns/op %6.1f %% %8.2f asign/op\n", nombre, mediana, dispersion, asig);
+    return mediana;
+}
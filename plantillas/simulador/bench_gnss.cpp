@@ -0,0 +1,166 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: MICROBENCHMARK DE LECTURA GNSS
+ *
+ * Compara, en la computadora, lo que cuesta leer una respuesta a
+ * AT+CGNSINF con modem.getGPS() (String por campo, como TinyGSM)
+ * contra el analizador de XC03-GNSS.h (búfer fijo, punto fijo).
+ * También mide las frases NMEA RMC y GGA.
+ *
+ * Por cada caso imprime ns por operación y asignaciones de memoria
+ * dinámica por operación (ver bench.h). El
+ * String del simulador usa std::string, que guarda cadenas cortas
+ * sin pedir memoria; el String de Arduino pide memoria para cualquier
+ * cadena, así que en la placa getGPS() asigna todavía más veces.
+ *
+ * Los tiempos son de la computadora, no del ESP32: sirven para
+ * comparar un camino contra el otro, no como valor absoluto.
+ *
+ * Compilar (desde plantillas/):
+ *   g++ -std=c++17 -O2 -I simulador -I . -include placa_xc01.h \
+ *       simulador/bench_gnss.cpp simulador/sim_*.cpp -o build/bench_gnss
+ *
+ * Uso: ./build/bench_gnss [iteraciones] [filtro]     (defecto 200000)
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "TinyGsmClient.h"
+#include "XC03-GNSS.h"
+#include "bench.h"
+
+//##################################################################
+// ### RESPUESTAS DEL MÓDEM ###
+//##################################################################
+
+// Entrega una y otra vez la misma respuesta; lo que se escribe se tira
+class FlujoRepetido : public Stream {
+public:
+    explicit FlujoRepetido(const char *texto) : texto_(texto), largo_(strlen(texto)) {}
+
+    void reiniciar() { pos_ = 0; }
+
+    int available() override { return (int)(largo_ - pos_); }
+    int read() override { return pos_ < largo_ ? (uint8_t)texto_[pos_++] : -1; }
+    int peek() override { return pos_ < largo_ ? (uint8_t)texto_[pos_] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    const char *texto_;
+    size_t largo_;
+    size_t pos_ = 0;
+};
+
+// Mismo formato que el módem simulado (sim_modem.cpp)
+static const char RESPUESTA_FIX[] =
+    "\r\n+CGNSINF: 1,1,20251018120042.147,20.676756,-103.341690,1561.032,"
+    "33.23,47.1,1,,0.9,1.3,0.9,,12,8,,,38,,\r\n\r\nOK\r\n";
+static const char RESPUESTA_SIN_FIX[] =
+    "\r\n+CGNSINF: 1,0,,,,,,,,,,,,,,,,,,,\r\n\r\nOK\r\n";
+
+static const char LINEA_FIX[] =
+    "+CGNSINF: 1,1,20251018120042.147,20.676756,-103.341690,1561.032,"
+    "33.23,47.1,1,,0.9,1.3,0.9,,12,8,,,38,,";
+static const char FRASE_RMC[] =
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+static const char FRASE_GGA[] =
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+
+
+//##################################################################
+// ### MEDICIÓN ###
+//##################################################################
+
+// Lee la respuesta completa con xc03GnssAsk/xc03GnssPoll
+static XC03GnssReply consultaXc03(XC03GnssQuery *q, FlujoRepetido &flujo, XC03Fix *fix)
+{
+    xc03GnssAsk(q, flujo, 0);
+    flujo.reiniciar();          // Ask tira lo pendiente: la respuesta llega después
+    XC03GnssReply r;
+    do {
+        r = xc03GnssPoll(q, flujo, 0, fix);
+    } while (r == XC03_GNSS_PENDING);
+    return r;
+}
+
+static bool cerca(double a, double b, double tolerancia)
+{
+    return fabs(a - b) <= tolerancia;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 200000;
+    benchFiltro = argc > 2 ? argv[2] : nullptr;
+
+    FlujoRepetido conFix(RESPUESTA_FIX);
+    FlujoRepetido sinFix(RESPUESTA_SIN_FIX);
+    TinyGsm modemFix(conFix);
+    TinyGsm modemSinFix(sinFix);
+    static XC03GnssQuery consulta;
+
+    // --- Los dos caminos deben dar la misma posición ---
+    float lat = 0, lon = 0, vel = 0, alt = 0, hdop = 0;
+    int vsat = 0, usat = 0, anio = 0, mes = 0, dia = 0, hora = 0, minuto = 0, segundo = 0;
+    conFix.reiniciar();
+    bool okTiny = modemFix.getGPS(&lat, &lon, &vel, &alt, &vsat, &usat, &hdop,
+                                  &anio, &mes, &dia, &hora, &minuto, &segundo);
+    XC03Fix fix;
+    memset(&fix, 0, sizeof(fix));
+    bool okXc03 = consultaXc03(&consulta, conFix, &fix) == XC03_GNSS_FIX;
+
+    bool iguales = okTiny && okXc03
+        && cerca(fix.latitude / 1e6, lat, 1e-5) && cerca(fix.longitude / 1e6, lon, 1e-5)
+        && cerca(fix.altitude / 10.0, alt, 0.1) && cerca(fix.speed / 10.0, vel, 0.1)
+        && cerca(fix.hdop / 100.0, hdop, 0.01) && fix.vsat == vsat && fix.usat == usat
+        && fix.year == anio && fix.month == mes && fix.day == dia
+        && fix.hour == hora && fix.minute == minuto && fix.second == segundo;
+
+    XC03Fix nmea;
+    memset(&nmea, 0, sizeof(nmea));
+    bool okRmc = xc03ParseNMEA(FRASE_RMC, sizeof(FRASE_RMC) - 1, &nmea);
+    bool okGga = xc03ParseNMEA(FRASE_GGA, sizeof(FRASE_GGA) - 1, &nmea);
+    bool nmeaBien = okRmc && okGga
+        && nmea.latitude == 48117300 && nmea.longitude == 11516666
+        && nmea.speed == 414 && nmea.course == 844 && nmea.altitude == 5454
+        && nmea.usat == 8 && nmea.hdop == 90
+        && nmea.year == 1994 && nmea.month == 3 && nmea.day == 23
+        && nmea.hour == 12 && nmea.minute == 35 && nmea.second == 19;
+
+    printf("getGPS vs XC03-GNSS.h: %s   NMEA RMC+GGA: %s   sizeof(XC03Fix) = %u B\n\n",
+           iguales ? "misma posición" : "¡DIFERENTES!",
+           nmeaBien ? "bien" : "¡MAL!", (unsigned)sizeof(XC03Fix));
+
+    // --- Mediciones ---
+    benchEncabezado();
+
+    benchMedir("getGPS() con fix", n, [&]() {
+        conFix.reiniciar();
+        modemFix.getGPS(&lat, &lon, &vel, &alt, &vsat, &usat, &hdop,
+                        &anio, &mes, &dia, &hora, &minuto, &segundo);
+        benchSumidero += vsat;
+    });
+    benchMedir("xc03GnssAsk/Poll con fix", n, [&]() {
+        benchSumidero += consultaXc03(&consulta, conFix, &fix);
+        benchSumidero += fix.latitude;
+    });
+    benchMedir("getGPS() sin fix", n, [&]() {
+        sinFix.reiniciar();
+        benchSumidero += modemSinFix.getGPS(&lat, &lon);
+    });
+    benchMedir("xc03GnssAsk/Poll sin fix", n, [&]() {
+        benchSumidero += consultaXc03(&consulta, sinFix, &fix);
+    });
+    benchMedir("xc03ParseCGNSINF (sólo la línea)", n, [&]() {
+        benchSumidero += xc03ParseCGNSINF(LINEA_FIX, sizeof(LINEA_FIX) - 1, &fix);
+        benchSumidero += fix.longitude;
+    });
+    benchMedir("xc03ParseNMEA RMC", n, [&]() {
+        benchSumidero += xc03ParseNMEA(FRASE_RMC, sizeof(FRASE_RMC) - 1, &nmea);
+    });
+    benchMedir("xc03ParseNMEA GGA", n, [&]() {
+        benchSumidero += xc03ParseNMEA(FRASE_GGA, sizeof(FRASE_GGA) - 1, &nmea);
+    });
+
+    return iguales && nmeaBien ? 0 : 1;
+}
@@ -0,0 +1,434 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: MICROBENCHMARK DE LOS CAMINOS POR MUESTRA
+ *
+ * Mide, en la computadora, lo que se ejecuta por cada muestra o cada
+ * cambio de E/S, para tener números antes y después de optimizar:
+ *   - XN04: 6 bytes del bus -> valores crudos -> unidades
+ *     (temperature_int / 100.0f) y la ventana de estadísticas
+ *   - XN02: writeXN02() (8 bool -> un byte) y las funciones por bit
+ *   - XN01: extraer cada entrada del byte de la copia
+ *   - GNSS: +CGNSINF y NMEA con XC03-GNSS.h
+ *   - Telemetría: un resumen con XC03-Telemetria.h (armar y leer) y
+ *     un punto de trayecto con XC03-Trayecto.h
+ *   - Geocercas: una posición contra GEOCERCAS cercas con
+ *     XC03-Geocerca.h, con y sin el índice de rejilla
+ *
+ * Los módulos XN se incluyen tal cual (XN0x-*.cpp). Sólo se mide lo
+ * que no usa el bus: las lecturas salen de la copia en RAM y
+ * writeXN02() sin cambio no escribe (el tiempo simulado no avanza,
+ * así que la copia nunca se vence). Lo que cuesta el bus lo mide el
+ * simulador, no este programa.
+ *
+ * Antes de medir revisa que cada camino dé el valor esperado; si no,
+ * termina con código 1. Medición y asignaciones como en bench.h.
+ *
+ * Compilar (desde plantillas/):
+ *   g++ -std=c++17 -O2 -I simulador -I . -include placa_xc01.h \
+ *       simulador/bench_muestras.cpp simulador/sim_*.cpp -o build/bench_muestras
+ *
+ * Uso: ./build/bench_muestras [iteraciones] [filtro]     (defecto 100000)
+ *   filtro: sólo los casos cuyo nombre lo contiene (ej. XN02)
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "TinyGsmClient.h"
+#include "sim.h"
+
+#include "XN01-EntradasDigitales.cpp"
+#include "XN02-SalidasDigitales.cpp"
+#include "XN04-Sensores.cpp"
+#include "XC03-GNSS.h"
+#include "XC03-Telemetria.h"
+#include "XC03-Trayecto.h"
+#include "XC03-Geocerca.h"
+#include "bench.h"
+
+//##################################################################
+// ### DATOS DE ENTRADA ###
+//##################################################################
+
+// Registros 0x01 - 0x03 del XN04 como llegan por el bus (big endian):
+// 23.45 °C, 51.20 %, 312 lux
+static const uint8_t XN04_BYTES[6] = { 0x09, 0x29, 0x14, 0x00, 0x01, 0x38 };
+
+static const char LINEA_FIX[] =
+    "+CGNSINF: 1,1,20251018120042.147,20.676756,-103.341690,1561.032,"
+    "33.23,47.1,1,,0.9,1.3,0.9,,12,8,,,38,,";
+static const char FRASE_RMC[] =
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+static const char FRASE_GGA[] =
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+
+// Un resumen de ventana como lo sube termometro_blynk_loT.ino.c
+static const uint16_t RESUMEN[5] = { 2345, 2310, 2388, 12, 300 };
+
+// Cambia en cada vuelta para que el compilador no precalcule nada
+static volatile uint8_t variable = 0;
+
+// Geocercas: círculos y polígonos de 50 a 800 m en ~20 × 20 km de
+// ciudad, y un recorrido de ~40 km por la misma zona
+#define GEOCERCAS 250
+#define GEO_PASOS 4096
+static const int32_t GEO_LAT0 = 20673600, GEO_LON0 = -103344000;
+static const int32_t GEO_ZONA = 90000;          // ± grados × 1e6 (~10 km)
+static char geoTexto[GEOCERCAS * 160];
+static GeoPoint geoCamino[GEO_PASOS];
+static uint32_t semilla = 12345;
+
+static uint32_t azar(uint32_t n)
+{
+    semilla = semilla * 1664525UL + 1013904223UL;
+    return (semilla >> 8) % n;
+}
+
+static int geoCoord(char *out, size_t n, int32_t lat, int32_t lon)
+{
+    return snprintf(out, n, ",%.6f,%.6f", lat / 1e6, lon / 1e6);
+}
+
+// El texto de las cercas como llegaría de la nube
+static void armarCercas()
+{
+    size_t n = snprintf(geoTexto, sizeof(geoTexto), "X");
+    for (uint16_t id = 1; id <= GEOCERCAS; id++) {
+        int32_t lat = GEO_LAT0 - GEO_ZONA + (int32_t)azar(2 * GEO_ZONA);
+        int32_t lon = GEO_LON0 - GEO_ZONA + (int32_t)azar(2 * GEO_ZONA);
+        uint32_t radio = 50 + azar(750);
+        if (id % 3) {
+            n += snprintf(geoTexto + n, sizeof(geoTexto) - n, ";C,%u", id);
+            n += geoCoord(geoTexto + n, sizeof(geoTexto) - n, lat, lon);
+            n += snprintf(geoTexto + n, sizeof(geoTexto) - n, ",%u", radio);
+            continue;
+        }
+        // Estrella de 5 a 8 puntas (cóncava casi siempre)
+        uint8_t k = 5 + azar(4);
+        n += snprintf(geoTexto + n, sizeof(geoTexto) - n, ";P,%u", id);
+        for (uint8_t i = 0; i < k; i++) {
+            float r = radio * (0.4f + azar(600) / 1000.0f) / GEO_M_PER_E6;
+            float a = 2 * (float)M_PI * i / k;
+            n += geoCoord(geoTexto + n, sizeof(geoTexto) - n,
+                          lat + (int32_t)(r * cosf(a)), lon + (int32_t)(r * sinf(a)));
+        }
+    }
+    // Recorrido: ~10 m por paso con vueltas suaves; da media vuelta al
+    // salir de la zona
+    GeoPoint p = { GEO_LAT0, GEO_LON0 };
+    float rumbo = 0.5f;
+    for (uint16_t i = 0; i < GEO_PASOS; i++) {
+        rumbo += ((int32_t)azar(21) - 10) * 0.02f;
+        if (abs(p.lat - GEO_LAT0) > GEO_ZONA || abs(p.lon - GEO_LON0) > GEO_ZONA) {
+            rumbo += (float)M_PI;
+        }
+        p.lat += (int32_t)(90 * cosf(rumbo));
+        p.lon += (int32_t)(90 * sinf(rumbo));
+        geoCamino[i] = p;
+    }
+}
+
+// Resumen -> reporte binario (como drainTelemetryBinary())
+static void armarResumen(XC03TelLink *tel, uint32_t edad)
+{
+    xc03TelReport(tel, edad);
+    xc03TelCenti(tel, 2, RESUMEN[0] / 100.0f);
+    xc03TelCenti(tel, 6, RESUMEN[1] / 100.0f);
+    xc03TelCenti(tel, 7, RESUMEN[2] / 100.0f);
+    xc03TelCenti(tel, 8, RESUMEN[3] / 100.0f);
+    xc03TelInt(tel, 9, RESUMEN[4]);
+    xc03TelFrameEnd(tel);
+}
+
+
+//##################################################################
+// ### VERIFICACIÓN ###
+//##################################################################
+
+static bool verificar(XC03TelLink *tel)
+{
+    bool ok = true;
+
+    // XN04 (la copia se llenó en main() desde el módulo simulado)
+    XN04Data d;
+    ok = ok && memcmp(xn04Snap.data, XN04_BYTES, sizeof(XN04_BYTES)) == 0;
+    decodeXN04(&d);
+    ok = ok && d.temperature_int == 2345 && d.humidity_int == 5120 && d.lux == 312;
+    ok = ok && readXN04Temperature() == 23.45f;
+
+    // XN02: writeXN02() pone el bit n - 1 para la salida n
+    beginXN02Transaction();
+    writeXN02(HIGH, LOW, HIGH, LOW, LOW, LOW, LOW, HIGH);
+    ok = ok && xn02State().shadow == 0x85 && getXN02Output(3) == 1 && getXN02Output(2) == 0;
+    commitXN02Transaction();
+
+    // XN01 (la copia se llenó en main() desde el módulo simulado)
+    ok = ok && readXN01Input(1) == 1 && readXN01Input(2) == 0 && readXN01Input(8) == 1;
+
+    // GNSS
+    XC03Fix fix;
+    memset(&fix, 0, sizeof(fix));
+    ok = ok && xc03ParseCGNSINF(LINEA_FIX, sizeof(LINEA_FIX) - 1, &fix)
+         && fix.latitude == 20676756 && fix.longitude == -103341690;
+
+    // Telemetría: lo que se arma se lee igual
+    tel->len = 0;
+    armarResumen(tel, 61);
+    uint16_t pos = 0;
+    uint32_t edad = 0;
+    XC03TelFrame f;
+    XC03TelValue v;
+    ok = ok && xc03TelNextFrame(tel->buf, tel->len, &pos, &f) && xc03TelReportAge(&f, &edad) && edad == 61;
+    ok = ok && xc03TelNextValue(&f, &v) && v.pin == 2 && v.i == 2345;
+    tel->len = 0;
+
+    printf("Verificación: %s   resumen binario: ", ok ? "bien" : "¡MAL!");
+    armarResumen(tel, 61);
+    printf("%u B\n", tel->len);
+    tel->len = 0;
+    return ok;
+}
+
+// Geocercas: casos conocidos, y con índice da lo mismo que sin él
+static bool verificarCercas(GeoSet *conIndice, GeoSet *sinIndice)
+{
+    static const char CERCAS[] =
+        "C,1,20.676300,-103.342000,200\n"
+        "P,2,20.683500,-103.338000,20.683500,-103.334000,20.687000,-103.334000,"
+        "20.687000,-103.330000,20.690000,-103.330000,20.690000,-103.338000\n"
+        "P,3,20.6,-103.3\n";                     // Dos vértices: no se usa
+    GeoEvent ev[GEO_MAX_INSIDE], ev2[GEO_MAX_INSIDE];
+    bool ok = true;
+
+    geoBegin(conIndice, 0);
+    ok = ok && geoLoad(conIndice, CERCAS, sizeof(CERCAS) - 1) == 2 && conIndice->loadErrors == 1;
+    ok = ok && geoUpdate(conIndice, 20676300, -103342000, 1, ev, 4) == 1 && ev[0].fenceId == 1;
+    ok = ok && geoUpdate(conIndice, 20678300, -103342000, 2, ev, 4) == 1 && ev[0].type == GEO_EXIT;
+    ok = ok && geoUpdate(conIndice, 20688500, -103336000, 3, ev, 4) == 1 && ev[0].fenceId == 2;
+    ok = ok && geoUpdate(conIndice, 20688500, -103331000, 4, ev, 4) == 0;   // Brazo de la L
+    ok = ok && geoUpdate(conIndice, 20685000, -103331000, 5, ev, 4) == 1;   // Hueco de la L
+
+    // Eventos: lo que se empaca se lee igual
+    GeoEventBlock bloque;
+    GeoEvent leido;
+    uint16_t pos = 1;
+    uint32_t t = 0;
+    geoEventsBegin(&bloque);
+    ev[0].t = 1760788842UL;
+    geoEventsAppend(&bloque, &ev[0]);
+    ev[0].t += 75;
+    ev[0].type = GEO_ENTER;
+    geoEventsAppend(&bloque, &ev[0]);
+    ok = ok && geoEventsNext(bloque.data, bloque.len, &pos, &t, &leido) && leido.t == 1760788842UL
+         && geoEventsNext(bloque.data, bloque.len, &pos, &t, &leido) && leido.t == 1760788917UL
+         && leido.fenceId == 2 && leido.type == GEO_ENTER
+         && !geoEventsNext(bloque.data, bloque.len, &pos, &t, &leido);
+
+    // Recarga con "X" estando adentro: la misma cerca no da otra
+    // ENTRADA, y si la nueva es más chica la SALIDA llega en la
+    // siguiente posición
+    static const char RECARGA[] = "X\nC,1,20.676300,-103.342000,200\n";
+    static const char RECARGA_CHICA[] = "X\nC,1,20.676300,-103.342000,50\n";
+    ok = ok && geoUpdate(conIndice, 20677300, -103342000, 6, ev, 4) == 1 && ev[0].type == GEO_ENTER;
+    ok = ok && geoLoad(conIndice, RECARGA, sizeof(RECARGA) - 1) == 2 && conIndice->insideCount == 1;
+    ok = ok && geoUpdate(conIndice, 20677300, -103342000, 7, ev, 4) == 0;
+    ok = ok && geoLoad(conIndice, RECARGA_CHICA, sizeof(RECARGA_CHICA) - 1) == 2;
+    ok = ok && geoUpdate(conIndice, 20677300, -103342000, 8, ev, 4) == 1
+         && ev[0].fenceId == 1 && ev[0].type == GEO_EXIT;
+
+    // El recorrido contra GEOCERCAS cercas, con y sin índice. Sin
+    // índice se cargan en pedazos de 7 bytes (como llegan por TCP)
+    GeoLoader carga;
+    size_t largo = strlen(geoTexto);
+    geoBegin(conIndice, GEO_HYSTERESIS_M);
+    geoBegin(sinIndice, GEO_HYSTERESIS_M);
+    ok = ok && geoLoad(conIndice, geoTexto, largo) == GEOCERCAS + 1 && conIndice->indexed;
+    geoLoaderBegin(&carga, sinIndice);
+    for (size_t i = 0; i < largo; i += 7) {
+        geoLoaderFeed(&carga, geoTexto + i, largo - i < 7 ? largo - i : 7);
+    }
+    ok = ok && geoLoaderEnd(&carga) == GEOCERCAS + 1 && sinIndice->vertexCount == conIndice->vertexCount;
+    sinIndice->indexed = false;
+    for (uint16_t i = 0; i < GEO_PASOS && ok; i++) {
+        uint8_t a = geoUpdate(conIndice, geoCamino[i].lat, geoCamino[i].lon, i, ev, GEO_MAX_INSIDE);
+        uint8_t b = geoUpdate(sinIndice, geoCamino[i].lat, geoCamino[i].lon, i, ev2, GEO_MAX_INSIDE);
+        ok = a == b;
+        for (uint8_t k = 0; k < a && ok; k++) {
+            ok = ev[k].fenceId == ev2[k].fenceId && ev[k].type == ev2[k].type;
+        }
+    }
+    printf("Geocercas: %s   %u cercas, %u eventos en %u pasos, %.2f pruebas exactas por paso "
+           "(%.2f sin índice)\n\n", ok ? "bien" : "¡MAL!", conIndice->count, conIndice->events, GEO_PASOS,
+           (double)conIndice->exactTests / conIndice->fixes, (double)sinIndice->exactTests / sinIndice->fixes);
+    return ok;
+}
+
+
+//##################################################################
+// ### MEDICIÓN ###
+//##################################################################
+
+int main(int argc, char **argv)
+{
+    uint32_t n = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 100000;
+    benchFiltro = argc > 2 ? argv[2] : nullptr;
+
+    // Estado inicial de los módulos simulados (esto sí usa el bus)
+    Wire.begin();
+    sim::xn01FijarEntradas(0x81);
+    sim::xn04Fijar(23.45f, 51.20f, 312);
+    uint8_t entradas;
+    XN04Data xn04;
+    readXN01All(&entradas);
+    readXN04All(&xn04);
+    beginXN02();
+    writeXN02Binary(0x85);
+
+    static TinyGsm modem(Serial2);
+    static TinyGsmClient cliente(modem, 1);
+    static XC03TelLink tel;
+    xc03TelBegin(&tel, cliente, "127.0.0.1", XC03_TEL_PORT, "bench");
+
+    static GeoSet cercas, cercasSinIndice;
+    armarCercas();
+
+    bool ok = verificar(&tel);
+    ok = verificarCercas(&cercas, &cercasSinIndice) && ok;
+
+    benchEncabezado();
+
+    benchGrupo("XN04: bus -> crudo -> unidades");
+    benchMedir("XN04 decodeXN04 (ráfaga de 6 B)", n, [&]() {
+        XN04Data d;
+        xn04Snap.data[1] = variable;
+        decodeXN04(&d);
+        benchSumidero += d.temperature_int + d.humidity_int + d.lux;
+    });
+    memcpy(xn04Snap.data, XN04_BYTES, sizeof(XN04_BYTES));
+    benchMedir("XN04 temperature_int / 100.0f", n, [&]() {
+        uint16_t crudo = 2345 + variable;
+        float t = crudo / 100.0f;
+        benchSumidero += (int32_t)t;
+    });
+    benchMedir("XN04 xnScale<> temp + hum + lux", n, [&]() {
+        XN04Data d = { (uint16_t)(2345 + variable), 5120, 312 };
+        float suma = xnScale<XN04Temperature>(d.temperature_int)
+                     + xnScale<XN04Humidity>(d.humidity_int) + d.lux;
+        benchSumidero += (int32_t)suma;
+    });
+    benchMedir("XN04 readXN04Temperature() (copia)", n, [&]() {
+        benchSumidero += (int32_t)readXN04Temperature();
+    });
+    {
+        XN04Window ventana;
+        XN04Summary resumen;
+        xn04WindowBegin(&ventana, 60000UL, millis());
+        benchMedir("XN04 xn04WindowAdd (una muestra)", n, [&]() {
+            XN04Data d = { (uint16_t)(2345 + variable), 5120, 312 };
+            benchSumidero += xn04WindowAdd(&ventana, &d, millis(), &resumen);
+        });
+    }
+
+    benchGrupo("XN02: bits de salida");
+    beginXN02Transaction();
+    benchMedir("XN02 writeXN02(8 bool) (sólo empacar)", n, [&]() {
+        uint8_t b = variable;
+        writeXN02(b & 1, b & 2, b & 4, b & 8, b & 16, b & 32, b & 64, b & 128);
+        benchSumidero += xn02State().shadow;
+    });
+    commitXN02Transaction();
+    writeXN02Binary(0x85);
+    benchMedir("XN02 writeXN02(8 bool) sin cambio", n, [&]() {
+        uint8_t b = variable;
+        writeXN02(HIGH, b, HIGH, b, b, b, b, HIGH);
+        benchSumidero += xn02State().skipped;
+    });
+    benchMedir("XN02 writeXN02Output(n, v) sin cambio", n, [&]() {
+        benchSumidero += writeXN02Output(1 + (variable & 1) * 7, HIGH);
+    });
+    benchMedir("XN02 getXN02Output(1..8)", n / 8, [&]() {
+        for (uint8_t i = 1; i <= 8; i++) {
+            benchSumidero += getXN02Output(i);
+        }
+    });
+
+    benchGrupo("XN01: bits de entrada");
+    benchMedir("XN01 (entradas >> i) & 1, i = 0..7", n / 8, [&]() {
+        uint8_t e = xnDecode<XN01Inputs>(xn01Snap.data) ^ variable;
+        for (uint8_t i = 0; i < 8; i++) {
+            benchSumidero += (e >> i) & 0x01;
+        }
+    });
+    benchMedir("XN01 readXN01Input(1..8) (copia)", n / 8, [&]() {
+        for (uint8_t i = 1; i <= 8; i++) {
+            benchSumidero += readXN01Input(i);
+        }
+    });
+
+    benchGrupo("GNSS: XC03-GNSS.h");
+    XC03Fix fix;
+    memset(&fix, 0, sizeof(fix));
+    benchMedir("GNSS xc03ParseCGNSINF", n, [&]() {
+        benchSumidero += xc03ParseCGNSINF(LINEA_FIX, sizeof(LINEA_FIX) - 1, &fix);
+        benchSumidero += fix.latitude;
+    });
+    benchMedir("GNSS xc03ParseNMEA RMC", n, [&]() {
+        benchSumidero += xc03ParseNMEA(FRASE_RMC, sizeof(FRASE_RMC) - 1, &fix);
+    });
+    benchMedir("GNSS xc03ParseNMEA GGA", n, [&]() {
+        benchSumidero += xc03ParseNMEA(FRASE_GGA, sizeof(FRASE_GGA) - 1, &fix);
+    });
+
+    benchGrupo("Telemetría: XC03-Telemetria.h y XC03-Trayecto.h");
+    benchMedir("Telemetría armar resumen (5 valores)", n, [&]() {
+        tel.len = 0;
+        armarResumen(&tel, variable);
+        benchSumidero += tel.len;
+    });
+    armarResumen(&tel, 61);
+    benchMedir("Telemetría leer resumen (5 valores)", n, [&]() {
+        uint16_t pos = 0;
+        uint32_t edad;
+        XC03TelFrame f;
+        XC03TelValue v;
+        if (!xc03TelNextFrame(tel.buf, tel.len, &pos, &f) || !xc03TelReportAge(&f, &edad)) {
+            return;
+        }
+        while (xc03TelNextValue(&f, &v)) {
+            benchSumidero += v.i;
+        }
+    });
+    tel.len = 0;
+    {
+        static TrackBlock bloque;
+        TrackPoint p = { 1760788842UL, 2067676, -10334169, 332 };
+        trackBegin(&bloque);
+        benchMedir("Trayecto trackAppend (un punto)", n, [&]() {
+            if (bloque.len + TRACK_POINT_MAX > TRACK_BLOCK_SIZE) {
+                trackBegin(&bloque);
+            }
+            p.t++;
+            p.latitude += 3 + (variable & 1);
+            p.longitude -= 2;
+            benchSumidero += trackAppend(&bloque, &p);
+        });
+    }
+
+    benchGrupo("Geocercas: XC03-Geocerca.h, 250 cercas");
+    {
+        GeoEvent ev[GEO_MAX_INSIDE];
+        uint16_t paso = 0;
+        benchMedir("Geocercas geoUpdate (rejilla)", n, [&]() {
+            const GeoPoint *p = &geoCamino[paso++ % GEO_PASOS];
+            benchSumidero += geoUpdate(&cercas, p->lat, p->lon, paso, ev, GEO_MAX_INSIDE);
+        });
+        benchMedir("Geocercas geoUpdate (sin índice)", n, [&]() {
+            const GeoPoint *p = &geoCamino[paso++ % GEO_PASOS];
+            benchSumidero += geoUpdate(&cercasSinIndice, p->lat, p->lon, paso, ev, GEO_MAX_INSIDE);
+        });
+        size_t largo = strlen(geoTexto);
+        benchMedir("Geocercas geoLoad (texto de 250)", n / 1000, [&]() {
+            benchSumidero += geoLoad(&cercas, geoTexto, largo);
+        });
+    }
+
+    return ok ? 0 : 1;
+}
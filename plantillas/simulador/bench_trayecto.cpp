@@ -0,0 +1,254 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: BYTES POR POSICIÓN DE UN TRAYECTO
+ *
+ * Genera un recorrido de ciudad (rectas, vueltas de 90°, altos de
+ * semáforo, un tramo de carretera con curva suave) con el ruido de un
+ * GPS real, y compara cuánto cuesta subirlo:
+ *   - CSV como lo subía plantilla_conexion_gnss.c (una línea por fix)
+ *   - El StoredFix binario del lote (sizeof)
+ *   - XC03-Trayecto.h con todas las posiciones (diferencias + varint)
+ *   - XC03-Trayecto.h con el filtro de banda muerta
+ * Con el filtro también mide cuánto se aleja cada posición original
+ * de la línea entre los puntos que sí se guardaron (el error de
+ * reconstruir el trayecto). Verifica que el decodificador regrese
+ * exactamente lo que se codificó.
+ *
+ * Se corre con una posición por segundo (localizador) y una cada 5 s
+ * (lote del árbitro). Los tiempos son de la computadora.
+ *
+ * Compilar (desde plantillas/):
+ *   g++ -std=c++17 -O2 -I simulador -I . -include placa_xc01.h \
+ *       simulador/bench_trayecto.cpp simulador/sim_*.cpp -o build/bench_trayecto
+ *
+ * Uso: ./build/bench_trayecto [segundos]     (defecto 3600)
+ * ===================================================================
+ */
+#include "Arduino.h"
+
+#define TRACK_BLOCK_SIZE 60000      // Un trayecto completo en un bloque
+#include "XC03-Trayecto.h"
+
+#include <chrono>
+#include <vector>
+
+//##################################################################
+// ### RECORRIDO SIMULADO ###
+//##################################################################
+
+static const double LAT0 = 20.673600;   // Guadalajara
+static const double LON0 = -103.344000;
+static const double M_POR_GRADO = 111319.5;
+
+static uint32_t semilla = 12345;
+
+static double azar()                    // 0..1
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return ((semilla >> 8) & 0xFFFF) / 65535.0;
+}
+
+static double ruido(double sigma)       // ~normal (suma de 4 uniformes)
+{
+    return (azar() + azar() + azar() + azar() - 2.0) * sigma * 1.7;
+}
+
+/**
+ * Un fix por segundo durante 'segundos'. Se maneja por tramos: recta
+ * hacia una velocidad objetivo, luego vuelta de 90° o alto; cada 10
+ * minutos, 3 minutos de carretera con una curva suave.
+ */
+static std::vector<XC03Fix> recorrido(uint32_t segundos)
+{
+    std::vector<XC03Fix> fixes;
+    double x = 0, y = 0, rumbo = 45, vel = 0;   // m, m, grados, m/s
+    double objetivo = 0, giro = 0;              // m/s, grados/s
+    int32_t tramo = 0;                          // Segundos que le quedan
+
+    for (uint32_t s = 0; s < segundos; s++) {
+        bool carretera = s % 600 >= 420;
+        if (tramo <= 0) {
+            giro = 0;
+            if (carretera) {
+                objetivo = 90 / 3.6;
+                giro = 0.3;
+                tramo = 30;
+            } else if (vel > 3 && azar() < 0.3) {
+                objetivo = 0;               // Alto
+                tramo = 20 + (int32_t)(azar() * 40);
+            } else if (vel > 3 && azar() < 0.5) {
+                objetivo = 15 / 3.6;        // Vuelta
+                giro = azar() < 0.5 ? 15 : -15;
+                tramo = 6;
+            } else {
+                objetivo = (40 + azar() * 20) / 3.6;
+                tramo = 30 + (int32_t)(azar() * 90);
+            }
+        }
+        tramo--;
+
+        // Acelera o frena a lo más 2 m/s²
+        double dv = objetivo - vel;
+        vel += dv > 2 ? 2 : (dv < -2 ? -2 : dv);
+        if (vel > 1) {
+            rumbo = fmod(rumbo + giro + 360.0, 360.0);
+        }
+        x += vel * sin(rumbo * M_PI / 180.0);
+        y += vel * cos(rumbo * M_PI / 180.0);
+
+        // Lo que reporta el GPS: ~2 m de ruido; parado, el rumbo es basura
+        double lat = LAT0 + (y + ruido(2.0)) / M_POR_GRADO;
+        double lon = LON0 + (x + ruido(2.0)) / (M_POR_GRADO * cos(LAT0 * M_PI / 180.0));
+        double rumboGps = vel > 1 ? fmod(rumbo + ruido(2.0) + 360.0, 360.0) : azar() * 360.0;
+        double velGps = fmax(0.0, vel * 3.6 + ruido(0.5));
+
+        XC03Fix f;
+        memset(&f, 0, sizeof(f));
+        f.latitude = (int32_t)lround(lat * 1e6);
+        f.longitude = (int32_t)lround(lon * 1e6);
+        f.speed = (uint16_t)lround(velGps * 10);
+        f.course = (uint16_t)lround(rumboGps * 10) % 3600;
+        uint32_t t = 12 * 3600 + s;
+        f.year = 2025;
+        f.month = 10;
+        f.day = 18 + t / 86400;
+        f.hour = t / 3600 % 24;
+        f.minute = t / 60 % 60;
+        f.second = t % 60;
+        f.valid = 1;
+        fixes.push_back(f);
+    }
+    return fixes;
+}
+
+
+//##################################################################
+// ### MEDICIÓN ###
+//##################################################################
+
+static size_t bytesCsv(const XC03Fix &f)
+{
+    char linea[64];
+    return (size_t)snprintf(linea, sizeof(linea), "%04u-%02u-%02uT%02u:%02u:%02uZ,%.6f,%.6f,%.1f\n",
+                            f.year, f.month, f.day, f.hour, f.minute, f.second,
+                            f.latitude / 1e6, f.longitude / 1e6, f.speed / 10.0);
+}
+
+// Distancia en metros de p al segmento a-b (todo en grados × 1e5)
+static double distanciaSegmento(const TrackPoint &p, const TrackPoint &a, const TrackPoint &b)
+{
+    double k = cos(LAT0 * M_PI / 180.0) * M_POR_GRADO / 1e5;
+    double px = (p.longitude - a.longitude) * k, py = (p.latitude - a.latitude) * M_POR_GRADO / 1e5;
+    double bx = (b.longitude - a.longitude) * k, by = (b.latitude - a.latitude) * M_POR_GRADO / 1e5;
+    double l2 = bx * bx + by * by;
+    double u = l2 > 0 ? fmin(1.0, fmax(0.0, (px * bx + py * by) / l2)) : 0.0;
+    return hypot(px - u * bx, py - u * by);
+}
+
+static TrackBlock bloque;
+static volatile int32_t sumidero = 0;
+
+/**
+ * Codifica las posiciones (cada 'paso' s), con o sin filtro, y las
+ * decodifica. Regresa false si lo decodificado no es lo codificado.
+ */
+static bool caso(const std::vector<XC03Fix> &todos, uint32_t paso, bool filtrar)
+{
+    std::vector<XC03Fix> fixes;
+    for (size_t i = 0; i < todos.size(); i += paso) {
+        fixes.push_back(todos[i]);
+    }
+
+    TrackFilter filtro;
+    trackFilterBegin(&filtro, 10, 15, 5, 60);
+    std::vector<TrackPoint> guardados;
+    std::vector<size_t> indice;         // Posición original de cada guardado
+    size_t csv = 0;
+
+    auto inicio = std::chrono::steady_clock::now();
+    trackBegin(&bloque);
+    for (size_t i = 0; i < fixes.size(); i++) {
+        TrackPoint p;
+        trackPointFromFix(&fixes[i], &p);
+        // Al cerrar el trayecto se guarda la última posición aunque el filtro no la pida
+        bool ultimo = i + 1 == fixes.size();
+        if (filtrar && !trackFilterKeep(&filtro, &fixes[i], p.t) && !ultimo) {
+            continue;
+        }
+        if (!trackAppend(&bloque, &p)) {
+            printf("¡El bloque se llenó!\n");
+            return false;
+        }
+        guardados.push_back(p);
+        indice.push_back(i);
+    }
+    auto fin = std::chrono::steady_clock::now();
+    double nsCodificar = std::chrono::duration<double, std::nano>(fin - inicio).count() / fixes.size();
+
+    // --- Decodificar y comparar ---
+    TrackReader lector;
+    TrackPoint p;
+    size_t n = 0;
+    bool iguales = trackReaderBegin(&lector, bloque.data, bloque.len);
+    inicio = std::chrono::steady_clock::now();
+    while (iguales && trackNext(&lector, &p)) {
+        iguales = n < guardados.size() && p.t == guardados[n].t
+            && p.latitude == guardados[n].latitude && p.longitude == guardados[n].longitude
+            && p.speed == guardados[n].speed;
+        sumidero += p.latitude;
+        n++;
+    }
+    fin = std::chrono::steady_clock::now();
+    double nsDecodificar = std::chrono::duration<double, std::nano>(fin - inicio).count() / (n ? n : 1);
+    iguales = iguales && n == guardados.size();
+
+    // --- Error contra la línea entre puntos guardados ---
+    double maxErr = 0, sumaErr = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < fixes.size(); i++) {
+        while (k + 1 < indice.size() && indice[k + 1] <= i) {
+            k++;
+        }
+        TrackPoint original;
+        trackPointFromFix(&fixes[i], &original);
+        const TrackPoint &b = guardados[k + 1 < guardados.size() ? k + 1 : k];
+        double e = distanciaSegmento(original, guardados[k], b);
+        maxErr = fmax(maxErr, e);
+        sumaErr += e;
+        csv += bytesCsv(fixes[i]);
+    }
+
+    char nombre[48];
+    snprintf(nombre, sizeof(nombre), "%s, cada %u s", filtrar ? "banda muerta + varint" : "varint", paso);
+    printf("%-34s %6zu %6zu %8u %7.2f %6.1f%% %6.1f %5.1f %6.0f %6.0f %s\n",
+           nombre, fixes.size(), guardados.size(), bloque.len,
+           (double)bloque.len / fixes.size(), 100.0 * bloque.len / csv,
+           maxErr, sumaErr / fixes.size(), nsCodificar, nsDecodificar,
+           iguales ? "" : "¡DECODIFICACIÓN MAL!");
+
+    if (!filtrar) {
+        printf("%-34s %6zu %6zu %8zu %7.2f %6.1f%%\n", "  (CSV del árbitro)",
+               fixes.size(), fixes.size(), csv, (double)csv / fixes.size(), 100.0);
+        printf("%-34s %6zu %6zu %8zu %7.2f %6.1f%%\n", "  (StoredFix binario)",
+               fixes.size(), fixes.size(), fixes.size() * 20, 20.0, 100.0 * fixes.size() * 20 / csv);
+    }
+    return iguales;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t segundos = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 3600;
+    std::vector<XC03Fix> fixes = recorrido(segundos);
+    bool ok = true;
+
+    printf("Recorrido simulado: %u s (ciudad con altos y vueltas + carretera)\n\n", segundos);
+    printf("%-34s %6s %6s %8s %7s %7s %6s %5s %6s %6s\n", "formato", "fixes", "puntos",
+           "bytes", "B/fix", "vs CSV", "errMax", "prom", "ns/cod", "ns/dec");
+    for (uint32_t paso : { 1u, 5u }) {
+        ok = caso(fixes, paso, false) && ok;
+        ok = caso(fixes, paso, true) && ok;
+        printf("\n");
+    }
+    printf("errMax/prom: metros de cada fix original a la línea entre puntos guardados\n");
+    return ok ? 0 : 1;
+}
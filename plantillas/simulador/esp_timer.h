@@ -0,0 +1,34 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: esp_timer (SUBCONJUNTO)
+ *
+ * Temporizadores de una vez del ESP-IDF. En la placa el callback corre
+ * en la tarea de esp_timer en cuanto vence el plazo, aunque loop() esté
+ * ocupado; aquí corre en el instante simulado del vencimiento (como
+ * las ISR de attachInterrupt()).
+ * ===================================================================
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    int dispatch_method;        // Se ignora (siempre "tarea")
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
@@ -0,0 +1,261 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: PROGRAMA PRINCIPAL
+ *
+ * Ejecuta setup() una vez y luego loop() hasta agotar la duración
+ * simulada. Por cada vuelta de loop() mide el tiempo simulado, las
+ * transacciones y bytes I2C, los comandos AT y los mensajes Blynk, y
+ * al final imprime un resumen en stderr (el monitor serie va a stdout).
+ *
+ * Uso: ./plantilla_sim [opciones]
+ *   --duracion MS          Tiempo simulado total (defecto 120000)
+ *   --vueltas N            Máximo de vueltas de loop()
+ *   --silencio             No imprimir el monitor serie
+ *   --traza-at             Imprimir los comandos AT y respuestas
+ *   --traza-broker         Imprimir cada reporte binario que recibe el broker
+ *                          (y cada lote del servidor de rastreo)
+ *   --csv ARCHIVO          Una fila por vuelta de loop()
+ *   --modem ESTADO         apagado | encendido | registrado | conectado
+ *   --arranque MS          PWRKEY -> módem responde
+ *   --registro MS          Tiempo de registro en la red
+ *   --attach MS            Tiempo de activación del PDP
+ *   --ttff MS              Primer fix GNSS en frío
+ *   --i2c-hz HZ            Reloj inicial del bus I2C
+ *   --i2c-max T_MS:DIR=HZ  Reloj máximo del módulo DIR desde T_MS
+ *   --sin-psram            Simula una placa sin PSRAM
+ *   --xn04 T,H,LUX         Fija las lecturas del XN04
+ *   --xn01 T_MS:MASCARA    Cambia las entradas del XN01 en T_MS
+ *   --pin T_MS:PIN=NIVEL   Nivel externo en un GPIO (botón, INT, ...)
+ *   --caida T_MS:DUR_MS    El servidor deja de responder DUR_MS
+ *   --app T_MS:VN=VALOR    Escritura desde la app de Blynk
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "sim.h"
+
+#include <string>
+
+void setup();
+void loop();
+
+struct Muestra {
+    uint64_t us;
+    sim::Contadores c;
+};
+
+static Muestra tomar()
+{
+    return { sim::ahoraUs(), sim::contadores };
+}
+
+static void imprimirDiferencia(const char *titulo, const Muestra &a, const Muestra &b)
+{
+    fprintf(stderr,
+            "[sim] %-8s t=%.3f ms  i2c=%llu trans/%llu B/%.3f ms bus  "
+            "at=%llu  tcp=%llu env/%llu B  blynk=%llu msj/%llu B  modos=%llu  isr=%llu  "
+            "tareas=%.3f ms\n",
+            titulo, (b.us - a.us) / 1000.0,
+            (unsigned long long)(b.c.i2cTransacciones - a.c.i2cTransacciones),
+            (unsigned long long)(b.c.i2cBytes - a.c.i2cBytes),
+            (b.c.i2cBusUs - a.c.i2cBusUs) / 1000.0,
+            (unsigned long long)(b.c.atComandos - a.c.atComandos),
+            (unsigned long long)(b.c.tcpEnvios - a.c.tcpEnvios),
+            (unsigned long long)(b.c.tcpBytes - a.c.tcpBytes),
+            (unsigned long long)(b.c.blynkMensajes - a.c.blynkMensajes),
+            (unsigned long long)(b.c.blynkBytes - a.c.blynkBytes),
+            (unsigned long long)(b.c.cambiosModo - a.c.cambiosModo),
+            (unsigned long long)(b.c.interrupciones - a.c.interrupciones),
+            (b.c.tareasUs - a.c.tareasUs) / 1000.0);
+}
+
+static bool separar(const char *arg, uint64_t &t_ms, std::string &resto)
+{
+    const char *dos_puntos = strchr(arg, ':');
+    if (!dos_puntos) {
+        return false;
+    }
+    t_ms = strtoull(arg, nullptr, 10);
+    resto = dos_puntos + 1;
+    return true;
+}
+
+static void uso(const char *programa)
+{
+    fprintf(stderr, "Uso: %s [--duracion MS] [--vueltas N] [--silencio] [--traza-at] [--traza-broker] [--csv ARCHIVO]\n"
+                    "       [--modem apagado|encendido|registrado|conectado]\n"
+                    "       [--arranque MS] [--registro MS] [--attach MS] [--ttff MS]\n"
+                    "       [--i2c-hz HZ] [--i2c-max T_MS:DIR=HZ] [--sin-psram] [--xn04 T,H,LUX] [--xn01 T_MS:MASCARA]\n"
+                    "       [--pin T_MS:PIN=NIVEL] [--caida T_MS:DUR_MS] [--app T_MS:VN=VALOR]\n", programa);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t duracion_ms = 120000;
+    uint64_t max_vueltas = 0;
+    FILE *csv = nullptr;
+    bool trazaBroker = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string op = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        uint64_t t_ms;
+        std::string resto;
+
+        if (op == "--silencio") {
+            sim::config.monitorSilencioso = true;
+            continue;
+        }
+        if (op == "--traza-at") {
+            sim::config.trazaAt = true;
+            continue;
+        }
+        if (op == "--traza-broker") {
+            trazaBroker = true;
+            continue;
+        }
+        if (op == "--sin-psram") {
+            sim::config.psram = false;
+            continue;
+        }
+        if (!v) {
+            uso(argv[0]);
+            return 2;
+        }
+        i++;
+        if (op == "--duracion") {
+            duracion_ms = strtoull(v, nullptr, 10);
+        } else if (op == "--vueltas") {
+            max_vueltas = strtoull(v, nullptr, 10);
+        } else if (op == "--csv") {
+            csv = fopen(v, "w");
+        } else if (op == "--modem") {
+            std::string e = v;
+            sim::config.modemEncendido = e != "apagado";
+            sim::config.modemRegistrado = e == "registrado" || e == "conectado";
+            sim::config.modemPdpActivo = e == "conectado";
+        } else if (op == "--arranque") {
+            sim::config.modemArranqueMs = (uint32_t)atoi(v);
+        } else if (op == "--registro") {
+            sim::config.modemRegistroMs = (uint32_t)atoi(v);
+        } else if (op == "--attach") {
+            sim::config.modemAttachMs = (uint32_t)atoi(v);
+        } else if (op == "--ttff") {
+            sim::config.gnssTtffFrioMs = (uint32_t)atoi(v);
+        } else if (op == "--i2c-hz") {
+            sim::config.i2cRelojHz = (uint32_t)atoi(v);
+        } else if (op == "--xn04") {
+            float t = 0, h = 0;
+            unsigned lux = 0;
+            if (sscanf(v, "%f,%f,%u", &t, &h, &lux) != 3) {
+                uso(argv[0]);
+                return 2;
+            }
+            sim::xn04Fijar(t, h, (uint16_t)lux);
+        } else if (op == "--xn01" && separar(v, t_ms, resto)) {
+            uint8_t mascara = (uint8_t)strtoul(resto.c_str(), nullptr, 0);
+            sim::programar(t_ms, [mascara]() { sim::xn01FijarEntradas(mascara); });
+        } else if (op == "--pin" && separar(v, t_ms, resto) && resto.find('=') != std::string::npos) {
+            uint8_t pin = (uint8_t)atoi(resto.c_str());
+            uint8_t nivel = (uint8_t)atoi(resto.c_str() + resto.find('=') + 1);
+            sim::programar(t_ms, [pin, nivel]() { sim::gpioExterno(pin, nivel); });
+        } else if (op == "--i2c-max" && separar(v, t_ms, resto) && resto.find('=') != std::string::npos) {
+            uint8_t dir = (uint8_t)atoi(resto.c_str());
+            uint32_t hz = (uint32_t)strtoul(resto.c_str() + resto.find('=') + 1, nullptr, 10);
+            if (t_ms == 0) {
+                sim::i2cRelojMaximo(dir, hz);   // Antes de setup()
+            } else {
+                sim::programar(t_ms, [dir, hz]() { sim::i2cRelojMaximo(dir, hz); });
+            }
+        } else if (op == "--caida" && separar(v, t_ms, resto)) {
+            uint32_t dur = (uint32_t)strtoul(resto.c_str(), nullptr, 10);
+            sim::programar(t_ms, [dur]() { sim::modemCaidaTcp(dur); });
+        } else if (op == "--app" && separar(v, t_ms, resto) && resto.find('=') != std::string::npos) {
+            uint8_t pin = (uint8_t)atoi(resto.c_str() + (resto[0] == 'V' || resto[0] == 'v'));
+            std::string valor = resto.substr(resto.find('=') + 1);
+            sim::programar(t_ms, [pin, valor]() { sim::blynkAppEscribe(pin, valor.c_str()); });
+        } else {
+            uso(argv[0]);
+            return 2;
+        }
+    }
+
+    sim::fijarLimiteUs(duracion_ms * 1000ULL);
+    sim::brokerIniciar(trazaBroker);
+    sim::rastreoIniciar(trazaBroker);
+    if (csv) {
+        fprintf(csv, "vuelta,inicio_us,duracion_us,i2c_trans,i2c_bytes,i2c_bus_us,"
+                     "at_cmds,tcp_envios,blynk_msj\n");
+    }
+
+    Muestra inicio = tomar();
+    Muestra fin_setup = inicio;
+    Muestra fin = inicio;
+    uint64_t vueltas = 0;
+    uint64_t max_us = 0, max_vuelta = 0;
+    uint64_t max_i2c = 0;
+
+    try {
+        setup();
+        fin_setup = tomar();
+
+        while (!max_vueltas || vueltas < max_vueltas) {
+            Muestra a = tomar();
+            loop();
+            sim::avanzarUs(sim::config.loopUs);
+            Muestra b = tomar();
+
+            uint64_t dur = b.us - a.us;
+            uint64_t i2c = b.c.i2cTransacciones - a.c.i2cTransacciones;
+            if (dur > max_us) {
+                max_us = dur;
+                max_vuelta = vueltas;
+            }
+            if (i2c > max_i2c) {
+                max_i2c = i2c;
+            }
+            if (csv) {
+                fprintf(csv, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+                        (unsigned long long)vueltas, (unsigned long long)a.us,
+                        (unsigned long long)dur, (unsigned long long)i2c,
+                        (unsigned long long)(b.c.i2cBytes - a.c.i2cBytes),
+                        (unsigned long long)(b.c.i2cBusUs - a.c.i2cBusUs),
+                        (unsigned long long)(b.c.atComandos - a.c.atComandos),
+                        (unsigned long long)(b.c.tcpEnvios - a.c.tcpEnvios),
+                        (unsigned long long)(b.c.blynkMensajes - a.c.blynkMensajes));
+            }
+            vueltas++;
+        }
+    } catch (const sim::FinSimulacion &) {
+        // Se acabó el tiempo simulado (también dentro de setup())
+    }
+    fin = tomar();
+    if (fin_setup.us == inicio.us && vueltas == 0) {
+        fin_setup = fin;
+    }
+    fflush(stdout);
+    if (csv) {
+        fclose(csv);
+    }
+
+    fprintf(stderr, "\n[sim] ============================ RESUMEN ============================\n");
+    imprimirDiferencia("setup()", inicio, fin_setup);
+    imprimirDiferencia("loop()", fin_setup, fin);
+    fprintf(stderr, "[sim] vueltas de loop(): %llu\n", (unsigned long long)vueltas);
+    if (vueltas) {
+        double n = (double)vueltas;
+        fprintf(stderr,
+                "[sim] por vuelta: %.1f us prom, %.3f ms max (vuelta %llu), "
+                "%.4f trans I2C prom, %llu max, %.2f B I2C prom\n",
+                (fin.us - fin_setup.us) / n, max_us / 1000.0,
+                (unsigned long long)max_vuelta,
+                (fin.c.i2cTransacciones - fin_setup.c.i2cTransacciones) / n,
+                (unsigned long long)max_i2c,
+                (fin.c.i2cBytes - fin_setup.c.i2cBytes) / n);
+    }
+    fprintf(stderr, "[sim] UART módem: %llu B tx, %llu B rx; NACK I2C: %llu\n",
+            (unsigned long long)fin.c.uartBytesTx, (unsigned long long)fin.c.uartBytesRx,
+            (unsigned long long)fin.c.i2cNack);
+    sim::brokerResumen();
+    sim::rastreoResumen();
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * ===================================================================
+ * MAPA DE PINES DEL XC01 PARA LOS FRAGMENTOS DE MÓDULO
+ *
+ * XN01-EntradasDigitales.cpp, XN04-Sensores.cpp, XN11-Relevadores.cpp,
+ * etc. son fragmentos que se copian dentro de una plantilla y no traen
+ * sus propios #include ni #define. El simulador los compila con
+ * "-include placa_xc01.h". Los valores son idénticos a los de
+ * setup.cpp, así que redefinirlos en una plantilla completa no choca.
+ * ===================================================================
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define MIKROBUS_AN 4
+#define MIKROBUS_RST 15
+#define MIKROBUS_CS 6
+#define MIKROBUS_SCK 8
+#define MIKROBUS_MISO 18
+#define MIKROBUS_MOSI 17
+#define MIKROBUS_PWM 5
+#define MIKROBUS_INT 7
+#define MIKROBUS_RX 9
+#define MIKROBUS_TX 10
+#define MIKROBUS_SCL 13
+#define MIKROBUS_SDA 12
+
+#define BOARD_LED 16
+#define BOARD_BUTTON 0
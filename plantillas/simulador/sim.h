@@ -0,0 +1,225 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01 (HOST / LINUX)
+ *
+ * DESCRIPCIÓN:
+ * API interna del simulador. Las plantillas NO incluyen este archivo;
+ * solo lo usan los sustitutos de Arduino.h, Wire.h, TinyGsmClient.h y
+ * BlynkSimpleTinyGSM.h, y el programa principal (main_sim.cpp).
+ *
+ * Todo el tiempo es SIMULADO: millis() no avanza solo, avanza cuando
+ * el código "gasta" tiempo (delay(), una transacción I2C, esperar la
+ * respuesta del módem, etc.). Así cada ejecución es repetible.
+ * ===================================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+//##################################################################
+// ### RELOJ SIMULADO ###
+//##################################################################
+
+// Se lanza cuando el reloj llega al límite de la simulación.
+struct FinSimulacion {};
+
+uint64_t ahoraUs();
+void avanzarUs(uint64_t us);
+void avanzarHastaUs(uint64_t t_us);
+
+// Espera pasiva: avanza hasta limiteUs, o antes si ocurre algo que el
+// código podría estar esperando (un evento programado o un byte del
+// módem). Quien espera vuelve a revisar su condición y llama de nuevo.
+void esperarHastaUs(uint64_t limiteUs);
+
+// Llamado por millis()/micros(): si el código consulta el reloj miles
+// de veces sin gastar tiempo (espera activa vacía) avanza 1 us para
+// que la simulación no se quede colgada.
+void consultaReloj();
+
+// Programa una acción para el instante t_ms (eventos de la línea de
+// comandos: botón, cambios del XN01, escrituras desde la app, ...).
+void programar(uint64_t t_ms, std::function<void()> accion);
+void programarUs(uint64_t t_us, std::function<void()> accion);
+
+// Límite de la simulación (0 = sin límite).
+void fijarLimiteUs(uint64_t t_us);
+
+// Mientras corre una tarea FreeRTOS (otro núcleo) el tiempo que gasta
+// avanza 'reloj' y no el de loop(). nullptr regresa al reloj principal.
+void usarRelojTarea(uint64_t *reloj);
+
+
+//##################################################################
+// ### CONFIGURACIÓN (COSTOS DE TIEMPO) ###
+//##################################################################
+struct Config {
+    // --- Bus I2C ---
+    uint32_t i2cRelojHz = 100000;         // Reloj por defecto de Wire
+    uint32_t i2cOverheadUs = 60;          // Driver + START/STOP por transacción
+
+    // --- loop() ---
+    uint32_t loopUs = 20;                 // Costo de una vuelta vacía de loop()
+
+    // --- Módem XC03 (SIM7080G) ---
+    uint32_t uartBaudios = 115200;
+    uint32_t modemArranqueMs = 5000;      // PWRKEY -> responde a "AT"
+    uint32_t modemLatenciaAtMs = 10;      // Procesamiento de un comando AT
+    uint32_t modemRegistroMs = 8000;      // Encendido -> registrado en LTE-M
+    uint32_t modemAttachMs = 2500;        // AT+CNACT=0,1 -> PDP activo
+    uint32_t gnssTtffFrioMs = 35000;      // Primer fix en arranque en frío
+    uint32_t gnssTtffTibioMs = 4000;      // Fix al re-encender el GNSS
+    uint32_t tcpAbrirMs = 800;            // AT+CAOPEN
+    uint32_t tcpEnvioMs = 120;            // AT+CASEND hasta el OK
+    uint32_t tcpRespuestaMs = 300;        // OK del envío -> llega la respuesta
+
+    // --- Estado inicial del módem ---
+    bool modemEncendido = false;          // true: ya estaba prendido
+    bool modemRegistrado = false;         // true: ya registrado en la red
+    bool modemPdpActivo = false;          // true: contexto PDP ya activo
+
+    uint8_t pinPwrKey = 7;                // PIN_MODEM_PK (MIKROBUS_INT)
+    bool psram = true;                    // La placa tiene PSRAM
+    uint8_t pinXn01Int = 7;               // INT del XN01 (MIKROBUS_INT)
+
+    bool monitorSilencioso = false;       // No imprimir Serial en stdout
+    bool trazaAt = false;                 // Imprimir el tráfico AT en stderr
+};
+
+extern Config config;
+
+
+//##################################################################
+// ### CONTADORES ###
+//##################################################################
+struct Contadores {
+    uint64_t i2cTransacciones = 0;   // Cada START ... STOP
+    uint64_t i2cBytes = 0;           // Dirección + datos
+    uint64_t i2cBusUs = 0;           // Tiempo ocupando el bus
+    uint64_t i2cNack = 0;            // Dispositivo ausente
+
+    uint64_t atComandos = 0;         // Comandos enviados al módem
+    uint64_t uartBytesTx = 0;        // XC01 -> XC03
+    uint64_t uartBytesRx = 0;        // XC03 -> XC01
+
+    uint64_t tcpEnvios = 0;          // AT+CASEND (paquetes al aire)
+    uint64_t tcpBytes = 0;           // Bytes de aplicación enviados
+
+    uint64_t blynkMensajes = 0;      // Mensajes del protocolo Blynk
+    uint64_t blynkBytes = 0;         // Incluye el encabezado de 5 bytes
+
+    uint64_t cambiosModo = 0;        // Encendidos/apagados GNSS y PDP
+
+    uint64_t interrupciones = 0;     // ISR ejecutadas
+
+    uint64_t tareasUs = 0;           // Tiempo ocupado en tareas FreeRTOS
+};
+
+extern Contadores contadores;
+
+
+//##################################################################
+// ### GPIO ###
+//##################################################################
+void gpioModo(uint8_t pin, uint8_t modo);
+void gpioEscribir(uint8_t pin, uint8_t nivel);
+int gpioLeer(uint8_t pin);
+
+// Nivel impuesto desde "afuera" (botón, línea INT de un módulo).
+void gpioExterno(uint8_t pin, uint8_t nivel);
+void gpioSoltar(uint8_t pin);           // Quita el nivel externo
+void gpioInterrupcion(uint8_t pin, void (*isr)(void), int modo);
+
+
+//##################################################################
+// ### BUS I2C Y MÓDULOS XN ###
+//##################################################################
+
+// Transacción de escritura completa (START, dirección, datos, STOP).
+// Regresa false si nadie respondió a la dirección (NACK).
+bool i2cEscribir(uint8_t direccion, const uint8_t *datos, size_t n);
+
+// Transacción de lectura. Regresa los bytes entregados (0 = NACK).
+size_t i2cLeer(uint8_t direccion, uint8_t *datos, size_t n);
+
+// --- Estado de los módulos simulados ---
+void xn01FijarEntradas(uint8_t entradas);
+uint8_t xn01Entradas();
+uint8_t xn02Salidas();
+uint8_t xn11Rele(uint8_t rele);        // 1 o 2
+void xn04Fijar(float temperatura, float humedad, uint16_t lux);
+
+// Reloj I2C más alto al que responde el módulo (ruido, cable largo...)
+void i2cRelojMaximo(uint8_t direccion, uint32_t hz);
+
+
+//##################################################################
+// ### MÓDEM XC03 ###
+//##################################################################
+
+// Bytes del XC01 hacia el módem (Serial2.write).
+void modemRecibir(uint8_t b);
+
+// Bytes del módem ya "llegados" al XC01 en el instante actual.
+int modemDisponibles();
+int modemLeer();
+int modemVer();
+
+// Instante (us) del próximo byte pendiente del módem (0 = ninguno).
+uint64_t modemProximoByteUs();
+
+// Flanco en el pin PWRKEY.
+void modemPwrKey(uint8_t nivel);
+
+bool modemGnssEncendido();
+bool modemPdpActivo();
+
+// Corte del servidor: cierra los sockets abiertos y AT+CAOPEN falla
+// durante duracionMs (el PDP sigue activo).
+void modemCaidaTcp(uint32_t duracionMs);
+
+// Servidor remoto simulado: recibe lo que el XC01 envía por TCP y
+// regresa lo que contesta ("" = nada). Puede haber varios; cada uno
+// revisa el host y el puerto. La respuesta llega tcpRespuestaMs
+// después con el URC "+CADATAIND" y se lee con AT+CARECV.
+typedef std::function<std::string(const char *host, uint16_t puerto,
+                                  const uint8_t *datos, size_t n)> ReceptorTcp;
+void agregarReceptorTcp(ReceptorTcp receptor);
+
+// Fecha/hora UTC simulada (segundos Unix). El reloj arranca el
+// 18/10/2025 12:00:00 UTC.
+uint32_t epochUtc();
+
+
+// Receptor de XC03-Telemetria.h en el puerto XC03_TEL_PORT
+// (sim_broker.cpp). 'traza': imprimir cada reporte en stderr.
+void brokerIniciar(bool traza);
+void brokerResumen();
+
+// Servidor de rastreo de plantilla_conexion_gnss.c en SIM_RASTREO_HOST
+// (sim_rastreo.cpp): cuenta posiciones y eventos de geocercas, contesta
+// "OK" y la primera vez manda las cercas de ejemplo.
+#define SIM_RASTREO_HOST "tracker.example.com"
+void rastreoIniciar(bool traza);
+void rastreoResumen();
+
+
+//##################################################################
+// ### BLYNK.CLOUD ###
+//##################################################################
+
+// Escritura desde la app: se entrega a BLYNK_WRITE(Vn) en Blynk.run().
+void blynkAppEscribe(uint8_t pin, const char *valor);
+
+
+//##################################################################
+// ### REPORTE ###
+//##################################################################
+void monitorEscribir(uint8_t b);
+
+} // namespace sim
@@ -0,0 +1,720 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: RELOJ, GPIO, String, Print/Stream Y PUERTOS SERIE
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+#include <map>
+#include <vector>
+
+namespace sim {
+
+Config config;
+Contadores contadores;
+
+//##################################################################
+// ### RELOJ SIMULADO Y EVENTOS PROGRAMADOS ###
+//##################################################################
+static uint64_t ahora_us = 0;
+static uint64_t limite_us = 0;
+static uint32_t consultas_sin_avance = 0;
+static std::multimap<uint64_t, std::function<void()>> eventos;
+
+// Reloj propio de la tarea FreeRTOS que está corriendo (nullptr = loop())
+static uint64_t *reloj_tarea = nullptr;
+
+static void ejecutarEventos()
+{
+    while (!eventos.empty() && eventos.begin()->first <= ahora_us) {
+        std::function<void()> accion = eventos.begin()->second;
+        eventos.erase(eventos.begin());
+        accion();
+    }
+}
+
+uint64_t ahoraUs()
+{
+    return reloj_tarea ? *reloj_tarea : ahora_us;
+}
+
+void avanzarHastaUs(uint64_t t_us)
+{
+    // En el otro núcleo el tiempo corre aparte: no detiene a loop() ni
+    // dispara eventos (eso pasa cuando la tarea se bloquea)
+    if (reloj_tarea) {
+        if (t_us > *reloj_tarea) {
+            contadores.tareasUs += t_us - *reloj_tarea;
+            *reloj_tarea = t_us;
+        }
+        return;
+    }
+    if (t_us <= ahora_us) {
+        return;
+    }
+    // Los eventos se disparan en su instante exacto, aunque el avance
+    // sea largo (ej. un delay(5000) durante el que se presiona el botón).
+    while (!eventos.empty() && eventos.begin()->first <= t_us) {
+        if (eventos.begin()->first > ahora_us) {
+            ahora_us = eventos.begin()->first;
+        }
+        ejecutarEventos();
+    }
+    ahora_us = t_us;
+    consultas_sin_avance = 0;
+
+    if (limite_us && ahora_us >= limite_us) {
+        throw FinSimulacion();
+    }
+}
+
+void avanzarUs(uint64_t us)
+{
+    avanzarHastaUs(ahoraUs() + us);
+}
+
+void esperarHastaUs(uint64_t limiteUs)
+{
+    if (reloj_tarea) {
+        avanzarHastaUs(limiteUs);
+        return;
+    }
+    uint64_t t = limiteUs;
+    if (!eventos.empty() && eventos.begin()->first < t) {
+        t = eventos.begin()->first;
+    }
+    uint64_t byte = modemProximoByteUs();
+    if (byte && byte < t) {
+        t = byte;
+    }
+    avanzarHastaUs(t > ahora_us ? t : ahora_us + 1);
+}
+
+void consultaReloj()
+{
+    if (++consultas_sin_avance >= 1000) {
+        avanzarUs(1);
+    }
+}
+
+void programar(uint64_t t_ms, std::function<void()> accion)
+{
+    eventos.emplace(t_ms * 1000ULL, accion);
+}
+
+void programarUs(uint64_t t_us, std::function<void()> accion)
+{
+    eventos.emplace(t_us, accion);
+}
+
+void fijarLimiteUs(uint64_t t_us)
+{
+    limite_us = t_us;
+}
+
+void usarRelojTarea(uint64_t *reloj)
+{
+    reloj_tarea = reloj;
+}
+
+
+//##################################################################
+// ### GPIO ###
+//##################################################################
+static const int NUM_PINES = 49;
+static uint8_t modo_pin[NUM_PINES];
+static uint8_t nivel_salida[NUM_PINES];
+static int nivel_externo[NUM_PINES];
+static bool gpio_iniciado = false;
+static void (*isr_pin[NUM_PINES])(void);
+static int modo_isr[NUM_PINES];
+
+static void iniciarGpio()
+{
+    if (gpio_iniciado) {
+        return;
+    }
+    for (int i = 0; i < NUM_PINES; i++) {
+        nivel_externo[i] = -1;
+    }
+    gpio_iniciado = true;
+}
+
+void gpioModo(uint8_t pin, uint8_t modo)
+{
+    iniciarGpio();
+    if (pin < NUM_PINES) {
+        modo_pin[pin] = modo;
+    }
+}
+
+void gpioEscribir(uint8_t pin, uint8_t nivel)
+{
+    iniciarGpio();
+    if (pin >= NUM_PINES) {
+        return;
+    }
+    nivel = nivel ? HIGH : LOW;
+    if (pin == config.pinPwrKey && nivel != nivel_salida[pin]) {
+        modemPwrKey(nivel);
+    }
+    nivel_salida[pin] = nivel;
+}
+
+int gpioLeer(uint8_t pin)
+{
+    iniciarGpio();
+    if (pin >= NUM_PINES) {
+        return LOW;
+    }
+    if (modo_pin[pin] == OUTPUT) {
+        return nivel_salida[pin];
+    }
+    if (nivel_externo[pin] >= 0) {
+        return nivel_externo[pin];
+    }
+    return (modo_pin[pin] & PULLUP) ? HIGH : LOW;
+}
+
+// Llama a la ISR del pin si el cambio de nivel es un flanco que le toca
+static void revisarFlanco(uint8_t pin, int antes)
+{
+    int ahora = gpioLeer(pin);
+    if (!isr_pin[pin] || ahora == antes) {
+        return;
+    }
+    int modo = modo_isr[pin];
+    if (modo == CHANGE || (modo == RISING && ahora == HIGH) || (modo == FALLING && ahora == LOW)) {
+        contadores.interrupciones++;
+        isr_pin[pin]();
+    }
+}
+
+void gpioExterno(uint8_t pin, uint8_t nivel)
+{
+    iniciarGpio();
+    if (pin < NUM_PINES) {
+        int antes = gpioLeer(pin);
+        nivel_externo[pin] = nivel ? HIGH : LOW;
+        revisarFlanco(pin, antes);
+    }
+}
+
+void gpioSoltar(uint8_t pin)
+{
+    iniciarGpio();
+    if (pin < NUM_PINES) {
+        int antes = gpioLeer(pin);
+        nivel_externo[pin] = -1;
+        revisarFlanco(pin, antes);
+    }
+}
+
+void gpioInterrupcion(uint8_t pin, void (*isr)(void), int modo)
+{
+    iniciarGpio();
+    if (pin < NUM_PINES) {
+        isr_pin[pin] = isr;
+        modo_isr[pin] = modo;
+    }
+}
+
+
+//##################################################################
+// ### MONITOR SERIE ###
+//##################################################################
+void monitorEscribir(uint8_t b)
+{
+    if (!config.monitorSilencioso) {
+        putchar(b);
+    }
+}
+
+} // namespace sim
+
+
+//##################################################################
+// ### API DE ARDUINO ###
+//##################################################################
+unsigned long millis()
+{
+    sim::consultaReloj();
+    return (unsigned long)(sim::ahoraUs() / 1000ULL);
+}
+
+unsigned long micros()
+{
+    sim::consultaReloj();
+    return (unsigned long)sim::ahoraUs();
+}
+
+void delay(uint32_t ms)
+{
+    sim::avanzarUs((uint64_t)ms * 1000ULL);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    sim::avanzarUs(us);
+}
+
+void yield()
+{
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    sim::gpioModo(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    sim::gpioEscribir(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return sim::gpioLeer(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+    sim::gpioInterrupcion(pin, isr, mode);
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    sim::gpioInterrupcion(pin, nullptr, 0);
+}
+
+// Las ISR del simulador sólo corren cuando avanza el reloj, nunca a la
+// mitad de una instrucción: no hay nada que deshabilitar.
+void noInterrupts() {}
+void interrupts() {}
+
+static uint32_t semilla = 12345;
+
+long random(long max)
+{
+    if (max <= 0) {
+        return 0;
+    }
+    semilla = semilla * 1103515245u + 12345u;
+    return (long)((semilla >> 8) % (uint32_t)max);
+}
+
+long random(long min, long max)
+{
+    return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long s)
+{
+    semilla = (uint32_t)s;
+}
+
+bool psramFound()
+{
+    return sim::config.psram;
+}
+
+void *ps_malloc(size_t size)
+{
+    return sim::config.psram ? malloc(size) : nullptr;
+}
+
+// esp_timer: cada arranque programa un evento; 'generacion' invalida
+// los eventos de un arranque anterior (esp_timer_stop o re-arranque)
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint32_t generacion;
+    bool activo;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    esp_timer_handle_t t = new esp_timer();
+    t->callback = args->callback;
+    t->arg = args->arg;
+    t->generacion = 0;
+    t->activo = false;
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    if (t->activo) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t generacion = ++t->generacion;
+    t->activo = true;
+    sim::programarUs(sim::ahoraUs() + timeout_us, [t, generacion]() {
+        if (t->activo && t->generacion == generacion) {
+            t->activo = false;
+            t->callback(t->arg);
+        }
+    });
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t->activo) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->activo = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)sim::ahoraUs();
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)(sim::ahoraUs() * getCpuFrequencyMhz());
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return 240;
+}
+
+
+//##################################################################
+// ### String ###
+//##################################################################
+static std::string enteroATexto(unsigned long v, bool negativo, unsigned char base)
+{
+    if (base < 2 || base > 16) {
+        base = 10;
+    }
+    char buf[40];
+    int i = sizeof(buf) - 1;
+    buf[i] = '\0';
+    do {
+        buf[--i] = "0123456789ABCDEF"[v % base];
+        v /= base;
+    } while (v);
+    if (negativo) {
+        buf[--i] = '-';
+    }
+    return std::string(&buf[i]);
+}
+
+String::String(int v, unsigned char base) : String((long)v, base) {}
+String::String(unsigned int v, unsigned char base) : String((unsigned long)v, base) {}
+
+String::String(long v, unsigned char base)
+{
+    if (base == 10 && v < 0) {
+        s_ = enteroATexto((unsigned long)(-v), true, base);
+    } else {
+        s_ = enteroATexto((unsigned long)v, false, base);
+    }
+}
+
+String::String(unsigned long v, unsigned char base) : s_(enteroATexto(v, false, base)) {}
+
+String::String(float v, unsigned int decimals) : String((double)v, decimals) {}
+
+String::String(double v, unsigned int decimals)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s_ = buf;
+}
+
+int String::indexOf(char c, unsigned int from) const
+{
+    size_t p = s_.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const String &o, unsigned int from) const
+{
+    size_t p = s_.find(o.s_, from);
+    return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::lastIndexOf(char c) const
+{
+    size_t p = s_.rfind(c);
+    return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned int from) const
+{
+    return from < s_.length() ? String(s_.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to) {
+        std::swap(from, to);
+    }
+    if (from >= s_.length()) {
+        return String();
+    }
+    return String(s_.substr(from, to - from));
+}
+
+bool String::endsWith(const String &o) const
+{
+    return s_.length() >= o.s_.length() &&
+           s_.compare(s_.length() - o.s_.length(), o.s_.length(), o.s_) == 0;
+}
+
+void String::trim()
+{
+    size_t a = s_.find_first_not_of(" \t\r\n");
+    size_t b = s_.find_last_not_of(" \t\r\n");
+    s_ = (a == std::string::npos) ? std::string() : s_.substr(a, b - a + 1);
+}
+
+void String::replace(const String &de, const String &a)
+{
+    if (de.s_.empty()) {
+        return;
+    }
+    size_t p = 0;
+    while ((p = s_.find(de.s_, p)) != std::string::npos) {
+        s_.replace(p, de.s_.length(), a.s_);
+        p += a.s_.length();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < s_.length()) {
+        s_.erase(index, count);
+    }
+}
+
+
+//##################################################################
+// ### Print / Stream ###
+//##################################################################
+size_t Print::write(const uint8_t *buf, size_t n)
+{
+    size_t escritos = 0;
+    while (n--) {
+        escritos += write(*buf++);
+    }
+    return escritos;
+}
+
+size_t Print::print(long v, int base)
+{
+    if (base == DEC) {
+        return print(String(v, DEC));
+    }
+    return print(String((unsigned long)v, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long v, int base)
+{
+    return print(String(v, (unsigned char)base));
+}
+
+size_t Print::print(double v, int digits)
+{
+    if (isnan(v)) {
+        return print("nan");
+    }
+    if (isinf(v)) {
+        return print("inf");
+    }
+    return print(String(v, (unsigned int)digits));
+}
+
+size_t Print::printf(const char *fmt, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0) {
+        return 0;
+    }
+    return write((const uint8_t *)buf, strlen(buf));
+}
+
+int Stream::timedRead()
+{
+    uint64_t limite = sim::ahoraUs() + (uint64_t)timeout_ * 1000ULL;
+    for (;;) {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+        if (sim::ahoraUs() >= limite) {
+            return -1;
+        }
+        sim::esperarHastaUs(limite);
+    }
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t n)
+{
+    size_t leidos = 0;
+    while (leidos < n) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+        buf[leidos++] = (uint8_t)c;
+    }
+    return leidos;
+}
+
+size_t Stream::readBytesUntil(char fin, char *buf, size_t n)
+{
+    size_t leidos = 0;
+    while (leidos < n) {
+        int c = timedRead();
+        if (c < 0 || c == fin) {
+            break;
+        }
+        buf[leidos++] = (char)c;
+    }
+    return leidos;
+}
+
+String Stream::readStringUntil(char fin)
+{
+    String s;
+    int c = timedRead();
+    while (c >= 0 && c != fin) {
+        s += (char)c;
+        c = timedRead();
+    }
+    return s;
+}
+
+String Stream::readString()
+{
+    String s;
+    int c = timedRead();
+    while (c >= 0) {
+        s += (char)c;
+        c = timedRead();
+    }
+    return s;
+}
+
+bool Stream::find(const char *objetivo)
+{
+    size_t largo = strlen(objetivo);
+    size_t iguales = 0;
+    if (largo == 0) {
+        return true;
+    }
+    int c;
+    while ((c = timedRead()) >= 0) {
+        if (c == objetivo[iguales]) {
+            if (++iguales == largo) {
+                return true;
+            }
+        } else {
+            iguales = (c == objetivo[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+long Stream::parseInt()
+{
+    int c;
+    do {
+        c = timedRead();
+    } while (c >= 0 && c != '-' && (c < '0' || c > '9'));
+    bool negativo = false;
+    long v = 0;
+    if (c == '-') {
+        negativo = true;
+        c = timedRead();
+    }
+    while (c >= '0' && c <= '9') {
+        v = v * 10 + (c - '0');
+        if (peek() < '0' || peek() > '9') {
+            break;
+        }
+        c = read();
+    }
+    return negativo ? -v : v;
+}
+
+float Stream::parseFloat()
+{
+    String s;
+    int c;
+    do {
+        c = timedRead();
+    } while (c >= 0 && c != '-' && c != '.' && (c < '0' || c > '9'));
+    while (c >= 0 && (c == '-' || c == '.' || (c >= '0' && c <= '9'))) {
+        s += (char)c;
+        int p = peek();
+        if (p != '-' && p != '.' && (p < '0' || p > '9')) {
+            break;
+        }
+        c = read();
+    }
+    return s.toFloat();
+}
+
+
+//##################################################################
+// ### PUERTOS SERIE ###
+//##################################################################
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rx, int8_t tx)
+{
+    (void)config; (void)rx; (void)tx;
+    if (uart_ == 2) {
+        sim::config.uartBaudios = (uint32_t)baud;
+    }
+}
+
+int HardwareSerial::available()
+{
+    return uart_ == 2 ? sim::modemDisponibles() : 0;
+}
+
+int HardwareSerial::read()
+{
+    return uart_ == 2 ? sim::modemLeer() : -1;
+}
+
+int HardwareSerial::peek()
+{
+    return uart_ == 2 ? sim::modemVer() : -1;
+}
+
+size_t HardwareSerial::write(uint8_t b)
+{
+    if (uart_ == 2) {
+        sim::modemRecibir(b);
+    } else {
+        sim::monitorEscribir(b);
+    }
+    return 1;
+}
+
+
+//##################################################################
+// ### SPI (sin dispositivos simulados) ###
+//##################################################################
+#include "SPI.h"
+
+SPIClass SPI;
@@ -0,0 +1,357 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: SUSTITUTO DE Blynk (TinyGSM) Y BlynkTimer
+ * ===================================================================
+ */
+#include "BlynkSimpleTinyGSM.h"
+#include "sim.h"
+
+#include <deque>
+
+BlynkSim Blynk;
+
+// Protocolo Blynk: comandos usados por el dispositivo
+static const uint8_t CMD_PING = 6;
+static const uint8_t CMD_HARDWARE_SYNC = 16;
+static const uint8_t CMD_HARDWARE = 20;
+static const uint8_t CMD_HW_LOGIN = 29;
+static const uint8_t CMD_GROUP = 64;
+
+// Intervalo del heartbeat de Blynk
+static const unsigned long HEARTBEAT_MS = 45000UL;
+
+//##################################################################
+// ### CALLBACKS POR DEFECTO (LA PLANTILLA PUEDE REDEFINIRLOS) ###
+//##################################################################
+#define BLYNK_DEFAULT_WRITE(n) \
+    __attribute__((weak)) BLYNK_WRITE_2(n) { (void)request; (void)param; }
+BLYNK_DEFAULT_WRITE(0)  BLYNK_DEFAULT_WRITE(1)  BLYNK_DEFAULT_WRITE(2)  BLYNK_DEFAULT_WRITE(3)
+BLYNK_DEFAULT_WRITE(4)  BLYNK_DEFAULT_WRITE(5)  BLYNK_DEFAULT_WRITE(6)  BLYNK_DEFAULT_WRITE(7)
+BLYNK_DEFAULT_WRITE(8)  BLYNK_DEFAULT_WRITE(9)  BLYNK_DEFAULT_WRITE(10) BLYNK_DEFAULT_WRITE(11)
+BLYNK_DEFAULT_WRITE(12) BLYNK_DEFAULT_WRITE(13) BLYNK_DEFAULT_WRITE(14) BLYNK_DEFAULT_WRITE(15)
+BLYNK_DEFAULT_WRITE(16) BLYNK_DEFAULT_WRITE(17) BLYNK_DEFAULT_WRITE(18) BLYNK_DEFAULT_WRITE(19)
+BLYNK_DEFAULT_WRITE(20) BLYNK_DEFAULT_WRITE(21) BLYNK_DEFAULT_WRITE(22) BLYNK_DEFAULT_WRITE(23)
+BLYNK_DEFAULT_WRITE(24) BLYNK_DEFAULT_WRITE(25) BLYNK_DEFAULT_WRITE(26) BLYNK_DEFAULT_WRITE(27)
+BLYNK_DEFAULT_WRITE(28) BLYNK_DEFAULT_WRITE(29) BLYNK_DEFAULT_WRITE(30) BLYNK_DEFAULT_WRITE(31)
+#undef BLYNK_DEFAULT_WRITE
+
+__attribute__((weak)) void BlynkOnConnected() {}
+__attribute__((weak)) void BlynkOnDisconnected() {}
+
+static const WidgetWriteHandler manejadores[BLYNK_MAX_VPIN] = {
+    BlynkWidgetWrite0,  BlynkWidgetWrite1,  BlynkWidgetWrite2,  BlynkWidgetWrite3,
+    BlynkWidgetWrite4,  BlynkWidgetWrite5,  BlynkWidgetWrite6,  BlynkWidgetWrite7,
+    BlynkWidgetWrite8,  BlynkWidgetWrite9,  BlynkWidgetWrite10, BlynkWidgetWrite11,
+    BlynkWidgetWrite12, BlynkWidgetWrite13, BlynkWidgetWrite14, BlynkWidgetWrite15,
+    BlynkWidgetWrite16, BlynkWidgetWrite17, BlynkWidgetWrite18, BlynkWidgetWrite19,
+    BlynkWidgetWrite20, BlynkWidgetWrite21, BlynkWidgetWrite22, BlynkWidgetWrite23,
+    BlynkWidgetWrite24, BlynkWidgetWrite25, BlynkWidgetWrite26, BlynkWidgetWrite27,
+    BlynkWidgetWrite28, BlynkWidgetWrite29, BlynkWidgetWrite30, BlynkWidgetWrite31,
+};
+
+static void entregar(int pin, const String &valor)
+{
+    if (pin < 0 || pin >= BLYNK_MAX_VPIN) {
+        return;
+    }
+    BlynkReq req = { (uint8_t)pin };
+    manejadores[pin](req, BlynkParam(valor));
+}
+
+
+//##################################################################
+// ### "NUBE" SIMULADA ###
+//##################################################################
+static String nube[BLYNK_MAX_VPIN];
+static bool nube_tiene[BLYNK_MAX_VPIN];
+static std::deque<std::pair<int, String>> desde_app;
+
+namespace sim {
+
+void blynkAppEscribe(uint8_t pin, const char *valor)
+{
+    if (pin >= BLYNK_MAX_VPIN) {
+        return;
+    }
+    nube[pin] = valor;
+    nube_tiene[pin] = true;
+    desde_app.emplace_back(pin, String(valor));
+}
+
+} // namespace sim
+
+
+//##################################################################
+// ### Blynk ###
+//##################################################################
+void BlynkSim::begin(const char *auth, TinyGsm &modem, const char *apn,
+                     const char *user, const char *pass,
+                     const char *domain, uint16_t port)
+{
+    config(modem, auth, domain, port);
+
+    // Igual que BlynkSimpleTinyGSM: init, red, GPRS y luego el servidor
+    BLYNK_LOG("Modem init...");
+    if (!modem.begin()) {
+        BLYNK_LOG("Cannot init");
+    }
+    BLYNK_LOG("Connecting to network...");
+    if (!modem.waitForNetwork()) {
+        BLYNK_LOG("Register in network failed");
+    }
+    BLYNK_LOG("Connecting to GPRS...");
+    if (!modem.gprsConnect(apn, user, pass)) {
+        BLYNK_LOG("Connect GPRS failed");
+    }
+    while (!connect()) {
+        delay(5000);
+    }
+}
+
+void BlynkSim::config(TinyGsm &modem, const char *auth, const char *domain, uint16_t port)
+{
+    modem_ = &modem;
+    cliente_.init(&modem, 0);
+    auth_ = auth;
+    domain_ = domain;
+    port_ = port;
+}
+
+bool BlynkSim::connect(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    if (!modem_) {
+        return false;
+    }
+    ultimoIntento_ = millis();
+    if (!cliente_.connect(domain_, port_)) {
+        return false;
+    }
+    conectado_ = true;
+    msgId_ = 0;
+    enviarComando(CMD_HW_LOGIN, String(auth_));
+    if (!conectado_) {
+        return false;
+    }
+    BLYNK_LOG("Ready");
+    BlynkOnConnected();
+    return true;
+}
+
+void BlynkSim::disconnect()
+{
+    cliente_.stop();
+    if (conectado_) {
+        conectado_ = false;
+        BlynkOnDisconnected();
+    }
+}
+
+void BlynkSim::perderConexion()
+{
+    agrupando_ = false;
+    grupo_.clear();
+    if (conectado_) {
+        conectado_ = false;
+        BlynkOnDisconnected();
+    }
+}
+
+void BlynkSim::run()
+{
+    if (!modem_) {
+        return;
+    }
+    if (!conectado_) {
+        // Reintento cada 5 s, como BlynkProtocol
+        if (millis() - ultimoIntento_ >= 5000UL) {
+            connect();
+        }
+        return;
+    }
+    if (!cliente_.connected()) {
+        perderConexion();
+        return;
+    }
+    while (!desde_app.empty()) {
+        std::pair<int, String> e = desde_app.front();
+        desde_app.pop_front();
+        entregar(e.first, e.second);
+    }
+    if (millis() - ultimoEnvio_ >= HEARTBEAT_MS) {
+        enviarComando(CMD_PING, String());
+    }
+}
+
+void BlynkSim::enviarComando(uint8_t cmd, const String &cuerpo, int pin)
+{
+    if (!conectado_) {
+        return;
+    }
+    size_t n = cuerpo.length();
+    uint8_t trama[5 + 256];
+    if (n > 256) {
+        n = 256;
+    }
+    msgId_++;
+    trama[0] = cmd;
+    trama[1] = (uint8_t)(msgId_ >> 8);
+    trama[2] = (uint8_t)(msgId_ & 0xFF);
+    trama[3] = (uint8_t)(n >> 8);
+    trama[4] = (uint8_t)(n & 0xFF);
+    memcpy(&trama[5], cuerpo.c_str(), n);
+
+    sim::contadores.blynkMensajes++;
+    sim::contadores.blynkBytes += n + 5;
+    if (agrupando_) {
+        grupo_.append((const char *)trama, n + 5);
+    } else if (cliente_.write(trama, n + 5) != n + 5) {
+        perderConexion();
+        return;
+    }
+    ultimoEnvio_ = millis();
+
+    // La nube guarda el último valor escrito en el pin
+    if (cmd == CMD_HARDWARE && pin >= 0 && pin < BLYNK_MAX_VPIN) {
+        int p = cuerpo.indexOf('\0', 3);
+        nube[pin] = p >= 0 ? cuerpo.substring(p + 1) : String();
+        nube_tiene[pin] = true;
+    }
+}
+
+void BlynkSim::beginGroup()
+{
+    if (!conectado_ || agrupando_) {
+        return;
+    }
+    agrupando_ = true;
+    grupo_.clear();
+    enviarComando(CMD_GROUP, String("b"));
+}
+
+void BlynkSim::beginGroup(uint64_t timestamp_ms)
+{
+    if (!conectado_ || agrupando_) {
+        return;
+    }
+    agrupando_ = true;
+    grupo_.clear();
+    enviarComando(CMD_GROUP, String("b") + '\0' + String((unsigned long)timestamp_ms));
+}
+
+void BlynkSim::endGroup()
+{
+    if (!agrupando_) {
+        return;
+    }
+    enviarComando(CMD_GROUP, String("e"));
+    agrupando_ = false;
+    if (conectado_ && cliente_.write((const uint8_t *)grupo_.data(), grupo_.size()) != grupo_.size()) {
+        perderConexion();
+    }
+    grupo_.clear();
+}
+
+void BlynkSim::sincronizar(int pin)
+{
+    if (!conectado_ || pin < 0 || pin >= BLYNK_MAX_VPIN) {
+        return;
+    }
+    enviarComando(CMD_HARDWARE_SYNC, String("vr") + '\0' + String(pin));
+    if (nube_tiene[pin]) {
+        entregar(pin, nube[pin]);
+    }
+}
+
+
+//##################################################################
+// ### BlynkTimer ###
+//##################################################################
+int BlynkTimer::alta(unsigned long d, void *f, void *p, bool conParam, int n)
+{
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        if (!t_[i].activo) {
+            t_[i].f = f;
+            t_[i].param = p;
+            t_[i].conParam = conParam;
+            t_[i].delay = d;
+            t_[i].prev = millis();
+            t_[i].repeticiones = n;
+            t_[i].activo = true;
+            t_[i].habilitado = true;
+            usados_++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BlynkTimer::run()
+{
+    unsigned long ahora = millis();
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        Temporizador &t = t_[i];
+        if (!t.activo || !t.habilitado || ahora - t.prev < t.delay) {
+            continue;
+        }
+        // Igual que SimpleTimer: si se atrasó, salta los periodos perdidos
+        unsigned long saltos = t.delay ? (ahora - t.prev) / t.delay : 1;
+        t.prev += t.delay * saltos;
+
+        void *f = t.f;
+        void *p = t.param;
+        bool conParam = t.conParam;
+        if (t.repeticiones > 0 && --t.repeticiones == 0) {
+            deleteTimer(i);
+        }
+        if (conParam) {
+            ((timer_callback_p)f)(p);
+        } else {
+            ((timer_callback)f)();
+        }
+    }
+}
+
+void BlynkTimer::deleteTimer(int id)
+{
+    if (id >= 0 && id < MAX_TIMERS && t_[id].activo) {
+        t_[id] = Temporizador();
+        usados_--;
+    }
+}
+
+void BlynkTimer::restartTimer(int id)
+{
+    if (id >= 0 && id < MAX_TIMERS) {
+        t_[id].prev = millis();
+    }
+}
+
+bool BlynkTimer::changeInterval(int id, unsigned long d)
+{
+    if (id < 0 || id >= MAX_TIMERS || !t_[id].activo) {
+        return false;
+    }
+    t_[id].delay = d;
+    t_[id].prev = millis();
+    return true;
+}
+
+bool BlynkTimer::isEnabled(int id)
+{
+    return id >= 0 && id < MAX_TIMERS && t_[id].habilitado;
+}
+
+void BlynkTimer::enable(int id)
+{
+    if (id >= 0 && id < MAX_TIMERS) {
+        t_[id].habilitado = true;
+    }
+}
+
+void BlynkTimer::disable(int id)
+{
+    if (id >= 0 && id < MAX_TIMERS) {
+        t_[id].habilitado = false;
+    }
+}
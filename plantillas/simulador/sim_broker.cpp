@@ -0,0 +1,111 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: RECEPTOR DE TELEMETRÍA BINARIA (BROKER LOCAL)
+ *
+ * Hace de servidor para XC03-Telemetria.h: recibe lo que el XC01
+ * manda por TCP al puerto XC03_TEL_PORT, lo separa en tramas y
+ * decodifica cada reporte. Al final cuenta envíos, bytes, reportes y
+ * valores para compararlos con los mensajes de Blynk.
+ *
+ * Con --traza-broker imprime cada reporte en stderr:
+ *   [broker] 120.512 s  termometro-01  edad 0 s: V2=23.45 V9=300
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "sim.h"
+#include "../XC03-Telemetria.h"
+
+#include <string>
+#include <vector>
+
+namespace sim {
+
+static struct {
+    bool traza = false;
+    std::vector<uint8_t> pendiente;     // Bytes de una trama a medias
+    std::string dispositivo;
+    uint64_t envios = 0;
+    uint64_t bytes = 0;
+    uint64_t hellos = 0;
+    uint64_t reportes = 0;
+    uint64_t valores = 0;
+    uint64_t errores = 0;               // Tramas que no se pudieron leer
+} broker;
+
+static void brokerReporte(XC03TelFrame &f)
+{
+    uint32_t edad;
+    if (!xc03TelReportAge(&f, &edad)) {
+        broker.errores++;
+        return;
+    }
+    broker.reportes++;
+
+    std::string linea;
+    XC03TelValue v;
+    while (xc03TelNextValue(&f, &v)) {
+        broker.valores++;
+        char buf[32];
+        if (v.type == XC03_TEL_INT) {
+            snprintf(buf, sizeof(buf), " V%u=%ld", v.pin, (long)v.i);
+        } else {
+            snprintf(buf, sizeof(buf), " V%u=%.2f", v.pin, v.f);
+        }
+        linea += buf;
+    }
+    if (f.pos != f.len) {
+        broker.errores++;
+    }
+    if (broker.traza) {
+        fprintf(stderr, "[broker] %.3f s  %s  edad %lu s:%s\n", ahoraUs() / 1e6,
+                broker.dispositivo.c_str(), (unsigned long)edad, linea.c_str());
+    }
+}
+
+static std::string brokerRecibir(const char *host, uint16_t puerto, const uint8_t *datos, size_t n)
+{
+    (void)host;
+    if (puerto != XC03_TEL_PORT) {
+        return "";                      // Blynk u otro servidor
+    }
+    broker.envios++;
+    broker.bytes += n;
+    broker.pendiente.insert(broker.pendiente.end(), datos, datos + n);
+
+    uint16_t pos = 0;
+    XC03TelFrame f;
+    while (xc03TelNextFrame(broker.pendiente.data(), (uint16_t)broker.pendiente.size(), &pos, &f)) {
+        if (f.type == XC03_TEL_HELLO && f.len >= 1) {
+            broker.hellos++;
+            broker.dispositivo.assign((const char *)f.body + 1, f.len - 1);
+        } else if (f.type == XC03_TEL_REPORT) {
+            brokerReporte(f);
+        } else {
+            broker.errores++;
+        }
+    }
+    broker.pendiente.erase(broker.pendiente.begin(), broker.pendiente.begin() + pos);
+    return "";
+}
+
+void brokerIniciar(bool traza)
+{
+    broker.traza = traza;
+    agregarReceptorTcp(brokerRecibir);
+}
+
+void brokerResumen()
+{
+    if (broker.envios == 0) {
+        return;
+    }
+    fprintf(stderr, "[sim] broker: %llu env/%llu B, %llu HELLO, %llu reportes, %llu valores "
+                    "(%.1f B/valor), errores %llu\n",
+            (unsigned long long)broker.envios, (unsigned long long)broker.bytes,
+            (unsigned long long)broker.hellos, (unsigned long long)broker.reportes,
+            (unsigned long long)broker.valores,
+            broker.valores ? (double)broker.bytes / broker.valores : 0.0,
+            (unsigned long long)broker.errores);
+}
+
+} // namespace sim
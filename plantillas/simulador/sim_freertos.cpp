@@ -0,0 +1,147 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: TAREAS FreeRTOS (SEGUNDO NÚCLEO)
+ *
+ * Cada tarea es una corrutina (ucontext) con su propia pila. Corre
+ * desde un evento programado hasta que se bloquea en vTaskDelay() /
+ * vTaskDelayUntil(); entonces se programa el evento de su siguiente
+ * despertar y el control regresa a loop().
+ *
+ * Mientras corre, el tiempo que gasta (I2C, delay, ...) avanza SU
+ * reloj y no el de loop(): así se modela que está en el otro núcleo.
+ * Lo que la tarea publica se ve en loop() en el instante en que
+ * despertó (unos cuantos ms antes que en la placa).
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "sim.h"
+
+#include <ucontext.h>
+#include <vector>
+
+namespace {
+
+struct Tarea {
+    TaskFunction_t funcion;
+    void *parametro;
+    BaseType_t nucleo;
+    ucontext_t contexto;
+    std::vector<uint8_t> pila;
+    uint64_t relojUs = 0;           // Reloj propio de la tarea
+    bool terminada = false;
+};
+
+ucontext_t contexto_loop;
+Tarea *actual = nullptr;
+
+// Las funciones de las tareas casi nunca regresan; si lo hacen, la
+// tarea se da por terminada (en FreeRTOS sería un error)
+void arrancar()
+{
+    actual->funcion(actual->parametro);
+    actual->terminada = true;
+}
+
+void correr(Tarea *t)
+{
+    if (t->terminada) {
+        return;
+    }
+    if (t->relojUs < sim::ahoraUs()) {
+        t->relojUs = sim::ahoraUs();
+    }
+    actual = t;
+    sim::usarRelojTarea(&t->relojUs);
+    swapcontext(&contexto_loop, &t->contexto);
+    sim::usarRelojTarea(nullptr);
+    actual = nullptr;
+}
+
+// Bloquea la tarea actual hasta despiertaUs
+void dormirHasta(uint64_t despiertaUs)
+{
+    Tarea *t = actual;
+    if (despiertaUs < t->relojUs) {
+        despiertaUs = t->relojUs;
+    }
+    t->relojUs = despiertaUs;
+    sim::programarUs(despiertaUs, [t]() { correr(t); });
+    swapcontext(&t->contexto, &contexto_loop);
+}
+
+} // namespace
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t tarea, const char *nombre,
+                                   uint32_t pila, void *parametro,
+                                   UBaseType_t prioridad, TaskHandle_t *handle,
+                                   BaseType_t nucleo)
+{
+    (void)nombre;
+    (void)prioridad;
+
+    Tarea *t = new Tarea();
+    t->funcion = tarea;
+    t->parametro = parametro;
+    t->nucleo = nucleo;
+    // La pila del ESP32 se da en bytes; en la computadora printf() y
+    // compañía necesitan bastante más
+    t->pila.resize(std::max<size_t>(pila * 16, 256 * 1024));
+
+    getcontext(&t->contexto);
+    t->contexto.uc_stack.ss_sp = t->pila.data();
+    t->contexto.uc_stack.ss_size = t->pila.size();
+    t->contexto.uc_link = &contexto_loop;
+    makecontext(&t->contexto, arrancar, 0);
+
+    if (handle) {
+        *handle = t;
+    }
+    // Empieza en cuanto loop() (o setup()) gaste tiempo
+    t->relojUs = sim::ahoraUs();
+    sim::programarUs(t->relojUs, [t]() { correr(t); });
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+    Tarea *t = handle ? (Tarea *)handle : actual;
+    if (!t) {
+        return;
+    }
+    t->terminada = true;
+    if (t == actual) {
+        swapcontext(&t->contexto, &contexto_loop);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (!actual) {
+        delay(ticks * portTICK_PERIOD_MS);
+        return;
+    }
+    dormirHasta(sim::ahoraUs() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000ULL);
+}
+
+void vTaskDelayUntil(TickType_t *anterior, TickType_t incremento)
+{
+    *anterior += incremento;
+    uint64_t despiertaUs = (uint64_t)*anterior * portTICK_PERIOD_MS * 1000ULL;
+
+    if (!actual) {
+        sim::avanzarHastaUs(despiertaUs);
+        return;
+    }
+    dormirHasta(despiertaUs);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(sim::ahoraUs() / 1000ULL / portTICK_PERIOD_MS);
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return actual ? actual->nucleo : ARDUINO_RUNNING_CORE;
+}
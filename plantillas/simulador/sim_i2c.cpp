@@ -0,0 +1,274 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: BUS I2C Y MÓDULOS XN
+ *
+ * Cada módulo es un archivo de registros con auto-incremento: el
+ * primer byte escrito fija el registro y los siguientes bytes (de
+ * escritura o de lectura) avanzan por los registros consecutivos.
+ *
+ *   XN01 (dir. 1)  0x01: entradas digitales (1 byte). Cuando cambian,
+ *                  baja su línea INT (MIKROBUS_INT, colector abierto)
+ *                  hasta que se lee el registro.
+ *   XN02 (dir. 2)  0x01: salidas digitales (1 byte)
+ *   XN04 (dir. 4)  0x01: temperatura x100, 0x02: humedad x100,
+ *                  0x03: luz en lux (2 bytes c/u, MSB primero)
+ *   XN11 (dir. 11) 0x01: relevador 1, 0x02: relevador 2 (1 byte c/u)
+ *
+ * Costo de una transacción: overhead fijo + 9 bits por byte
+ * (8 datos + ACK), incluyendo el byte de dirección.
+ *
+ * Cada módulo tiene un reloj máximo (defecto 400 kHz, cambia con
+ * --i2c-max). Por arriba de él el módulo no contesta (NACK).
+ * ===================================================================
+ */
+#include "Wire.h"
+#include "sim.h"
+
+namespace sim {
+
+struct ModuloXN {
+    uint8_t direccion;
+    uint8_t primerRegistro;
+    uint8_t numRegistros;
+    uint8_t anchoRegistro;          // bytes por registro
+    uint8_t imagen[16];             // registros concatenados
+    size_t puntero;                 // byte actual dentro de imagen
+    void (*refrescar)(ModuloXN &m); // actualiza valores antes de leer
+    void (*alEscribir)(ModuloXN &m);
+    uint32_t maxRelojHz;            // Por arriba de esto no responde
+
+    size_t tamano() const { return (size_t)numRegistros * anchoRegistro; }
+};
+
+static bool xn01_int_activa = false;
+
+static float xn04_temp_fija = NAN;
+static float xn04_hum_fija = NAN;
+static int32_t xn04_lux_fija = -1;
+
+static void escribir16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)(v & 0xFF);
+}
+
+// Ambiente simulado: oscilación lenta + ruido determinista.
+static void refrescarXN04(ModuloXN &m)
+{
+    double t = ahoraUs() / 1e6;
+    float temp = isnan(xn04_temp_fija)
+        ? 24.0f + 3.0f * (float)sin(t / 600.0) + 0.05f * (float)((random(21) - 10) / 10.0)
+        : xn04_temp_fija;
+    float hum = isnan(xn04_hum_fija)
+        ? 45.0f + 10.0f * (float)sin(t / 900.0)
+        : xn04_hum_fija;
+    uint16_t lux = xn04_lux_fija >= 0
+        ? (uint16_t)xn04_lux_fija
+        : (uint16_t)(300.0 + 200.0 * sin(t / 300.0));
+
+    escribir16(&m.imagen[0], (uint16_t)lroundf(temp * 100.0f));
+    escribir16(&m.imagen[2], (uint16_t)lroundf(hum * 100.0f));
+    escribir16(&m.imagen[4], lux);
+}
+
+static ModuloXN modulos[] = {
+    { 1, 0x01, 1, 1, {0}, 0, nullptr, nullptr, 400000 },          // XN01
+    { 2, 0x01, 1, 1, {0}, 0, nullptr, nullptr, 400000 },          // XN02
+    { 4, 0x01, 3, 2, {0}, 0, refrescarXN04, nullptr, 400000 },    // XN04
+    { 11, 0x01, 2, 1, {0}, 0, nullptr, nullptr, 400000 },         // XN11
+};
+
+static ModuloXN *buscar(uint8_t direccion)
+{
+    for (ModuloXN &m : modulos) {
+        if (m.direccion == direccion) {
+            return &m;
+        }
+    }
+    return nullptr;
+}
+
+static void cobrarBus(size_t bytesDatos)
+{
+    // +1 por el byte de dirección
+    uint64_t bits = (uint64_t)(bytesDatos + 1) * 9ULL;
+    uint64_t us = config.i2cOverheadUs + (bits * 1000000ULL + config.i2cRelojHz - 1) / config.i2cRelojHz;
+
+    contadores.i2cTransacciones++;
+    contadores.i2cBytes += bytesDatos + 1;
+    contadores.i2cBusUs += us;
+    avanzarUs(us);
+}
+
+bool i2cEscribir(uint8_t direccion, const uint8_t *datos, size_t n)
+{
+    ModuloXN *m = buscar(direccion);
+    if (!m || config.i2cRelojHz > m->maxRelojHz) {
+        cobrarBus(0);
+        contadores.i2cNack++;
+        return false;
+    }
+    cobrarBus(n);
+
+    if (n == 0) {
+        return true;
+    }
+    // Primer byte: número de registro
+    uint8_t reg = datos[0];
+    if (reg < m->primerRegistro || reg >= m->primerRegistro + m->numRegistros) {
+        m->puntero = m->tamano();
+    } else {
+        m->puntero = (size_t)(reg - m->primerRegistro) * m->anchoRegistro;
+    }
+    for (size_t i = 1; i < n && m->puntero < m->tamano(); i++) {
+        m->imagen[m->puntero++] = datos[i];
+    }
+    if (n > 1 && m->alEscribir) {
+        m->alEscribir(*m);
+    }
+    return true;
+}
+
+size_t i2cLeer(uint8_t direccion, uint8_t *datos, size_t n)
+{
+    ModuloXN *m = buscar(direccion);
+    if (!m || config.i2cRelojHz > m->maxRelojHz) {
+        cobrarBus(0);
+        contadores.i2cNack++;
+        return 0;
+    }
+    if (m->refrescar) {
+        m->refrescar(*m);
+    }
+    cobrarBus(n);
+
+    // Leer las entradas del XN01 suelta su línea INT
+    if (direccion == 1 && m->puntero == 0 && n > 0 && xn01_int_activa) {
+        xn01_int_activa = false;
+        gpioSoltar(config.pinXn01Int);
+    }
+
+    // Más allá del último registro el módulo entrega 0xFF
+    for (size_t i = 0; i < n; i++) {
+        datos[i] = m->puntero < m->tamano() ? m->imagen[m->puntero++] : 0xFF;
+    }
+    return n;
+}
+
+void xn01FijarEntradas(uint8_t entradas)
+{
+    ModuloXN *m = buscar(1);
+    if (m->imagen[0] == entradas) {
+        return;
+    }
+    m->imagen[0] = entradas;
+    if (!xn01_int_activa) {
+        xn01_int_activa = true;
+        gpioExterno(config.pinXn01Int, LOW);
+    }
+}
+
+uint8_t xn01Entradas()
+{
+    return buscar(1)->imagen[0];
+}
+
+uint8_t xn02Salidas()
+{
+    return buscar(2)->imagen[0];
+}
+
+uint8_t xn11Rele(uint8_t rele)
+{
+    return (rele == 1 || rele == 2) ? buscar(11)->imagen[rele - 1] : 0;
+}
+
+void i2cRelojMaximo(uint8_t direccion, uint32_t hz)
+{
+    ModuloXN *m = buscar(direccion);
+    if (m) {
+        m->maxRelojHz = hz;
+    }
+}
+
+void xn04Fijar(float temperatura, float humedad, uint16_t lux)
+{
+    xn04_temp_fija = temperatura;
+    xn04_hum_fija = humedad;
+    xn04_lux_fija = lux;
+}
+
+} // namespace sim
+
+
+//##################################################################
+// ### Wire ###
+//##################################################################
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frecuencia)
+{
+    setPins(sda, scl);
+    if (frecuencia) {
+        setClock(frecuencia);
+    }
+    return begin();
+}
+
+bool TwoWire::setClock(uint32_t frecuencia)
+{
+    if (frecuencia == 0) {
+        return false;
+    }
+    sim::config.i2cRelojHz = frecuencia;
+    return true;
+}
+
+uint32_t TwoWire::getClock()
+{
+    return sim::config.i2cRelojHz;
+}
+
+void TwoWire::beginTransmission(uint16_t direccion)
+{
+    txDireccion_ = direccion;
+    txLen_ = 0;
+}
+
+size_t TwoWire::write(uint8_t b)
+{
+    if (txLen_ >= sizeof(txBuf_)) {
+        return 0;
+    }
+    txBuf_[txLen_++] = b;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *buf, size_t n)
+{
+    size_t escritos = 0;
+    while (n-- && write(*buf++)) {
+        escritos++;
+    }
+    return escritos;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    bool ack = sim::i2cEscribir((uint8_t)txDireccion_, txBuf_, txLen_);
+    txLen_ = 0;
+    // 0 = éxito, 2 = NACK en la dirección (códigos de la Wire real)
+    return ack ? 0 : 2;
+}
+
+size_t TwoWire::requestFrom(uint16_t direccion, size_t n, bool sendStop)
+{
+    (void)sendStop;
+    if (n > sizeof(rxBuf_)) {
+        n = sizeof(rxBuf_);
+    }
+    rxLen_ = sim::i2cLeer((uint8_t)direccion, rxBuf_, n);
+    rxPos_ = 0;
+    return rxLen_;
+}
@@ -0,0 +1,637 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: MÓDEM XC03 (SIM7080G) A NIVEL DE COMANDOS AT
+ *
+ * El módem recibe los bytes que el XC01 escribe en Serial2, procesa
+ * cada línea "AT...\r" y agenda su respuesta en la UART con la
+ * latencia del comando + el tiempo de cada byte a la velocidad de la
+ * UART. También respeta la REGLA DE ORO del XC03: GNSS y PDP (datos
+ * celulares) no pueden estar activos al mismo tiempo.
+ *
+ * Comandos: AT, ATE0/1, ATI, +CGMM, +CGMR, +CGSN, +CMEE, +CPIN,
+ * +CFUN, +CPOWD, +CSQ, +CEREG/+CREG/+CGREG, +COPS, +CNCFG, +CNACT,
+ * +CGNSPWR, +CGNSINF, +CAOPEN, +CASEND, +CARECV, +CACLOSE, +CASTATE,
+ * +CCLK. Lo que contesta el servidor (ReceptorTcp) llega con el URC
+ * "+CADATAIND: <cid>" y se queda en el socket hasta AT+CARECV.
+ * Cualquier otro "AT+XXX=..." responde OK.
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "sim.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include <time.h>
+
+namespace sim {
+
+static const uint64_t NUNCA = UINT64_MAX;
+static const uint32_t EPOCH_INICIO = 1760788800u; // 18/10/2025 12:00:00 UTC
+
+enum EstadoPdp { PDP_INACTIVO, PDP_ACTIVANDO, PDP_ACTIVO };
+
+struct Socket {
+    bool abierto = false;
+    std::string host;
+    uint16_t puerto = 0;
+    std::string entrada;          // Bytes del servidor sin leer (AT+CARECV)
+    uint32_t generacion = 0;      // Invalida respuestas de una conexión anterior
+};
+
+struct Modem {
+    bool iniciado = false;
+    bool encendido = false;
+    uint64_t listoUs = 0;         // A partir de aquí responde a "AT"
+    bool eco = true;
+    bool radio = true;            // AT+CFUN=1
+    uint64_t registradoUs = NUNCA;
+    EstadoPdp pdp = PDP_INACTIVO;
+    uint32_t generacionPdp = 0;   // Invalida URCs agendados
+    uint32_t generacionEnergia = 0;
+    bool gnss = false;
+    uint64_t gnssFixUs = NUNCA;
+    uint64_t ultimoFixUs = 0;
+    uint64_t inicioPulsoUs = NUNCA;
+
+    std::string linea;            // Comando en construcción
+    int datosPendientes = 0;      // Modo datos de AT+CASEND
+    int datosMux = 0;
+    bool ignorarLf = false;       // "\n" que sigue al "\r" de AT+CASEND
+    std::string datos;
+    uint64_t ocupadoHastaUs = 0;  // Último byte agendado en la UART
+    uint64_t tcpCaidoHastaUs = 0; // Corte del servidor (--caida)
+
+    Socket sockets[4];
+    std::deque<std::pair<uint64_t, uint8_t>> rx;
+};
+
+static Modem m;
+static std::vector<ReceptorTcp> receptores;
+
+static uint64_t usPorByte()
+{
+    // 10 bits por byte (START + 8 + STOP)
+    return (10ULL * 1000000ULL + config.uartBaudios - 1) / config.uartBaudios;
+}
+
+static void iniciar()
+{
+    if (m.iniciado) {
+        return;
+    }
+    m.iniciado = true;
+    m.encendido = config.modemEncendido || config.modemRegistrado || config.modemPdpActivo;
+    m.listoUs = 0;
+    // Un módem que ya estaba encendido normalmente ya tiene el eco apagado
+    m.eco = !m.encendido;
+    if (config.modemRegistrado || config.modemPdpActivo) {
+        m.registradoUs = 0;
+    } else if (m.encendido) {
+        m.registradoUs = config.modemRegistroMs * 1000ULL;
+    }
+    if (config.modemPdpActivo) {
+        m.pdp = PDP_ACTIVO;
+    }
+}
+
+static bool responde()
+{
+    return m.encendido && ahoraUs() >= m.listoUs;
+}
+
+static bool registrado()
+{
+    return m.encendido && m.radio && ahoraUs() >= m.registradoUs;
+}
+
+// Agenda texto en la UART hacia el XC01.
+static void enviar(const std::string &texto, uint64_t retardoUs = 0)
+{
+    if (config.trazaAt) {
+        std::string limpio;
+        for (char c : texto) {
+            limpio += (c == '\r') ? ' ' : (c == '\n') ? '|' : c;
+        }
+        fprintf(stderr, "[at %10.3f] << %s (+%.1f ms)\n", ahoraUs() / 1000.0,
+                limpio.c_str(), retardoUs / 1000.0);
+    }
+    uint64_t t = ahoraUs() + retardoUs;
+    if (t < m.ocupadoHastaUs) {
+        t = m.ocupadoHastaUs;
+    }
+    for (char c : texto) {
+        t += usPorByte();
+        m.rx.emplace_back(t, (uint8_t)c);
+    }
+    m.ocupadoHastaUs = t;
+}
+
+static uint64_t latencia(uint32_t extraMs = 0)
+{
+    return (uint64_t)(config.modemLatenciaAtMs + extraMs) * 1000ULL;
+}
+
+static void ok(const std::string &info = "", uint32_t extraMs = 0)
+{
+    std::string r;
+    if (!info.empty()) {
+        r += "\r\n" + info + "\r\n";
+    }
+    r += "\r\nOK\r\n";
+    enviar(r, latencia(extraMs));
+}
+
+static void error(uint32_t extraMs = 0)
+{
+    enviar("\r\nERROR\r\n", latencia(extraMs));
+}
+
+static void urc(const std::string &texto, uint64_t enUs)
+{
+    uint32_t gen = m.generacionEnergia;
+    programarUs(enUs, [texto, gen]() {
+        if (m.encendido && gen == m.generacionEnergia) {
+            enviar("\r\n" + texto + "\r\n");
+        }
+    });
+}
+
+static void cerrarSockets()
+{
+    for (int i = 0; i < 4; i++) {
+        if (m.sockets[i].abierto) {
+            m.sockets[i].abierto = false;
+            m.sockets[i].entrada.clear();
+            m.sockets[i].generacion++;
+            urc("+CASTATE: " + std::to_string(i) + ",0", ahoraUs() + 1000);
+        }
+    }
+}
+
+static void desactivarPdp()
+{
+    if (m.pdp != PDP_INACTIVO) {
+        m.generacionPdp++;
+        if (m.pdp == PDP_ACTIVO) {
+            contadores.cambiosModo++;
+        }
+        m.pdp = PDP_INACTIVO;
+        cerrarSockets();
+        urc("+APP PDP: 0,DEACTIVE", ahoraUs() + 200000);
+    }
+}
+
+static void encender()
+{
+    m.encendido = true;
+    m.generacionEnergia++;
+    m.listoUs = ahoraUs() + config.modemArranqueMs * 1000ULL;
+    m.eco = true;
+    m.radio = true;
+    m.registradoUs = m.listoUs + config.modemRegistroMs * 1000ULL;
+    m.pdp = PDP_INACTIVO;
+    m.gnss = false;
+    m.gnssFixUs = NUNCA;
+    m.linea.clear();
+    m.datosPendientes = 0;
+    for (Socket &s : m.sockets) {
+        s.abierto = false;
+    }
+    urc("RDY", m.listoUs);
+    urc("+CFUN: 1", m.listoUs + 100000);
+    urc("+CPIN: READY", m.listoUs + 200000);
+    urc("SMS Ready", m.listoUs + 1500000);
+}
+
+static void apagar()
+{
+    enviar("\r\nNORMAL POWER DOWN\r\n", 100000);
+    m.encendido = false;
+    m.generacionEnergia++;
+    m.pdp = PDP_INACTIVO;
+    m.gnss = false;
+    m.registradoUs = NUNCA;
+}
+
+
+//##################################################################
+// ### GNSS ###
+//##################################################################
+static std::string fechaUtc(uint64_t t_us, bool conMilisegundos)
+{
+    time_t t = (time_t)(EPOCH_INICIO + t_us / 1000000ULL);
+    struct tm f;
+    gmtime_r(&t, &f);
+    char buf[48];
+    if (conMilisegundos) {
+        snprintf(buf, sizeof(buf), "%04d%02d%02d%02d%02d%02d.%03d",
+                 f.tm_year + 1900, f.tm_mon + 1, f.tm_mday,
+                 f.tm_hour, f.tm_min, f.tm_sec, (int)((t_us / 1000ULL) % 1000ULL));
+    } else {
+        snprintf(buf, sizeof(buf), "%02d/%02d/%02d,%02d:%02d:%02d+00",
+                 f.tm_year % 100, f.tm_mon + 1, f.tm_mday,
+                 f.tm_hour, f.tm_min, f.tm_sec);
+    }
+    return buf;
+}
+
+// Recorrido simulado: sale de Guadalajara a 30 km/h girando despacio.
+static std::string lineaCgnsinf()
+{
+    if (!m.gnss) {
+        return "+CGNSINF: 0,,,,,,,,,,,,,,,,,,,,";
+    }
+    uint64_t t = ahoraUs();
+    if (t < m.gnssFixUs) {
+        return "+CGNSINF: 1,0,,,,,,,,,,,,,,,,,,,";
+    }
+    m.ultimoFixUs = t;
+
+    double s = t / 1e6;
+    double rumbo = fmod(45.0 + s * 0.05, 360.0);
+    double velKmh = 30.0 + 5.0 * sin(s / 60.0);
+    // Aproximación: 30 km/h ~ 0.0000749 grados por segundo
+    double lat = 20.673600 + 0.0000749 * s * cos(s / 2000.0);
+    double lon = -103.344000 + 0.0000749 * s * sin(s / 2000.0 + 0.8);
+
+    char buf[200];
+    snprintf(buf, sizeof(buf),
+             "+CGNSINF: 1,1,%s,%.6f,%.6f,%.3f,%.2f,%.1f,1,,0.9,1.3,0.9,,%d,%d,,,%d,,",
+             fechaUtc(t, true).c_str(), lat, lon, 1560.0 + 3.0 * sin(s / 120.0),
+             velKmh, rumbo, 12, 8, 38);
+    return buf;
+}
+
+
+//##################################################################
+// ### PROCESAMIENTO DE COMANDOS ###
+//##################################################################
+static bool empieza(const std::string &cmd, const char *prefijo)
+{
+    return cmd.compare(0, strlen(prefijo), prefijo) == 0;
+}
+
+static std::string comillas(const std::string &s, size_t &pos)
+{
+    size_t a = s.find('"', pos);
+    if (a == std::string::npos) {
+        return "";
+    }
+    size_t b = s.find('"', a + 1);
+    if (b == std::string::npos) {
+        return "";
+    }
+    pos = b + 1;
+    return s.substr(a + 1, b - a - 1);
+}
+
+static void procesar(const std::string &original)
+{
+    std::string cmd = original;
+    for (char &c : cmd) {
+        // Solo el comando en mayúsculas; los parámetros entre comillas no importan
+        if (c >= 'a' && c <= 'z') {
+            c = (char)(c - 'a' + 'A');
+        }
+    }
+    contadores.atComandos++;
+    if (config.trazaAt) {
+        fprintf(stderr, "[at %10.3f] >> %s\n", ahoraUs() / 1000.0, original.c_str());
+    }
+
+    if (m.eco) {
+        enviar(original + "\r");
+    }
+
+    if (cmd == "AT") {
+        ok();
+    } else if (cmd == "ATE0" || cmd == "ATE1") {
+        m.eco = (cmd == "ATE1");
+        ok();
+    } else if (cmd == "ATI") {
+        ok("SIM7080 R1951.03", 10);
+    } else if (cmd == "AT+CGMM") {
+        ok("SIMCOM_SIM7080G");
+    } else if (cmd == "AT+CGMR") {
+        ok("Revision:1951B03SIM7080");
+    } else if (cmd == "AT+CGSN") {
+        ok("860016040000001");
+    } else if (cmd == "AT+CPIN?") {
+        ok("+CPIN: READY");
+    } else if (cmd == "AT+CFUN?") {
+        ok(m.radio ? "+CFUN: 1" : "+CFUN: 0");
+    } else if (cmd == "AT+CFUN=0") {
+        m.radio = false;
+        m.registradoUs = NUNCA;
+        desactivarPdp();
+        ok("", 500);
+    } else if (cmd == "AT+CFUN=1") {
+        if (!m.radio) {
+            m.radio = true;
+            m.registradoUs = ahoraUs() + config.modemRegistroMs * 1000ULL;
+        }
+        ok("", 200);
+    } else if (cmd == "AT+CFUN=1,1") {
+        // Reinicio por software: responde OK y vuelve a arrancar
+        ok();
+        uint32_t gen = m.generacionEnergia;
+        programarUs(ahoraUs() + latencia() + 100000, [gen]() {
+            if (gen == m.generacionEnergia) {
+                if (m.pdp == PDP_ACTIVO || m.gnss) {
+                    contadores.cambiosModo++;
+                }
+                encender();
+            }
+        });
+    } else if (cmd == "AT+CPOWD=1") {
+        apagar();
+    } else if (cmd == "AT+CSQ") {
+        ok(m.radio ? "+CSQ: 21,99" : "+CSQ: 99,99");
+    } else if (cmd == "AT+CEREG?" || cmd == "AT+CREG?" || cmd == "AT+CGREG?") {
+        std::string nombre = cmd.substr(2, cmd.size() - 3);
+        ok(nombre + ": 0," + (registrado() ? "1" : "2"));
+    } else if (cmd == "AT+COPS?") {
+        ok(registrado() ? "+COPS: 0,0,\"Telcel\",9" : "+COPS: 0");
+    } else if (cmd == "AT+CNACT?") {
+        ok(m.pdp == PDP_ACTIVO ? "+CNACT: 0,1,\"10.45.3.7\"" : "+CNACT: 0,0,\"0.0.0.0\"");
+    } else if (cmd == "AT+CNACT=0,1") {
+        // REGLA DE ORO: no hay datos mientras el GNSS está encendido
+        if (m.gnss || m.pdp != PDP_INACTIVO || !m.radio) {
+            error();
+            return;
+        }
+        ok();
+        m.pdp = PDP_ACTIVANDO;
+        uint32_t gen = ++m.generacionPdp;
+        uint64_t base = ahoraUs() > m.registradoUs ? ahoraUs() : m.registradoUs;
+        if (m.registradoUs == NUNCA) {
+            base = ahoraUs() + 60000000ULL;
+        }
+        programarUs(base + config.modemAttachMs * 1000ULL, [gen]() {
+            if (gen == m.generacionPdp && m.pdp == PDP_ACTIVANDO && m.encendido) {
+                m.pdp = PDP_ACTIVO;
+                contadores.cambiosModo++;
+                enviar("\r\n+APP PDP: 0,ACTIVE\r\n");
+            }
+        });
+    } else if (cmd == "AT+CNACT=0,0") {
+        ok();
+        desactivarPdp();
+    } else if (cmd == "AT+CGNSPWR=1") {
+        // REGLA DE ORO: el GNSS no enciende con el PDP activo
+        if (m.pdp != PDP_INACTIVO) {
+            error();
+            return;
+        }
+        if (!m.gnss) {
+            m.gnss = true;
+            contadores.cambiosModo++;
+            bool tibio = m.ultimoFixUs && ahoraUs() - m.ultimoFixUs < 2ULL * 3600ULL * 1000000ULL;
+            m.gnssFixUs = ahoraUs() +
+                (tibio ? config.gnssTtffTibioMs : config.gnssTtffFrioMs) * 1000ULL;
+        }
+        ok("", 100);
+    } else if (cmd == "AT+CGNSPWR=0") {
+        if (m.gnss) {
+            m.gnss = false;
+            m.gnssFixUs = NUNCA;
+            contadores.cambiosModo++;
+        }
+        ok("", 50);
+    } else if (cmd == "AT+CGNSPWR?") {
+        ok(m.gnss ? "+CGNSPWR: 1" : "+CGNSPWR: 0");
+    } else if (cmd == "AT+CGNSINF") {
+        ok(lineaCgnsinf(), 10);
+    } else if (cmd == "AT+CCLK?") {
+        ok("+CCLK: \"" + fechaUtc(ahoraUs(), false) + "\"");
+    } else if (empieza(cmd, "AT+CAOPEN=")) {
+        int mux = atoi(cmd.c_str() + 10);
+        size_t pos = 0;
+        comillas(original, pos);                 // "TCP"
+        std::string host = comillas(original, pos);
+        size_t coma = original.find(',', pos);
+        uint16_t puerto = coma == std::string::npos ? 0 : (uint16_t)atoi(original.c_str() + coma + 1);
+        if (mux < 0 || mux > 3) {
+            error();
+            return;
+        }
+        int resultado = (m.pdp == PDP_ACTIVO && ahoraUs() >= m.tcpCaidoHastaUs) ? 0 : 1;
+        if (resultado == 0) {
+            m.sockets[mux].abierto = true;
+            m.sockets[mux].host = host;
+            m.sockets[mux].puerto = puerto;
+            m.sockets[mux].entrada.clear();
+            m.sockets[mux].generacion++;
+        }
+        ok("+CAOPEN: " + std::to_string(mux) + "," + std::to_string(resultado), config.tcpAbrirMs);
+    } else if (empieza(cmd, "AT+CASEND=")) {
+        int mux = atoi(cmd.c_str() + 10);
+        size_t coma = cmd.find(',');
+        int n = coma == std::string::npos ? 0 : atoi(cmd.c_str() + coma + 1);
+        if (mux < 0 || mux > 3 || !m.sockets[mux].abierto || n <= 0) {
+            error();
+            return;
+        }
+        enviar("\r\n> ", latencia());
+        m.datosPendientes = n;
+        m.datosMux = mux;
+        m.ignorarLf = true;
+        m.datos.clear();
+    } else if (empieza(cmd, "AT+CARECV=")) {
+        // +CARECV: <n>,<n bytes>   (sin datos: +CARECV: 0)
+        int mux = atoi(cmd.c_str() + 10);
+        size_t coma = cmd.find(',');
+        int max = coma == std::string::npos ? 0 : atoi(cmd.c_str() + coma + 1);
+        if (mux < 0 || mux > 3 || !m.sockets[mux].abierto || max <= 0) {
+            error();
+            return;
+        }
+        std::string &entrada = m.sockets[mux].entrada;
+        size_t n = std::min((size_t)max, entrada.size());
+        std::string info = "+CARECV: " + std::to_string(n);
+        if (n > 0) {
+            info += "," + entrada.substr(0, n);
+            entrada.erase(0, n);
+        }
+        ok(info);
+    } else if (empieza(cmd, "AT+CACLOSE=")) {
+        int mux = atoi(cmd.c_str() + 11);
+        if (mux >= 0 && mux <= 3) {
+            m.sockets[mux].abierto = false;
+            m.sockets[mux].entrada.clear();
+            m.sockets[mux].generacion++;
+        }
+        ok("", 100);
+    } else if (cmd == "AT+CASTATE?") {
+        std::string info;
+        for (int i = 0; i < 4; i++) {
+            if (m.sockets[i].abierto) {
+                if (!info.empty()) {
+                    info += "\r\n";
+                }
+                info += "+CASTATE: " + std::to_string(i) + ",1";
+            }
+        }
+        ok(info);
+    } else if (empieza(cmd, "AT+")) {
+        ok();
+    } else {
+        error();
+    }
+}
+
+static void datosCompletos()
+{
+    Socket &s = m.sockets[m.datosMux];
+    contadores.tcpEnvios++;
+    contadores.tcpBytes += m.datos.size();
+    std::string respuesta;
+    for (const ReceptorTcp &r : receptores) {
+        respuesta += r(s.host.c_str(), s.puerto, (const uint8_t *)m.datos.data(), m.datos.size());
+    }
+    m.datosPendientes = 0;
+    m.datos.clear();
+    ok("", config.tcpEnvioMs);
+
+    if (!respuesta.empty()) {
+        int mux = m.datosMux;
+        uint32_t gen = s.generacion;
+        uint64_t llega = ahoraUs() + latencia(config.tcpEnvioMs + config.tcpRespuestaMs);
+        programarUs(llega, [mux, gen, respuesta]() {
+            Socket &destino = m.sockets[mux];
+            if (destino.abierto && destino.generacion == gen) {
+                destino.entrada += respuesta;
+                urc("+CADATAIND: " + std::to_string(mux), ahoraUs());
+            }
+        });
+    }
+}
+
+void modemRecibir(uint8_t b)
+{
+    iniciar();
+    contadores.uartBytesTx++;
+    if (!responde()) {
+        return;
+    }
+    if (m.datosPendientes > 0) {
+        // TinyGSM termina el comando con "\r\n" y el módem entra a modo
+        // datos con el "\r": ese "\n" no es parte de los datos.
+        if (m.ignorarLf) {
+            m.ignorarLf = false;
+            if (b == '\n') {
+                return;
+            }
+        }
+        m.datos += (char)b;
+        if ((int)m.datos.size() >= m.datosPendientes) {
+            datosCompletos();
+        }
+        return;
+    }
+    if (b == '\r') {
+        if (!m.linea.empty()) {
+            procesar(m.linea);
+        }
+        m.linea.clear();
+    } else if (b != '\n') {
+        m.linea += (char)b;
+    }
+}
+
+int modemDisponibles()
+{
+    iniciar();
+    int n = 0;
+    for (const auto &p : m.rx) {
+        if (p.first > ahoraUs()) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+int modemLeer()
+{
+    iniciar();
+    if (m.rx.empty() || m.rx.front().first > ahoraUs()) {
+        return -1;
+    }
+    uint8_t b = m.rx.front().second;
+    m.rx.pop_front();
+    contadores.uartBytesRx++;
+    return b;
+}
+
+int modemVer()
+{
+    iniciar();
+    if (m.rx.empty() || m.rx.front().first > ahoraUs()) {
+        return -1;
+    }
+    return m.rx.front().second;
+}
+
+uint64_t modemProximoByteUs()
+{
+    iniciar();
+    return m.rx.empty() ? 0 : m.rx.front().first;
+}
+
+void modemPwrKey(uint8_t nivel)
+{
+    iniciar();
+    if (nivel == HIGH) {
+        m.inicioPulsoUs = ahoraUs();
+        return;
+    }
+    if (m.inicioPulsoUs == NUNCA) {
+        return;
+    }
+    uint64_t duracion = ahoraUs() - m.inicioPulsoUs;
+    m.inicioPulsoUs = NUNCA;
+
+    // SIM7080G: pulso >= 1 s enciende, >= 1.2 s apaga si ya estaba encendido
+    if (!m.encendido && duracion >= 1000000ULL) {
+        encender();
+    } else if (m.encendido && duracion >= 1200000ULL) {
+        if (m.pdp == PDP_ACTIVO || m.gnss) {
+            contadores.cambiosModo++;
+        }
+        apagar();
+    }
+}
+
+bool modemGnssEncendido()
+{
+    iniciar();
+    return m.gnss;
+}
+
+bool modemPdpActivo()
+{
+    iniciar();
+    return m.pdp == PDP_ACTIVO;
+}
+
+void modemCaidaTcp(uint32_t duracionMs)
+{
+    iniciar();
+    m.tcpCaidoHastaUs = ahoraUs() + duracionMs * 1000ULL;
+    cerrarSockets();
+}
+
+void agregarReceptorTcp(ReceptorTcp r)
+{
+    receptores.push_back(r);
+}
+
+uint32_t epochUtc()
+{
+    return EPOCH_INICIO + (uint32_t)(ahoraUs() / 1000000ULL);
+}
+
+} // namespace sim
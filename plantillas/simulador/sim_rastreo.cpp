@@ -0,0 +1,156 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: SERVIDOR DE RASTREO (LOTES Y GEOCERCAS)
+ *
+ * Hace de servidor para plantilla_conexion_gnss.c en SIM_RASTREO_HOST.
+ * Cada conexión trae UN lote:
+ *   binario  2 bytes (largo del trayecto, big endian) + bloque de
+ *            XC03-Trayecto.h + bloque de eventos de XC03-Geocerca.h
+ *   CSV      una línea por posición y "GEO,t,id,ENTRADA|SALIDA" por
+ *            evento
+ * y se contesta "OK,<n>\n" seguido de n bytes de cercas (texto de
+ * geoLoad()). La primera respuesta trae las cercas de ejemplo; las
+ * demás, ninguna (n = 0).
+ *
+ * Con --traza-broker imprime cada lote en stderr:
+ *   [rastreo] 241.120 s  20 posiciones, 2 eventos: 2 ENTRADA 2 SALIDA
+ * ===================================================================
+ */
+#include "Arduino.h"
+#include "sim.h"
+#include "../XC03-Trayecto.h"
+#include "../XC03-Geocerca.h"
+
+#include <algorithm>
+#include <string>
+
+namespace sim {
+
+// Las mismas cercas que el ejemplo de localizador_gps_dedicado.ino.c; el
+// recorrido simulado pasa por la zona en L y por el cliente
+static const char CERCAS[] =
+    "X\n"
+    "C,1,20.676300,-103.342000,200\n"
+    "P,2,20.683500,-103.338000,20.683500,-103.334000,20.687000,-103.334000,"
+    "20.687000,-103.330000,20.690000,-103.330000,20.690000,-103.338000\n"
+    "C,3,20.702963,-103.318790,100\n"
+    "C,10,20.659700,-103.349400,300\n"
+    "P,11,20.640000,-103.400000,20.640000,-103.390000,20.650000,-103.395000\n";
+
+static struct {
+    bool traza = false;
+    bool cercasEnviadas = false;
+    uint64_t lotes = 0;
+    uint64_t bytes = 0;
+    uint64_t posiciones = 0;
+    uint64_t eventos = 0;
+    uint64_t errores = 0;               // Lotes que no se pudieron leer
+} rastreo;
+
+static void rastreoBinario(const uint8_t *datos, size_t n, uint32_t *posiciones, std::string *eventos)
+{
+    if (n < 2 || 2u + ((datos[0] << 8) | datos[1]) > n) {
+        rastreo.errores++;
+        return;
+    }
+    uint16_t largo = (uint16_t)((datos[0] << 8) | datos[1]);
+
+    TrackReader r;
+    TrackPoint p;
+    if (!trackReaderBegin(&r, datos + 2, largo)) {
+        rastreo.errores++;
+        return;
+    }
+    while (trackNext(&r, &p)) {
+        (*posiciones)++;
+    }
+
+    const uint8_t *geo = datos + 2 + largo;
+    uint16_t geoLen = (uint16_t)(n - 2 - largo);
+    uint16_t pos = 1;
+    uint32_t lastT = 0;
+    GeoEvent ev;
+    while (geoEventsNext(geo, geoLen, &pos, &lastT, &ev)) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), " %u %s", ev.fenceId, ev.type == GEO_ENTER ? "ENTRADA" : "SALIDA");
+        *eventos += buf;
+        rastreo.eventos++;
+    }
+    if (geoLen < 1 || geo[0] != GEO_EVENTS_FORMAT || pos != geoLen) {
+        rastreo.errores++;
+    }
+}
+
+static void rastreoCsv(const uint8_t *datos, size_t n, uint32_t *posiciones, std::string *eventos)
+{
+    std::string texto((const char *)datos, n);
+    size_t inicio = 0;
+
+    while (inicio < texto.size()) {
+        size_t fin = texto.find('\n', inicio);
+        if (fin == std::string::npos) {
+            fin = texto.size();
+        }
+        std::string linea = texto.substr(inicio, fin - inicio);
+        if (linea.compare(0, 4, "GEO,") == 0) {
+            std::string evento = linea.substr(linea.find(',', 4) + 1);
+            std::replace(evento.begin(), evento.end(), ',', ' ');
+            *eventos += " " + evento;
+            rastreo.eventos++;
+        } else if (!linea.empty()) {
+            (*posiciones)++;
+        }
+        inicio = fin + 1;
+    }
+}
+
+static std::string rastreoRecibir(const char *host, uint16_t puerto, const uint8_t *datos, size_t n)
+{
+    (void)puerto;
+    if (strcmp(host, SIM_RASTREO_HOST) != 0 || n == 0) {
+        return "";
+    }
+    rastreo.lotes++;
+    rastreo.bytes += n;
+
+    uint32_t posiciones = 0;
+    std::string eventos;
+    // Un CSV empieza con el año o con "GEO"; el binario, con el largo
+    if (datos[0] >= '0') {
+        rastreoCsv(datos, n, &posiciones, &eventos);
+    } else {
+        rastreoBinario(datos, n, &posiciones, &eventos);
+    }
+    rastreo.posiciones += posiciones;
+    if (rastreo.traza) {
+        fprintf(stderr, "[rastreo] %.3f s  %u posiciones, eventos:%s\n", ahoraUs() / 1e6,
+                (unsigned)posiciones, eventos.empty() ? " ninguno" : eventos.c_str());
+    }
+
+    std::string cercas;
+    if (!rastreo.cercasEnviadas) {
+        rastreo.cercasEnviadas = true;
+        cercas = CERCAS;
+    }
+    return "OK," + std::to_string(cercas.size()) + "\n" + cercas;
+}
+
+void rastreoIniciar(bool traza)
+{
+    rastreo.traza = traza;
+    agregarReceptorTcp(rastreoRecibir);
+}
+
+void rastreoResumen()
+{
+    if (rastreo.lotes == 0) {
+        return;
+    }
+    fprintf(stderr, "[sim] rastreo: %llu lotes/%llu B, %llu posiciones, %llu eventos de geocercas, "
+                    "errores %llu\n",
+            (unsigned long long)rastreo.lotes, (unsigned long long)rastreo.bytes,
+            (unsigned long long)rastreo.posiciones, (unsigned long long)rastreo.eventos,
+            (unsigned long long)rastreo.errores);
+}
+
+} // namespace sim
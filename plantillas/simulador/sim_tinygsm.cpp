@@ -0,0 +1,537 @@
+/*
+ * ===================================================================
+ * SIMULADOR XC01: SUSTITUTO DE TinyGSM (SIM7080)
+ *
+ * Sigue la misma secuencia de comandos AT que la librería real, así
+ * que los tiempos y el número de comandos por llamada son parecidos a
+ * los de la placa.
+ * ===================================================================
+ */
+#include "TinyGsmClient.h"
+#include "sim.h"
+
+// Lee un byte esperando (en tiempo simulado) hasta limiteUs.
+static int leerConEspera(Stream &s, uint64_t limiteUs)
+{
+    for (;;) {
+        int c = s.read();
+        if (c >= 0) {
+            return c;
+        }
+        if (sim::ahoraUs() >= limiteUs) {
+            return -1;
+        }
+        sim::esperarHastaUs(limiteUs);
+    }
+}
+
+static bool terminaCon(const String &data, GsmConstStr r)
+{
+    return r && data.endsWith(String(r));
+}
+
+
+//##################################################################
+// ### RESPUESTAS Y URCs ###
+//##################################################################
+bool TinyGsmSim7080::handleURC(const String &linea)
+{
+    if (linea.startsWith("+APP PDP: 0,ACTIVE")) {
+        pdpActivo_ = true;
+    } else if (linea.startsWith("+APP PDP: 0,DEACTIVE")) {
+        pdpActivo_ = false;
+        for (bool &s : sockConectado_) {
+            s = false;
+        }
+    } else if (linea.startsWith("+CADATAIND: ")) {
+        int mux = linea.substring(12).toInt();
+        if (mux >= 0 && mux < 4) {
+            sockDatos_[mux] = true;
+        }
+    } else if (linea.startsWith("+CASTATE: ")) {
+        int mux = linea.substring(10).toInt();
+        int estado = linea.substring(linea.indexOf(',') + 1).toInt();
+        if (mux >= 0 && mux < 4 && estado == 0) {
+            sockConectado_[mux] = false;
+        }
+    } else if (linea == "RDY" || linea == "SMS Ready" || linea.startsWith("+CFUN:") ||
+               linea.startsWith("+CPIN:") || linea == "NORMAL POWER DOWN") {
+        // Mensajes de arranque: no hay nada que hacer
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int8_t TinyGsmSim7080::waitResponse(uint32_t timeout_ms, String &data,
+                                    GsmConstStr r1, GsmConstStr r2, GsmConstStr r3,
+                                    GsmConstStr r4, GsmConstStr r5)
+{
+    data = "";
+    uint64_t limite = sim::ahoraUs() + (uint64_t)timeout_ms * 1000ULL;
+    size_t inicioLinea = 0;
+
+    for (;;) {
+        int c = leerConEspera(stream, limite);
+        if (c < 0) {
+            return 0;
+        }
+        data += (char)c;
+
+        if (terminaCon(data, r1)) return 1;
+        if (terminaCon(data, r2)) return 2;
+        if (terminaCon(data, r3)) return 3;
+        if (terminaCon(data, r4)) return 4;
+        if (terminaCon(data, r5)) return 5;
+
+        if (c == '\n') {
+            String linea = data.substring(inicioLinea);
+            linea.trim();
+            if (handleURC(linea)) {
+                // Se descarta el URC para que no contamine la respuesta
+                data = data.substring(0, inicioLinea);
+            }
+            inicioLinea = data.length();
+        }
+    }
+}
+
+bool TinyGsmSim7080::streamSkipUntil(char c, uint32_t timeout_ms)
+{
+    uint64_t limite = sim::ahoraUs() + (uint64_t)timeout_ms * 1000ULL;
+    for (;;) {
+        int leido = leerConEspera(stream, limite);
+        if (leido < 0) {
+            return false;
+        }
+        if (leido == c) {
+            return true;
+        }
+    }
+}
+
+void TinyGsmSim7080::maintain()
+{
+    String linea;
+    while (stream.available()) {
+        char c = (char)stream.read();
+        if (c == '\n') {
+            linea.trim();
+            handleURC(linea);
+            linea = "";
+        } else {
+            linea += c;
+        }
+    }
+}
+
+
+//##################################################################
+// ### ARRANQUE ###
+//##################################################################
+bool TinyGsmSim7080::testAT(uint32_t timeout_ms)
+{
+    unsigned long inicio = millis();
+    while (millis() - inicio < timeout_ms) {
+        sendAT("");
+        if (waitResponse(200) == 1) {
+            return true;
+        }
+        delay(100);
+    }
+    return false;
+}
+
+bool TinyGsmSim7080::init(const char *pin)
+{
+    if (!testAT()) {
+        return false;
+    }
+    sendAT("E0");
+    if (waitResponse() != 1) {
+        return false;
+    }
+    sendAT("+CMEE=0");
+    waitResponse();
+
+    SimStatus estado = getSimStatus();
+    if (estado == SIM_LOCKED && pin && strlen(pin) > 0) {
+        simUnlock(pin);
+        return getSimStatus() == SIM_READY;
+    }
+    return estado == SIM_READY || estado == SIM_LOCKED;
+}
+
+bool TinyGsmSim7080::restart(const char *pin)
+{
+    if (!testAT()) {
+        return false;
+    }
+    sendAT("+CFUN=0");
+    waitResponse(10000L);
+    sendAT("+CFUN=1,1");
+    waitResponse(10000L);
+    delay(5000L);
+    return init(pin);
+}
+
+bool TinyGsmSim7080::poweroff()
+{
+    sendAT("+CPOWD=1");
+    return waitResponse(GF("NORMAL POWER DOWN")) == 1;
+}
+
+String TinyGsmSim7080::getModemInfo()
+{
+    sendAT("I");
+    String res;
+    if (waitResponse(1000L, res) != 1) {
+        return "";
+    }
+    res.replace(GSM_NL "OK" GSM_NL, "");
+    res.replace(GSM_NL, " ");
+    res.trim();
+    return res;
+}
+
+bool TinyGsmSim7080::simUnlock(const char *pin)
+{
+    sendAT("+CPIN=\"", pin, "\"");
+    return waitResponse() == 1;
+}
+
+SimStatus TinyGsmSim7080::getSimStatus(uint32_t timeout_ms)
+{
+    for (unsigned long inicio = millis(); millis() - inicio < timeout_ms;) {
+        sendAT("+CPIN?");
+        if (waitResponse(GF(GSM_NL "+CPIN:")) != 1) {
+            delay(1000);
+            continue;
+        }
+        String estado;
+        int8_t r = waitResponse(1000L, estado, GF("READY"), GF("SIM PIN"), GF("SIM PUK"));
+        waitResponse();
+        switch (r) {
+            case 1: return SIM_READY;
+            case 2:
+            case 3: return SIM_LOCKED;
+            default: return SIM_ERROR;
+        }
+    }
+    return SIM_ERROR;
+}
+
+
+//##################################################################
+// ### RED CELULAR ###
+//##################################################################
+bool TinyGsmSim7080::isNetworkConnected()
+{
+    sendAT("+CEREG?");
+    if (waitResponse(GF(GSM_NL "+CEREG:")) != 1) {
+        return false;
+    }
+    streamSkipUntil(',');
+    String estado = stream.readStringUntil('\n');
+    waitResponse();
+    int s = estado.toInt();
+    return s == 1 || s == 5;
+}
+
+bool TinyGsmSim7080::waitForNetwork(uint32_t timeout_ms)
+{
+    for (unsigned long inicio = millis(); millis() - inicio < timeout_ms;) {
+        if (isNetworkConnected()) {
+            return true;
+        }
+        delay(250);
+    }
+    return false;
+}
+
+int16_t TinyGsmSim7080::getSignalQuality()
+{
+    sendAT("+CSQ");
+    if (waitResponse(GF(GSM_NL "+CSQ:")) != 1) {
+        return 99;
+    }
+    String rssi = stream.readStringUntil(',');
+    waitResponse();
+    return (int16_t)rssi.toInt();
+}
+
+bool TinyGsmSim7080::gprsConnect(const char *apn, const char *user, const char *pwd)
+{
+    gprsDisconnect();
+
+    sendAT("+CNCFG=0,1,\"", apn, "\",\"", user ? user : "", "\",\"", pwd ? pwd : "", "\"");
+    waitResponse();
+
+    sendAT("+CNACT=0,1");
+    if (waitResponse(60000L, GF("+APP PDP: 0,ACTIVE")) != 1) {
+        return false;
+    }
+    pdpActivo_ = true;
+    return true;
+}
+
+bool TinyGsmSim7080::gprsDisconnect()
+{
+    sendAT("+CNACT=0,0");
+    if (waitResponse(60000L) != 1) {
+        return false;
+    }
+    pdpActivo_ = false;
+    return true;
+}
+
+bool TinyGsmSim7080::isGprsConnected()
+{
+    sendAT("+CNACT?");
+    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) {
+        return false;
+    }
+    streamSkipUntil(',');
+    String estado = stream.readStringUntil(',');
+    waitResponse();
+    pdpActivo_ = estado.toInt() == 1;
+    return pdpActivo_;
+}
+
+String TinyGsmSim7080::getLocalIP()
+{
+    sendAT("+CNACT?");
+    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) {
+        return "";
+    }
+    streamSkipUntil('"');
+    String ip = stream.readStringUntil('"');
+    waitResponse();
+    return ip;
+}
+
+
+//##################################################################
+// ### GNSS ###
+//##################################################################
+bool TinyGsmSim7080::getNetworkTime(int *year, int *month, int *day,
+                                    int *hour, int *minute, int *second, float *timezone)
+{
+    // +CCLK: "aa/MM/dd,hh:mm:ss±zz" (zz en cuartos de hora)
+    sendAT("+CCLK?");
+    if (waitResponse(2000L, GF("+CCLK: \"")) != 1) {
+        return false;
+    }
+    int a = stream.readStringUntil('/').toInt();
+    int mes = stream.readStringUntil('/').toInt();
+    int dia = stream.readStringUntil(',').toInt();
+    int h = stream.readStringUntil(':').toInt();
+    int m = stream.readStringUntil(':').toInt();
+    String resto = stream.readStringUntil('"');
+    waitResponse();
+
+    int signo = resto.indexOf('-') >= 0 ? -1 : 1;
+    int corte = resto.indexOf(signo < 0 ? '-' : '+');
+    int s = resto.substring(0, corte).toInt();
+    int cuartos = corte >= 0 ? (int)resto.substring(corte + 1).toInt() : 0;
+
+    if (year) *year = a + 2000;
+    if (month) *month = mes;
+    if (day) *day = dia;
+    if (hour) *hour = h;
+    if (minute) *minute = m;
+    if (second) *second = s;
+    if (timezone) *timezone = signo * cuartos / 4.0f;
+    return a > 0;
+}
+
+bool TinyGsmSim7080::enableGPS()
+{
+    sendAT("+CGNSPWR=1");
+    return waitResponse() == 1;
+}
+
+bool TinyGsmSim7080::disableGPS()
+{
+    sendAT("+CGNSPWR=0");
+    return waitResponse() == 1;
+}
+
+String TinyGsmSim7080::getGPSraw()
+{
+    sendAT("+CGNSINF");
+    if (waitResponse(10000L, GF(GSM_NL "+CGNSINF:")) != 1) {
+        return "";
+    }
+    String res = stream.readStringUntil('\n');
+    waitResponse();
+    res.trim();
+    return res;
+}
+
+bool TinyGsmSim7080::getGPS(float *lat, float *lon, float *speed, float *alt,
+                            int *vsat, int *usat, float *accuracy,
+                            int *year, int *month, int *day,
+                            int *hour, int *minute, int *second)
+{
+    sendAT("+CGNSINF");
+    if (waitResponse(10000L, GF(GSM_NL "+CGNSINF:")) != 1) {
+        return false;
+    }
+
+    // Igual que TinyGSM: un String por campo
+    stream.readStringUntil(',');                              // GNSS run status
+    if (stream.readStringUntil(',').toInt() != 1) {           // Fix status
+        waitResponse();
+        return false;
+    }
+
+    String utc = stream.readStringUntil(',');
+    float ilat = stream.readStringUntil(',').toFloat();
+    float ilon = stream.readStringUntil(',').toFloat();
+    float ialt = stream.readStringUntil(',').toFloat();
+    float ispeed = stream.readStringUntil(',').toFloat();
+    stream.readStringUntil(',');                              // Course
+    stream.readStringUntil(',');                              // Fix mode
+    stream.readStringUntil(',');                              // Reserved1
+    float iaccuracy = stream.readStringUntil(',').toFloat();  // HDOP
+    stream.readStringUntil(',');                              // PDOP
+    stream.readStringUntil(',');                              // VDOP
+    stream.readStringUntil(',');                              // Reserved2
+    int ivsat = (int)stream.readStringUntil(',').toInt();     // Sats en vista
+    int iusat = (int)stream.readStringUntil(',').toInt();     // Sats usados
+    stream.readStringUntil('\n');
+    waitResponse();
+
+    if (lat) *lat = ilat;
+    if (lon) *lon = ilon;
+    if (speed) *speed = ispeed;
+    if (alt) *alt = ialt;
+    if (vsat) *vsat = ivsat;
+    if (usat) *usat = iusat;
+    if (accuracy) *accuracy = iaccuracy;
+    if (year) *year = (int)utc.substring(0, 4).toInt();
+    if (month) *month = (int)utc.substring(4, 6).toInt();
+    if (day) *day = (int)utc.substring(6, 8).toInt();
+    if (hour) *hour = (int)utc.substring(8, 10).toInt();
+    if (minute) *minute = (int)utc.substring(10, 12).toInt();
+    if (second) *second = (int)utc.substring(12, 14).toInt();
+    return true;
+}
+
+
+//##################################################################
+// ### TinyGsmClient (TCP sobre AT+CAOPEN / AT+CASEND) ###
+//##################################################################
+int TinyGsmClient::connect(const char *host, uint16_t puerto, int timeout_s)
+{
+    if (!at_) {
+        return 0;
+    }
+    stop();
+    at_->sendAT("+CAOPEN=", mux_, ",0,\"TCP\",\"", host, "\",", puerto);
+    if (at_->waitResponse((uint32_t)timeout_s * 1000UL, GF(GSM_NL "+CAOPEN:")) != 1) {
+        return 0;
+    }
+    at_->streamSkipUntil(',');
+    String resultado = at_->stream.readStringUntil('\n');
+    at_->waitResponse();
+    at_->sockConectado_[mux_] = resultado.toInt() == 0;
+    at_->sockDatos_[mux_] = false;
+    rx_.clear();
+    return at_->sockConectado_[mux_];
+}
+
+void TinyGsmClient::stop()
+{
+    if (!at_ || !at_->sockConectado_[mux_]) {
+        return;
+    }
+    at_->sendAT("+CACLOSE=", mux_);
+    at_->waitResponse(3000);
+    at_->sockConectado_[mux_] = false;
+    rx_.clear();
+}
+
+uint8_t TinyGsmClient::connected()
+{
+    if (!at_) {
+        return 0;
+    }
+    at_->maintain();
+    return at_->sockConectado_[mux_];
+}
+
+size_t TinyGsmClient::write(const uint8_t *buf, size_t n)
+{
+    if (!at_ || !at_->sockConectado_[mux_] || n == 0) {
+        return 0;
+    }
+    at_->sendAT("+CASEND=", mux_, ",", (unsigned)n);
+    if (at_->waitResponse(GF(">")) != 1) {
+        return 0;
+    }
+    at_->stream.write(buf, n);
+    if (at_->waitResponse(10000L) != 1) {
+        return 0;
+    }
+    return n;
+}
+
+// +CARECV: <n>,<n bytes>  (sin datos: +CARECV: 0)
+void TinyGsmClient::recibir()
+{
+    at_->sendAT("+CARECV=", mux_, ",1460");
+    if (at_->waitResponse(GF("+CARECV:")) != 1) {
+        return;
+    }
+    uint64_t limite = sim::ahoraUs() + 1000000ULL;
+    String n;
+    for (;;) {
+        int c = leerConEspera(at_->stream, limite);
+        if (c < 0 || c == ',' || c == '\n') {
+            break;
+        }
+        n += (char)c;
+    }
+    int len = n.toInt();
+    while (len-- > 0) {
+        uint8_t b;
+        if (at_->stream.readBytes(&b, 1) != 1) {
+            break;
+        }
+        rx_ += (char)b;
+    }
+    at_->waitResponse();
+}
+
+int TinyGsmClient::available()
+{
+    if (!at_) {
+        return 0;
+    }
+    if (rx_.empty() && at_->sockConectado_[mux_]) {
+        at_->maintain();
+        if (at_->sockDatos_[mux_] || millis() - ultimaConsulta_ >= 500) {
+            at_->sockDatos_[mux_] = false;
+            ultimaConsulta_ = millis();
+            recibir();
+        }
+    }
+    return (int)rx_.size();
+}
+
+int TinyGsmClient::read()
+{
+    if (available() == 0) {
+        return -1;
+    }
+    uint8_t b = (uint8_t)rx_[0];
+    rx_.erase(0, 1);
+    return b;
+}
+
+int TinyGsmClient::peek()
+{
+    return available() > 0 ? (uint8_t)rx_[0] : -1;
+}
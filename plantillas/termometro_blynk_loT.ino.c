@@ -3,29 +3,87 @@
  * PROYECTO:      Termómetro Celular LTE
  * AUTOR:         [TU NOMBRE O NOMBRE DE EQUIPO]
  * FECHA:         Octubre 2025
- * VERSIÓN:       1.1 (Lectura de Sensor XN04)
+ * VERSIÓN:       1.10 (Latencia del Loop Medida)
  *
  * DESCRIPCIÓN:
  * Implementación para el Hackathon 2025 de Microside.
  * El sistema lee la temperatura del sensor XN04 (I2C) y la envía
  * a Blynk.Cloud usando el módulo celular XC03 (SIM7080G).
- * También recibe un umbral de temperatura desde Blynk para
- * realizar comparaciones locales.
+ * También recibe umbrales de temperatura desde Blynk y con ellos
+ * controla relevadores (XN11) y salidas (XN02) AQUÍ MISMO, sin
+ * esperar a la nube (SECCIÓN 13).
+ *
+ * Las muestras NO se envían una por una: se guardan con su hora en
+ * un buffer circular (RAM interna + PSRAM opcional) y se suben en
+ * ráfagas con su marca de tiempo. Si se pierde la conexión no se
+ * pierde ninguna muestra: se suben todas al reconectar.
+ *
+ * Los valores "en vivo" (humedad, luz) pasan por una capa de
+ * publicación: todo lo que se escribe en una vuelta del scheduler
+ * sale junto en UN solo mensaje agrupado.
+ *
+ * El XN04 lo lee una tarea de FreeRTOS en el núcleo 0 (el loop() de
+ * Arduino corre en el núcleo 1). La tarea es la ÚNICA que usa el bus
+ * I2C y deja cada lectura en una "foto" protegida por un seqlock, que
+ * loop() y los callbacks de Blynk leen sin bloquearse. Así una
+ * transferencia I2C lenta no frena a Blynk, ni una espera del módem
+ * atrasa las lecturas.
+ *
+ * El módem arranca con una máquina de estados (SECCIÓN 14): en lugar
+ * de esperar tiempos fijos pregunta "AT", el registro y el PDP hasta
+ * que están listos. Mientras tanto el sensor ya está midiendo y las
+ * muestras se guardan en el buffer. Al salir el primer dato se
+ * imprime cuánto tardó cada etapa del arranque.
+ * Antes del pulso se pregunta "AT": si el módem contesta es que sólo
+ * se reinició el ESP32, y el registro y el PDP que ya tenía se usan
+ * tal cual (arranque en caliente, ~2 s en lugar de ~19 s).
+ *
+ * El XN04 se lee 5 veces por segundo, pero a la nube sólo sube un
+ * resumen por ventana de 60 s: promedio (V2), mínimo, máximo,
+ * desviación estándar y número de muestras (XN-Estadisticas.h).
+ * Es mejor dato que una lectura suelta y cuesta lo mismo de subir.
+ *
+ * Con TELEMETRY_UPLINK_BINARY en 1 los resúmenes y los valores en
+ * vivo SUBEN en tramas binarias (XC03-Telemetria.h) por una conexión
+ * TCP propia: ~18 bytes por resumen en lugar de ~100, y una ráfaga
+ * completa en un solo envío. Blynk se queda para los umbrales y el
+ * control desde la app.
+ *
+ * Cada pieza del loop() (arranque del módem, Blynk.run(),
+ * scheduler.run() y cada timer) se mide con el contador de ciclos
+ * (XC01-Latencia.h). Una pieza que tarda más de su presupuesto se
+ * reporta en el momento; cada 10 minutos sale la tabla completa por
+ * Serial y un resumen en V12.
+ *
+ * Reglas locales: cada lectura (5 Hz) se compara con los umbrales
+ * con histéresis y tiempos mínimos encendido/apagado, y la tarea de
+ * adquisición mueve el relevador en la misma vuelta. La reacción
+ * tarda lo que un periodo de muestreo (200 ms), no un viaje por LTE.
  *
  * ===================================================================
  * HARDWARE UTILIZADO:
  * - Controlador:   Microside XC01 R5-I (ESP32-S3)
  * - Celular/GPS:   Microside XC03 (SIM7080G)
  * - Sensores:      Microside XN04 (Temp/Hum/Luz)
- * - Actuadores:    (Ninguno en esta versión)
+ * - Actuadores:    Microside XN11 (Relevadores), XN02 (Salidas)
  *
  * ===================================================================
  * MAPA DE PINES VIRTUALES (BLYNK Vpin):
  * -------------------------------------------------------------------
  * V0 (Entrada): Control Remoto de BOARD_LED (0=OFF, 1=ON)
  *
- * V2 (Salida):  Lectura de Temperatura (XN04)
- * V3 (Entrada): Umbral de Temperatura (para comparación local)
+ * V2 (Salida):  Lectura de Temperatura (XN04, con marca de tiempo)
+ * V3 (Entrada): Umbral de Temperatura alta (ventilador, XN11 relevador 1
+ *               e indicador, XN02 salida 1)
+ * V4 (Salida):  Humedad relativa en % (XN04)
+ * V5 (Salida):  Luz en lux (XN04)
+ * V6 (Salida):  Temperatura mínima de la ventana
+ * V7 (Salida):  Temperatura máxima de la ventana
+ * V8 (Salida):  Desviación estándar de la temperatura en la ventana
+ * V9 (Salida):  Muestras en la ventana
+ * V10 (Salida): Reglas activas (bit 0 = regla 0, ...)
+ * V11 (Entrada): Umbral de Temperatura baja (calefactor, XN11 relevador 2)
+ * V12 (Salida): Latencia del loop: "pieza máx_ms/bloqueos ..." (texto)
  * ===================================================================
  */
 
@@ -63,6 +121,10 @@
  * * BLYNK_CONNECTED()
  * Para QUÉ: Función "callback" que se ejecuta automáticamente
  * justo cuando la conexión con Blynk se establece con éxito.
+ * * Blynk.beginGroup(timestamp_ms) / Blynk.endGroup()
+ * Para QUÉ: Los virtualWrite() entre estas dos llamadas se guardan
+ * en la nube con la hora 'timestamp_ms' (ms UTC) y no con la hora
+ * de llegada. Así se suben muestras tomadas en el pasado.
  * * BlynkTimer scheduler
  * Para QUÉ: Es un objeto para crear temporizadores no bloqueantes.
  * Es la alternativa correcta a usar delay() en un proyecto de IoT.
@@ -76,18 +138,108 @@
  * * modem.restart()
  * Para QUÉ: Envía los comandos AT de inicialización al SIM7080G
  * para configurarlo en un estado conocido y listo para conectar.
- * * --- LIBRERÍA Wire (I2C / SENSOR XN04) ---
- * * Wire.beginTransmission(direccion)
- * Para QUÉ: Inicia una "conversación" I2C con el dispositivo
- * esclavo en la 'direccion' (ej. 4 para el XN04).
- * * Wire.write(registro)
- * Para QUÉ: Envía un byte. En este caso, le dice al XN04
- * qué 'registro' interno queremos leer (ej. 0x01 para Temp).
- * * Wire.requestFrom(direccion, numBytes)
- * Para QUÉ: Le pide 'numBytes' de datos al esclavo I2C
- * (ej. 2 bytes para la temperatura).
- * * Wire.read()
- * Para QUÉ: Lee un solo byte de los datos que el sensor envió.
+ * * modem.getNetworkTime(&año, &mes, ..., &zona)
+ * Para QUÉ: Lee la hora de la red celular (AT+CCLK?). La usamos
+ * para convertir millis() de cada muestra a hora UTC.
+ * * modem.sendAT("") / modem.waitResponse(ms)
+ * Para QUÉ: Envía un comando AT sin esperar / lee su respuesta.
+ * Mientras el módem arranca se envía "AT" y sólo se lee cuando
+ * ya llegó algo (SerialAT.available()), así loop() no se detiene.
+ * * Blynk.config(modem, auth, domain) / Blynk.connect()
+ * Para QUÉ: Igual que Blynk.begin() pero SIN encender la red:
+ * se usan cuando el PDP ya está activo.
+ * * --- BUFFER DE TELEMETRÍA (SECCIÓN 10) ---
+ * * telemetryPush(muestra)
+ * Para QUÉ: Guarda una muestra. Si la RAM se llena, la más vieja
+ * pasa a la PSRAM; si también se llena, se descarta la más vieja.
+ * * drainTelemetry()
+ * Para QUÉ: Sube hasta DRAIN_PER_PASS muestras (las más viejas
+ * primero) y regresa, para no congelar el loop(). En modo binario
+ * sube todas las que quepan en un envío TCP. Por Blynk, las muestras
+ * se quedan en el buffer hasta que el servidor contesta el
+ * Blynk.syncVirtual(V9) que va detrás de ellas.
+ * * psramFound() / ps_malloc(bytes)
+ * Para QUÉ: Detecta la PSRAM del ESP32-S3 y reserva memoria en
+ * ella. Se usa UNA sola vez en setup().
+ * * --- CAPA DE PUBLICACIÓN (XC01-Publicacion.h) ---
+ * * publishStage(Vpin, valor)
+ * Para QUÉ: Reemplaza a Blynk.virtualWrite(). No envía nada: deja
+ * el valor "en espera". Si el mismo pin se escribe dos veces antes
+ * de enviar, sólo sale el último valor.
+ * El valor también puede ser un texto (se copia; ej. el resumen de
+ * latencia). Con la telemetría binaria los textos salen por Blynk.
+ * * publishFlush()
+ * Para QUÉ: Envía todos los valores en espera en UN mensaje
+ * (publishSendBlynk(): Blynk.beginGroup() ... Blynk.endGroup()).
+ * loop() la llama al terminar cada vuelta del scheduler.
+ * * publishPolicy(Vpin, banda, bandaRel, minMs, maxMs)
+ * Para QUÉ: Hace que publishStage() sólo envíe cambios reales del
+ * pin: más grandes que la banda muerta (absoluta o relativa), no
+ * más seguido que minMs, y de todos modos cada maxMs ("latido").
+ * * --- TELEMETRÍA BINARIA (XC03-Telemetria.h) ---
+ * * xc03TelMaintain(&tel, millis())
+ * Para QUÉ: Mantiene abierta la conexión TCP con el receptor de
+ * telemetría (socket 1 del módem; Blynk usa el 0). Si se cae, la
+ * reabre cada XC03_TEL_RETRY_MS y pide subir el buffer.
+ * * xc03TelReport(&tel, edad) ... xc03TelFrameEnd() / xc03TelSend()
+ * Para QUÉ: Arman un reporte binario con la edad de la muestra en
+ * segundos (el receptor calcula la hora, no hace falta syncClock())
+ * y mandan todos los reportes armados en una sola escritura TCP.
+ * * --- TAREA DE ADQUISICIÓN (SECCIÓN 12) ---
+ * * xTaskCreatePinnedToCore(funcion, nombre, pila, param, prioridad, &handle, nucleo)
+ * Para QUÉ: Crea una tarea de FreeRTOS que corre en paralelo a
+ * loop(), fija en un 'nucleo' del ESP32-S3 (0 o 1).
+ * * vTaskDelayUntil(&ultimo, periodo)
+ * Para QUÉ: Duerme la tarea hasta el siguiente periodo exacto
+ * (no acumula atraso como un delay()).
+ * * readSensorSnapshot(&lectura)
+ * Para QUÉ: Copia la última lectura del XN04 sin bloquear. Si la
+ * tarea la estaba escribiendo justo en ese momento, vuelve a copiar.
+ * * xn04WindowAdd(&ventana, &datos, ahora, &resumen)
+ * Para QUÉ: Acumula una lectura del XN04 (sin guardarla) en las
+ * ventanas de temperatura, humedad y luz (XN04-Sensores.h). Cuando
+ * la ventana termina, entrega de cada una cuántas muestras hubo, el
+ * mínimo, el máximo, el promedio y la desviación estándar.
+ * * xnSlidingGet(&ventana, ahora, &resumen)
+ * Para QUÉ: Lo mismo pero de los últimos N segundos (deslizante).
+ * * xnBusBegin(direcciones, n)
+ * Para QUÉ: Prueba cada módulo XN a 1 MHz, 400 kHz y 100 kHz y
+ * se queda con la más rápida que funciona. Si después aparecen
+ * errores en el bus, baja de velocidad sola (y vuelve a subir
+ * cuando el bus lleva un buen rato sin errores).
+ * * --- REGLAS LOCALES (SECCIÓN 13) ---
+ * * rulesSetThreshold(Vpin, umbral)
+ * Para QUÉ: Cambia el umbral de las reglas que escuchan ese pin.
+ * Las reglas se evalúan en la tarea de adquisición con cada lectura.
+ * El calefactor (V11) nunca queda arriba de V3 menos la histéresis
+ * y no enciende mientras el ventilador siga encendido (ni al revés).
+ * * --- ARRANQUE DEL MÓDEM (SECCIÓN 14) ---
+ * * xc03BootUpdate(&boot)
+ * Para QUÉ: Avanza el arranque del módem UN paso y regresa de
+ * inmediato (XC03-Arranque.h). Regresa true cuando Blynk ya está
+ * configurado. El pulso del PWRKEY lo termina un esp_timer.
+ * * xc03BootMarkData(&boot)
+ * Para QUÉ: Se llama con cada dato que sale; la primera vez imprime
+ * cuánto tardó cada etapa del arranque y el primer dato.
+ * * --- LATENCIA DEL LOOP (XC01-Latencia.h) ---
+ * * XC01_LAT_TIME(pieza, instrucción)
+ * Para QUÉ: Mide cuánto tarda la instrucción con el contador de
+ * ciclos y lo suma al histograma de la pieza.
+ * * XC01_LAT_TIMED(funcion)
+ * Para QUÉ: Va en scheduler.setInterval() en lugar de la función:
+ * cada llamada del timer se mide en su propia pieza.
+ * * latencyReport()
+ * Para QUÉ: Imprime los histogramas, manda el resumen a V12 y
+ * empieza otra ventana de medición.
+ * * --- REGISTROS DEL XN04 (XN04-Sensores.h) ---
+ * * xnReadBurst<XN04Block>(bytes)
+ * Para QUÉ: Lee los registros 0x01 - 0x03 del XN04 (temperatura,
+ * humedad y luz) en UNA transacción I2C de 6 bytes, con el reloj
+ * negociado para el módulo. La dirección y los registros salen del
+ * descriptor XN04Block, no se escriben a mano.
+ * * XN04Block::get<XN04Temperature>(bytes)
+ * Para QUÉ: Saca un valor crudo de los bytes de la ráfaga
+ * (getScaled<> ya lo regresa en unidades: °C, %).
  * ===================================================================
  */
 
@@ -109,8 +261,17 @@
 
 #include <Arduino.h>
 #include <Wire.h>                 // Librería para comunicación I2C (XN04)
+#include "XN-Registros.h"         // Registros XN (incluye XN-Bus.h)
+#include "XN04-Sensores.h"        // Descriptores de los registros del XN04
+#include "XN02-SalidasDigitales.h" // Salidas del XN02 (copia sombra)
+#include "XN11-Relevadores.h"     // Relevadores del XN11 (copia sombra)
+#include "XN-Estadisticas.h"      // Resumen por ventana (Welford)
 #include <TinyGsmClient.h>        // Librería de control del módem (comandos AT)
 #include <BlynkSimpleTinyGSM.h>   // Puente entre Blynk y TinyGSM
+#include "XC03-Telemetria.h"      // Telemetría binaria por TCP (opcional)
+#include "XC01-Latencia.h"        // Histogramas de latencia del loop()
+#include "XC01-Publicacion.h"     // Envío por lotes y por cambio
+#include "XC03-Arranque.h"        // Arranque del módem sin espera
 
 
 //##################################################################
@@ -149,22 +310,211 @@ const char pass[] = "";
 const char domain[] = "ny3.blynk.cloud";
 const char auth[] = BLYNK_AUTH_TOKEN;
 
+// --- Telemetría binaria (XC03-Telemetria.h) ---
+// 1: resúmenes y valores en vivo suben como tramas binarias al
+// receptor de abajo y Blynk sólo se usa para el control. 0: todo por Blynk.
+#ifndef TELEMETRY_UPLINK_BINARY
+#define TELEMETRY_UPLINK_BINARY 0
+#endif
+const char telemetryHost[] = "telemetria.example.com";
+const uint16_t telemetryPort = XC03_TEL_PORT;
+const char telemetryId[] = "termometro-01";
+
 
 //##################################################################
 // ### SECCIÓN 5: OBJETOS GLOBALES Y VARIABLES ###
 //##################################################################
 static BlynkTimer scheduler;
 static TinyGsm modem(SerialAT);
+static TinyGsmClient telClient(modem, 1);  // Socket 1: el 0 es de Blynk
+static XC03TelLink tel;
+
+// --- Tarea de adquisición (XN04 en el núcleo 0) ---
+#define ACQ_TASK_CORE 0          // loop() de Arduino corre en el núcleo 1
+#define ACQ_TASK_STACK 4096      // Bytes
+#define ACQ_TASK_PRIORITY 1
+
+const unsigned long SNAPSHOT_POLL_MS = 1000UL;    // loop() revisa si hay lectura nueva
+
+static TaskHandle_t acqTaskHandle = NULL;
+static volatile uint32_t acqErrors = 0;           // Lecturas fallidas del XN04
+
+// --- Reglas locales (histéresis y tiempos mínimos) ---
+const float RULE_HYSTERESIS = 0.5f;               // °C
+const unsigned long RULE_MIN_ON_MS = 30000UL;     // Un relevador no se apaga antes
+const unsigned long RULE_MIN_OFF_MS = 30000UL;    // ... ni se vuelve a encender antes
+
+// --- Buffer de telemetría (store-and-forward) ---
+#define TELEMETRY_RAM_CAPACITY 64      // Muestras en RAM interna
+#define TELEMETRY_SPILL_CAPACITY 8192  // Muestras en PSRAM (0 = no usar PSRAM)
+
+const unsigned long SAMPLE_INTERVAL_MS = 200UL;   // Lectura local del XN04 (5 Hz)
+const unsigned long WINDOW_MS = 60000UL;          // Un resumen por ventana
+const unsigned long SLIDING_WINDOW_MS = 10000UL;  // Promedio reciente (umbral V3)
+const unsigned long UPLOAD_INTERVAL_MS = 60000UL; // Ráfaga hacia Blynk
+const uint8_t DRAIN_PER_PASS = 2;                 // Muestras por vuelta de loop()
+const unsigned long DRAIN_ACK_TIMEOUT_MS = 10000UL; // Sin confirmación: se reenvían
+
+// Se vuelve true cuando toca subir el buffer (timer o reconexión)
+static bool drainRequested = false;
+
+// Muestras enviadas por Blynk que esperan la confirmación (BLYNK_WRITE(V9))
+static uint16_t drainInFlight = 0;
+static unsigned long drainSentAt = 0;
+
+// --- Latencia del loop (XC01-Latencia.h) ---
+// Un AT+CASEND tarda ~140 ms: 500 ms deja pasar uno o dos por vuelta
+const uint32_t LOOP_BUDGET_US = 500000UL;          // Más que esto es un bloqueo
+const unsigned long LATENCY_REPORT_MS = 600000UL;  // Tabla por Serial y V12
 
-// --- Variable de estado global (Optimización) ---
-static float currentTemperature = 0.0f;
+static XC01LatSlot *latLoop;        // Tiempo entre vueltas de loop()
+static XC01LatSlot *latBoot;
+static XC01LatSlot *latBlynk;
+static XC01LatSlot *latScheduler;   // Incluye los timers (cada uno tiene la suya)
+static XC01LatSlot *latPublish;
+static XC01LatSlot *latDrain;
+
+// --- Capa de publicación por lotes (XC01-Publicacion.h) ---
+const unsigned long PUBLISH_REPORT_MS = 600000UL; // Reporte de contadores
+
+// --- Política de envío (sólo cambios reales) ---
+const float TEMPERATURE_DEADBAND = 0.10f;           // °C (promedio de la ventana)
+const float TEMPERATURE_SPREAD = 0.50f;             // °C: max - min que se sube siempre
+const float HUMIDITY_DEADBAND = 1.0f;               // %
+const float LUX_DEADBAND = 5.0f;                    // lux (con poca luz)
+const float LUX_DEADBAND_REL = 0.10f;               // 10 % de la lectura
+const unsigned long SENSOR_MIN_INTERVAL_MS = 10000UL;
+const unsigned long SENSOR_HEARTBEAT_MS = 300000UL; // Latido aunque no cambie
+
+// --- Arranque del módem (XC03-Arranque.h) ---
+// Tiempos del pulso, de los "AT" y de la red: XC03_BOOT_* en el header
+static XC03Boot boot;
+
+// Hora de la red: epoch (ms UTC) que corresponde a millis() == clockBaseMillis
+static bool clockSynced = false;
+static uint64_t clockBaseEpochMs = 0;
+static uint32_t clockBaseMillis = 0;
 
 
 //##################################################################
 // ### SECCIÓN 6: DECLARACIÓN DE FUNCIONES ###
 //##################################################################
+// Reglas locales (SECCIÓN 13)
+typedef enum {
+    RULE_ABOVE,                 // Activa con valor >= umbral (ej. ventilador)
+    RULE_BELOW                  // Activa con valor <= umbral (ej. calefactor)
+} RuleDirection;
+
+typedef enum {
+    RULE_TEMPERATURE,
+    RULE_HUMIDITY,
+    RULE_LUX
+} RuleSource;
+
+typedef enum {
+    RULE_XN11_RELAY,            // Relevador 1-2
+    RULE_XN02_OUTPUT            // Salida 1-8
+} RuleTarget;
+
+typedef struct {
+    const char *name;
+    RuleSource source;
+    RuleDirection direction;
+    uint8_t thresholdPin;       // Pin de Blynk que fija el umbral
+    float hysteresis;           // Se desactiva en umbral -/+ histéresis
+    unsigned long minOnMs;
+    unsigned long minOffMs;
+    RuleTarget target;
+    uint8_t channel;
+    int8_t interlock;           // Regla que no puede estar activa a la vez (-1 = ninguna)
+    // Estado (lo escribe sólo la tarea de adquisición)
+    volatile float threshold;   // NAN = sin umbral, regla apagada
+    volatile bool active;
+    unsigned long changedAt;
+    uint32_t switches;
+} Rule;
+
+// Una muestra del buffer: el resumen de una ventana, 14 bytes.
+// Temperaturas en centésimas de grado (como el XN04).
+typedef struct __attribute__((packed)) {
+    uint32_t t_ms;              // millis() al cerrar la ventana
+    uint16_t count;             // Lecturas en la ventana
+    uint16_t temperature_int;   // Promedio
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t stddev_int;        // Desviación estándar
+} TelemetrySample;
+
+// Buffer circular sobre memoria fija (no usa malloc al guardar)
+typedef struct {
+    TelemetrySample *buf;
+    uint16_t capacity;
+    uint16_t head;              // Posición de la muestra más vieja
+    uint16_t count;
+} SampleRing;
+
+// Una lectura del XN04 con la hora en que se tomó
+typedef struct {
+    uint32_t t_ms;              // millis() al leer el sensor
+    XN04Data data;
+    float temperatureAvg;       // Promedio de los últimos SLIDING_WINDOW_MS
+} SensorReading;
+
+// Resumen de una ventana de WINDOW_MS (grados, %, lux)
+typedef struct {
+    uint32_t t_ms;              // millis() al cerrar la ventana
+    XN04Summary stats;
+} WindowSummary;
+
+// Última lectura publicada por la tarea de adquisición (seqlock).
+// 'seq' es impar mientras la tarea escribe 'reading'.
+typedef struct {
+    volatile uint32_t seq;
+    SensorReading reading;
+} SensorSnapshot;
+
+// Último resumen de ventana (mismo seqlock; cambia cada WINDOW_MS)
+typedef struct {
+    volatile uint32_t seq;
+    WindowSummary summary;
+} WindowSnapshot;
+
+// Política de V2. No se registra con publishPolicy(): la temperatura
+// sale por el buffer con su marca de tiempo, no por publishStage().
+static PublishPolicy temperaturePolicy = { V2, TEMPERATURE_DEADBAND, 0.0f,
+                                           0UL, SENSOR_HEARTBEAT_MS };
+
+// Foto compartida entre la tarea de adquisición y loop()
+static SensorSnapshot sensorSnapshot;
+static WindowSnapshot windowSnapshot;
+
+bool readXN04All(XN04Data *data);
 float readXN04Temperature();
+void acquisitionBegin();
+void acquisitionTask(void *arg);
+bool readSensorSnapshot(SensorReading *out);
+uint32_t sensorSnapshotSeq();
+bool readWindowSnapshot(WindowSummary *out);
+uint32_t windowSnapshotSeq();
+void rulesBegin();
+void rulesEvaluate(const SensorReading *reading);
+void rulesSetThreshold(uint8_t pin, float threshold);
+void publishRules();
 void updateTemperature();
+void requestDrain();
+
+bool publishSend(PendingWrite *writes, uint8_t count);
+void publishReport();
+
+void bootBegin();
+
+void latencyReport();
+
+void telemetryBegin();
+void telemetryPush(const TelemetrySample *sample);
+uint16_t telemetryCount();
+void drainTelemetry();
+bool syncClock();
 
 
 //##################################################################
@@ -182,26 +532,38 @@ void setup()
     pinMode(BOARD_LED, OUTPUT);
     digitalWrite(BOARD_LED, LOW);
     pinMode(PIN_MODEM_PK, OUTPUT);
-
-    // --- 3. Reinicio por Hardware del Módem XC03 ---
-    SerialMon.println("Reiniciando módem XC03 (pulso de 3s)...");
-    digitalWrite(PIN_MODEM_PK, HIGH);
-    delay(3000);
     digitalWrite(PIN_MODEM_PK, LOW);
 
-    // --- 4. Conexión a la Red Celular y Blynk ---
-    SerialMon.println("Iniciando modem LTE...");
-    modem.restart();
-    String modemInfo = modem.getModemInfo();
-    SerialMon.print("Modem: ");
-    SerialMon.println(modemInfo);
+    // --- 3. Programar Tareas ---
+    // El módem arranca desde loop() (xc03BootUpdate): el sensor
+    // empieza a medir ya y las muestras esperan en el buffer
+    bootBegin();
+    telemetryBegin();
+    xc03TelBegin(&tel, telClient, telemetryHost, telemetryPort, telemetryId);
+    // Velocidad del bus para el XN04 y los actuadores; desde aquí el
+    // bus I2C es de la tarea de adquisición
+    const uint8_t xnAddresses[] = { 4, 11, 2 };
+    xnBusBegin(xnAddresses, sizeof(xnAddresses));
+    acquisitionBegin();
+
+    // Piezas del loop() que se miden (en este orden salen en la tabla)
+    latLoop = xc01LatSlot("loop (vuelta)", LOOP_BUDGET_US);
+    latBoot = xc01LatSlot("xc03BootUpdate", LOOP_BUDGET_US);
+    latBlynk = xc01LatSlot("Blynk.run", LOOP_BUDGET_US);
+    latScheduler = xc01LatSlot("scheduler.run", LOOP_BUDGET_US);
+    latPublish = xc01LatSlot("publishFlush", LOOP_BUDGET_US);
+    latDrain = xc01LatSlot("drainTelemetry", LOOP_BUDGET_US);
 
-    SerialMon.println("Conectando a GPRS y Blynk...");
-    Blynk.begin(auth, modem, apn, user, pass, domain);
-    SerialMon.println("Conexión iniciada.");
+    scheduler.setInterval(SNAPSHOT_POLL_MS, XC01_LAT_TIMED(updateTemperature));
+    scheduler.setInterval(SNAPSHOT_POLL_MS, XC01_LAT_TIMED(publishRules));
+    scheduler.setInterval(UPLOAD_INTERVAL_MS, XC01_LAT_TIMED(requestDrain));
+    scheduler.setInterval(PUBLISH_REPORT_MS, XC01_LAT_TIMED(publishReport));
+    scheduler.setInterval(LATENCY_REPORT_MS, latencyReport);
 
-    // --- 5. Programar Tareas ---
-    scheduler.setInterval(30000UL, updateTemperature);
+    publishBegin(publishSend);
+    // Humedad y luz: sólo cambios reales, a lo más cada 10 s
+    publishPolicy(V4, HUMIDITY_DEADBAND, 0.0f, SENSOR_MIN_INTERVAL_MS, SENSOR_HEARTBEAT_MS);
+    publishPolicy(V5, LUX_DEADBAND, LUX_DEADBAND_REL, SENSOR_MIN_INTERVAL_MS, SENSOR_HEARTBEAT_MS);
 }
 
 
@@ -210,8 +572,45 @@ void setup()
 //##################################################################
 void loop()
 {
-    Blynk.run();      
-    scheduler.run();  
+    bool online;
+
+    xc01LatLoop(latLoop);
+
+    // Arranque del módem en pasos cortos; Blynk corre cuando ya hay red
+    XC01_LAT_TIME(latBoot, online = xc03BootUpdate(&boot));
+    if (online) {
+        XC01_LAT_TIME(latBlynk, Blynk.run());
+        if (TELEMETRY_UPLINK_BINARY) {
+            uint32_t connects = tel.connects;
+            xc03TelMaintain(&tel, millis());
+            if (tel.connects != connects) {
+                drainRequested = true;  // Reconectó: subir lo pendiente
+            }
+        }
+    }
+    XC01_LAT_TIME(latScheduler, scheduler.run());
+
+    // Todo lo que las tareas escribieron en esta vuelta sale junto
+    XC01_LAT_TIME(latPublish, publishFlush());
+
+    // Ráfaga de subida en pedazos: cada vuelta sube unas cuantas muestras
+    if (drainRequested) {
+        XC01_LAT_TIME(latDrain, drainTelemetry());
+    }
+}
+
+/**
+ * @brief Imprime los histogramas de latencia, manda el resumen a V12
+ * y empieza otra ventana: cada reporte cubre LATENCY_REPORT_MS.
+ */
+void latencyReport()
+{
+    char summary[160];
+
+    xc01LatPrint(Serial);
+    xc01LatSummary(summary, sizeof(summary));
+    publishStage(V12, summary);
+    xc01LatReset();
 }
 
 
@@ -219,42 +618,740 @@ void loop()
 // ### SECCIÓN 9: TAREAS PROGRAMADAS Y LECTURA DE SENSORES ###
 //##################################################################
 
+/**
+ * @brief Toma el resumen de la última ventana (si hay uno nuevo).
+ * No usa el bus I2C: sólo copia la foto del seqlock.
+ */
 void updateTemperature()
 {
-    currentTemperature = readXN04Temperature();
+    static uint32_t lastSeq = 0;
+    static uint32_t lastErrors = 0;
+    WindowSummary summary;
 
-    Serial.print("Temperatura actual: ");
-    Serial.println(currentTemperature);
+    if (acqErrors != lastErrors) {
+        lastErrors = acqErrors;
+        Serial.println("Error: el XN04 no respondió");
+    }
 
-    Blynk.virtualWrite(V2, currentTemperature);
+    // Misma ventana que la vuelta pasada: no hay nada nuevo
+    if (windowSnapshotSeq() == lastSeq || !readWindowSnapshot(&summary)) {
+        return;
+    }
+    lastSeq = windowSnapshotSeq();
+
+    const XNStats *t = &summary.stats.temperature;
+    float stddev = xnStatsStddev(t);
+    Serial.printf("Ventana: %lu lecturas, temperatura %.2f (min %.2f, max %.2f, desv %.3f)\n",
+                  (unsigned long)t->count, t->mean, t->min, t->max, stddev);
+
+    // Se guarda si el promedio cambió más que la banda muerta (o toca
+    // latido), o si dentro de la ventana hubo un pico; se sube en la
+    // siguiente ráfaga con la hora de cierre de la ventana
+    bool spread = t->max - t->min >= TEMPERATURE_SPREAD;
+    if (publishAccept(&temperaturePolicy, t->mean, summary.t_ms) || spread) {
+        TelemetrySample sample;
+        sample.t_ms = summary.t_ms;
+        sample.count = t->count > 0xFFFF ? 0xFFFF : (uint16_t)t->count;
+        sample.temperature_int = (uint16_t)lroundf(t->mean * 100.0f);
+        sample.min_int = (uint16_t)lroundf(t->min * 100.0f);
+        sample.max_int = (uint16_t)lroundf(t->max * 100.0f);
+        sample.stddev_int = (uint16_t)lroundf(stddev * 100.0f);
+        telemetryPush(&sample);
+    }
+
+    // Humedad y luz: promedio de la ventana; su política (setup())
+    // decide si salen
+    publishStage(V4, summary.stats.humidity.mean);
+    publishStage(V5, (int32_t)lroundf(summary.stats.lux.mean));
+}
+
+void requestDrain()
+{
+    drainRequested = true;
+}
+
+/**
+ * @brief Lee los registros 0x01 (Temp), 0x02 (Hum) y 0x03 (Luz) del XN04
+ * en UNA sola transacción I2C de 6 bytes (el XN04 auto-incrementa el
+ * registro). Cuesta lo mismo en el bus que leer solo la temperatura.
+ * Sólo la llama la tarea de adquisición (es la dueña del bus).
+ * @return false si el módulo no entregó los 6 bytes.
+ */
+bool readXN04All(XN04Data *data)
+{
+    uint8_t bytes[XN04Block::length];
+
+    if (!xnReadBurst<XN04Block>(bytes)) {
+        return false;
+    }
+    xn04Decode(bytes, data);
+    return true;
 }
 
 float readXN04Temperature()
 {
-    float temperature;
-    uint16_t temperature_int;
+    XN04Data data;
+
+    if (!readXN04All(&data)) {
+        return NAN;
+    }
+
+    return xnScale<XN04Temperature>(data.temperature_int);
+}
+
+
+//##################################################################
+// ### SECCIÓN 10: BUFFER DE TELEMETRÍA (STORE-AND-FORWARD) ###
+//##################################################################
+
+// Nivel 1: RAM interna (siempre)
+static TelemetrySample ramSamples[TELEMETRY_RAM_CAPACITY];
+static SampleRing ramRing = { ramSamples, TELEMETRY_RAM_CAPACITY, 0, 0 };
+
+// Nivel 2: PSRAM (opcional, se reserva una sola vez en telemetryBegin)
+static SampleRing spillRing = { NULL, 0, 0, 0 };
+
+// Muestras descartadas porque los dos niveles estaban llenos
+static uint32_t telemetryDropped = 0;
+
+static void ringPush(SampleRing *ring, const TelemetrySample *sample)
+{
+    uint16_t tail = (ring->head + ring->count) % ring->capacity;
+    ring->buf[tail] = *sample;
+    ring->count++;
+}
+
+static void ringPop(SampleRing *ring, TelemetrySample *sample)
+{
+    *sample = ring->buf[ring->head];
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+}
+
+/**
+ * @brief Reserva el nivel de PSRAM si la placa la tiene.
+ */
+void telemetryBegin()
+{
+#if TELEMETRY_SPILL_CAPACITY > 0
+    if (psramFound()) {
+        spillRing.buf = (TelemetrySample *)ps_malloc(sizeof(TelemetrySample) * TELEMETRY_SPILL_CAPACITY);
+        spillRing.capacity = spillRing.buf ? TELEMETRY_SPILL_CAPACITY : 0;
+    }
+#endif
+    Serial.print("Buffer de telemetría: ");
+    Serial.print(ramRing.capacity + spillRing.capacity);
+    Serial.println(" muestras");
+}
+
+/**
+ * @brief Guarda una muestra. Si la RAM está llena, la muestra más vieja
+ * baja a la PSRAM (el orden se conserva: la PSRAM siempre tiene las
+ * más viejas). Si no hay lugar, se descarta la más vieja de todas.
+ */
+void telemetryPush(const TelemetrySample *sample)
+{
+    if (ramRing.count == ramRing.capacity) {
+        TelemetrySample oldest;
+        ringPop(&ramRing, &oldest);
+
+        if (spillRing.capacity > 0) {
+            if (spillRing.count == spillRing.capacity) {
+                TelemetrySample dropped;
+                ringPop(&spillRing, &dropped);
+                telemetryDropped++;
+                // Era la más vieja: si estaba en camino ya no se confirma
+                if (drainInFlight > 0) {
+                    drainInFlight--;
+                }
+            }
+            ringPush(&spillRing, &oldest);
+        } else {
+            telemetryDropped++;
+            if (drainInFlight > 0) {
+                drainInFlight--;
+            }
+        }
+    }
+    ringPush(&ramRing, sample);
+}
+
+uint16_t telemetryCount()
+{
+    return ramRing.count + spillRing.count;
+}
+
+/**
+ * @brief Lee la hora de la red celular y la amarra a millis().
+ */
+bool syncClock()
+{
+    int year, month, day, hour, minute, second;
+    float timezone;
+
+    if (!modem.getNetworkTime(&year, &month, &day, &hour, &minute, &second, &timezone)) {
+        return false;
+    }
+    if (year < 2024) {
+        return false; // El módem aún no recibe la hora de la red
+    }
+
+    // Días desde el 1/1/1970 (algoritmo de calendario civil)
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + (int64_t)doe - 719468;
+
+    // La hora de la red es local: se resta la zona horaria
+    int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second -
+                      (int64_t)(timezone * 3600.0f);
+
+    clockBaseMillis = millis();
+    clockBaseEpochMs = (uint64_t)seconds * 1000ULL;
+    clockSynced = true;
+    return true;
+}
+
+static uint64_t sampleEpochMs(const TelemetrySample *sample)
+{
+    // Diferencia con signo: la muestra puede ser anterior a la sincronización
+    int32_t delta = (int32_t)(sample->t_ms - clockBaseMillis);
+    return clockBaseEpochMs + (int64_t)delta;
+}
+
+// La muestra i del buffer, contando desde la más vieja (PSRAM primero)
+static const TelemetrySample *telemetryAt(uint16_t i)
+{
+    SampleRing *ring = &spillRing;
+    if (i >= spillRing.count) {
+        i -= spillRing.count;
+        ring = &ramRing;
+    }
+    return &ring->buf[(ring->head + i) % ring->capacity];
+}
+
+/**
+ * @brief Versión binaria de drainTelemetry(): cada muestra es un
+ * reporte con su edad en segundos y salen todas las que quepan en el
+ * búfer del enlace en UN envío TCP. Se sacan del buffer sólo si el
+ * envío se completó.
+ */
+static void drainTelemetryBinary()
+{
+    uint16_t count = telemetryCount();
+    uint16_t packed = 0;
+    unsigned long now = millis();
+
+    if (!xc03TelConnected(&tel)) {
+        return;
+    }
+    if (count == 0) {
+        drainRequested = false;
+        return;
+    }
+
+    while (packed < count) {
+        const TelemetrySample *sample = telemetryAt(packed);
+
+        xc03TelReport(&tel, (now - sample->t_ms) / 1000UL);
+        xc03TelCenti(&tel, V2, sample->temperature_int / 100.0f);
+        xc03TelCenti(&tel, V6, sample->min_int / 100.0f);
+        xc03TelCenti(&tel, V7, sample->max_int / 100.0f);
+        xc03TelCenti(&tel, V8, sample->stddev_int / 100.0f);
+        xc03TelInt(&tel, V9, sample->count);
+        if (!xc03TelFrameEnd(&tel)) {
+            break;  // Búfer lleno: el resto sale en la siguiente vuelta
+        }
+        packed++;
+    }
+    if (!xc03TelSend(&tel)) {
+        return;     // Se reintenta al reconectar
+    }
+
+    for (uint16_t i = 0; i < packed; i++) {
+        SampleRing *ring = spillRing.count > 0 ? &spillRing : &ramRing;
+        TelemetrySample sent;
+        ringPop(ring, &sent);
+    }
+    xc03BootMarkData(&boot);
+}
+
+/**
+ * @brief Sube hasta DRAIN_PER_PASS muestras, las más viejas primero,
+ * cada una en su grupo con su propia marca de tiempo. Detrás va un
+ * Blynk.syncVirtual(V9): el servidor contesta después de haber
+ * recibido los grupos (TCP no cambia el orden), así que su respuesta
+ * (telemetryAck()) confirma la entrega. Hasta entonces las muestras
+ * siguen en el buffer; sin respuesta se reenvían con la misma marca
+ * de tiempo, que Blynk sobrescribe.
+ */
+void drainTelemetry()
+{
+    if (TELEMETRY_UPLINK_BINARY) {
+        drainTelemetryBinary();
+        return;
+    }
+    if (!Blynk.connected()) {
+        drainInFlight = 0;  // Se reenvían al reconectar
+        return;
+    }
+    if (drainInFlight > 0) {
+        if (millis() - drainSentAt < DRAIN_ACK_TIMEOUT_MS) {
+            return;
+        }
+        drainInFlight = 0;
+    }
+
+    uint16_t count = telemetryCount();
+    if (count == 0) {
+        drainRequested = false;
+        return;
+    }
+    if (count > DRAIN_PER_PASS) {
+        count = DRAIN_PER_PASS;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        const TelemetrySample *sample = telemetryAt(i);
+
+        // Todo el resumen sale en un mensaje
+        if (clockSynced) {
+            Blynk.beginGroup(sampleEpochMs(sample));
+        } else {
+            // Sin hora de la red: se sube con la hora de llegada
+            Blynk.beginGroup();
+        }
+        Blynk.virtualWrite(V2, sample->temperature_int / 100.0f);
+        Blynk.virtualWrite(V6, sample->min_int / 100.0f);
+        Blynk.virtualWrite(V7, sample->max_int / 100.0f);
+        Blynk.virtualWrite(V8, sample->stddev_int / 100.0f);
+        Blynk.virtualWrite(V9, sample->count);
+        Blynk.endGroup();
+    }
+    if (!Blynk.connected()) {
+        return; // Se reintenta al reconectar
+    }
+    drainInFlight = count;
+    drainSentAt = millis();
+    Blynk.syncVirtual(V9);
+}
+
+/**
+ * @brief Llegó la respuesta al Blynk.syncVirtual(V9) de
+ * drainTelemetry(): las muestras enviadas ya están en el servidor.
+ */
+void telemetryAck()
+{
+    if (drainInFlight == 0) {
+        return;
+    }
+    for (; drainInFlight > 0; drainInFlight--) {
+        SampleRing *ring = spillRing.count > 0 ? &spillRing : &ramRing;
+        TelemetrySample sent;
+        ringPop(ring, &sent);
+    }
+    xc03BootMarkData(&boot);
+}
+
+
+//##################################################################
+// ### SECCIÓN 11: CAPA DE PUBLICACIÓN (POR LOTES) ###
+//##################################################################
+
+/**
+ * @brief Manda un lote de la capa de publicación en un solo mensaje
+ * agrupado de Blynk (o en un reporte binario con
+ * TELEMETRY_UPLINK_BINARY), con publishSendBlynk(). Sin conexión
+ * regresa false y los valores se quedan para el siguiente
+ * publishFlush().
+ */
+bool publishSend(PendingWrite *writes, uint8_t count)
+{
+    if (!publishSendBlynk(writes, count, TELEMETRY_UPLINK_BINARY ? &tel : NULL)) {
+        return false;
+    }
+    xc03BootMarkData(&boot);
+    return true;
+}
+
+void publishReport()
+{
+    publishPrintReport(Serial);
+    if (TELEMETRY_UPLINK_BINARY) {
+        xc03TelPrintReport(Serial, &tel);
+    }
+
+    xnBusReport();
+}
+
+
+//##################################################################
+// ### SECCIÓN 12: TAREA DE ADQUISICIÓN (NÚCLEO 0) ###
+//##################################################################
+
+/**
+ * @brief Escribe 'size' bytes en una foto protegida por 'seq'. Sólo la
+ * tarea escribe, así que no hace falta candado: 'seq' impar avisa que
+ * está a medias.
+ */
+static void seqlockWrite(volatile uint32_t *seq, void *data, const void *src, size_t size)
+{
+    uint32_t s = *seq;
+
+    __atomic_store_n(seq, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(data, src, size);
+
+    __atomic_store_n(seq, s + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Número de la foto actual (cambia con cada escritura).
+ */
+static uint32_t seqlockSeq(volatile uint32_t *seq)
+{
+    return __atomic_load_n(seq, __ATOMIC_ACQUIRE) & ~1UL;
+}
+
+/**
+ * @brief Copia la foto sin bloquear. Si la tarea escribió durante la
+ * copia, la copia se repite (dura microsegundos).
+ * @return false si todavía no se ha escrito nada.
+ */
+static bool seqlockRead(volatile uint32_t *seq, const void *data, void *out, size_t size)
+{
+    uint32_t before, after;
+
+    do {
+        before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(out, data, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+
+    return before != 0;
+}
+
+uint32_t sensorSnapshotSeq()
+{
+    return seqlockSeq(&sensorSnapshot.seq);
+}
+
+bool readSensorSnapshot(SensorReading *out)
+{
+    return seqlockRead(&sensorSnapshot.seq, &sensorSnapshot.reading, out, sizeof(*out));
+}
+
+uint32_t windowSnapshotSeq()
+{
+    return seqlockSeq(&windowSnapshot.seq);
+}
+
+bool readWindowSnapshot(WindowSummary *out)
+{
+    return seqlockRead(&windowSnapshot.seq, &windowSnapshot.summary, out, sizeof(*out));
+}
+
+/**
+ * @brief Lee el XN04 cada SAMPLE_INTERVAL_MS. Corre en el núcleo 0,
+ * así que el tiempo del bus I2C no frena a loop() (Blynk, módem).
+ * Cada lectura va a la foto y a las ventanas; las lecturas no se
+ * guardan, sólo los acumuladores (~300 bytes en la pila).
+ */
+void acquisitionTask(void *arg)
+{
+    (void)arg;
+    TickType_t lastWake = xTaskGetTickCount();
+    unsigned long now = millis();
+    XN04Window window;
+    XNSliding recentT;
+
+    xn04WindowBegin(&window, WINDOW_MS, now);
+    xnSlidingBegin(&recentT, SLIDING_WINDOW_MS, now);
+    rulesBegin();
+
+    for (;;) {
+        SensorReading reading;
+
+        if (readXN04All(&reading.data)) {
+            now = millis();
+            float temperature = xnScale<XN04Temperature>(reading.data.temperature_int);
+            XNStats recent;
+
+            xnSlidingAdd(&recentT, temperature, now);
+            xnSlidingGet(&recentT, now, &recent);
+            reading.t_ms = now;
+            reading.temperatureAvg = recent.mean;
+            seqlockWrite(&sensorSnapshot.seq, &sensorSnapshot.reading, &reading, sizeof(reading));
+
+            // Los actuadores reaccionan con esta misma lectura
+            rulesEvaluate(&reading);
+
+            WindowSummary closed;
+            if (xn04WindowAdd(&window, &reading.data, now, &closed.stats)) {
+                closed.t_ms = now;
+                seqlockWrite(&windowSnapshot.seq, &windowSnapshot.summary, &closed, sizeof(closed));
+            }
+        } else {
+            acqErrors = acqErrors + 1;
+        }
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+    }
+}
+
+/**
+ * @brief Arranca la tarea de adquisición. Después de esto loop() ya
+ * no debe usar Wire.
+ */
+void acquisitionBegin()
+{
+    xTaskCreatePinnedToCore(acquisitionTask, "xn04", ACQ_TASK_STACK, NULL,
+                            ACQ_TASK_PRIORITY, &acqTaskHandle, ACQ_TASK_CORE);
+}
+
+
+//##################################################################
+// ### SECCIÓN 13: REGLAS LOCALES (HISTÉRESIS) ###
+//##################################################################
+
+// Una regla activa su salida cuando el valor cruza el umbral y la
+// desactiva cuando regresa más allá de la histéresis (así no "tiembla"
+// cerca del umbral). Además, una salida no cambia antes de minOnMs /
+// minOffMs desde su último cambio (cuida relevadores y compresores).
+static Rule rules[] = {
+    { "Ventilador", RULE_TEMPERATURE, RULE_ABOVE, V3, RULE_HYSTERESIS,
+      RULE_MIN_ON_MS, RULE_MIN_OFF_MS, RULE_XN11_RELAY, 1, 1, NAN },
+    { "Calefactor", RULE_TEMPERATURE, RULE_BELOW, V11, RULE_HYSTERESIS,
+      RULE_MIN_ON_MS, RULE_MIN_OFF_MS, RULE_XN11_RELAY, 2, 0, NAN },
+    // Indicador de temperatura alta: sin tiempos mínimos (es un LED)
+    { "Indicador", RULE_TEMPERATURE, RULE_ABOVE, V3, RULE_HYSTERESIS,
+      0UL, 0UL, RULE_XN02_OUTPUT, 1, -1, NAN },
+};
+#define RULE_COUNT ( sizeof( rules ) / sizeof( rules[0] ) )
+
+static volatile uint32_t rulesWriteErrors = 0;
+
+static float ruleValue(const Rule *rule, const SensorReading *reading)
+{
+    switch (rule->source) {
+    case RULE_HUMIDITY:
+        return reading->data.humidity_int / 100.0f;
+    case RULE_LUX:
+        return reading->data.lux;
+    default:
+        return reading->data.temperature_int / 100.0f;
+    }
+}
+
+// Mueve la salida de la regla (la llama sólo la tarea: es dueña del bus).
+// Los drivers del XN11 y del XN02 llevan la copia sombra: el bus sólo se
+// usa si la salida realmente cambia.
+static bool ruleDrive(const Rule *rule, bool on)
+{
+    if (rule->target == RULE_XN11_RELAY) {
+        return setXN11Relay(rule->channel, on ? HIGH : LOW) && flushXN11();
+    }
+    return writeXN02Output(rule->channel, on);
+}
+
+/**
+ * @brief Todas las salidas de las reglas a un estado conocido (apagadas).
+ */
+void rulesBegin()
+{
+    // La copia del XN02 parte del estado real (las otras 7 salidas no
+    // son de las reglas y se respetan)
+    if (!beginXN02()) {
+        rulesWriteErrors = rulesWriteErrors + 1;
+    }
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        rules[i].active = false;
+        rules[i].changedAt = millis();
+        if (!ruleDrive(&rules[i], false)) {
+            rulesWriteErrors = rulesWriteErrors + 1;
+        }
+    }
+}
+
+/**
+ * @brief Evalúa todas las reglas con una lectura. Corre en la tarea de
+ * adquisición, así que la salida cambia en el mismo periodo de muestreo.
+ */
+void rulesEvaluate(const SensorReading *reading)
+{
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        Rule *rule = &rules[i];
+        float threshold = rule->threshold;
+        float value = ruleValue(rule, reading);
+        bool want;
+
+        if (isnan(threshold)) {
+            want = false;               // Sin umbral (aún no llega de Blynk)
+        } else if (rule->direction == RULE_ABOVE) {
+            want = rule->active ? value > threshold - rule->hysteresis
+                                : value >= threshold;
+        } else {
+            want = rule->active ? value < threshold + rule->hysteresis
+                                : value <= threshold;
+        }
+        if (want == rule->active) {
+            continue;
+        }
+
+        // Interbloqueo: no se enciende mientras su pareja siga encendida
+        // (ej. el ventilador aún en su tiempo mínimo y el calefactor)
+        if (want && rule->interlock >= 0 && rules[rule->interlock].active) {
+            continue;
+        }
+
+        // Tiempo mínimo en el estado actual
+        unsigned long dwell = rule->active ? rule->minOnMs : rule->minOffMs;
+        if (reading->t_ms - rule->changedAt < dwell) {
+            continue;
+        }
+
+        // Si el módulo no contesta, se reintenta con la siguiente lectura
+        if (!ruleDrive(rule, want)) {
+            rulesWriteErrors = rulesWriteErrors + 1;
+            continue;
+        }
+        rule->active = want;
+        rule->changedAt = reading->t_ms;
+        rule->switches++;
+    }
+}
+
+/**
+ * @brief Cambia el umbral de las reglas que escuchan 'pin' (BLYNK_WRITE).
+ * Un float alineado se escribe de una vez, así que la tarea nunca ve
+ * un umbral a medias.
+ *
+ * Una regla "abajo" (calefactor) con pareja "arriba" (ventilador) debe
+ * quedar al menos una histéresis por debajo: si no, los dos encenderían
+ * a la vez. Su umbral se recorta y se regresa a la app.
+ */
+void rulesSetThreshold(uint8_t pin, float threshold)
+{
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        if (rules[i].thresholdPin == pin) {
+            rules[i].threshold = threshold;
+        }
+    }
 
-    Wire.beginTransmission(4);
-    Wire.write(0x01); // Registro 0x01 = Temperatura
-    Wire.endTransmission();
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        Rule *low = &rules[i];
+        if (low->direction != RULE_BELOW || low->interlock < 0) {
+            continue;
+        }
+        const Rule *high = &rules[low->interlock];
+        float hysteresis = fmaxf(low->hysteresis, high->hysteresis);
+        float limit = high->threshold - hysteresis;
 
-    Wire.requestFrom(4, 2);
+        if (isnan(low->threshold) || isnan(high->threshold) || low->threshold <= limit) {
+            continue;
+        }
+        low->threshold = limit;
+        Serial.print("Umbral de ");
+        Serial.print(low->name);
+        Serial.print(" recortado a ");
+        Serial.print(limit);
+        Serial.print(" (debe quedar ");
+        Serial.print(hysteresis);
+        Serial.print(" abajo del de ");
+        Serial.print(high->name);
+        Serial.println(")");
+        publishStage(low->thresholdPin, limit);
+    }
+}
 
-    temperature_int = ((Wire.read() << 8) | Wire.read());
-    temperature = temperature_int / 100.0f;
+/**
+ * @brief Publica en V10 qué reglas están activas y avisa los cambios
+ * por el monitor serie. Corre en loop(); no toca el bus.
+ */
+void publishRules()
+{
+    static uint32_t lastMask = 0;
+    static uint32_t lastErrors = 0;
+    uint32_t mask = 0;
 
-    return temperature;
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        if (rules[i].active) {
+            mask |= 1UL << i;
+        }
+    }
+    if (rulesWriteErrors != lastErrors) {
+        lastErrors = rulesWriteErrors;
+        Serial.println("Error: un actuador (XN11/XN02) no respondió");
+    }
+    if (mask == lastMask) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < RULE_COUNT; i++) {
+        if ((mask ^ lastMask) & (1UL << i)) {
+            Serial.print("Regla ");
+            Serial.print(rules[i].name);
+            Serial.println(rules[i].active ? ": ENCENDIDA" : ": APAGADA");
+        }
+    }
+    lastMask = mask;
+    publishStage(V10, (int32_t)mask);
 }
 
 
 //##################################################################
-// ### SECCIÓN 10: FUNCIONES DE EVENTOS BLYNK (CALLBACKS) ###
+// ### SECCIÓN 14: ARRANQUE DEL MÓDEM (NO BLOQUEANTE) ###
+//##################################################################
+
+static const XC03BootStep bootSteps[] = {
+    { NULL, xc03BootStepInit },         // Eco apagado, SIM lista
+    { "red", xc03BootStepNetwork },     // Registro en la red (CEREG)
+    { "PDP", xc03BootStepAttach },      // Activación del PDP (CNACT)
+    { "Blynk", xc03BootStepBlynk },     // Conexión con Blynk.Cloud
+};
+
+// Arranque en caliente: cierra los sockets que quedaron abiertos
+static const XC03BootHooks bootHooks = { NULL, NULL, xc03BootCloseSockets };
+
+/**
+ * @brief Prepara el arranque del módem; loop() lo avanza con
+ * xc03BootUpdate(&boot). Lo más largo que se detiene loop() es una
+ * respuesta AT (o el AT+CAOPEN de Blynk).
+ */
+void bootBegin()
+{
+    xc03BootBegin(&boot, &modem, SerialMon, PIN_MODEM_PK, bootSteps,
+                  sizeof(bootSteps) / sizeof(bootSteps[0]), &bootHooks);
+    xc03BootSetApn(&boot, apn, user, pass);
+    xc03BootSetBlynk(&boot, auth, domain);
+    xc03BootSetSockets(&boot, TELEMETRY_UPLINK_BINARY ? 2 : 1);
+}
+
+
+//##################################################################
+// ### SECCIÓN 15: FUNCIONES DE EVENTOS BLYNK (CALLBACKS) ###
 //##################################################################
 
 BLYNK_CONNECTED()
 {
     Serial.println("¡Conectado a Blynk.Cloud!");
-    Blynk.syncVirtual(V0, V3);
+    Blynk.syncVirtual(V0, V3, V11);
+
+    if (!clockSynced) {
+        syncClock();
+    }
+
+    // Sube lo que se juntó mientras no había conexión
+    Serial.print("Muestras pendientes: ");
+    Serial.println(telemetryCount());
+    requestDrain();
 }
 
 BLYNK_DISCONNECTED()
@@ -275,13 +1372,40 @@ BLYNK_WRITE(V0)
 BLYNK_WRITE(V3)
 {
     double treshold = param.asDouble();
+    SensorReading reading;
     
     Serial.print("Nuevo umbral recibido: ");
     Serial.println(treshold);
 
-    if ( currentTemperature < treshold ){
+    // Las reglas locales (ventilador, indicador) lo usan desde la
+    // siguiente lectura; ya no hace falta la nube para decidir
+    rulesSetThreshold(V3, (float)treshold);
+
+    // La foto se copia sin esperar a la tarea de adquisición. Se compara
+    // el promedio de los últimos segundos, no una lectura suelta.
+    if ( !readSensorSnapshot(&reading) ){
+        Serial.println( "-> Aún no hay lectura del XN04" );
+        return;
+    }
+
+    if ( reading.temperatureAvg < treshold ){
         Serial.println( "-> Temperatura actual MENOR al umbral" );
     } else {
         Serial.println( "-> Temperatura actual MAYOR o IGUAL al umbral" );
     }
-}
\ No newline at end of file
+}
+
+// Respuesta al Blynk.syncVirtual(V9) de drainTelemetry()
+BLYNK_WRITE(V9)
+{
+    telemetryAck();
+}
+
+BLYNK_WRITE(V11)
+{
+    double treshold = param.asDouble();
+
+    Serial.print("Nuevo umbral bajo recibido: ");
+    Serial.println(treshold);
+    rulesSetThreshold(V11, (float)treshold);
+}